@@ -1,25 +1,27 @@
 #include "buffer_sync.h"
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <vector>
 
 
 
-// Collect all dirty leaf fields
-void collect_dirty_fields(const std::vector<DarttField*> &leaf_list, std::vector<DarttField*>& out)
+// Collect all dirty leaf fields that are not waiting out a retry backoff
+void collect_dirty_fields(const std::vector<DarttField*> &leaf_list, std::vector<DarttField*>& out, uint64_t now_us)
 {
 	out.clear();
 	for(size_t i = 0; i < leaf_list.size(); i++)
 	{
 		DarttField * leaf = leaf_list[i];
-		if (leaf->dirty)
+		if (leaf->dirty && leaf->next_write_us <= now_us)
 		{
 			out.push_back(leaf);
 		}
 	}
 }
 
-// Collect all subscribed leaf fields
+// Collect all subscribed leaf fields. An unsubscribed leaf drops any pending read request,
+// so it does not fire later when the leaf is subscribed again.
 void collect_subscribed_fields(const std::vector<DarttField*> &leaf_list, std::vector<DarttField*>& out)
 {
 	out.clear();
@@ -30,6 +32,10 @@ void collect_subscribed_fields(const std::vector<DarttField*> &leaf_list, std::v
 		{
 			out.push_back(leaf);
 		}
+		else
+		{
+			leaf->read_requested = false;
+		}
 	}
 }
 
@@ -101,6 +107,249 @@ std::vector<MemoryRegion> build_read_queue(DarttConfig& config)
     return coalesce_fields(config.subscribed_list);
 }
 
+/*
+Rate-scheduled read plan. Fields with a target rate become due once their deadline
+passes, rate 0 fields are due every cycle, and on-demand fields only when requested.
+Due fields are taken earliest deadline first until the byte budget is spent, then
+re-sorted by offset and coalesced like any other read queue.
+*/
+std::vector<MemoryRegion> build_scheduled_read_queue(DarttConfig& config, uint64_t now_us, uint32_t budget_bytes)
+{
+	struct DueField
+	{
+		uint64_t deadline;
+		DarttField* field;
+	};
+	std::vector<DueField> due;
+	for (DarttField* f : config.subscribed_list)
+	{
+		if (f->poll_rate_hz < 0.f)
+		{
+			if (f->read_requested)
+			{
+				due.push_back({0, f});	//explicit requests go ahead of everything
+			}
+		}
+		else if (f->poll_rate_hz == 0.f)
+		{
+			due.push_back({now_us, f});
+		}
+		else if (f->next_read_us <= now_us)
+		{
+			due.push_back({f->next_read_us, f});
+		}
+	}
+
+	std::stable_sort(due.begin(), due.end(), [](const DueField& a, const DueField& b) {
+		return a.deadline < b.deadline;
+	});
+
+	std::vector<DarttField*> batch;
+	uint32_t batch_bytes = 0;
+	for (const DueField& d : due)
+	{
+		if (budget_bytes > 0 && !batch.empty() && batch_bytes + d.field->nbytes > budget_bytes)
+		{
+			break;
+		}
+		batch.push_back(d.field);
+		batch_bytes += d.field->nbytes;
+	}
+
+	std::stable_sort(batch.begin(), batch.end(), [](const DarttField* a, const DarttField* b) {
+		return a->byte_offset < b->byte_offset;
+	});
+	return coalesce_fields(batch);
+}
+
+void update_read_schedule(const MemoryRegion& region, uint64_t now_us)
+{
+	for (DarttField* field : region.fields)
+	{
+		if (field->last_read_us > 0 && now_us > field->last_read_us)
+		{
+			float inst_hz = 1e6f / (float)(now_us - field->last_read_us);
+			if (field->achieved_hz == 0.f)
+			{
+				field->achieved_hz = inst_hz;
+			}
+			else
+			{
+				field->achieved_hz += 0.1f * (inst_hz - field->achieved_hz);	//light smoothing, settles in ~20 reads
+			}
+		}
+		field->last_read_us = now_us;
+		field->read_requested = false;
+
+		if (field->poll_rate_hz > 0.f)
+		{
+			field->next_read_us += (uint64_t)(1e6f / field->poll_rate_hz);
+			if (field->next_read_us < now_us)
+			{
+				field->next_read_us = now_us;	//fell behind; don't burst to catch up
+			}
+		}
+	}
+}
+
+double field_numeric_value(const DarttField& field)
+{
+	switch (field.type)
+	{
+		case FieldType::FLOAT:  return (double)field.value.f32;
+		case FieldType::DOUBLE: return field.value.f64;
+		case FieldType::INT8:   return (double)field.value.i8;
+		case FieldType::UINT8:  return (double)field.value.u8;
+		case FieldType::INT16:  return (double)field.value.i16;
+		case FieldType::UINT16: return (double)field.value.u16;
+		case FieldType::INT32:  return (double)field.value.i32;
+		case FieldType::UINT32: return (double)field.value.u32;
+		case FieldType::INT64:  return (double)field.value.i64;
+		case FieldType::UINT64: return (double)field.value.u64;
+		case FieldType::ENUM:   return (double)get_enum_value(field);
+		default:                return 0.0;
+	}
+}
+
+/*
+Welford's update into the current half-window accumulator. When it has been filling for
+half the window the other one is cleared and takes over, so the pair always holds between
+half and all of the last window; a leaf not read for a whole window starts over.
+*/
+void update_field_stats(const MemoryRegion& region, uint64_t now_us)
+{
+	for (DarttField* field : region.fields)
+	{
+		DarttFieldStats& st = field->stats;
+		uint64_t raw = 0;
+		std::memcpy(&raw, &field->value, std::min<size_t>(field->nbytes, sizeof(raw)));
+		if (st.last_change_us == 0 || raw != st.last_raw)
+		{
+			st.last_change_us = now_us;
+			st.last_raw = raw;
+		}
+
+		uint64_t age = now_us - st.half_start_us;
+		if (st.half_start_us == 0 || age >= FIELD_STATS_WINDOW_US)
+		{
+			st.count[0] = st.count[1] = 0;
+			st.current = 0;
+			st.half_start_us = now_us;
+		}
+		else if (age >= FIELD_STATS_WINDOW_US / 2)
+		{
+			st.current ^= 1;
+			st.count[st.current] = 0;
+			st.half_start_us = now_us;
+		}
+
+		double v = field_numeric_value(*field);
+		if (!std::isfinite(v))
+		{
+			continue;	//a NaN would poison the mean; the change above still counts
+		}
+		int c = st.current;
+		if (st.count[c] == 0)
+		{
+			st.mean[c] = 0.0;
+			st.m2[c] = 0.0;
+			st.min[c] = st.max[c] = (float)v;
+		}
+		st.count[c]++;
+		double delta = v - st.mean[c];
+		st.mean[c] += delta / (double)st.count[c];
+		st.m2[c] += delta * (v - st.mean[c]);
+		st.min[c] = std::min(st.min[c], (float)v);
+		st.max[c] = std::max(st.max[c], (float)v);
+	}
+}
+
+bool field_stats_summary(const DarttField& field, uint64_t now_us, FieldStatsSummary& out)
+{
+	const DarttFieldStats& st = field.stats;
+	if (st.half_start_us == 0 || now_us - st.half_start_us >= FIELD_STATS_WINDOW_US)
+	{
+		return false;
+	}
+	int a = st.current;
+	int b = a ^ 1;
+	uint32_t n = st.count[a] + st.count[b];
+	if (n == 0)
+	{
+		return false;
+	}
+	out.count = n;
+	if (st.count[b] == 0)
+	{
+		out.min = st.min[a];
+		out.max = st.max[a];
+		out.mean = st.mean[a];
+		out.stddev = std::sqrt(st.m2[a] / (double)n);
+		return true;
+	}
+	if (st.count[a] == 0)
+	{
+		out.min = st.min[b];
+		out.max = st.max[b];
+		out.mean = st.mean[b];
+		out.stddev = std::sqrt(st.m2[b] / (double)n);
+		return true;
+	}
+	//Chan et al.'s pairwise merge of the two accumulators
+	double na = (double)st.count[a];
+	double nb = (double)st.count[b];
+	double delta = st.mean[b] - st.mean[a];
+	out.min = std::min(st.min[a], st.min[b]);
+	out.max = std::max(st.max[a], st.max[b]);
+	out.mean = st.mean[a] + delta * nb / (double)n;
+	out.stddev = std::sqrt((st.m2[a] + st.m2[b] + delta * delta * na * nb / (double)n) / (double)n);
+	return true;
+}
+
+/*
+Bitfield access. The target is little-endian, so a field's byte span is loaded LSB first
+into a u64 and its bits picked out with the precomputed mask and shift. Signed types are
+sign-extended to 64 bits, which leaves the narrower union members correct as well.
+*/
+static uint64_t load_span(const uint8_t* p, uint32_t nbytes)
+{
+	uint64_t v = 0;
+	for (uint32_t i = nbytes; i > 0; i--)
+	{
+		v = (v << 8) | p[i - 1];
+	}
+	return v;
+}
+
+static void store_span(uint8_t* p, uint32_t nbytes, uint64_t v)
+{
+	for (uint32_t i = 0; i < nbytes; i++)
+	{
+		p[i] = (uint8_t)(v >> (8 * i));
+	}
+}
+
+static bool is_signed_field(const DarttField* field)
+{
+	FieldType type = field->type;
+	if (type == FieldType::ENUM)
+	{
+		return !field->enum_info || field->enum_info->is_signed;
+	}
+	return type == FieldType::INT8 || type == FieldType::INT16 || type == FieldType::INT32 ||
+		   type == FieldType::INT64;
+}
+
+static void span_to_bitfield_value(DarttField* field, uint64_t span)
+{
+	uint64_t raw = (span & field->bit_mask) >> field->bit_shift;
+	if (is_signed_field(field) && field->bit_size < 64 && ((raw >> (field->bit_size - 1)) & 1))
+	{
+		raw |= ~0ull << field->bit_size;
+	}
+	field->value.u64 = raw;
+}
+
 bool sync_fields_to_ctl_buf(DarttConfig& config, const MemoryRegion& region) 
 {
     if (!config.ctl_buf.buf) 
@@ -115,6 +364,14 @@ bool sync_fields_to_ctl_buf(DarttConfig& config, const MemoryRegion& region)
 		{
 			return false;
 		}
+		if (field->bit_size > 0)
+		{
+			//read-modify-write so the other bits sharing these bytes keep their ctl_buf values
+			uint64_t span = load_span(dst, field->nbytes);
+			span = (span & ~field->bit_mask) | ((field->value.u64 << field->bit_shift) & field->bit_mask);
+			store_span(dst, field->nbytes, span);
+			continue;
+		}
 		std::memcpy(dst, (unsigned char *)(&field->value.u8), field->nbytes);
     }
 	return true;
@@ -128,20 +385,232 @@ bool sync_periph_buf_to_fields(DarttConfig& config, const MemoryRegion& region)
 
     for (DarttField* field : region.fields) 
 	{
+		if (field->dirty)
+		{
+			continue;	//an edit still waiting for its write wins over the peripheral's old value
+		}
         const uint8_t* src = config.periph_buf.buf + field->byte_offset;
 		if(field->byte_offset + field->nbytes > config.periph_buf.size)
 		{
 			return false;
 		}
+		if (field->bit_size > 0)
+		{
+			uint64_t span = load_span(src, field->nbytes);
+			span_to_bitfield_value(field, span);
+
+			//mirror the bits into ctl_buf too, so a later write of a neighbouring bitfield
+			//in the same bytes carries the peripheral's value for these bits
+			if (config.ctl_buf.buf && field->byte_offset + field->nbytes <= config.ctl_buf.size)
+			{
+				uint8_t* ctl = config.ctl_buf.buf + field->byte_offset;
+				uint64_t ctl_span = load_span(ctl, field->nbytes);
+				ctl_span = (ctl_span & ~field->bit_mask) | (span & field->bit_mask);
+				store_span(ctl, field->nbytes, ctl_span);
+			}
+			continue;
+		}
 		std::memcpy((unsigned char *)(&field->value.u8), src, field->nbytes);
     }
 	return true;
 }
 
+int count_write_mismatches(const DarttConfig& config, const MemoryRegion& region)
+{
+	int mismatches = 0;
+	for (const DarttField* field : region.fields)
+	{
+		if (field->byte_offset + field->nbytes > config.ctl_buf.size ||
+			field->byte_offset + field->nbytes > config.periph_buf.size)
+		{
+			mismatches++;
+			continue;
+		}
+		if (field->bit_size > 0)
+		{
+			uint64_t want = load_span(config.ctl_buf.buf + field->byte_offset, field->nbytes);
+			uint64_t got = load_span(config.periph_buf.buf + field->byte_offset, field->nbytes);
+			if ((want ^ got) & field->bit_mask)
+			{
+				mismatches++;
+			}
+		}
+		else if (std::memcmp(config.ctl_buf.buf + field->byte_offset,
+						config.periph_buf.buf + field->byte_offset, field->nbytes) != 0)
+		{
+			mismatches++;
+		}
+	}
+	return mismatches;
+}
+
+/*
+Blobs are compared 8 bytes at a time in blocks of four words whose XORs are OR'd together,
+a branch-free loop the compiler vectorises, so an unchanged block costs a few instructions;
+only blocks that differ are looked at word by word.
+*/
+bool diff_chunks(const uint8_t* a, const uint8_t* b, size_t size, std::vector<uint64_t>& changed)
+{
+	size_t nchunks = (size + 7) / 8;
+	changed.assign((nchunks + 63) / 64, 0);
+	bool any = false;
+
+	size_t full = size / 8;
+	size_t c = 0;
+	for (; c + 4 <= full; c += 4)
+	{
+		uint64_t wa[4];
+		uint64_t wb[4];
+		std::memcpy(wa, a + c * 8, sizeof(wa));
+		std::memcpy(wb, b + c * 8, sizeof(wb));
+		uint64_t diff = (wa[0] ^ wb[0]) | (wa[1] ^ wb[1]) | (wa[2] ^ wb[2]) | (wa[3] ^ wb[3]);
+		if (diff == 0)
+		{
+			continue;
+		}
+		for (size_t k = 0; k < 4; k++)
+		{
+			if (wa[k] != wb[k])
+			{
+				changed[(c + k) >> 6] |= 1ull << ((c + k) & 63);
+			}
+		}
+		any = true;
+	}
+	for (; c < nchunks; c++)
+	{
+		size_t n = std::min<size_t>(8, size - c * 8);
+		if (std::memcmp(a + c * 8, b + c * 8, n) != 0)
+		{
+			changed[c >> 6] |= 1ull << (c & 63);
+			any = true;
+		}
+	}
+	return any;
+}
+
+bool chunks_changed(const std::vector<uint64_t>& changed, uint32_t byte_offset, uint32_t nbytes)
+{
+	if (nbytes == 0)
+	{
+		return false;
+	}
+	size_t last = std::min<size_t>(((size_t)byte_offset + nbytes - 1) / 8, changed.size() * 64 - 1);
+	for (size_t k = byte_offset / 8; k <= last; k++)
+	{
+		if (changed[k >> 6] & (1ull << (k & 63)))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool leaf_bytes_differ(const DarttField& field, const uint8_t* a, const uint8_t* b)
+{
+	if (field.bit_size > 0)
+	{
+		uint64_t sa = load_span(a + field.byte_offset, field.nbytes);
+		uint64_t sb = load_span(b + field.byte_offset, field.nbytes);
+		return ((sa ^ sb) & field.bit_mask) != 0;
+	}
+	return std::memcmp(a + field.byte_offset, b + field.byte_offset, field.nbytes) != 0;
+}
+
+void copy_leaf_bytes(const DarttField& field, const uint8_t* src, uint8_t* dst)
+{
+	if (field.bit_size > 0)
+	{
+		uint64_t from = load_span(src + field.byte_offset, field.nbytes);
+		uint64_t to = load_span(dst + field.byte_offset, field.nbytes);
+		store_span(dst + field.byte_offset, field.nbytes, (to & ~field.bit_mask) | (from & field.bit_mask));
+		return;
+	}
+	std::memcpy(dst + field.byte_offset, src + field.byte_offset, field.nbytes);
+}
+
+void decode_field_value(DarttField& field, const uint8_t* blob)
+{
+	if (field.bit_size > 0)
+	{
+		span_to_bitfield_value(&field, load_span(blob + field.byte_offset, field.nbytes));
+		return;
+	}
+	std::memcpy((unsigned char *)(&field.value.u8), blob + field.byte_offset, field.nbytes);
+}
+
+// Leaves are checked only if one of their chunks changed; the changed chunks are then copied over
+void diff_periph_buf(DarttConfig& config, uint64_t now_ms)
+{
+	const uint8_t* cur = config.periph_buf.buf;
+	size_t size = config.periph_buf.size;
+	if (!cur)
+	{
+		return;
+	}
+	std::vector<uint8_t>& seen = config.periph_seen;
+	if (seen.size() != size)
+	{
+		seen.assign(cur, cur + size);	//first look: nothing has changed yet
+		return;
+	}
+	std::vector<uint64_t>& changed = config.changed_chunks;
+	if (!diff_chunks(cur, seen.data(), size, changed))
+	{
+		return;
+	}
+
+	for (DarttField* field : config.subscribed_list)
+	{
+		if (field->dirty || field->byte_offset + field->nbytes > size)
+		{
+			continue;	//a dirty field shows the edit, not the read
+		}
+		if (chunks_changed(changed, field->byte_offset, field->nbytes) && leaf_bytes_differ(*field, cur, seen.data()))
+		{
+			field->changed_ms = now_ms;
+		}
+	}
+
+	size_t nchunks = (size + 7) / 8;
+	for (size_t c = 0; c < nchunks; c++)
+	{
+		if (changed[c >> 6] & (1ull << (c & 63)))
+		{
+			size_t n = std::min<size_t>(8, size - c * 8);
+			std::memcpy(seen.data() + c * 8, cur + c * 8, n);
+		}
+	}
+}
+
 void clear_dirty_flags(const MemoryRegion& region)
 {
     for (DarttField* field : region.fields) 
 	{
         field->dirty = false;
+        field->write_failures = 0;
+        field->write_failed = false;
+        field->next_write_us = 0;
     }
 }
+
+uint32_t note_write_failure(const MemoryRegion& region, uint64_t now_us)
+{
+	uint32_t dropped = 0;
+	for (DarttField* field : region.fields)
+	{
+		field->write_failures++;
+		if (field->write_failures >= WRITE_RETRY_LIMIT)
+		{
+			//give the field back to the reads, which skip it while it is dirty
+			field->dirty = false;
+			field->write_failed = true;
+			field->write_failures = 0;
+			field->next_write_us = 0;
+			dropped++;
+			continue;
+		}
+		field->next_write_us = now_us + (WRITE_RETRY_BACKOFF_US << (field->write_failures - 1));
+	}
+	return dropped;
+}
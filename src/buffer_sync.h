@@ -4,6 +4,11 @@
 #include "config.h"
 #include <vector>
 
+/* A failed edit is sent again after WRITE_RETRY_BACKOFF_US, doubling each time, and dropped
+   after WRITE_RETRY_LIMIT failures so reads take the field over again */
+#define WRITE_RETRY_LIMIT 5
+#define WRITE_RETRY_BACKOFF_US 100000ull
+
 struct MemoryRegion {
     uint32_t start_offset;              // Byte offset from buffer base
     uint32_t length;                    // Total bytes (32-bit aligned)
@@ -12,19 +17,73 @@ struct MemoryRegion {
 
 
 
-// Collect subscribed/dirty fields into output vectors
+// Collect subscribed/dirty fields into output vectors. Only subscribed leaves keep a read request,
+// and dirty leaves still backing off from a failed write (next_write_us > now_us) are left out.
 void collect_subscribed_fields(const std::vector<DarttField*> &leaf_list, std::vector<DarttField*>& out);
-void collect_dirty_fields(const std::vector<DarttField*> &leaf_list, std::vector<DarttField*>& out);
+void collect_dirty_fields(const std::vector<DarttField*> &leaf_list, std::vector<DarttField*>& out, uint64_t now_us);
 
 // Build coalesced queues
 std::vector<MemoryRegion> build_write_queue(DarttConfig& config);
 std::vector<MemoryRegion> build_read_queue(DarttConfig& config);
 
+// Build the read queue from subscribed fields that are due at now_us, earliest deadline first.
+// budget_bytes caps the field bytes taken per cycle (0 = no cap); the most overdue fields win.
+// A cycle is one BusManager::poll, which the app runs once per frame, so rates above the
+// frame rate come out at the frame rate.
+std::vector<MemoryRegion> build_scheduled_read_queue(DarttConfig& config, uint64_t now_us, uint32_t budget_bytes);
+
+// Record a successful read of every field in region and schedule their next deadlines
+void update_read_schedule(const MemoryRegion& region, uint64_t now_us);
+
+// Window covered by a leaf's read statistics (DarttFieldStats)
+#define FIELD_STATS_WINDOW_US 5000000ull
+
+// Summary of a leaf's statistics over the window, in native units
+struct FieldStatsSummary
+{
+    uint32_t count;
+    float min;
+    float max;
+    double mean;
+    double stddev;
+};
+
+// A leaf's value as a number (enums by their value), 0 for non-numeric types
+double field_numeric_value(const DarttField& field);
+
+// Add the values just read for region's fields to their statistics, noting changes
+void update_field_stats(const MemoryRegion& region, uint64_t now_us);
+
+// Combine a leaf's accumulators; false if it has no reads in the window
+bool field_stats_summary(const DarttField& field, uint64_t now_us, FieldStatsSummary& out);
+
+// Compare two blobs of size bytes: bit k of changed is set if bytes [8k, 8k+8) differ. Returns true if any do.
+bool diff_chunks(const uint8_t* a, const uint8_t* b, size_t size, std::vector<uint64_t>& changed);
+
+// Whether any chunk overlapping [byte_offset, byte_offset + nbytes) is set in changed
+bool chunks_changed(const std::vector<uint64_t>& changed, uint32_t byte_offset, uint32_t nbytes);
+
+// Per-leaf access to whole blobs laid out like periph_buf. Bitfields use only their own bits.
+bool leaf_bytes_differ(const DarttField& field, const uint8_t* a, const uint8_t* b);
+void copy_leaf_bytes(const DarttField& field, const uint8_t* src, uint8_t* dst);
+void decode_field_value(DarttField& field, const uint8_t* blob);
+
+// Compare periph_buf with its copy from the previous call and stamp changed_ms = now_ms on
+// the subscribed leaves whose bytes differ. Call once per frame, after the bus poll.
+void diff_periph_buf(DarttConfig& config, uint64_t now_ms);
+
 // Sync values between DarttField.value and flat buffers
 bool sync_fields_to_ctl_buf(DarttConfig& config, const MemoryRegion& region);
 bool sync_periph_buf_to_fields(DarttConfig& config, const MemoryRegion& region);
 
+// Compare a written region's fields in ctl_buf against the read-back in periph_buf. Returns fields that differ.
+int count_write_mismatches(const DarttConfig& config, const MemoryRegion& region);
+
 // Clear dirty flags after successful write
 void clear_dirty_flags(const MemoryRegion& region);
 
+// Count a failed write against each field in region and schedule its retry. Fields that
+// reach WRITE_RETRY_LIMIT stop being dirty and get write_failed. Returns how many did.
+uint32_t note_write_failure(const MemoryRegion& region, uint64_t now_us);
+
 #endif // DARTT_BUFFER_SYNC_H
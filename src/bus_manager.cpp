@@ -0,0 +1,415 @@
+#include "bus_manager.h"
+#include "dartt_init.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+BusDevice::BusDevice()
+	: config()
+	, ds()
+	, config_json_path()
+	, elf_path()
+	, elf_symbols()
+	, elf_watch()
+	, autosave()
+	, snapshots()
+	, read_plan()
+	, read_errors(0)
+	, write_errors(0)
+	, writes_ok(0)
+	, write_bytes(0)
+	, verify_errors(0)
+	, writes_deferred(0)
+	, writes_dropped(0)
+	, write_failing(false)
+	, last_write_rc(0)
+	, write_tokens(0.0)
+	, last_refill_us(0)
+{
+	init_ds(&ds);
+}
+
+void BusDevice::attach_buffers()
+{
+	ds.ctl_base.buf = config.ctl_buf.buf;
+	ds.ctl_base.size = config.ctl_buf.size;
+	ds.periph_base.buf = config.periph_buf.buf;
+	ds.periph_base.size = config.periph_buf.size;
+}
+
+void BusDevice::detach_buffers()
+{
+	ds.ctl_base.buf = nullptr;
+	ds.periph_base.buf = nullptr;
+}
+
+HotReloadStats BusDevice::replace_config(DarttConfig& fresh, std::vector<Line>& lines)
+{
+	config_save_wait();
+	detach_buffers();
+	bool reload = config.nbytes > 0;
+	HotReloadStats stats = carry_over_session(config, fresh, lines);
+	config = std::move(fresh);
+	if (reload)
+	{
+		autosave_mark_changed(autosave);	//the carried-over session is not in the file yet
+	}
+	else
+	{
+		autosave_reset(autosave);
+	}
+	if (config.nbytes > 0)
+	{
+		config.allocate_buffers();
+		attach_buffers();
+	}
+	read_plan.clear();
+	return stats;
+}
+
+BusManager::BusManager()
+	: devices()
+	, active(0)
+	, read_budget_bytes(0)
+	, write_budget_bytes_per_s(0)
+	, verify_writes(false)
+{
+}
+
+BusDevice* BusManager::add_device()
+{
+	devices.push_back(std::make_unique<BusDevice>());
+	BusDevice* dev = devices.back().get();
+	if (devices.size() > 1)
+	{
+		//new drops on a multi-drop bus are usually the next node over
+		dev->ds.address = (unsigned char)(devices[devices.size() - 2]->ds.address + 1);
+	}
+	return dev;
+}
+
+void BusManager::remove_device(int idx)
+{
+	if (idx < 0 || idx >= (int)devices.size() || devices.size() <= 1)
+	{
+		return;		//always keep one device for the Live Expressions view
+	}
+	config_save_wait();		//a save may still be reading its config
+	devices.erase(devices.begin() + idx);
+	if (active >= (int)devices.size())
+	{
+		active = (int)devices.size() - 1;
+	}
+}
+
+BusDevice& BusManager::active_device()
+{
+	if (devices.empty())
+	{
+		add_device();
+	}
+	if (active < 0 || active >= (int)devices.size())
+	{
+		active = 0;
+	}
+	return *devices[active];
+}
+
+DarttField* BusManager::find_field(const plot_source_t& source)
+{
+	if (source.kind != SOURCE_FIELD)
+	{
+		return nullptr;
+	}
+	for (size_t i = 0; i < devices.size(); i++)
+	{
+		if (devices[i]->config.instance == source.config)
+		{
+			return config_field(devices[i]->config, source.field);
+		}
+	}
+	return nullptr;
+}
+
+std::vector<PlotSourceDevice> BusManager::other_devices(const BusDevice& dev)
+{
+	std::vector<PlotSourceDevice> out;
+	for (size_t i = 0; i < devices.size(); i++)
+	{
+		if (devices[i].get() != &dev && devices[i]->config.nbytes > 0)
+		{
+			out.push_back({devices[i]->ds.address, &devices[i]->config});
+		}
+	}
+	return out;
+}
+
+/*
+Token bucket refilled at write_budget_bytes_per_s and holding up to 100ms of budget.
+A region may go out whenever the bucket is positive and is charged in full, so a region
+larger than the bucket still gets sent and the long-run rate stays on budget.
+*/
+bool BusManager::take_write_budget(BusDevice& dev, const MemoryRegion& region, uint64_t now_us)
+{
+	if (write_budget_bytes_per_s == 0)
+	{
+		return true;
+	}
+	double burst = std::max((double)write_budget_bytes_per_s * 0.1, 1.0);
+	if (dev.last_refill_us != 0 && now_us > dev.last_refill_us)
+	{
+		dev.write_tokens += (double)write_budget_bytes_per_s * (double)(now_us - dev.last_refill_us) * 1e-6;
+	}
+	else if (dev.last_refill_us == 0)
+	{
+		dev.write_tokens = burst;
+	}
+	dev.write_tokens = std::min(dev.write_tokens, burst);
+	dev.last_refill_us = now_us;
+
+	if (dev.write_tokens <= 0.0)
+	{
+		return false;
+	}
+	dev.write_tokens -= (double)region.length;
+	return true;
+}
+
+void BusManager::write_region(BusDevice& dev, const MemoryRegion& region, uint64_t now_us)
+{
+	DarttConfig& config = dev.config;
+	sync_fields_to_ctl_buf(config, region);
+
+	dartt_mem_t slice = {
+		.buf = config.ctl_buf.buf + region.start_offset,
+		.size = region.length
+	};
+
+	int rc = dartt_write_multi(&slice, &dev.ds);
+	if (rc != DARTT_PROTOCOL_SUCCESS)
+	{
+		dev.write_errors++;
+		dev.writes_dropped += note_write_failure(region, now_us);
+		if (!dev.write_failing)
+		{
+			//once per run of failures; the Bus window and the rows show the rest
+			fprintf(stderr, "write error %d (addr=%u), retrying\n", rc, dev.ds.address);
+		}
+		dev.write_failing = true;
+		dev.last_write_rc = rc;
+		return;
+	}
+	clear_dirty_flags(region);
+	dev.write_failing = false;
+	dev.writes_ok++;
+	dev.write_bytes += region.length;
+
+	if (verify_writes)
+	{
+		rc = dartt_read_multi(&slice, &dev.ds);		//lands in periph_buf at the same offset
+		if (rc != DARTT_PROTOCOL_SUCCESS)
+		{
+			dev.read_errors++;
+			return;
+		}
+		int mismatches = count_write_mismatches(config, region);
+		if (mismatches > 0)
+		{
+			dev.verify_errors += (uint32_t)mismatches;
+			printf("write verify: %d field(s) differ (addr=%u offset=%u len=%u)\n",
+				mismatches, dev.ds.address, region.start_offset, region.length);
+		}
+		sync_periph_buf_to_fields(config, region);
+	}
+}
+
+void BusManager::poll()
+{
+	uint64_t now_us = transport_now_us();
+
+	// WRITE: Send dirty fields to each device
+	for (size_t d = 0; d < devices.size(); d++)
+	{
+		BusDevice& dev = *devices[d];
+		DarttConfig& config = dev.config;
+
+		// Rebuild subscribed and dirty lists before read/write operations
+		collect_subscribed_fields(config.leaf_list, config.subscribed_list);
+		collect_dirty_fields(config.leaf_list, config.dirty_list, now_us);
+		dev.read_plan.clear();
+		if (!config.ctl_buf.buf || !config.periph_buf.buf)
+		{
+			continue;
+		}
+
+		std::vector<MemoryRegion> write_queue = build_write_queue(config);
+		for (MemoryRegion& region : write_queue)
+		{
+			if (!take_write_budget(dev, region, now_us))
+			{
+				dev.writes_deferred++;	//fields stay dirty and go out with their latest value next cycle
+				break;
+			}
+			write_region(dev, region, now_us);
+		}
+		dev.read_plan = build_scheduled_read_queue(config, now_us, read_budget_bytes);
+	}
+
+	// READ: Interleave subscribed regions across devices, one transaction per device per turn
+	bool any_read = true;
+	for (size_t turn = 0; any_read; turn++)
+	{
+		any_read = false;
+		for (size_t d = 0; d < devices.size(); d++)
+		{
+			BusDevice& dev = *devices[d];
+			if (turn >= dev.read_plan.size())
+			{
+				continue;
+			}
+			any_read = true;
+			const MemoryRegion& region = dev.read_plan[turn];
+			dartt_mem_t slice =
+			{
+				.buf = dev.config.ctl_buf.buf + region.start_offset,
+				.size = region.length,
+			};
+
+			int rc = dartt_read_multi(&slice, &dev.ds);
+			if (rc == DARTT_PROTOCOL_SUCCESS)
+			{
+				sync_periph_buf_to_fields(dev.config, region);
+				uint64_t read_us = transport_now_us();
+				update_read_schedule(region, read_us);
+				update_field_stats(region, read_us);
+			}
+			else
+			{
+				dev.read_errors++;
+				printf("read error %d (addr=%u)\n", rc, dev.ds.address);
+			}
+		}
+	}
+}
+
+bool BusManager::read_all(BusDevice& dev)
+{
+	DarttConfig& config = dev.config;
+	if (!config.ctl_buf.buf || !config.periph_buf.buf)
+	{
+		return false;
+	}
+	dartt_mem_t all =
+	{
+		.buf = config.ctl_buf.buf,
+		.size = config.ctl_buf.size,
+	};
+	int rc = dartt_read_multi(&all, &dev.ds);		//split into packets by the library
+	if (rc != DARTT_PROTOCOL_SUCCESS)
+	{
+		dev.read_errors++;
+		printf("read error %d (addr=%u)\n", rc, dev.ds.address);
+		return false;
+	}
+	MemoryRegion region = { 0, (uint32_t)config.periph_buf.size, config.leaf_list };
+	sync_periph_buf_to_fields(config, region);
+	return true;
+}
+
+bool BusManager::take_snapshot(BusDevice& dev, const char* name, DarttSnapshot& out)
+{
+	if (!read_all(dev))
+	{
+		return false;
+	}
+	snapshot_capture(dev.config, name, out);
+	return true;
+}
+
+bool BusManager::restore_snapshot(BusDevice& dev, const DarttSnapshot& snap, const std::vector<SnapshotChange>& changes,
+	SnapshotRestoreStats* stats)
+{
+	DarttConfig& config = dev.config;
+	SnapshotRestoreStats st = { 0, 0, 0 };
+	if (!snapshot_matches(snap, config))
+	{
+		printf("snapshot \"%s\" was taken with a different layout\n", snap.name.c_str());
+		return false;
+	}
+	if (!read_all(dev))
+	{
+		return false;
+	}
+
+	std::vector<uint8_t> image;
+	std::vector<MemoryRegion> regions = build_restore_regions(config, snap, changes, config.periph_buf.buf, image);
+	for (const SnapshotChange& c : changes)
+	{
+		DarttField* leaf = c.selected ? config_field(config, c.id) : nullptr;
+		if (leaf && leaf_bytes_differ(*leaf, snap.bytes.data(), config.periph_buf.buf))
+		{
+			st.fields++;
+		}
+	}
+
+	bool ok = true;
+	for (const MemoryRegion& region : regions)
+	{
+		std::memcpy(config.ctl_buf.buf + region.start_offset, image.data() + region.start_offset, region.length);
+		dartt_mem_t slice =
+		{
+			.buf = config.ctl_buf.buf + region.start_offset,
+			.size = region.length,
+		};
+		int rc = dartt_write_multi(&slice, &dev.ds);
+		if (rc != DARTT_PROTOCOL_SUCCESS)
+		{
+			dev.write_errors++;
+			printf("write error %d (addr=%u)\n", rc, dev.ds.address);
+			ok = false;
+			break;
+		}
+		dev.writes_ok++;
+		dev.write_bytes += region.length;
+		st.regions++;
+		st.bytes += region.length;
+
+		if (!verify_writes)
+		{
+			//the device took it, so the shadow copy can too
+			std::memcpy(config.periph_buf.buf + region.start_offset, image.data() + region.start_offset, region.length);
+			continue;
+		}
+		rc = dartt_read_multi(&slice, &dev.ds);		//lands in periph_buf at the same offset
+		if (rc != DARTT_PROTOCOL_SUCCESS)
+		{
+			dev.read_errors++;
+		}
+		else if (std::memcmp(config.periph_buf.buf + region.start_offset, image.data() + region.start_offset, region.length) != 0)
+		{
+			dev.verify_errors++;
+			printf("write verify: restored region differs (addr=%u offset=%u len=%u)\n",
+				dev.ds.address, region.start_offset, region.length);
+		}
+	}
+
+	// The restored values replace any edit still waiting to go out
+	for (const SnapshotChange& c : changes)
+	{
+		DarttField* leaf = c.selected ? config_field(config, c.id) : nullptr;
+		if (leaf)
+		{
+			leaf->dirty = false;
+		}
+	}
+	MemoryRegion all = { 0, (uint32_t)config.periph_buf.size, config.leaf_list };
+	sync_periph_buf_to_fields(config, all);
+
+	printf("restored %u field(s) from \"%s\" in %u write(s), %u bytes (addr=%u)\n",
+		st.fields, snap.name.c_str(), st.regions, st.bytes, dev.ds.address);
+	if (stats)
+	{
+		*stats = st;
+	}
+	return ok;
+}
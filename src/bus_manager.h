@@ -0,0 +1,114 @@
+#ifndef DARTT_BUS_MANAGER_H
+#define DARTT_BUS_MANAGER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "buffer_sync.h"
+#include "dartt_sync.h"
+#include "config_save.h"
+#include "file_watch.h"
+#include "hot_reload.h"
+#include "snapshot.h"
+
+// One DARTT peripheral on the shared link, with its own layout, address and read plan
+struct BusDevice
+{
+	DarttConfig config;
+	dartt_sync_t ds;
+	std::string config_json_path;
+	std::string elf_path;		//ELF the layout was loaded from, watched for rebuilds; empty for a JSON load
+	std::string elf_symbols;	//symbol list it was loaded with
+	FileWatch elf_watch;
+	ConfigAutosave autosave;	//saves config_json_path after UI settings or plot lines change
+	std::vector<DarttSnapshot> snapshots;	//taken this session, oldest first
+
+	std::vector<MemoryRegion> read_plan;	//coalesced regions due this cycle, rebuilt every poll
+	uint32_t read_errors;
+	uint32_t write_errors;
+	uint32_t writes_ok;
+	uint32_t write_bytes;		//payload bytes written since connect
+	uint32_t verify_errors;		//fields whose read-back did not match what was written
+	uint32_t writes_deferred;	//regions held back by the write budget
+	uint32_t writes_dropped;	//edits given up after WRITE_RETRY_LIMIT failed writes
+	bool write_failing;			//the last write failed; cleared by the next one that succeeds
+	int last_write_rc;			//error code of the last failed write
+
+	double write_tokens;		//write budget bucket, bytes
+	uint64_t last_refill_us;
+
+	BusDevice();
+
+	// Point ds at the config buffers (call after allocate_buffers) or detach them
+	void attach_buffers();
+	void detach_buffers();
+
+	// Swap in a freshly loaded config, keeping the session (see hot_reload.h). fresh is left
+	// holding the old config. Waits for saves in flight, which may be reading the old one.
+	// Buffers are reallocated; the read plan rebuilds on the next poll. Autosave takes a first
+	// load as already saved, and a reload as a change to save.
+	HotReloadStats replace_config(DarttConfig& fresh, std::vector<Line>& lines);
+};
+
+/*
+Polls several DARTT peripherals sharing one serial link (e.g. an RS-485 multi-drop bus).
+Devices are heap allocated so a device's config stays put as others are added or removed.
+Plot lines name fields by config instance and field ID; find_field looks them up.
+*/
+class BusManager
+{
+public:
+	std::vector<std::unique_ptr<BusDevice>> devices;
+	int active;		//device shown in the Live Expressions view
+	uint32_t read_budget_bytes;	//per-device field bytes read per cycle, 0 = no cap (see build_scheduled_read_queue)
+	uint32_t write_budget_bytes_per_s;	//per-device write payload rate, 0 = no cap
+	bool verify_writes;			//read each written region back and compare against ctl_buf
+
+	BusManager();
+
+	BusDevice* add_device();
+	void remove_device(int idx);
+	BusDevice& active_device();
+
+	// The leaf a plot source names, or nullptr if it is not a field or its config is gone
+	DarttField* find_field(const plot_source_t& source);
+
+	// Every device but dev that has a layout, for saving and loading plot lines that read them
+	std::vector<PlotSourceDevice> other_devices(const BusDevice& dev);
+
+	/*
+	One bus cycle: pending writes for every device go out first (within the write budget),
+	then the read plans are interleaved one region per device per turn, so a device with a
+	large subscription cannot hold the bus while the others wait. Each plan holds only the fields whose
+	poll rate makes them due this cycle.
+
+	Writes are sent from the fields' current values, so edits that pile up while a region
+	is held back by the budget collapse into one write of the latest value. The budget also
+	keeps a fast slider drag from crowding the read stream off the link. A failed write is
+	retried with backoff and dropped after a few tries (see note_write_failure), so a dead
+	link does not stall every frame on the transport timeout.
+	*/
+	void poll();
+
+	// Read dev's whole blob into periph_buf and decode it into every leaf not waiting to be
+	// written. Snapshots, diffs against the device and restores start from this.
+	bool read_all(BusDevice& dev);
+
+	// Read dev in full and copy it into out
+	bool take_snapshot(BusDevice& dev, const char* name, DarttSnapshot& out);
+
+	/*
+	Put the selected changes' values from snap back on dev (see build_restore_regions). The
+	device is read in full first, so only words that really differ from it are written,
+	as few coalesced regions, outside the write budget. Restored leaves drop pending edits.
+	*/
+	bool restore_snapshot(BusDevice& dev, const DarttSnapshot& snap, const std::vector<SnapshotChange>& changes,
+		SnapshotRestoreStats* stats);
+
+private:
+	bool take_write_budget(BusDevice& dev, const MemoryRegion& region, uint64_t now_us);
+	void write_region(BusDevice& dev, const MemoryRegion& region, uint64_t now_us);
+};
+
+#endif // DARTT_BUS_MANAGER_H
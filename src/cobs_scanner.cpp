@@ -0,0 +1,151 @@
+#include "cobs_scanner.h"
+#include <cstring>
+
+/*
+Standard COBS (the same framing cobs_encode_single_buffer produces): each code byte n
+is followed by n-1 data bytes and an implied zero, except after 0xFF and after the last
+group. Output never overtakes input, so decoding in place is safe.
+*/
+int cobs_decode_in_place(uint8_t* data, size_t len)
+{
+	size_t in = 0;
+	size_t out = 0;
+	while (in < len)
+	{
+		uint8_t code = data[in++];
+		if (code == 0)
+		{
+			return -1;
+		}
+		size_t run = (size_t)code - 1;
+		if (run > len - in)
+		{
+			return -1;	//group runs past the delimiter - truncated or corrupted frame
+		}
+		memmove(data + out, data + in, run);
+		out += run;
+		in += run;
+		if (code != 0xFF && in < len)
+		{
+			data[out++] = 0;
+		}
+	}
+	return (int)out;
+}
+
+CobsScanner::CobsScanner()
+	: bad_frames(0)
+	, overflows(0)
+	, buf()
+	, head(0)
+	, scan(0)
+	, tail(0)
+	, discarding(false)
+{
+}
+
+void CobsScanner::init(size_t capacity)
+{
+	buf.assign(capacity, 0);
+	reset();
+}
+
+void CobsScanner::reset()
+{
+	head = 0;
+	scan = 0;
+	tail = 0;
+	discarding = false;
+}
+
+uint8_t* CobsScanner::write_ptr(size_t* space)
+{
+	if (head > 0 && (head == tail || buf.size() - tail < buf.size() / 4))
+	{
+		//slide the unconsumed partial frame to the front; typically only a few bytes
+		memmove(buf.data(), buf.data() + head, tail - head);
+		tail -= head;
+		head = 0;
+	}
+	if (tail == buf.size())
+	{
+		//a whole buffer without a delimiter cannot be a valid frame; drop it and resync
+		overflows++;
+		discarding = true;
+		head = 0;
+		scan = 0;
+		tail = 0;
+	}
+	*space = buf.size() - tail;
+	return buf.data() + tail;
+}
+
+void CobsScanner::commit(size_t n)
+{
+	tail += n;
+}
+
+void CobsScanner::end_of_packet()
+{
+	if (tail > head && buf[tail - 1] != 0)
+	{
+		if (tail == buf.size())
+		{
+			//no room to terminate the last frame: drop just that one, keeping the whole frames before it
+			overflows++;
+			size_t end = tail;
+			while (end > head && buf[end - 1] != 0)
+			{
+				end--;
+			}
+			if (end == head)
+			{
+				reset();
+			}
+			else
+			{
+				tail = end;
+			}
+			return;
+		}
+		buf[tail++] = 0;
+	}
+}
+
+bool CobsScanner::next_frame(uint8_t** frame, size_t* len)
+{
+	while (head + scan < tail)
+	{
+		uint8_t* start = buf.data() + head;
+		uint8_t* delim = (uint8_t*)memchr(start + scan, 0, tail - head - scan);
+		if (delim == nullptr)
+		{
+			scan = tail - head;
+			return false;
+		}
+		size_t frame_len = (size_t)(delim - start);
+		head += frame_len + 1;
+		scan = 0;
+
+		if (discarding)
+		{
+			discarding = false;	//tail of an overflowed frame, the next one is clean
+			continue;
+		}
+		if (frame_len == 0)
+		{
+			continue;	//back to back delimiters
+		}
+
+		int decoded = cobs_decode_in_place(start, frame_len);
+		if (decoded < 0)
+		{
+			bad_frames++;
+			continue;
+		}
+		*frame = start;
+		*len = (size_t)decoded;
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,45 @@
+#ifndef DARTT_COBS_SCANNER_H
+#define DARTT_COBS_SCANNER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/*
+Incremental COBS receiver. Reads land directly in the scanner's buffer (write_ptr/commit),
+next_frame() locates delimiters with memchr and decodes each frame in place. A corrupt or
+oversized frame only costs that frame - scanning resumes at the following delimiter.
+*/
+class CobsScanner
+{
+public:
+	CobsScanner();
+
+	void init(size_t capacity);
+	void reset();
+
+	// Free space for the next read. Compacts consumed bytes to the front when needed.
+	uint8_t* write_ptr(size_t* space);
+	void commit(size_t n);
+	// Terminate the current frame without a delimiter on the wire (datagram boundary)
+	void end_of_packet();
+
+	// Decode the next complete frame in place. Returns false once no complete frames remain.
+	// The returned pointer is valid until the next write_ptr() call.
+	bool next_frame(uint8_t** frame, size_t* len);
+
+	uint32_t bad_frames;	//frames rejected by the decoder
+	uint32_t overflows;		//frames dropped for exceeding the buffer
+
+private:
+	std::vector<uint8_t> buf;
+	size_t head;	//first unconsumed byte
+	size_t scan;	//bytes before this index (from head) are known to hold no delimiter
+	size_t tail;	//end of received data
+	bool discarding;	//overflowed mid-frame, skip everything up to the next delimiter
+};
+
+// Decode a single COBS frame (delimiter excluded) in place. Returns decoded length, or -1 if malformed.
+int cobs_decode_in_place(uint8_t* data, size_t len);
+
+#endif // DARTT_COBS_SCANNER_H
@@ -1,20 +1,19 @@
 #include "config.h"
+#include "config_binary.h"
+#include "config_stream.h"
 #include "dartt_init.h"
 #include "plotting.h"
+#include <algorithm>
+#include <filesystem>
 #include <fstream>
+#include <unordered_map>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <vector>
 
 using json = nlohmann::json;
 
-// Work item for iterative JSON parsing
-struct ParseWork {
-    const json* j;
-    DarttField* field;
-    bool is_type_info;  // true = parse as type_info, false = parse as field
-};
-
 // Helper: get FieldType from type string
 //TODO: consider falling back to uint32_t if the type is unknown and the size is equal to four. 
 //TODO: cross reference type with nbytes to confirm that the label matches the expected size.
@@ -86,8 +85,61 @@ bool is_primitive_type(FieldType type) {
     }
 }
 
+DarttEnumRef make_enum_table(const std::string& name, std::vector<std::pair<int64_t, std::string>> entries)
+{
+    std::stable_sort(entries.begin(), entries.end(),
+        [](const std::pair<int64_t, std::string>& a, const std::pair<int64_t, std::string>& b) {
+            return a.first < b.first;
+        });
+    std::shared_ptr<DarttEnum> e = std::make_shared<DarttEnum>();
+    e->name = name;
+    e->values.reserve(entries.size());
+    e->names.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++)
+	{
+        e->values.push_back(entries[i].first);
+        e->names.push_back(std::move(entries[i].second));
+        if (entries[i].first < 0)
+		{
+            e->is_signed = true;
+        }
+    }
+    return e;
+}
+
+const char* enum_value_name(const DarttEnum& e, int64_t v)
+{
+    std::vector<int64_t>::const_iterator it = std::lower_bound(e.values.begin(), e.values.end(), v);
+    if (it == e.values.end() || *it != v)
+	{
+        return nullptr;
+    }
+    return e.names[it - e.values.begin()].c_str();
+}
+
+int64_t get_enum_value(const DarttField& field)
+{
+    if (field.bit_size > 0)
+	{
+        return field.value.i64;     // already extended by the bitfield sync
+    }
+    bool is_signed = !field.enum_info || field.enum_info->is_signed;
+    switch (field.nbytes)
+	{
+        case 1: return is_signed ? (int64_t)field.value.i8 : (int64_t)field.value.u8;
+        case 2: return is_signed ? (int64_t)field.value.i16 : (int64_t)field.value.u16;
+        case 8: return field.value.i64;
+        default: return is_signed ? (int64_t)field.value.i32 : (int64_t)field.value.u32;
+    }
+}
+
+void set_enum_value(DarttField& field, int64_t v)
+{
+    field.value.i64 = v;    // the low nbytes are what gets written
+}
+
 // Helper: get display string for a field's value
-std::string format_field_value(const DarttField& field) 
+std::string format_field_value(const DarttField& field, bool enum_names) 
 {
     char buf[64];
     switch (field.type) 
@@ -126,114 +178,276 @@ std::string format_field_value(const DarttField& field)
             snprintf(buf, sizeof(buf), "0x%08X", field.value.u32);
             break;
         case FieldType::ENUM:
-            snprintf(buf, sizeof(buf), "%d", field.value.i32);
+		{
+            int64_t v = get_enum_value(field);
+            const char* name = (enum_names && field.enum_info) ? enum_value_name(*field.enum_info, v) : nullptr;
+            if (name)
+			{
+                return name;
+            }
+            snprintf(buf, sizeof(buf), "%lld", (long long)v);
             break;
+		}
         default:
             return "???";
     }
     return std::string(buf);
 }
 
-// Parse fields from JSON iteratively using explicit stack
-static void parse_fields_iterative(const json& root_type_info, DarttField& root_field) {
-    std::vector<ParseWork> stack;
-    stack.push_back({&root_type_info, &root_field, true});
+bool set_bitfield_layout(DarttField& field, uint32_t abs_bit_offset, uint32_t bit_size)
+{
+    uint32_t shift = abs_bit_offset % 8;
+    if (bit_size == 0 || shift + bit_size > 64)
+	{
+        field.bit_size = 0;
+        return false;
+    }
+    field.byte_offset = abs_bit_offset / 8;
+    field.dartt_offset = field.byte_offset / 4;
+    field.nbytes = (shift + bit_size + 7) / 8;
+    field.bit_size = (uint8_t)bit_size;
+    field.bit_shift = (uint8_t)shift;
+    uint64_t ones = (bit_size == 64) ? ~0ull : ((1ull << bit_size) - 1);
+    field.bit_mask = ones << shift;
+    return true;
+}
 
-    while (!stack.empty()) {
-        ParseWork work = stack.back();
-        stack.pop_back();
+static void adjust_offsets(DarttField& field, uint32_t delta) {
+    field.byte_offset += delta;
+    field.dartt_offset = field.byte_offset / 4;
+    for (auto& child : field.children) {
+        adjust_offsets(child, delta);
+    }
+}
 
-        const json& j = *work.j;
-        DarttField& field = *work.field;
+/*
+Several DARTT-mapped symbols share one pair of buffers. A symbol with an explicit
+base_offset keeps it; the rest are packed after the previous symbol, 4-byte aligned, so
+firmware that exposes its blocks back to back in that order needs no extra settings.
+*/
+bool combine_symbol_roots(DarttConfig& config, std::vector<DarttField>& roots)
+{
+    if (roots.empty() || roots.size() != config.symbols.size())
+	{
+        return false;
+    }
+
+    uint32_t next = 0;
+    uint32_t end = 0;
+    for (size_t i = 0; i < config.symbols.size(); i++)
+	{
+        DarttSymbol& sym = config.symbols[i];
+        if (sym.base_offset == DARTT_SYMBOL_PACKED)
+		{
+            sym.base_offset = next;
+        }
+        else if (sym.base_offset % 4 != 0)
+		{
+            fprintf(stderr, "Error: symbol %s base_offset %u is not word aligned\n", sym.name.c_str(), sym.base_offset);
+            return false;
+        }
+        next = (sym.base_offset + sym.nbytes + 3u) & ~3u;
+        end = std::max(end, sym.base_offset + sym.nbytes);
+    }
 
-        if (work.is_type_info) 
+    std::vector<const DarttSymbol*> by_offset;
+    for (const DarttSymbol& sym : config.symbols)
+	{
+        by_offset.push_back(&sym);
+    }
+    std::sort(by_offset.begin(), by_offset.end(), [](const DarttSymbol* a, const DarttSymbol* b) {
+        return a->base_offset < b->base_offset;
+    });
+    for (size_t i = 1; i < by_offset.size(); i++)
+	{
+        if (by_offset[i]->base_offset < by_offset[i - 1]->base_offset + by_offset[i - 1]->nbytes)
 		{
-            // Parse as type_info
-            if (!j.is_object()) continue;
+            fprintf(stderr, "Error: symbols %s and %s overlap in the DARTT map\n",
+                    by_offset[i - 1]->name.c_str(), by_offset[i]->name.c_str());
+            return false;
+        }
+    }
 
-            std::string type_str = j.value("type", "unknown");
-            field.type = parse_field_type(type_str);
-            field.nbytes = j.value("size", 0u);
+    config.address_str = config.symbols[0].address_str;
+    config.address = config.symbols[0].address;
+    config.nbytes = end;
+    config.nwords = (end + 3) / 4;
 
-            if (j.contains("typedef")) 
-			{
-                field.type_name = j["typedef"].get<std::string>();
-            } 
-			else 
+    if (roots.size() == 1)
+	{
+        config.symbol = config.symbols[0].name;
+        config.root = std::move(roots[0]);
+        config.root.name = config.symbol;
+        return true;
+    }
+
+    config.symbol.clear();
+    config.root = DarttField();
+    config.root.type = FieldType::STRUCT;
+    config.root.type_name = "dartt map";
+    config.root.nbytes = end;
+    config.root.children.resize(roots.size());
+    for (size_t i = 0; i < roots.size(); i++)
+	{
+        if (i > 0)
+		{
+            config.symbol += ",";
+        }
+        config.symbol += config.symbols[i].name;
+        DarttField& child = config.root.children[i];
+        child = std::move(roots[i]);
+        child.name = config.symbols[i].name;
+        adjust_offsets(child, config.symbols[i].base_offset);
+    }
+    config.root.name = config.symbol;
+    return true;
+}
+
+/*
+Array nodes carry (base, stride, dims) instead of their elements. Each array level gets
+dims[0] direct children of element_nbytes each; a multi-dimensional array's children are
+arrays over the remaining dims. Struct/union arrays keep one element as a shared template
+that is copied and shifted per element when the level is built.
+*/
+void init_lazy_arrays(DarttField& root)
+{
+    std::vector<DarttField*> stack;
+    stack.push_back(&root);
+    while (!stack.empty())
+	{
+        DarttField* f = stack.back();
+        stack.pop_back();
+
+        if (f->array_size > 0 && f->element_nbytes > 0 && !f->lazy)
+		{
+            // element_nbytes arrives as the size of one scalar/struct element and
+            // array_size as the flattened count
+            uint32_t total = f->array_size;
+            uint32_t product = 1;
+            for (uint32_t d : f->dims)
 			{
-                field.type_name = type_str;
+                product *= d;
             }
-
-            // Handle struct/union - queue child fields
-            if (type_str == "struct" || type_str == "union") 
+            if (f->dims.empty() || product != total)
 			{
-                if (j.contains("fields") && j["fields"].is_array()) 
-				{
-                    const json& fields_array = j["fields"];
-                    // Pre-allocate children
-                    field.children.resize(fields_array.size());
-                    // Push in reverse order so first child is processed first
-                    for (size_t i = fields_array.size(); i > 0; i--) 
-					{
-                        stack.push_back({&fields_array[i-1], &field.children[i-1], false});
-                    }
-                }
+                f->dims.assign(1, total);     // no usable dimensions: one flat level
             }
-            // Handle array
-            else if (type_str == "array") 
+            if (f->nbytes == 0)
 			{
-                field.array_size = j.value("total_elements", 0u);
-                if (j.contains("element_type")) 
-				{
-                    const json& elem = j["element_type"];
-                    field.element_nbytes = elem.value("size", 0u);
-
-                    std::string elem_type = elem.value("type", "");
-                    if (elem_type == "struct" || elem_type == "union") 
-					{
-                        // Array of structs - queue element type parsing
-                        field.children.resize(1);
-                        stack.push_back({&elem, &field.children[0], true});
-                    } 
-					else 
-					{
-                        // Primitive array
-                        field.type_name = elem.value("typedef", elem.value("type", "unknown"));
-                    }
-                }
+                f->nbytes = total * f->element_nbytes;
             }
-        } 
-		else 
-		{
-            // Parse as field (has name, byte_offset, type_info)
-            field.name = j.value("name", "");
-            field.byte_offset = j.value("byte_offset", 0u);
-            field.dartt_offset = j.value("dartt_offset", 0u);
+            f->element_nbytes *= total / f->dims[0];
+            f->array_size = f->dims[0];
 
-            // Queue type_info parsing
-            if (j.contains("type_info")) 
+            if (f->children.size() == 1 &&
+                (f->children[0].type == FieldType::STRUCT || f->children[0].type == FieldType::UNION))
 			{
-                stack.push_back({&j["type_info"], &field, true});
+                init_lazy_arrays(f->children[0]);   // arrays inside the element, before it is shared
+                // Its members are laid out at the first element; a parsed element type has no offset of its own
+                f->children[0].byte_offset = f->byte_offset;
+                f->children[0].dartt_offset = f->byte_offset / 4;
+                f->element_template = std::make_shared<DarttField>(std::move(f->children[0]));
             }
+            f->children.clear();
+            f->lazy = true;
+            continue;
+        }
+
+        for (size_t i = f->children.size(); i > 0; i--)
+		{
+            stack.push_back(&f->children[i - 1]);
         }
     }
 }
 
-static void adjust_offsets(DarttField& field, uint32_t delta) {
-    field.byte_offset += delta;
-    field.dartt_offset = field.byte_offset / 4;
-    for (auto& child : field.children) {
-        adjust_offsets(child, delta);
+// Copy the settings a user applies to a whole array onto a newly built element subtree
+static void inherit_array_settings(const DarttField& array, DarttField& elem)
+{
+    std::vector<DarttField*> stack;
+    stack.push_back(&elem);
+    while (!stack.empty())
+	{
+        DarttField* f = stack.back();
+        stack.pop_back();
+        f->subscribed = array.subscribed;
+        f->poll_rate_hz = array.poll_rate_hz;
+        f->display_scale = array.display_scale;
+        f->use_display_scale = array.use_display_scale;
+        for (size_t i = 0; i < f->children.size(); i++)
+		{
+            stack.push_back(&f->children[i]);
+        }
     }
 }
 
-/*
-Expand primitive arrays into individual element children.
-For any field where array_size > 0 && children.empty() && element_nbytes > 0,
-creates array_size children with [i] names and correct offsets/types.
-For struct/union arrays, children[0] holds the template; clones it for remaining elements.
-*/
-void expand_array_elements(DarttField& root)
+bool materialize_children(DarttField& field)
+{
+    if (!field.lazy)
+	{
+        return false;
+    }
+    field.lazy = false;
+
+    bool sub_array = field.dims.size() > 1;
+    FieldType elem_type = parse_field_type(field.type_name);
+    if (elem_type == FieldType::UNKNOWN && field.enum_info)
+	{
+        elem_type = FieldType::ENUM;     // typedef'd enum
+    }
+    else if (elem_type == FieldType::UNKNOWN && is_primitive_type(field.type))
+	{
+        elem_type = field.type;          // typedef'd primitive, typed from DWARF
+    }
+
+    field.children.resize(field.array_size);
+    for (uint32_t i = 0; i < field.array_size; i++)
+	{
+        DarttField& elem = field.children[i];
+        uint32_t offset = field.byte_offset + i * field.element_nbytes;
+        if (sub_array)
+		{
+            elem.type = field.type;
+            elem.type_name = field.type_name;
+            elem.enum_info = field.enum_info;
+            elem.element_template = field.element_template;
+            elem.dims.assign(field.dims.begin() + 1, field.dims.end());
+            elem.array_size = elem.dims[0];
+            elem.element_nbytes = field.element_nbytes / elem.dims[0];
+            elem.nbytes = field.element_nbytes;
+            elem.byte_offset = offset;
+            elem.dartt_offset = offset / 4;
+            elem.lazy = true;
+        }
+        else if (field.element_template)
+		{
+            elem = *field.element_template;
+            adjust_offsets(elem, offset - field.element_template->byte_offset);
+        }
+        else
+		{
+            elem.byte_offset = offset;
+            elem.dartt_offset = offset / 4;
+            elem.nbytes = field.element_nbytes;
+            elem.type = elem_type;
+            elem.type_name = field.type_name;
+            elem.enum_info = field.enum_info;
+        }
+        elem.name = "[" + std::to_string(i) + "]";
+        inherit_array_settings(field, elem);
+    }
+    return true;
+}
+
+std::string field_child_path(const std::string& prefix, const std::string& name)
+{
+    if (prefix.empty() || (!name.empty() && name[0] == '['))
+    {
+        return prefix + name;
+    }
+    return prefix + "." + name;
+}
+
+DarttField* find_leaf(DarttField& root, uint32_t byte_offset, const std::string& name, bool materialize)
 {
     std::vector<DarttField*> stack;
     stack.push_back(&root);
@@ -242,43 +456,29 @@ void expand_array_elements(DarttField& root)
         DarttField* f = stack.back();
         stack.pop_back();
 
-        if (f->array_size > 0 && f->children.empty() && f->element_nbytes > 0)
+        // Only descend into nodes that cover the offset (size 0 = unknown, always look)
+        if (f->nbytes > 0 && (byte_offset < f->byte_offset || byte_offset >= f->byte_offset + f->nbytes))
 		{
-            FieldType elem_type = parse_field_type(f->type_name);
-
-            f->children.resize(f->array_size);
-            for (uint32_t i = 0; i < f->array_size; i++)
+            continue;
+        }
+        if (is_leaf_field(*f))
+		{
+            if (f->byte_offset == byte_offset && f->name == name)
 			{
-                DarttField& elem = f->children[i];
-                elem.name = "[" + std::to_string(i) + "]";
-                elem.byte_offset = f->byte_offset + i * f->element_nbytes;
-                elem.dartt_offset = elem.byte_offset / 4;
-                elem.nbytes = f->element_nbytes;
-                elem.type = elem_type;
-                elem.type_name = f->type_name;
+                return f;
             }
+            continue;
         }
-        else if (f->array_size > 0 && f->children.size() == 1 &&
-                 (f->children[0].type == FieldType::STRUCT || f->children[0].type == FieldType::UNION))
-        {
-            // Template for element [0] is in children[0]; create remaining elements
-            f->children[0].name = "[0]";
-            DarttField tmpl = f->children[0];          // deep copy before resize
-            f->children.resize(f->array_size);
-            f->children[0] = tmpl;                     // restore after potential realloc
-            for (uint32_t i = 1; i < f->array_size; i++) {
-                f->children[i] = tmpl;
-                f->children[i].name = "[" + std::to_string(i) + "]";
-                adjust_offsets(f->children[i], i * f->element_nbytes);
-            }
+        if (f->lazy && !(materialize && materialize_children(*f)))
+		{
+            continue;
         }
-
-        // Continue DFS into children (including newly created ones)
         for (size_t i = f->children.size(); i > 0; i--)
 		{
             stack.push_back(&f->children[i - 1]);
         }
     }
+    return nullptr;
 }
 
 /*
@@ -293,7 +493,7 @@ void collect_leaves(DarttField& root, std::vector<DarttField*> &leaf_list)
 	{
 		DarttField* field = stack.back();
         stack.pop_back();
-		if(field->children.empty())	//leaf node
+		if(is_leaf_field(*field))
 		{
 			leaf_list.push_back(field);
 		}
@@ -308,282 +508,518 @@ void collect_leaves(DarttField& root, std::vector<DarttField*> &leaf_list)
 	}
 }
 
-// Main config loader
-bool load_dartt_config(const char* json_path, DarttConfig& config, Plotter& plot, Serial & serial, dartt_sync_t& ds)
+uint32_t next_config_instance()
 {
-    // Open and parse JSON file
-    std::ifstream f(json_path);
-    if (!f.is_open())
+    static uint32_t instance = 0;
+    return ++instance;
+}
+
+DarttConfig::DarttConfig(DarttConfig&& other)
+    : DarttConfig()
+{
+    *this = std::move(other);
+}
+
+// Pointers to a config's root (a layout that is one primitive) follow it to its new address
+static void repoint_root(DarttConfig& config, const DarttField* from)
+{
+    std::vector<DarttField*>* lists[] = { &config.leaf_list, &config.subscribed_list, &config.dirty_list, &config.fields };
+    for (std::vector<DarttField*>* list : lists)
     {
-        fprintf(stderr, "Error: Could not open config file: %s\n", json_path);
-        return false;
+        std::replace(list->begin(), list->end(), (DarttField*)from, &config.root);
+    }
+    for (DarttViewRow& row : config.view_rows)
+    {
+        if (row.field == from)
+        {
+            row.field = &config.root;
+        }
     }
+}
 
-    json j;
-    try
+// Swaps, so other takes this config's old tree and buffers with it and frees them
+DarttConfig& DarttConfig::operator=(DarttConfig&& other)
+{
+    if (this == &other)
     {
-        j = json::parse(f);
+        return *this;
     }
-    catch (const json::parse_error& e)
+    std::swap(instance, other.instance);
+    std::swap(symbol, other.symbol);
+    std::swap(address_str, other.address_str);
+    std::swap(address, other.address);
+    std::swap(nbytes, other.nbytes);
+    std::swap(nwords, other.nwords);
+    std::swap(root, other.root);
+    std::swap(symbols, other.symbols);
+    std::swap(ctl_buf, other.ctl_buf);
+    std::swap(periph_buf, other.periph_buf);
+    std::swap(leaf_list, other.leaf_list);
+    std::swap(subscribed_list, other.subscribed_list);
+    std::swap(dirty_list, other.dirty_list);
+    std::swap(settings_version, other.settings_version);
+    std::swap(periph_seen, other.periph_seen);
+    std::swap(changed_chunks, other.changed_chunks);
+    std::swap(fields, other.fields);
+    std::swap(ids_by_key, other.ids_by_key);
+    std::swap(view_rows, other.view_rows);
+    std::swap(view_rows_valid, other.view_rows_valid);
+    std::swap(watch_rows, other.watch_rows);
+    std::swap(watch_rows_key, other.watch_rows_key);
+    std::swap(search_index, other.search_index);
+    std::swap(search, other.search);
+    repoint_root(*this, &other.root);
+    repoint_root(other, &root);
+    return *this;
+}
+
+uint64_t field_key_hash(uint32_t byte_offset, const std::string& name)
+{
+    uint64_t h = 0xcbf29ce484222325ull;     // FNV-1a over the offset bytes, then the name
+    for (int i = 0; i < 4; i++)
     {
-        fprintf(stderr, "Error: JSON parse error: %s\n", e.what());
-        return false;
+        h = (h ^ ((byte_offset >> (8 * i)) & 0xFF)) * 0x100000001b3ull;
+    }
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        h = (h ^ (uint8_t)name[i]) * 0x100000001b3ull;
     }
+    return h;
+}
 
-	if(j.contains("serial_settings") && j["serial_settings"].is_object())
-	{
-		const json & ser_settings = j["serial_settings"];
+DarttFieldId register_field(DarttConfig& config, DarttField* field)
+{
+    if (config_field(config, field->id) == field)
+    {
+        return field->id;
+    }
+    field->id = (DarttFieldId)config.fields.size();
+    config.fields.push_back(field);
+    config.ids_by_key.emplace(field_key_hash(field->byte_offset, field->name), field->id);
+    return field->id;
+}
+
+void refresh_leaf_list(DarttConfig& config)
+{
+    config.leaf_list.clear();
+    collect_leaves(config.root, config.leaf_list);
+    for (size_t i = 0; i < config.leaf_list.size(); i++)
+    {
+        register_field(config, config.leaf_list[i]);
+    }
+}
+
+DarttFieldId field_id_by_key(DarttConfig& config, uint32_t byte_offset, const std::string& name, bool build)
+{
+    DarttField* field = find_field_by_offset_and_name(config, (int32_t)byte_offset, name);
+    if (field)
+    {
+        return field->id;
+    }
+    if (!build)
+    {
+        return DARTT_FIELD_NONE;
+    }
+    // Not registered: in an array that is not built yet (or a hash collision)
+    field = find_leaf(config.root, byte_offset, name, true);
+    if (!field)
+    {
+        return DARTT_FIELD_NONE;
+    }
+    refresh_leaf_list(config);
+    config.view_rows_valid = false;
+    return register_field(config, field);
+}
 
-		ds.address = ser_settings.value("dartt_serial_address", 0);
-		ds.base_offset = ser_settings.value("dartt_blob_base_offset", 0);
-		uint32_t baudrate = ser_settings.value("baudrate", 921600);
-		if(baudrate != serial.get_baud_rate())
+DarttFieldId field_id_by_path(DarttConfig& config, const std::string& path, bool build)
+{
+    FieldSearchHit hit;
+    if (!field_search_find_path(config.search_index, path, &hit))
+    {
+        return DARTT_FIELD_NONE;
+    }
+    return field_id_by_key(config, field_search_offset(config.search_index, hit),
+                           field_search_leaf_name(config.search_index, hit), build);
+}
+
+// Leaves that already exist are found by offset with a binary search; entries inside
+// arrays build just the array levels on their path.
+void apply_ui_map(DarttField& root, const std::vector<DarttField*>& leaves_by_offset, const std::vector<UiMapEntry>& ui_map)
+{
+    for (size_t i = 0; i < ui_map.size(); i++)
+	{
+        const UiMapEntry& e = ui_map[i];
+        DarttField* leaf = nullptr;
+        std::vector<DarttField*>::const_iterator it = std::lower_bound(leaves_by_offset.begin(), leaves_by_offset.end(), e.byte_offset,
+                     [](const DarttField* f, uint32_t offset) { return f->byte_offset < offset; });
+        for (; it != leaves_by_offset.end() && (*it)->byte_offset == e.byte_offset; ++it)
 		{
-			printf("Disconnecting serial...\n");
-			serial.disconnect();
-			printf("done.\n Reconnecting with baudrate %d\n", baudrate);
-			if(serial.autoconnect(baudrate))
-			{
-				printf("Success. Serial connected\n");
-			}
-			else
+            if ((*it)->name == e.name)
 			{
-				printf("Serial failed to connect\n");
-			}
-		}
+                leaf = *it;
+                break;
+            }
+        }
+        if (!leaf)
+		{
+            leaf = find_leaf(root, e.byte_offset, e.name, true);
+        }
+        if (leaf)
+		{
+            leaf->subscribed        = e.subscribed;
+            leaf->display_scale     = e.display_scale;
+            leaf->use_display_scale = e.use_display_scale;
+            leaf->poll_rate_hz      = e.poll_rate_hz;
+        }
+    }
+}
 
-		comm_mode = (CommMode)ser_settings.value("comm_mode", (int)COMM_SERIAL);
+// Only leaves with non-default settings are listed, so loading does not build array
+// elements nobody touched
+void collect_ui_map(const std::vector<DarttField*>& leaf_list, std::vector<UiMapEntry>& ui_map)
+{
+    for (const DarttField* leaf : leaf_list)
+	{
+        if (!leaf->subscribed && leaf->display_scale == 1.0f && !leaf->use_display_scale && leaf->poll_rate_hz == 0.0f)
+		{
+            continue;
+        }
+        UiMapEntry e;
+        e.byte_offset = leaf->byte_offset;
+        e.name = leaf->name;
+        e.subscribed = leaf->subscribed;
+        e.display_scale = leaf->display_scale;
+        e.use_display_scale = leaf->use_display_scale;
+        e.poll_rate_hz = leaf->poll_rate_hz;
+        ui_map.push_back(e);
+    }
+}
 
-		std::string ip = ser_settings.value("udp_ip", "192.168.1.100");
-		strncpy(udp_state.ip, ip.c_str(), sizeof(udp_state.ip) - 1);
-		udp_state.ip[sizeof(udp_state.ip) - 1] = '\0';
-		udp_state.port = ser_settings.value("udp_port", (uint16_t)5000);
+// Main config loader. The file is parsed in one streaming pass (config_stream.cpp) that
+// builds the field trees directly; only the serial and plotting sections become JSON.
+// Binary configs (.dcfg) are read by config_binary.cpp instead.
+bool load_dartt_config(const char* json_path, DarttConfig& config, Plotter& plot, Serial & serial, dartt_sync_t& ds,
+                       const std::vector<PlotSourceDevice>* devices)
+{
+    if (is_binary_config_path(json_path))
+	{
+        return load_dartt_config_binary(json_path, config, plot, serial, ds, devices);
+    }
+
+    std::ifstream f(json_path, std::ios::binary);
+    if (!f.is_open())
+    {
+        fprintf(stderr, "Error: Could not open config file: %s\n", json_path);
+        return false;
+    }
+    std::string text((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    StreamedConfig parsed;
+    std::string parse_error;
+    if (!stream_dartt_config(text.data(), text.size(), parsed, &parse_error))
+    {
+        fprintf(stderr, "Error: JSON parse error: %s\n", parse_error.c_str());
+        return false;
+    }
+    std::string().swap(text);
+    const json& j = parsed.extras;
 
-		std::string tcp_ip = ser_settings.value("tcp_ip", "192.168.1.100");
-		strncpy(tcp_state.ip, tcp_ip.c_str(), sizeof(tcp_state.ip) - 1);
-		tcp_state.ip[sizeof(tcp_state.ip) - 1] = '\0';
-		tcp_state.port = ser_settings.value("tcp_port", (uint16_t)5000);
+	if(j.contains("serial_settings") && j["serial_settings"].is_object())
+	{
+		const json & ser_settings = j["serial_settings"];
+		DarttSerialSettings settings;
+		settings.dartt_serial_address = ser_settings.value("dartt_serial_address", settings.dartt_serial_address);
+		settings.blob_base_offset = ser_settings.value("dartt_blob_base_offset", settings.blob_base_offset);
+		settings.baudrate = ser_settings.value("baudrate", settings.baudrate);
+		settings.comm_mode = ser_settings.value("comm_mode", settings.comm_mode);
+		settings.udp_ip = ser_settings.value("udp_ip", settings.udp_ip);
+		settings.udp_port = ser_settings.value("udp_port", settings.udp_port);
+		settings.tcp_ip = ser_settings.value("tcp_ip", settings.tcp_ip);
+		settings.tcp_port = ser_settings.value("tcp_port", settings.tcp_port);
+		apply_serial_settings(settings, serial, ds);
 	}
 	
-    // Parse top-level fields
-    config.symbol = j.value("symbol", "");
-    config.address_str = j.value("address", "");
-    config.address = j.value("address_int", 0u);
-    config.nbytes = j.value("nbytes", 0u);
-    config.nwords = j.value("nwords", 0u);
-
-    // Parse the root type structure
-    if (j.contains("type")) {
-        config.root.name = config.symbol;
-        parse_fields_iterative(j["type"], config.root);
+    // A multi-symbol map lists each under "symbols", otherwise the document itself
+    // describes the one symbol
+    config.symbols = parsed.symbols;
+    std::vector<DarttField>& roots = parsed.roots;
+    if (!combine_symbol_roots(config, roots))
+	{
+        fprintf(stderr, "Error: could not lay out symbols in %s\n", json_path);
+        return false;
     }
 
     printf("Loaded config: symbol=%s, address=0x%08X, nbytes=%u, nwords=%u\n",
            config.symbol.c_str(), config.address, config.nbytes, config.nwords);
 
-    expand_array_elements(config.root);
-    collect_leaves(config.root, config.leaf_list);
+    init_lazy_arrays(config.root);
 
-    // Apply flat leaf UI map (covers dynamically-expanded array elements)
-    if (j.contains("ui_map") && j["ui_map"].is_object()) {
-        const json& ui_map = j["ui_map"];
-        for (DarttField* leaf : config.leaf_list) {
-            std::string key = std::to_string(leaf->byte_offset) + ":" + leaf->name;
-            if (ui_map.contains(key)) {
-                const json& e = ui_map[key];
-                leaf->subscribed        = e.value("subscribed",        false);
-                leaf->display_scale     = e.value("display_scale",     1.0f);
-                leaf->use_display_scale = e.value("use_display_scale", false);
-            }
-        }
-    }
+    std::vector<DarttField*> leaves;
+    collect_leaves(config.root, leaves);
+    std::stable_sort(leaves.begin(), leaves.end(),
+                     [](const DarttField* a, const DarttField* b) { return a->byte_offset < b->byte_offset; });
+    apply_ui_map(config.root, leaves, parsed.ui_map);
+    refresh_leaf_list(config);
+    build_field_search_index(config.root, config.search_index);
 
     // Load plotting config if plotter provided
-	load_plotting_config(j, plot, config.leaf_list);
+	load_plotting_config(j, plot, config, devices);
 
     return true;
 }
 
-void save_serial_settings(json & j, Serial & serial, const dartt_sync_t & ds)
+DarttSerialSettings get_serial_settings(Serial & serial, const dartt_sync_t & ds)
 {
-	json serial_settings;
-	serial_settings["dartt_serial_address"] = ds.address;
-	serial_settings["dartt_blob_base_offset"] = ds.base_offset;
-	serial_settings["baudrate"] = serial.get_baud_rate();
-	serial_settings["comm_mode"] = (int)comm_mode;
-	serial_settings["udp_ip"] = std::string(udp_state.ip);
-	serial_settings["udp_port"] = udp_state.port;
-	serial_settings["tcp_ip"] = std::string(tcp_state.ip);
-	serial_settings["tcp_port"] = tcp_state.port;
-	j["serial_settings"] = serial_settings;
+	DarttSerialSettings settings;
+	settings.dartt_serial_address = ds.address;
+	settings.blob_base_offset = ds.base_offset;
+	settings.baudrate = serial.get_baud_rate();
+	settings.comm_mode = (int32_t)comm_mode;
+	settings.udp_ip = udp_state.ip;
+	settings.udp_port = udp_state.port;
+	settings.tcp_ip = tcp_state.ip;
+	settings.tcp_port = tcp_state.port;
+	return settings;
 }
 
-// Save plotting config to JSON
-void save_plotting_config(json& j, const Plotter& plot, const std::vector<DarttField*>& leaf_list)
+void apply_serial_settings(const DarttSerialSettings& settings, Serial & serial, dartt_sync_t & ds)
 {
-    json plotting;
-    json lines_json = json::array();
+	ds.address = settings.dartt_serial_address;
+	ds.base_offset = settings.blob_base_offset;
+	if(settings.baudrate != serial.get_baud_rate())
+	{
+		printf("Disconnecting serial...\n");
+		serial.disconnect();
+		printf("done.\n Reconnecting with baudrate %d\n", settings.baudrate);
+		if(serial.autoconnect(settings.baudrate))
+		{
+			printf("Success. Serial connected\n");
+		}
+		else
+		{
+			printf("Serial failed to connect\n");
+		}
+	}
 
-    for (size_t i = 0; i < plot.lines.size(); i++)
-    {
-        const Line& line = plot.lines[i];
-        json line_json;
+	comm_mode = (CommMode)settings.comm_mode;
 
-        line_json["mode"] = (int)line.mode;
+	strncpy(udp_state.ip, settings.udp_ip.c_str(), sizeof(udp_state.ip) - 1);
+	udp_state.ip[sizeof(udp_state.ip) - 1] = '\0';
+	udp_state.port = settings.udp_port;
 
-        // X source data
-        json xsource_data;
-        if (line.xsource == &plot.sys_sec)
-        {
-            xsource_data["byte_offset"] = -1;
-            xsource_data["name"] = "sys_sec";
-        }
-        else if (line.xsource == nullptr)
+	strncpy(tcp_state.ip, settings.tcp_ip.c_str(), sizeof(tcp_state.ip) - 1);
+	tcp_state.ip[sizeof(tcp_state.ip) - 1] = '\0';
+	tcp_state.port = settings.tcp_port;
+}
+
+PlotSourceRef plot_source_ref(const plot_source_t& source, const DarttConfig& config, const std::vector<PlotSourceDevice>* devices)
+{
+    PlotSourceRef ref;
+    if (source.kind == SOURCE_SYS_SEC)
+    {
+        ref.byte_offset = PLOT_SOURCE_SYS_SEC;
+        ref.name = "sys_sec";
+        return ref;
+    }
+    if (source.kind != SOURCE_FIELD)
+    {
+        return ref;
+    }
+    const DarttConfig* owner = (source.config == config.instance) ? &config : nullptr;
+    int32_t device = PLOT_SOURCE_THIS_DEVICE;
+    for (size_t i = 0; !owner && devices && i < devices->size(); i++)
+    {
+        if ((*devices)[i].config->instance == source.config)
         {
-            xsource_data["byte_offset"] = -2;
-            xsource_data["name"] = "none";
+            owner = (*devices)[i].config;
+            device = (*devices)[i].address;
         }
-        else
+    }
+    DarttField* field = owner ? config_field(*owner, source.field) : nullptr;
+    if (field)
+    {
+        ref.byte_offset = (int32_t)field->byte_offset;
+        ref.name = field->name;
+        ref.device = device;
+    }
+    return ref;
+}
+
+plot_source_t resolve_plot_source(const PlotSourceRef& ref, DarttConfig& config, const plot_source_t& fallback,
+                                  const std::vector<PlotSourceDevice>* devices)
+{
+    if (ref.byte_offset == PLOT_SOURCE_SYS_SEC && ref.name == "sys_sec")
+    {
+        return plot_source_t::sys_sec();
+    }
+    if (ref.byte_offset < 0 || ref.name == "none")
+    {
+        return plot_source_t();
+    }
+    DarttConfig* owner = &config;
+    if (ref.device != PLOT_SOURCE_THIS_DEVICE)
+    {
+        owner = nullptr;
+        for (size_t i = 0; devices && i < devices->size(); i++)
         {
-            // Find field in leaf_list
-            bool found = false;
-            for (size_t k = 0; k < leaf_list.size(); k++)
-            {
-                if (&leaf_list[k]->display_value == line.xsource)
-                {
-                    xsource_data["byte_offset"] = (int32_t)leaf_list[k]->byte_offset;
-                    xsource_data["name"] = leaf_list[k]->name;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
+            if ((*devices)[i].address == ref.device)
             {
-                xsource_data["byte_offset"] = -2;
-                xsource_data["name"] = "none";
+                owner = (*devices)[i].config;
+                break;
             }
         }
-        line_json["xsource_data"] = xsource_data;
-
-        // Y source data
-        json ysource_data;
-        if (line.ysource == nullptr)
+        if (!owner)
         {
-            ysource_data["byte_offset"] = -2;
-            ysource_data["name"] = "none";
+            printf("Warning: Plot source '%s' is on device %d, which is not on the bus, defaulting to %s\n",
+                   ref.name.c_str(), ref.device, fallback.kind == SOURCE_SYS_SEC ? "sys_sec" : "none");
+            return fallback;
         }
-        else
-        {
-            bool found = false;
-            for (size_t k = 0; k < leaf_list.size(); k++)
-            {
-                if (&leaf_list[k]->display_value == line.ysource)
-                {
-                    ysource_data["byte_offset"] = (int32_t)leaf_list[k]->byte_offset;
-                    ysource_data["name"] = leaf_list[k]->name;
-                    found = true;
-                    break;
-                }
-            }
-            if (!found)
-            {
-                ysource_data["byte_offset"] = -2;
-                ysource_data["name"] = "none";
-            }
-        }
-        line_json["ysource_data"] = ysource_data;
-
-        // Color
-        line_json["color"] = {line.color.r, line.color.g, line.color.b, line.color.a};
-
-        // Scales and offsets
-        line_json["xscale"] = line.xscale;
-        line_json["xoffset"] = line.xoffset;
-        line_json["yscale"] = line.yscale;
-        line_json["yoffset"] = line.yoffset;
-		line_json["enqueue_cap"] = line.enqueue_cap;
-        lines_json.push_back(line_json);
     }
-
-    plotting["lines"] = lines_json;
-    j["plotting"] = plotting;
+    DarttFieldId id = field_id_by_key(*owner, (uint32_t)ref.byte_offset, ref.name, true);
+    if (id != DARTT_FIELD_NONE)
+    {
+        return plot_source_t::of_field(owner->instance, id);
+    }
+    printf("Warning: Could not find plot source field '%s' at offset %d, defaulting to %s\n",
+           ref.name.c_str(), ref.byte_offset, fallback.kind == SOURCE_SYS_SEC ? "sys_sec" : "none");
+    return fallback;
 }
 
-// Save config to JSON file (only adds ui objects, preserves everything else)
-// If plot is provided, also saves plotting config
-bool save_dartt_config(const char* json_path, const DarttConfig& config, const Plotter& plot, Serial & serial, dartt_sync_t& ds) 
+void capture_session(const DarttConfig& config, const Plotter& plot, const DarttSerialSettings& serial, ConfigSession& out,
+                     const std::vector<PlotSourceDevice>* devices)
 {
-    // Read original JSON
-    std::ifstream f_in(json_path);
-    if (!f_in.is_open()) {
-        fprintf(stderr, "Error: Could not open config file for reading: %s\n", json_path);
-        return false;
+    out.ui_map.clear();
+    collect_ui_map(config.leaf_list, out.ui_map);
+    out.lines.clear();
+    out.lines.reserve(plot.lines.size());
+    for (const Line& line : plot.lines)
+    {
+        SavedPlotLine saved;
+        saved.mode = line.mode;
+        saved.color = line.color;
+        saved.xsource = plot_source_ref(line.xsource, config, devices);
+        saved.ysource = plot_source_ref(line.ysource, config, devices);
+        saved.xscale = line.xscale;
+        saved.xoffset = line.xoffset;
+        saved.yscale = line.yscale;
+        saved.yoffset = line.yoffset;
+        saved.enqueue_cap = line.enqueue_cap;
+        out.lines.push_back(saved);
     }
+    out.serial = serial;
+}
 
-    json j;
-    try 
-	{
-        j = json::parse(f_in);
-    } 
-	catch (const json::parse_error& e) 
-	{
-        fprintf(stderr, "Error: JSON parse error: %s\n", e.what());
+// Write beside path and rename over it, so readers (and a crash) never see half a file
+bool write_file_atomic(const char* path, const char* data, size_t len)
+{
+    std::filesystem::path tmp = std::filesystem::u8path(path);
+    tmp += ".tmp";
+    std::error_code ec;
+    {
+        std::ofstream f_out(tmp, std::ios::binary | std::ios::trunc);
+        if (!f_out.is_open())
+        {
+            fprintf(stderr, "Error: Could not open file for writing: %s\n", tmp.string().c_str());
+            return false;
+        }
+        f_out.write(data, (std::streamsize)len);
+        f_out.close();
+        if (!f_out)
+        {
+            fprintf(stderr, "Error: Could not write file: %s\n", tmp.string().c_str());
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::filesystem::rename(tmp, std::filesystem::u8path(path), ec);
+    if (ec)
+    {
+        fprintf(stderr, "Error: Could not replace %s: %s\n", path, ec.message().c_str());
+        std::filesystem::remove(tmp, ec);
         return false;
     }
-    f_in.close();
+    return true;
+}
 
-    // Write flat leaf UI map (covers dynamically-expanded array elements)
-    json ui_map = json::object();
-    for (const DarttField* leaf : config.leaf_list) {
-        std::string key = std::to_string(leaf->byte_offset) + ":" + leaf->name;
-        json entry;
-        entry["subscribed"]        = leaf->subscribed;
-        entry["display_scale"]     = leaf->display_scale;
-        entry["use_display_scale"] = leaf->use_display_scale;
-        ui_map[key] = entry;
+// The layout is written from the loaded tree in one pass (config_stream.cpp, config_binary.cpp),
+// except that a JSON file already holding it only has its session sections replaced
+bool write_dartt_config_file(const char* path, const DarttConfig& config, const ConfigSession& session)
+{
+    bool ok;
+    if (is_binary_config_path(path))
+    {
+        std::vector<uint8_t> blob;
+        encode_dartt_config_binary(config, session, blob);
+        ok = write_file_atomic(path, (const char*)blob.data(), blob.size());
     }
-    j["ui_map"] = ui_map;
-
-    // Save plotting config if plotter provided
-	save_plotting_config(j, plot, config.leaf_list);
-
-	save_serial_settings(j, serial, ds);
-
-    // Write back
-    std::ofstream f_out(json_path);
-    if (!f_out.is_open()) 
-	{
-        fprintf(stderr, "Error: Could not open config file for writing: %s\n", json_path);
-        return false;
+    else
+    {
+        std::string text;
+        std::string existing;
+        {
+            std::ifstream f(path, std::ios::binary);    //closed again before the rename
+            if (f.is_open())
+            {
+                existing.assign((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+            }
+        }
+        if (existing.empty() || !splice_dartt_config_json(existing, config, session, text))
+        {
+            text.clear();
+            write_dartt_config_json(text, config, session);
+        }
+        ok = write_file_atomic(path, text.data(), text.size());
     }
+    if (ok)
+    {
+        printf("Saved UI settings to: %s\n", path);
+    }
+    return ok;
+}
 
-    f_out << j.dump(2);
-    f_out.close();
-
-    printf("Saved UI settings to: %s\n", json_path);
-    return true;
+bool save_dartt_config(const char* json_path, const DarttConfig& config, const Plotter& plot, Serial & serial, dartt_sync_t& ds,
+                       const std::vector<PlotSourceDevice>* devices)
+{
+    ConfigSession session;
+    capture_session(config, plot, get_serial_settings(serial, ds), session, devices);
+    return write_dartt_config_file(json_path, config, session);
 }
 
-// Find field by byte_offset and name (both must match)
+// Find a registered leaf by byte_offset and name (both must match)
 DarttField* find_field_by_offset_and_name(
-    const std::vector<DarttField*>& leaf_list,
+    const DarttConfig& config,
     int32_t byte_offset,
     const std::string& name)
 {
-    for (size_t i = 0; i < leaf_list.size(); i++)
+    if (byte_offset < 0)
     {
-        if ((int32_t)leaf_list[i]->byte_offset == byte_offset &&
-            leaf_list[i]->name == name)
-        {
-            return leaf_list[i];
-        }
+        return nullptr;
     }
-    return nullptr;
+    auto it = config.ids_by_key.find(field_key_hash((uint32_t)byte_offset, name));
+    if (it == config.ids_by_key.end())
+    {
+        return nullptr;
+    }
+    DarttField* field = config.fields[it->second];
+    if (field->byte_offset != (uint32_t)byte_offset || field->name != name)
+    {
+        return nullptr;
+    }
+    return field;
 }
 
+// Read a saved source reference ({"byte_offset", "name"}, plus "device" for another device's leaf)
+static PlotSourceRef plot_source_from_json(const json& j)
+{
+    PlotSourceRef ref;
+    ref.byte_offset = j.value("byte_offset", PLOT_SOURCE_NONE);
+    ref.name = j.value("name", "none");
+    ref.device = j.value("device", PLOT_SOURCE_THIS_DEVICE);
+    return ref;
+}
 
 // Load plotting config from JSON
-void load_plotting_config(const json& j, Plotter& plot, const std::vector<DarttField*>& leaf_list)
+void load_plotting_config(const json& j, Plotter& plot, DarttConfig& config, const std::vector<PlotSourceDevice>* devices)
 {
     if (!j.contains("plotting"))
     {
@@ -612,67 +1048,21 @@ void load_plotting_config(const json& j, Plotter& plot, const std::vector<DarttF
         // X source
         if (line_json.contains("xsource_data"))
         {
-            const json& xdata = line_json["xsource_data"];
-            int32_t offset = xdata.value("byte_offset", -2);
-            std::string name = xdata.value("name", "none");
-
-            if (offset == -1 && name == "sys_sec")
-            {
-                line.xsource = &plot.sys_sec;
-            }
-            else if (offset == -2 || name == "none")
-            {
-                line.xsource = nullptr;
-            }
-            else
-            {
-                DarttField* field = find_field_by_offset_and_name(leaf_list, offset, name);
-                if (field)
-                {
-                    line.xsource = &field->display_value;
-                }
-                else
-                {
-                    printf("Warning: Could not find xsource field '%s' at offset %d, defaulting to sys_sec\n",
-                           name.c_str(), offset);
-                    line.xsource = &plot.sys_sec;
-                }
-            }
+            line.xsource = resolve_plot_source(plot_source_from_json(line_json["xsource_data"]), config, plot_source_t::sys_sec(), devices);
         }
         else
         {
-            line.xsource = &plot.sys_sec;
+            line.xsource = plot_source_t::sys_sec();
         }
 
         // Y source
         if (line_json.contains("ysource_data"))
         {
-            const json& ydata = line_json["ysource_data"];
-            int32_t offset = ydata.value("byte_offset", -2);
-            std::string name = ydata.value("name", "none");
-
-            if (offset == -2 || name == "none")
-            {
-                line.ysource = nullptr;
-            }
-            else
-            {
-                DarttField* field = find_field_by_offset_and_name(leaf_list, offset, name);
-                if (field)
-                {
-                    line.ysource = &field->display_value;
-                }
-                else
-                {
-                    printf("Warning: Could not find ysource field '%s' at offset %d, defaulting to none\n",
-                           name.c_str(), offset);
-                    line.ysource = nullptr;
-                }
-            }
+            line.ysource = resolve_plot_source(plot_source_from_json(line_json["ysource_data"]), config, plot_source_t(), devices);
         }
         else
         {
-            line.ysource = nullptr;
+            line.ysource = plot_source_t();
         }
 
         // Color
@@ -695,4 +1085,3 @@ void load_plotting_config(const json& j, Plotter& plot, const std::vector<DarttF
 
     printf("Loaded %zu plot lines from config\n", plot.lines.size());
 }
-
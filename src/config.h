@@ -4,11 +4,14 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include "dartt_sync.h"
 #include "dartt.h"
 #include "plotting.h"
 #include <nlohmann/json.hpp>
 #include "serial.h"
+#include "field_search.h"
 
 // Field type classification for parsing and display
 enum class FieldType {
@@ -30,6 +33,57 @@ enum class FieldType {
     UNKNOWN
 };
 
+#define POLL_RATE_ON_DEMAND -1.0f
+
+// Stable handle for a leaf of one loaded config: its index in DarttConfig::fields.
+// Assigned as leaves are collected (refresh_leaf_list) and never reused while the config lives.
+typedef uint32_t DarttFieldId;
+#define DARTT_FIELD_NONE 0xFFFFFFFFu
+
+// Enumerators of one enum type. Built once per type and shared by every leaf of it.
+struct DarttEnum
+{
+    std::string name;                       // "enum State" or its typedef
+    std::vector<int64_t> values;            // sorted ascending
+    std::vector<std::string> names;         // names[i] is the enumerator for values[i]
+    bool is_signed;                         // any enumerator is negative
+
+    DarttEnum() : is_signed(false) {}
+};
+typedef std::shared_ptr<const DarttEnum> DarttEnumRef;
+
+// Streaming statistics of a leaf's reads (see update_field_stats). Two accumulators each
+// cover half of FIELD_STATS_WINDOW_US and take turns, so together they span the last half
+// to whole window at O(1) per read. Values are native (unscaled).
+struct DarttFieldStats
+{
+    uint32_t count[2];
+    double mean[2];
+    double m2[2];               // sum of squared deviations from mean (Welford)
+    float min[2];
+    float max[2];
+    uint8_t current;            // accumulator being filled
+    uint64_t half_start_us;     // when current started filling
+    uint64_t last_change_us;    // last read that returned a different value
+    uint64_t last_raw;          // value bits of that read
+
+    DarttFieldStats()
+        : current(0)
+        , half_start_us(0)
+        , last_change_us(0)
+        , last_raw(0)
+    {
+        for (int i = 0; i < 2; i++)
+        {
+            count[i] = 0;
+            mean[i] = 0.0;
+            m2[i] = 0.0;
+            min[i] = 0.f;
+            max[i] = 0.f;
+        }
+    }
+};
+
 // Single field in the hierarchy
 struct DarttField 
 {
@@ -40,22 +94,51 @@ struct DarttField
     FieldType type;
     std::string type_name;      // original type string from JSON
 
-    // For arrays
-    uint32_t array_size;        // number of elements (0 if not array)
-    uint32_t element_nbytes;    // size of each element
+    // For arrays. Children are built on first use (materialize_children), one level of
+    // dims at a time, so large arrays cost one node until they are expanded or subscribed.
+    uint32_t array_size;        // number of direct elements, dims[0] (0 if not array)
+    uint32_t element_nbytes;    // stride of each direct element (a whole sub-array for multi-dim)
+    std::vector<uint32_t> dims; // remaining dimensions from this level down
+    std::shared_ptr<const DarttField> element_template;   // struct/union element, laid out at byte_offset
+    bool lazy;                  // array whose children have not been built yet
+
+    // For bitfields: the value is bits [bit_shift, bit_shift + bit_size) of the
+    // little-endian bytes at byte_offset, and nbytes spans just those bits
+    uint8_t bit_size;           // 0 if not a bitfield
+    uint8_t bit_shift;
+    uint64_t bit_mask;          // ((1 << bit_size) - 1) << bit_shift
+
+    // For enums (and arrays of them)
+    DarttEnumRef enum_info;     // null if the enumerators are unknown
 
     // For structs/unions - child fields
     std::vector<DarttField> children;
 
+    DarttFieldId id;            // DARTT_FIELD_NONE until registered (leaves only)
+
     // UI state
+    uint32_t leaf_count;        // leaves (and unbuilt arrays) in this subtree, see refresh_view_rows
+    uint32_t subscribed_count;  // how many of those are subscribed
     bool subscribed;
     bool dirty;                 // set when value edited, cleared after write
+    uint8_t write_failures;     // failed sends of the pending edit (see note_write_failure)
+    bool write_failed;          // the last edit was dropped after WRITE_RETRY_LIMIT failures
+    uint64_t next_write_us;     // a failed edit is not sent again before this
     float display_scale;
     bool expanded;              // tree node expanded in UI
 
 	bool use_display_scale;
 	float display_value;	//the True Value, scaled by display scale.
 
+    // Read scheduling (see build_scheduled_read_queue)
+    float poll_rate_hz;         // target rate; 0 = every bus cycle, POLL_RATE_ON_DEMAND = only when requested
+    bool read_requested;        // one-shot read for on-demand fields
+    uint64_t next_read_us;      // deadline for the next read
+    uint64_t last_read_us;      // time of the last successful read
+    float achieved_hz;          // smoothed measured read rate
+    DarttFieldStats stats;      // min/max/mean/stddev and last change, for the Watch panel
+    uint64_t changed_ms;        // frame time the value read back last changed (diff_periph_buf), for the highlight
+
     // Runtime value storage
     union {
         float f32;
@@ -78,26 +161,172 @@ struct DarttField
         , type(FieldType::UNKNOWN)
         , array_size(0)
         , element_nbytes(0)
+        , lazy(false)
+        , bit_size(0)
+        , bit_shift(0)
+        , bit_mask(0)
+        , leaf_count(0)
+        , subscribed_count(0)
         , subscribed(false)
         , dirty(false)
+        , write_failures(0)
+        , write_failed(false)
+        , next_write_us(0)
         , display_scale(1.0f)
         , expanded(false)
 		, use_display_scale(false)
 		, display_value(0.f)
+        , poll_rate_hz(0.f)
+        , read_requested(false)
+        , next_read_us(0)
+        , last_read_us(0)
+        , achieved_hz(0.f)
+        , changed_ms(0)
     {
+        id = DARTT_FIELD_NONE;
         value.u64 = 0;
     }
 };
 
-// Top-level config loaded from JSON
-struct DarttConfig 
+#define DARTT_SYMBOL_PACKED 0xFFFFFFFFu   // base_offset: place after the previous symbol
+
+// One DARTT-mapped variable. Its bytes sit at base_offset in the config's buffers,
+// which is also its byte offset in the device's DARTT space.
+struct DarttSymbol
 {
-    std::string symbol;
+    std::string name;
     std::string address_str;    // hex string "0x20001000"
     uint32_t address;           // numeric address
+    uint32_t base_offset;       // byte offset in the combined buffers (multiple of 4)
+    uint32_t nbytes;            // size in bytes
+
+    DarttSymbol()
+        : address(0)
+        , base_offset(DARTT_SYMBOL_PACKED)
+        , nbytes(0)
+    {}
+};
+
+// One row of the Live Expressions table: a node whose ancestors are all expanded
+struct DarttViewRow
+{
+    DarttField* field;
+    int32_t depth;
+    int32_t parent;     // row index of the parent, -1 for the root
+};
+
+// One row of the Watch panel. By ID rather than pointer, so it needs no fixing up on a move.
+struct DarttWatchRow
+{
+    DarttFieldId id;
+    std::string path;
+};
+
+// Saved UI settings of one leaf, keyed by its byte offset and name ("ui_map")
+struct UiMapEntry
+{
+    uint32_t byte_offset;
+    std::string name;
+    bool subscribed;
+    float display_scale;
+    bool use_display_scale;
+    float poll_rate_hz;
+
+    UiMapEntry()
+        : byte_offset(0)
+        , subscribed(false)
+        , display_scale(1.0f)
+        , use_display_scale(false)
+        , poll_rate_hz(0.0f)
+    {}
+};
+
+// Link settings saved with a config ("serial_settings"); defaults match a config without them
+struct DarttSerialSettings
+{
+    uint32_t dartt_serial_address;
+    uint32_t blob_base_offset;
+    uint32_t baudrate;
+    int32_t comm_mode;
+    std::string udp_ip;
+    uint16_t udp_port;
+    std::string tcp_ip;
+    uint16_t tcp_port;
+
+    DarttSerialSettings()
+        : dartt_serial_address(0)
+        , blob_base_offset(0)
+        , baudrate(921600)
+        , comm_mode(0)
+        , udp_ip("192.168.1.100")
+        , udp_port(5000)
+        , tcp_ip("192.168.1.100")
+        , tcp_port(5000)
+    {}
+};
+
+// A plot line's data source as saved: a leaf's byte offset and name, or one of these
+#define PLOT_SOURCE_SYS_SEC -1      // name "sys_sec"
+#define PLOT_SOURCE_NONE    -2      // name "none"
+
+// PlotSourceRef::device for a leaf of the config the line is saved with
+#define PLOT_SOURCE_THIS_DEVICE -1
+
+struct PlotSourceRef
+{
+    int32_t byte_offset;
+    std::string name;
+    int32_t device;             // PLOT_SOURCE_THIS_DEVICE, or the DARTT address of the bus device holding the leaf
+
+    PlotSourceRef() : byte_offset(PLOT_SOURCE_NONE), name("none"), device(PLOT_SOURCE_THIS_DEVICE) {}
+};
+
+// Another device on the bus, for plot lines that read its fields (BusManager::other_devices)
+struct DarttConfig;
+struct PlotSourceDevice
+{
+    uint8_t address;            // dartt_sync_t::address
+    DarttConfig* config;
+};
+
+// One plot line as saved: its settings and sources, without the data
+struct SavedPlotLine
+{
+    timemode_t mode;
+    rgb_t color;
+    PlotSourceRef xsource;
+    PlotSourceRef ysource;
+    float xscale;
+    float xoffset;
+    float yscale;
+    float yoffset;
+    uint32_t enqueue_cap;
+};
+
+// Everything a save writes besides the layout. It is copied out of the live session
+// (capture_session), so the layout can be written off the UI thread (see config_save.h).
+struct ConfigSession
+{
+    std::vector<UiMapEntry> ui_map;
+    std::vector<SavedPlotLine> lines;
+    DarttSerialSettings serial;
+};
+
+// Process-unique number for a new DarttConfig, never 0
+uint32_t next_config_instance();
+
+// Top-level config loaded from JSON
+struct DarttConfig 
+{
+    uint32_t instance;          // which load this is; plot lines name fields by (instance, id)
+
+    std::string symbol;         // symbol name, or comma-separated names for a multi-symbol map
+    std::string address_str;    // hex string "0x20001000" (first symbol)
+    uint32_t address;           // numeric address (first symbol)
     uint32_t nbytes;            // total size in bytes
     uint32_t nwords;            // total size in 32-bit words
-    DarttField root;            // root struct containing all fields
+    DarttField root;            // root struct containing all fields; with several symbols, one child per symbol
+    std::vector<DarttSymbol> symbols;   // every mapped symbol, in DARTT offset order
 
     // DARTT buffers (allocated after parsing)
 	dartt_mem_t ctl_buf;
@@ -109,15 +338,49 @@ struct DarttConfig
 	std::vector<DarttField*> leaf_list;
 	std::vector<DarttField*> subscribed_list;  // subscribed leaves only
 	std::vector<DarttField*> dirty_list;       // dirty leaves only
+	uint32_t settings_version;                 // bumped when a leaf's saved UI settings change (autosave)
+
+	// Frame-to-frame changes of periph_buf (diff_periph_buf)
+	std::vector<uint8_t> periph_seen;          // periph_buf as of the last diff
+	std::vector<uint64_t> changed_chunks;      // bit per 8-byte chunk that differed in the last diff
+
+	// Field IDs: fields[id] is the leaf with that ID. ids_by_key maps field_key_hash(byte_offset,
+	// name) to an ID; lookups check the field itself, so a hash collision is only a miss.
+	std::vector<DarttField*> fields;
+	std::unordered_map<uint64_t, DarttFieldId> ids_by_key;
+
+	// Live Expressions view: the expanded tree flattened to rows, rebuilt on expand/collapse
+	std::vector<DarttViewRow> view_rows;
+	bool view_rows_valid;
+
+	// Watch panel: subscribed leaves with their paths, rebuilt when watch_rows_key changes
+	std::vector<DarttWatchRow> watch_rows;
+	uint64_t watch_rows_key;
+
+	// Full paths of every leaf for the search box, unbuilt arrays as patterns; built at load (build_field_search_index)
+	FieldSearchIndex search_index;
+	FieldSearch search;
 	
     DarttConfig()
-        : address(0)
+        : instance(next_config_instance())
+        , address(0)
         , nbytes(0)
         , nwords(0)
         , ctl_buf(0)
         , periph_buf(0)
+        , settings_version(0)
+        , view_rows_valid(false)
+        , watch_rows_key(0)
     {}
 
+    // Move only: the lists point into root, and a copy would share the buffers. Moving keeps
+    // every field pointer valid (children vectors move with the tree), so a config can be
+    // loaded on the side and swapped in (see BusDevice::replace_config).
+    DarttConfig(const DarttConfig&) = delete;
+    DarttConfig& operator=(const DarttConfig&) = delete;
+    DarttConfig(DarttConfig&& other);
+    DarttConfig& operator=(DarttConfig&& other);
+
     ~DarttConfig() {
         if (ctl_buf.buf)
 		{
@@ -148,28 +411,123 @@ struct DarttConfig
     }
 };
 
-// Parse config from JSON file
-// If plot is provided, also loads plotting config
-// Returns true on success, false on error (error message printed to stderr)
-bool load_dartt_config(const char* json_path, DarttConfig& config, Plotter& plot, Serial & serial, dartt_sync_t& ds);
+// Parse config from JSON file, or from the binary format if the path ends in .dcfg
+// If plot is provided, also loads plotting config; devices are the other devices on the bus,
+// for lines that read their fields. Returns true on success, false on error (error message printed to stderr)
+bool load_dartt_config(const char* json_path, DarttConfig& config, Plotter& plot, Serial & serial, dartt_sync_t& ds,
+                       const std::vector<PlotSourceDevice>* devices = nullptr);
+
+// Current link settings, and applying loaded ones (reconnects serial if the baudrate changed)
+DarttSerialSettings get_serial_settings(Serial & serial, const dartt_sync_t & ds);
+void apply_serial_settings(const DarttSerialSettings& settings, Serial & serial, dartt_sync_t & ds);
+
+// Saved form of a plot line source, and back. A leaf of one of devices saves with that
+// device's address and resolves against whichever of devices has it then; sources in
+// any other config save as "none". A leaf that no longer exists resolves to fallback.
+PlotSourceRef plot_source_ref(const plot_source_t& source, const DarttConfig& config, const std::vector<PlotSourceDevice>* devices = nullptr);
+plot_source_t resolve_plot_source(const PlotSourceRef& ref, DarttConfig& config, const plot_source_t& fallback,
+                                  const std::vector<PlotSourceDevice>* devices = nullptr);
+
+// Apply saved per-leaf UI settings. leaves_by_offset is the tree's leaves sorted by byte offset;
+// entries inside arrays build just the array levels on their path.
+void apply_ui_map(DarttField& root, const std::vector<DarttField*>& leaves_by_offset, const std::vector<UiMapEntry>& ui_map);
+
+// The leaves with non-default UI settings, as saved in "ui_map"
+void collect_ui_map(const std::vector<DarttField*>& leaf_list, std::vector<UiMapEntry>& ui_map);
 
 
 // Parse plotting config from json, if present.
-void load_plotting_config(const nlohmann::json& j, Plotter& plot, const std::vector<DarttField*>& leaf_list);
+void load_plotting_config(const nlohmann::json& j, Plotter& plot, DarttConfig& config, const std::vector<PlotSourceDevice>* devices = nullptr);
+
+// Lay out one tree per symbol in a single config: resolves packed base offsets, shifts each
+// tree by its symbol's base_offset and sets root, symbol, address and sizes. A single symbol
+// becomes the root itself. roots[i] belongs to config.symbols[i]; call before init_lazy_arrays.
+bool combine_symbol_roots(DarttConfig& config, std::vector<DarttField>& roots);
 
-// Expand primitive arrays into individual element children
-void expand_array_elements(DarttField& root);
+// Turn every array in a freshly parsed tree into a lazy node: dims and strides filled in,
+// a struct/union element moved into element_template, and no children until materialized.
+void init_lazy_arrays(DarttField& root);
+
+// Build a lazy array's direct children. Elements inherit the array's subscription and
+// display settings. Returns false if field was not lazy. Existing nodes never move, but
+// callers must rebuild leaf_list afterwards.
+bool materialize_children(DarttField& field);
+
+// A node with a value: no children and not an unbuilt array
+inline bool is_leaf_field(const DarttField& field)
+{
+    return field.children.empty() && !field.lazy;
+}
 
-// Collect a list of all leaves
+// An array init_lazy_arrays gave a shape (dims and stride) to. Saved configs describe it by
+// that shape whether or not its elements have been built.
+inline bool is_shaped_array(const DarttField& field)
+{
+    return field.array_size > 0 && field.element_nbytes > 0 && !field.dims.empty();
+}
+
+// Full path of a child named name under the path prefix: "motor.pid", "motor.pid[2]" for an
+// array element (names that start with '['), or just name at the top. Every path shown or
+// searched is built with this, so paths from different walks compare equal.
+std::string field_child_path(const std::string& prefix, const std::string& name);
+
+// Find the leaf at byte_offset named name, building lazy arrays on the way down if
+// materialize is set. Returns nullptr if there is none.
+DarttField* find_leaf(DarttField& root, uint32_t byte_offset, const std::string& name, bool materialize);
+
+// Place a bitfield at an absolute bit position (LSB of byte 0 = bit 0). Sets byte_offset,
+// dartt_offset, nbytes and the shift/mask. Returns false (field left as plain bytes) if the bits span more than 8 bytes.
+bool set_bitfield_layout(DarttField& field, uint32_t abs_bit_offset, uint32_t bit_size);
+
+// Collect a list of all leaves (appends to leaf_list)
 void collect_leaves(DarttField& root, std::vector<DarttField*> &leaf_list);
 
+// Rebuild config.leaf_list from the tree and give any new leaves their IDs. Call whenever
+// leaves may have been added (load, materialize_children).
+void refresh_leaf_list(DarttConfig& config);
+
+// ID of a leaf of config, registering it if it has none yet
+DarttFieldId register_field(DarttConfig& config, DarttField* field);
+
+// Leaf with ID id, or nullptr
+inline DarttField* config_field(const DarttConfig& config, DarttFieldId id)
+{
+    return id < config.fields.size() ? config.fields[id] : nullptr;
+}
+
+// Key of a leaf in DarttConfig::ids_by_key
+uint64_t field_key_hash(uint32_t byte_offset, const std::string& name);
+
+// ID of the leaf at byte_offset named name, or DARTT_FIELD_NONE. With build set, a leaf in an
+// array that has not been built yet is built and registered (leaf_list is refreshed).
+DarttFieldId field_id_by_key(DarttConfig& config, uint32_t byte_offset, const std::string& name, bool build);
+
+// ID of the leaf at a full path ("motor.pid[2].kp", as in the search index), or DARTT_FIELD_NONE.
+// Builds arrays on the way like field_id_by_key.
+DarttFieldId field_id_by_path(DarttConfig& config, const std::string& path, bool build);
+
 // Forward declaration for Plotter
 class Plotter;
 
-// Save config to JSON file (preserves UI settings)
-// If plot is provided, also saves plotting config
-// Returns true on success, false on error (error message printed to stderr)
-bool save_dartt_config(const char* json_path, const DarttConfig& config, const Plotter& plot, Serial & serial, dartt_sync_t& ds);
+// Copy the parts of a save that change while the session runs: ui_map, plot lines, serial settings.
+// Lines reading a field of one of devices keep it (see plot_source_ref).
+void capture_session(const DarttConfig& config, const Plotter& plot, const DarttSerialSettings& serial, ConfigSession& out,
+                     const std::vector<PlotSourceDevice>* devices = nullptr);
+
+// Save config to JSON file (preserves UI settings), or in the binary format if the path ends in .dcfg
+// If plot is provided, also saves plotting config. Runs on the calling thread; see config_save.h
+// for saving in the background. Returns true on success, false on error (error message printed to stderr)
+bool save_dartt_config(const char* json_path, const DarttConfig& config, const Plotter& plot, Serial & serial, dartt_sync_t& ds,
+                       const std::vector<PlotSourceDevice>* devices = nullptr);
+
+// Write config with a captured session. The file is written beside path and renamed over it,
+// so a crash mid-save leaves the old file intact. A JSON file that already describes config's
+// layout keeps everything but its session sections (splice_dartt_config_json). Reads only the parts of config's layout that
+// never change after load, so it may run on another thread while the config is in use.
+bool write_dartt_config_file(const char* path, const DarttConfig& config, const ConfigSession& session);
+
+// Write len bytes to path through a temporary beside it, so readers never see half a file
+bool write_file_atomic(const char* path, const char* data, size_t len);
 
 // Helper: get FieldType from type string
 FieldType parse_field_type(const std::string& type_str);
@@ -177,16 +535,24 @@ FieldType parse_field_type(const std::string& type_str);
 // Helper: check if a field type is a primitive (can be read/displayed directly)
 bool is_primitive_type(FieldType type);
 
-// Helper: get display string for a field's value
-std::string format_field_value(const DarttField& field);
+// Helper: get display string for a field's value. Enums show their enumerator name
+// unless enum_names is false (or the value has none), in which case the number.
+std::string format_field_value(const DarttField& field, bool enum_names = true);
+
+// Build a shared enumerator table from (value, name) pairs in any order
+DarttEnumRef make_enum_table(const std::string& name, std::vector<std::pair<int64_t, std::string>> entries);
 
-// Find field by byte_offset and name (both must match)
+// Enumerator name for v, or nullptr if v has none
+const char* enum_value_name(const DarttEnum& e, int64_t v);
+
+// An enum leaf's value, sign- or zero-extended from its nbytes (or bit_size)
+int64_t get_enum_value(const DarttField& field);
+void set_enum_value(DarttField& field, int64_t v);
+
+// Find a registered leaf by byte_offset and name (both must match), through config's ID index
 DarttField* find_field_by_offset_and_name(
-    const std::vector<DarttField*>& leaf_list,
+    const DarttConfig& config,
     int32_t byte_offset,
     const std::string& name);
 
-// Note: save_plotting_config and load_plotting_config are declared in config.cpp
-// and use nlohmann::json directly. Call them from files that include nlohmann/json.hpp.
-
 #endif // DARTT_CONFIG_H
@@ -0,0 +1,611 @@
+/*
+ * config_binary.cpp - compact binary form of a DARTT config (.dcfg)
+ *
+ * Saving flattens the tree into records in one pass, interning every string once.
+ * Loading maps the file, checks every section and reference against the file size,
+ * then rebuilds the DarttField tree from the node records, so a damaged or truncated
+ * file is rejected instead of read out of bounds.
+ */
+
+#include "config_binary.h"
+#include "plotting.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char DCFG_MAGIC[4] = { 'D', 'C', 'F', 'G' };
+
+static_assert(sizeof(DcfgHeader) % 8 == 0, "DcfgHeader must keep sections 8-byte aligned");
+static_assert(sizeof(DcfgNode) == 52, "DcfgNode layout changed; bump DCFG_VERSION");
+static_assert(sizeof(DcfgLine) == 60, "DcfgLine layout changed; bump DCFG_VERSION");
+
+bool is_binary_config_path(const char* path)
+{
+    size_t n = strlen(path);
+    size_t ext = sizeof(DARTT_CONFIG_BINARY_EXT) - 1;
+    if (n < ext) {
+        return false;
+    }
+    for (size_t i = 0; i < ext; i++) {
+        char c = path[n - ext + i];
+        if (c >= 'A' && c <= 'Z') {
+            c = (char)(c - 'A' + 'a');
+        }
+        if (c != DARTT_CONFIG_BINARY_EXT[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ============================================================================
+ * Saving
+ * ============================================================================ */
+
+/* String table with each distinct string stored once */
+class StringTable {
+public:
+    std::string data;
+
+    DcfgStr add(const std::string& s) {
+        std::unordered_map<std::string, uint32_t>::iterator it = offsets.find(s);
+        DcfgStr ref;
+        ref.len = (uint32_t)s.size();
+        if (it != offsets.end()) {
+            ref.offset = it->second;
+            return ref;
+        }
+        ref.offset = (uint32_t)data.size();
+        data += s;
+        data += '\0';
+        offsets.emplace(s, ref.offset);
+        return ref;
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> offsets;
+};
+
+static DcfgPlotSource plot_source_record(const PlotSourceRef& ref, StringTable& strings) {
+    DcfgPlotSource rec;
+    rec.byte_offset = ref.byte_offset;
+    rec.name = strings.add(ref.name);
+    rec.device = ref.device;
+    return rec;
+}
+
+template <typename T>
+static void put_section(std::vector<uint8_t>& out, DcfgHeader& header, DcfgSectionId id,
+                        const T* records, size_t count, size_t bytes) {
+    out.resize((out.size() + 7) & ~(size_t)7, 0);
+    header.sections[id].offset = (uint32_t)out.size();
+    header.sections[id].count = (uint32_t)count;
+    const uint8_t* p = (const uint8_t*)records;
+    out.insert(out.end(), p, p + bytes);
+}
+
+template <typename T>
+static void put_section(std::vector<uint8_t>& out, DcfgHeader& header, DcfgSectionId id, const std::vector<T>& records) {
+    put_section(out, header, id, records.data(), records.size(), records.size() * sizeof(T));
+}
+
+void encode_dartt_config_binary(const DarttConfig& config, const ConfigSession& session, std::vector<uint8_t>& out) {
+    StringTable strings;
+    std::vector<DcfgSymbol> symbols;
+    std::vector<DcfgEnum> enums;
+    std::vector<DcfgEnumerator> enumerators;
+    std::vector<DcfgNode> nodes;
+    std::vector<uint32_t> dims;
+    std::vector<uint32_t> leaves;
+    std::vector<DcfgUi> ui;
+    std::vector<DcfgLine> lines;
+
+    for (const DarttSymbol& sym : config.symbols) {
+        DcfgSymbol rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.name = strings.add(sym.name);
+        rec.address_str = strings.add(sym.address_str);
+        rec.address = sym.address;
+        rec.base_offset = sym.base_offset;
+        rec.nbytes = sym.nbytes;
+        symbols.push_back(rec);
+    }
+
+    /* Nodes in pre-order; a shaped array's built elements are left out. Members of an
+       element template are not leaves of the tree, only a pattern for them. */
+    std::unordered_map<const DarttEnum*, uint32_t> enum_refs;
+    std::vector<std::pair<const DarttField*, bool>> stack;
+    stack.push_back(std::make_pair(&config.root, false));
+    while (!stack.empty()) {
+        const DarttField* f = stack.back().first;
+        bool in_template = stack.back().second;
+        stack.pop_back();
+
+        DcfgNode rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.name = strings.add(f->name);
+        rec.type_name = strings.add(f->type_name);
+        rec.byte_offset = f->byte_offset;
+        rec.nbytes = f->nbytes;
+        rec.array_size = f->array_size;
+        rec.element_nbytes = f->element_nbytes;
+        rec.dims_first = (uint32_t)dims.size();
+        rec.dims_count = (uint32_t)f->dims.size();
+        dims.insert(dims.end(), f->dims.begin(), f->dims.end());
+        rec.type = (uint8_t)f->type;
+        rec.bit_size = f->bit_size;
+        rec.bit_shift = f->bit_shift;
+        if (f->enum_info) {
+            std::unordered_map<const DarttEnum*, uint32_t>::iterator it = enum_refs.find(f->enum_info.get());
+            if (it == enum_refs.end()) {
+                const DarttEnum& e = *f->enum_info;
+                DcfgEnum erec;
+                erec.name = strings.add(e.name);
+                erec.first = (uint32_t)enumerators.size();
+                erec.count = (uint32_t)e.values.size();
+                for (size_t i = 0; i < e.values.size(); i++) {
+                    DcfgEnumerator v;
+                    memset(&v, 0, sizeof(v));
+                    v.value = e.values[i];
+                    v.name = strings.add(e.names[i]);
+                    enumerators.push_back(v);
+                }
+                enums.push_back(erec);
+                it = enum_refs.emplace(f->enum_info.get(), (uint32_t)enums.size()).first;
+            }
+            rec.enum_ref = it->second;
+        }
+
+        bool shaped = is_shaped_array(*f);
+        if (shaped) {
+            rec.flags |= DCFG_NODE_LAZY;
+        } else {
+            rec.child_count = (uint32_t)f->children.size();
+            for (size_t i = f->children.size(); i > 0; i--) {
+                stack.push_back(std::make_pair(&f->children[i - 1], in_template));
+            }
+        }
+        if (f->element_template) {
+            rec.flags |= DCFG_NODE_TEMPLATE;
+            stack.push_back(std::make_pair(f->element_template.get(), true));
+        }
+        if (!in_template && !shaped && is_leaf_field(*f)) {
+            leaves.push_back((uint32_t)nodes.size());
+        }
+        nodes.push_back(rec);
+    }
+    std::stable_sort(leaves.begin(), leaves.end(), [&nodes](uint32_t a, uint32_t b) {
+        return nodes[a].byte_offset < nodes[b].byte_offset;
+    });
+
+    for (const UiMapEntry& e : session.ui_map) {
+        DcfgUi rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.name = strings.add(e.name);
+        rec.byte_offset = e.byte_offset;
+        rec.display_scale = e.display_scale;
+        rec.poll_rate_hz = e.poll_rate_hz;
+        rec.subscribed = e.subscribed ? 1 : 0;
+        rec.use_display_scale = e.use_display_scale ? 1 : 0;
+        ui.push_back(rec);
+    }
+
+    for (const SavedPlotLine& line : session.lines) {
+        DcfgLine rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.mode = (int32_t)line.mode;
+        rec.color[0] = line.color.r;
+        rec.color[1] = line.color.g;
+        rec.color[2] = line.color.b;
+        rec.color[3] = line.color.a;
+        rec.xsource = plot_source_record(line.xsource, strings);
+        rec.ysource = plot_source_record(line.ysource, strings);
+        rec.xscale = line.xscale;
+        rec.xoffset = line.xoffset;
+        rec.yscale = line.yscale;
+        rec.yoffset = line.yoffset;
+        rec.enqueue_cap = line.enqueue_cap;
+        lines.push_back(rec);
+    }
+
+    DcfgHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, DCFG_MAGIC, 4);
+    header.version = DCFG_VERSION;
+    header.nbytes = config.nbytes;
+    header.nwords = config.nwords;
+    const DarttSerialSettings& serial = session.serial;
+    header.serial.dartt_serial_address = serial.dartt_serial_address;
+    header.serial.blob_base_offset = serial.blob_base_offset;
+    header.serial.baudrate = serial.baudrate;
+    header.serial.comm_mode = serial.comm_mode;
+    header.serial.udp_ip = strings.add(serial.udp_ip);
+    header.serial.tcp_ip = strings.add(serial.tcp_ip);
+    header.serial.udp_port = serial.udp_port;
+    header.serial.tcp_port = serial.tcp_port;
+
+    out.clear();
+    out.resize(sizeof(DcfgHeader), 0);
+    put_section(out, header, DCFG_SYMBOLS, symbols);
+    put_section(out, header, DCFG_ENUMS, enums);
+    put_section(out, header, DCFG_ENUMERATORS, enumerators);
+    put_section(out, header, DCFG_NODES, nodes);
+    put_section(out, header, DCFG_DIMS, dims);
+    put_section(out, header, DCFG_LEAVES, leaves);
+    put_section(out, header, DCFG_UI, ui);
+    put_section(out, header, DCFG_LINES, lines);
+    put_section(out, header, DCFG_STRINGS, strings.data.data(), strings.data.size(), strings.data.size());
+    header.file_size = (uint32_t)out.size();
+    memcpy(out.data(), &header, sizeof(header));
+}
+
+/* ============================================================================
+ * Loading
+ * ============================================================================ */
+
+/* Read-only mapping of a whole file, as elf_image does it */
+struct MappedFile {
+    const uint8_t* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+
+    MappedFile() : data(nullptr), size(0)
+#ifdef _WIN32
+        , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#else
+        , fd(-1)
+#endif
+    {}
+    ~MappedFile() { close(); }
+
+    bool open(const char* path) {
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            return false;
+        }
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) {
+            return false;
+        }
+        data = (const uint8_t*)view;
+        size = (size_t)file_size.QuadPart;
+#else
+        fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            return false;
+        }
+        void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        data = (const uint8_t*)view;
+        size = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) munmap((void*)data, size);
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
+
+/* Checked view of a mapped .dcfg: every accessor fails instead of reading past the file */
+struct DcfgView {
+    const uint8_t* data;
+    size_t size;
+    const DcfgHeader* header;
+    const char* strings;
+    uint32_t strings_len;
+
+    template <typename T> const T* section(DcfgSectionId id) const {
+        return (const T*)(data + header->sections[id].offset);
+    }
+    uint32_t count(DcfgSectionId id) const {
+        return header->sections[id].count;
+    }
+    bool str(const DcfgStr& s, std::string& out) const {
+        if (s.offset >= strings_len || s.len >= strings_len - s.offset || strings[s.offset + s.len] != '\0') {
+            return false;
+        }
+        out.assign(strings + s.offset, s.len);
+        return true;
+    }
+};
+
+static bool open_view(const uint8_t* data, size_t size, DcfgView& view) {
+    static const size_t record_size[DCFG_SECTION_COUNT] = {
+        1, sizeof(DcfgSymbol), sizeof(DcfgEnum), sizeof(DcfgEnumerator), sizeof(DcfgNode),
+        sizeof(uint32_t), sizeof(uint32_t), sizeof(DcfgUi), sizeof(DcfgLine)
+    };
+    if (size < sizeof(DcfgHeader) || memcmp(data, DCFG_MAGIC, 4) != 0) {
+        return false;
+    }
+    const DcfgHeader* header = (const DcfgHeader*)data;
+    if (header->version != DCFG_VERSION || header->file_size != size) {
+        return false;
+    }
+    for (int i = 0; i < DCFG_SECTION_COUNT; i++) {
+        const DcfgSection& s = header->sections[i];
+        if (s.offset % 8 != 0 || s.offset < sizeof(DcfgHeader) ||
+            s.offset > size || (uint64_t)s.count * record_size[i] > size - s.offset) {
+            return false;
+        }
+    }
+    view.data = data;
+    view.size = size;
+    view.header = header;
+    view.strings = view.section<char>(DCFG_STRINGS);
+    view.strings_len = view.count(DCFG_STRINGS);
+    return true;
+}
+
+/* Rebuild the layout trees from the node records; node_ptrs[i] is node i in the result */
+static bool read_nodes(const DcfgView& view, const std::vector<DarttEnumRef>& enums,
+                       DarttField& root, std::vector<DarttField*>& node_ptrs) {
+    const DcfgNode* nodes = view.section<DcfgNode>(DCFG_NODES);
+    const uint32_t* dims = view.section<uint32_t>(DCFG_DIMS);
+    uint32_t node_count = view.count(DCFG_NODES);
+    uint32_t dim_count = view.count(DCFG_DIMS);
+    if (node_count == 0) {
+        return false;
+    }
+    node_ptrs.reserve(node_count);
+
+    std::vector<DarttField*> stack;
+    stack.push_back(&root);
+    while (!stack.empty()) {
+        DarttField* field = stack.back();
+        stack.pop_back();
+        uint32_t index = (uint32_t)node_ptrs.size();
+        if (index >= node_count) {
+            return false;
+        }
+        const DcfgNode& rec = nodes[index];
+        node_ptrs.push_back(field);
+
+        if (!view.str(rec.name, field->name) || !view.str(rec.type_name, field->type_name) ||
+            rec.type > (uint8_t)FieldType::UNKNOWN || rec.enum_ref > enums.size() ||
+            rec.dims_first > dim_count || rec.dims_count > dim_count - rec.dims_first ||
+            (uint64_t)rec.byte_offset + rec.nbytes > view.header->nbytes) {
+            return false;
+        }
+        field->byte_offset = rec.byte_offset;
+        field->dartt_offset = rec.byte_offset / 4;
+        field->nbytes = rec.nbytes;
+        field->type = (FieldType)rec.type;
+        field->array_size = rec.array_size;
+        field->element_nbytes = rec.element_nbytes;
+        field->dims.assign(dims + rec.dims_first, dims + rec.dims_first + rec.dims_count);
+        field->lazy = (rec.flags & DCFG_NODE_LAZY) != 0;
+        if (rec.enum_ref > 0) {
+            field->enum_info = enums[rec.enum_ref - 1];
+        }
+        if (rec.bit_size > 0 && !set_bitfield_layout(*field, rec.byte_offset * 8 + rec.bit_shift, rec.bit_size)) {
+            return false;
+        }
+
+        bool has_template = (rec.flags & DCFG_NODE_TEMPLATE) != 0;
+        uint32_t remaining = node_count - index - 1;
+        if (rec.child_count > remaining || (has_template && rec.child_count == remaining)) {
+            return false;
+        }
+        field->children.resize(rec.child_count);
+        for (size_t i = rec.child_count; i > 0; i--) {
+            stack.push_back(&field->children[i - 1]);
+        }
+        if (has_template) {
+            std::shared_ptr<DarttField> tmpl = std::make_shared<DarttField>();
+            field->element_template = tmpl;
+            stack.push_back(tmpl.get());    /* filled in place; shared as const from here on */
+        }
+    }
+    return node_ptrs.size() == node_count;
+}
+
+static bool leaf_offset_less(const DarttField* a, const DarttField* b) {
+    return a->byte_offset < b->byte_offset;
+}
+
+static bool read_plot_source(const DcfgView& view, const DcfgPlotSource& rec, PlotSourceRef& ref) {
+    ref.byte_offset = rec.byte_offset;
+    ref.device = rec.device;
+    return view.str(rec.name, ref.name);
+}
+
+bool load_dartt_config_binary(const char* path, DarttConfig& config, Plotter& plot, Serial & serial, dartt_sync_t& ds,
+                              const std::vector<PlotSourceDevice>* devices)
+{
+    MappedFile file;
+    if (!file.open(path)) {
+        fprintf(stderr, "Error: Could not open config file: %s\n", path);
+        return false;
+    }
+    DcfgView view;
+    if (!open_view(file.data, file.size, view)) {
+        fprintf(stderr, "Error: %s is not a version %d binary config\n", path, DCFG_VERSION);
+        return false;
+    }
+
+    /* Everything is decoded and checked before config is touched */
+    std::vector<DarttSymbol> symbols;
+    const DcfgSymbol* sym_recs = view.section<DcfgSymbol>(DCFG_SYMBOLS);
+    for (uint32_t i = 0; i < view.count(DCFG_SYMBOLS); i++) {
+        DarttSymbol sym;
+        if (!view.str(sym_recs[i].name, sym.name) || !view.str(sym_recs[i].address_str, sym.address_str)) {
+            fprintf(stderr, "Error: corrupt symbol table in %s\n", path);
+            return false;
+        }
+        sym.address = sym_recs[i].address;
+        sym.base_offset = sym_recs[i].base_offset;
+        sym.nbytes = sym_recs[i].nbytes;
+        symbols.push_back(sym);
+    }
+
+    std::vector<DarttEnumRef> enums;
+    const DcfgEnum* enum_recs = view.section<DcfgEnum>(DCFG_ENUMS);
+    const DcfgEnumerator* enumerators = view.section<DcfgEnumerator>(DCFG_ENUMERATORS);
+    uint32_t enumerator_count = view.count(DCFG_ENUMERATORS);
+    for (uint32_t i = 0; i < view.count(DCFG_ENUMS); i++) {
+        const DcfgEnum& e = enum_recs[i];
+        std::string name;
+        if (!view.str(e.name, name) || e.first > enumerator_count || e.count > enumerator_count - e.first) {
+            fprintf(stderr, "Error: corrupt enum table in %s\n", path);
+            return false;
+        }
+        std::vector<std::pair<int64_t, std::string>> entries(e.count);
+        for (uint32_t k = 0; k < e.count; k++) {
+            entries[k].first = enumerators[e.first + k].value;
+            if (!view.str(enumerators[e.first + k].name, entries[k].second)) {
+                fprintf(stderr, "Error: corrupt enum table in %s\n", path);
+                return false;
+            }
+        }
+        enums.push_back(make_enum_table(name, std::move(entries)));
+    }
+
+    DarttField root;
+    std::vector<DarttField*> node_ptrs;
+    if (!read_nodes(view, enums, root, node_ptrs)) {
+        fprintf(stderr, "Error: corrupt field tree in %s\n", path);
+        return false;
+    }
+
+    std::vector<DarttField*> leaves;
+    const uint32_t* leaf_recs = view.section<uint32_t>(DCFG_LEAVES);
+    for (uint32_t i = 0; i < view.count(DCFG_LEAVES); i++) {
+        if (leaf_recs[i] >= node_ptrs.size()) {
+            fprintf(stderr, "Error: corrupt leaf table in %s\n", path);
+            return false;
+        }
+        leaves.push_back(node_ptrs[leaf_recs[i]]);
+    }
+    std::vector<UiMapEntry> ui_map;
+    const DcfgUi* ui_recs = view.section<DcfgUi>(DCFG_UI);
+    for (uint32_t i = 0; i < view.count(DCFG_UI); i++) {
+        UiMapEntry e;
+        if (!view.str(ui_recs[i].name, e.name)) {
+            fprintf(stderr, "Error: corrupt UI map in %s\n", path);
+            return false;
+        }
+        e.byte_offset = ui_recs[i].byte_offset;
+        e.subscribed = ui_recs[i].subscribed != 0;
+        e.display_scale = ui_recs[i].display_scale;
+        e.use_display_scale = ui_recs[i].use_display_scale != 0;
+        e.poll_rate_hz = ui_recs[i].poll_rate_hz;
+        ui_map.push_back(e);
+    }
+    DarttSerialSettings settings;
+    const DcfgSerial& ser = view.header->serial;
+    if (!view.str(ser.udp_ip, settings.udp_ip) || !view.str(ser.tcp_ip, settings.tcp_ip)) {
+        fprintf(stderr, "Error: corrupt serial settings in %s\n", path);
+        return false;
+    }
+    settings.dartt_serial_address = ser.dartt_serial_address;
+    settings.blob_base_offset = ser.blob_base_offset;
+    settings.baudrate = ser.baudrate;
+    settings.comm_mode = ser.comm_mode;
+    settings.udp_port = ser.udp_port;
+    settings.tcp_port = ser.tcp_port;
+
+    std::vector<PlotSourceRef> sources;
+    const DcfgLine* line_recs = view.section<DcfgLine>(DCFG_LINES);
+    for (uint32_t i = 0; i < view.count(DCFG_LINES); i++) {
+        PlotSourceRef x, y;
+        if (!read_plot_source(view, line_recs[i].xsource, x) || !read_plot_source(view, line_recs[i].ysource, y)) {
+            fprintf(stderr, "Error: corrupt plot lines in %s\n", path);
+            return false;
+        }
+        sources.push_back(x);
+        sources.push_back(y);
+    }
+
+    /* The leaf table is already in the order apply_ui_map searches */
+    if (!std::is_sorted(leaves.begin(), leaves.end(), leaf_offset_less)) {
+        std::stable_sort(leaves.begin(), leaves.end(), leaf_offset_less);
+    }
+    apply_ui_map(root, leaves, ui_map);
+
+    apply_serial_settings(settings, serial, ds);
+
+    config.symbols = std::move(symbols);
+    config.symbol.clear();
+    for (size_t i = 0; i < config.symbols.size(); i++) {
+        config.symbol += (i > 0 ? "," : "") + config.symbols[i].name;
+    }
+    if (!config.symbols.empty()) {
+        config.address_str = config.symbols[0].address_str;
+        config.address = config.symbols[0].address;
+    }
+    config.nbytes = view.header->nbytes;
+    config.nwords = view.header->nwords;
+    config.root = std::move(root);
+    printf("Loaded config: symbol=%s, address=0x%08X, nbytes=%u, nwords=%u\n",
+           config.symbol.c_str(), config.address, config.nbytes, config.nwords);
+
+    refresh_leaf_list(config);
+    build_field_search_index(config.root, config.search_index);
+
+    plot.lines.clear();
+    for (uint32_t i = 0; i < view.count(DCFG_LINES); i++) {
+        const DcfgLine& rec = line_recs[i];
+        Line line;
+        line.mode = (timemode_t)rec.mode;
+        line.color.r = rec.color[0];
+        line.color.g = rec.color[1];
+        line.color.b = rec.color[2];
+        line.color.a = rec.color[3];
+        line.xsource = resolve_plot_source(sources[2 * i], config, plot_source_t::sys_sec(), devices);
+        line.ysource = resolve_plot_source(sources[2 * i + 1], config, plot_source_t(), devices);
+        line.xscale = rec.xscale;
+        line.xoffset = rec.xoffset;
+        line.yscale = rec.yscale;
+        line.yoffset = rec.yoffset;
+        line.enqueue_cap = rec.enqueue_cap;
+        plot.lines.push_back(line);
+    }
+    printf("Loaded %zu plot lines from config\n", plot.lines.size());
+    return true;
+}
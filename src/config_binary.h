@@ -0,0 +1,159 @@
+/*
+ * config_binary.h - compact binary form of a DARTT config (.dcfg)
+ *
+ * Holds everything a JSON config does: the layout trees with their enum tables, a
+ * leaf table, the UI map, plot lines and serial settings. All of it is fixed-size
+ * records plus one string table, so a mapped file is read in place with no parsing.
+ * The two formats convert through a loaded DarttConfig: load one, save the other.
+ *
+ * File layout (native byte order, little-endian on every supported host):
+ *   DcfgHeader, then the sections its table points at, each 8-byte aligned
+ * Strings are (offset, length) into the string table, which also NUL-terminates them.
+ * Nodes are the layout trees in pre-order (with several symbols, node 0 is the map
+ * root and each symbol's tree is one of its children); arrays are stored by shape,
+ * never by their built elements, and a node's element template comes right before
+ * its children. The leaf table lists leaf node indices sorted by byte offset.
+ *
+ * Usage:
+ *   encode_dartt_config_binary(config, session, blob);      // session from capture_session
+ *   load_dartt_config_binary("motor.dcfg", config, plot, serial, ds);
+ * load_dartt_config / save_dartt_config pick this format for paths ending in .dcfg.
+ */
+
+#ifndef DARTT_CONFIG_BINARY_H
+#define DARTT_CONFIG_BINARY_H
+
+#include <stdint.h>
+#include <vector>
+#include "config.h"
+
+#define DARTT_CONFIG_BINARY_EXT ".dcfg"
+
+/* Bump when a record changes; older files are rejected rather than misread */
+#define DCFG_VERSION 2
+
+enum DcfgSectionId {
+    DCFG_STRINGS,       // count is in bytes
+    DCFG_SYMBOLS,
+    DCFG_ENUMS,
+    DCFG_ENUMERATORS,
+    DCFG_NODES,
+    DCFG_DIMS,          // uint32_t
+    DCFG_LEAVES,        // uint32_t node indices
+    DCFG_UI,
+    DCFG_LINES,
+    DCFG_SECTION_COUNT
+};
+
+struct DcfgSection {
+    uint32_t offset;    // from the start of the file
+    uint32_t count;     // records
+};
+
+struct DcfgStr {
+    uint32_t offset;    // into the string table
+    uint32_t len;
+};
+
+struct DcfgSerial {
+    uint32_t dartt_serial_address;
+    uint32_t blob_base_offset;
+    uint32_t baudrate;
+    int32_t comm_mode;
+    DcfgStr udp_ip;
+    DcfgStr tcp_ip;
+    uint16_t udp_port;
+    uint16_t tcp_port;
+    uint32_t reserved;
+};
+
+struct DcfgHeader {
+    char magic[4];      // "DCFG"
+    uint32_t version;
+    uint32_t file_size;
+    uint32_t nbytes;    // whole DARTT map
+    uint32_t nwords;
+    uint32_t reserved;
+    DcfgSerial serial;
+    DcfgSection sections[DCFG_SECTION_COUNT];
+};
+
+struct DcfgSymbol {
+    DcfgStr name;
+    DcfgStr address_str;
+    uint32_t address;
+    uint32_t base_offset;
+    uint32_t nbytes;
+    uint32_t reserved;
+};
+
+struct DcfgEnum {
+    DcfgStr name;
+    uint32_t first;     // into DCFG_ENUMERATORS
+    uint32_t count;
+};
+
+struct DcfgEnumerator {
+    int64_t value;
+    DcfgStr name;
+};
+
+#define DCFG_NODE_LAZY      0x01    // array stored by shape; children are built on use
+#define DCFG_NODE_TEMPLATE  0x02    // element template follows, before the children
+
+struct DcfgNode {
+    DcfgStr name;
+    DcfgStr type_name;
+    uint32_t byte_offset;   // absolute in the DARTT map
+    uint32_t nbytes;
+    uint32_t array_size;
+    uint32_t element_nbytes;
+    uint32_t dims_first;    // into DCFG_DIMS
+    uint32_t dims_count;
+    uint32_t enum_ref;      // index into DCFG_ENUMS + 1, 0 = none
+    uint32_t child_count;
+    uint8_t type;           // FieldType
+    uint8_t flags;          // DCFG_NODE_*
+    uint8_t bit_size;
+    uint8_t bit_shift;
+};
+
+struct DcfgUi {
+    DcfgStr name;
+    uint32_t byte_offset;
+    float display_scale;
+    float poll_rate_hz;
+    uint8_t subscribed;
+    uint8_t use_display_scale;
+    uint8_t reserved[2];
+};
+
+struct DcfgPlotSource {
+    int32_t byte_offset;    // or PLOT_SOURCE_SYS_SEC / PLOT_SOURCE_NONE
+    DcfgStr name;
+    int32_t device;         // PlotSourceRef::device
+};
+
+struct DcfgLine {
+    int32_t mode;
+    uint8_t color[4];       // r, g, b, a
+    DcfgPlotSource xsource;
+    DcfgPlotSource ysource;
+    float xscale;
+    float xoffset;
+    float yscale;
+    float yoffset;
+    uint32_t enqueue_cap;
+};
+
+/* True if path names a binary config (ends in .dcfg, any case) */
+bool is_binary_config_path(const char* path);
+
+/* Map and load a .dcfg file; same effect as load_dartt_config on the equivalent JSON */
+bool load_dartt_config_binary(const char* path, DarttConfig& config, Plotter& plot, Serial & serial, dartt_sync_t& ds,
+                              const std::vector<PlotSourceDevice>* devices = nullptr);
+
+/* Encode config's layout and a captured session (UI map, plot lines, serial settings) as a .dcfg image */
+void encode_dartt_config_binary(const DarttConfig& config, const ConfigSession& session, std::vector<uint8_t>& out);
+
+#endif /* DARTT_CONFIG_BINARY_H */
@@ -0,0 +1,178 @@
+/*
+ * config_save.cpp - save configs in the background, and autosave
+ */
+
+#include "config_save.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/* ============================================================================
+ * Worker
+ * ============================================================================ */
+
+struct SaveJob {
+    std::string path;
+    const DarttConfig* config;
+    ConfigSession session;
+};
+
+/* One thread, started on the first save and joined at exit */
+struct SaveWorker {
+    std::mutex mutex;
+    std::condition_variable wake;       // a job was queued, or stop
+    std::condition_variable idle;       // the queue drained
+    std::deque<SaveJob> queue;
+    bool writing;
+    bool stop;
+    std::thread thread;
+
+    SaveWorker() : writing(false), stop(false) {}
+
+    ~SaveWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_one();
+        if (thread.joinable()) {
+            thread.join();      /* queued saves are finished first */
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this] { return stop || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            SaveJob job = std::move(queue.front());
+            queue.pop_front();
+            writing = true;
+            lock.unlock();
+            write_dartt_config_file(job.path.c_str(), *job.config, job.session);
+            lock.lock();
+            writing = false;
+            if (queue.empty()) {
+                idle.notify_all();
+            }
+        }
+    }
+};
+
+static SaveWorker worker;
+
+void config_save_async(const char* path, const DarttConfig& config, const Plotter& plot,
+                       const DarttSerialSettings& serial, const std::vector<PlotSourceDevice>* devices) {
+    SaveJob job;
+    job.path = path;
+    job.config = &config;
+    capture_session(config, plot, serial, job.session, devices);
+
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    bool replaced = false;
+    for (SaveJob& queued : worker.queue) {
+        if (queued.path == job.path) {
+            queued = std::move(job);    /* not started yet: the newer session wins */
+            replaced = true;
+            break;
+        }
+    }
+    if (!replaced) {
+        worker.queue.push_back(std::move(job));
+    }
+    if (!worker.thread.joinable()) {
+        worker.thread = std::thread([] { worker.run(); });
+    }
+    worker.wake.notify_one();
+}
+
+void config_save_wait() {
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.idle.wait(lock, [] { return worker.queue.empty() && !worker.writing; });
+}
+
+bool config_save_busy() {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    return !worker.queue.empty() || worker.writing;
+}
+
+/* ============================================================================
+ * Autosave
+ * ============================================================================ */
+
+static inline void fnv_bytes(uint64_t& h, const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+}
+
+/* Everything a save writes that can change without a reload, without copying any of it */
+static uint64_t session_fingerprint(const DarttConfig& config, const Plotter& plot, const DarttSerialSettings& serial) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    fnv_bytes(h, &config.settings_version, sizeof(config.settings_version));
+    for (const Line& line : plot.lines) {
+        const plot_source_t* sources[2] = { &line.xsource, &line.ysource };
+        for (const plot_source_t* s : sources) {
+            fnv_bytes(h, &s->kind, sizeof(s->kind));
+            fnv_bytes(h, &s->config, sizeof(s->config));
+            fnv_bytes(h, &s->field, sizeof(s->field));
+        }
+        fnv_bytes(h, &line.mode, sizeof(line.mode));
+        fnv_bytes(h, &line.color, sizeof(line.color));
+        fnv_bytes(h, &line.xscale, sizeof(line.xscale));
+        fnv_bytes(h, &line.xoffset, sizeof(line.xoffset));
+        fnv_bytes(h, &line.yscale, sizeof(line.yscale));
+        fnv_bytes(h, &line.yoffset, sizeof(line.yoffset));
+        fnv_bytes(h, &line.enqueue_cap, sizeof(line.enqueue_cap));
+    }
+    fnv_bytes(h, &serial.dartt_serial_address, sizeof(serial.dartt_serial_address));
+    fnv_bytes(h, &serial.blob_base_offset, sizeof(serial.blob_base_offset));
+    fnv_bytes(h, &serial.baudrate, sizeof(serial.baudrate));
+    fnv_bytes(h, &serial.comm_mode, sizeof(serial.comm_mode));
+    fnv_bytes(h, serial.udp_ip.data(), serial.udp_ip.size());
+    fnv_bytes(h, &serial.udp_port, sizeof(serial.udp_port));
+    fnv_bytes(h, serial.tcp_ip.data(), serial.tcp_ip.size());
+    fnv_bytes(h, &serial.tcp_port, sizeof(serial.tcp_port));
+    return h;
+}
+
+void autosave_reset(ConfigAutosave& autosave) {
+    autosave.rebase = true;
+    autosave.force = false;
+}
+
+void autosave_mark_changed(ConfigAutosave& autosave) {
+    autosave.rebase = false;
+    autosave.force = true;
+}
+
+bool autosave_update(ConfigAutosave& autosave, const DarttConfig& config, const Plotter& plot,
+                     const DarttSerialSettings& serial, uint64_t now_ms) {
+    uint64_t fingerprint = session_fingerprint(config, plot, serial);
+    if (autosave.rebase) {
+        autosave.rebase = false;
+        autosave.fingerprint = fingerprint;
+        autosave.pending = false;
+        return false;
+    }
+    if (autosave.force || fingerprint != autosave.fingerprint) {
+        autosave.force = false;
+        autosave.fingerprint = fingerprint;
+        autosave.pending = true;
+        autosave.changed_ms = now_ms;
+        return false;
+    }
+    if (autosave.pending && autosave.enabled && config.nbytes > 0 &&
+        now_ms - autosave.changed_ms >= CONFIG_AUTOSAVE_DELAY_MS) {
+        autosave.pending = false;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,70 @@
+/*
+ * config_save.h - save configs in the background, and autosave
+ *
+ * A save copies the session (ui_map, plot lines, serial settings; see capture_session)
+ * on the calling thread, which is cheap, and leaves the layout, the slow part, to one
+ * worker thread. The worker reads only parts of the tree that never change after load
+ * (arrays are written by their shape, never through their built elements), so the UI
+ * keeps running while a large config is written. Files are written beside the target
+ * and renamed over it.
+ *
+ * The config must outlive its saves: call config_save_wait before a config is replaced
+ * or destroyed. A queued save to a path is replaced by a newer save to the same path.
+ *
+ * Autosave is debounced: autosave_update notices session changes each frame and saves
+ * once they have been quiet for CONFIG_AUTOSAVE_DELAY_MS, so a slider drag or a burst
+ * of subscriptions becomes one write.
+ *
+ * Usage:
+ *   config_save_async(path, config, plot, serial_settings);   // Save button
+ *   if (autosave_update(dev.autosave, config, plot, settings, now_ms)) {
+ *       config_save_async(dev.config_json_path.c_str(), config, plot, settings);
+ *   }
+ */
+
+#ifndef DARTT_CONFIG_SAVE_H
+#define DARTT_CONFIG_SAVE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "plotting.h"
+
+/* Quiet time after the last session change before an autosave */
+#define CONFIG_AUTOSAVE_DELAY_MS 1000
+
+/* Queue a save of config to path; the session is captured now (devices as for capture_session) */
+void config_save_async(const char* path, const DarttConfig& config, const Plotter& plot,
+                       const DarttSerialSettings& serial, const std::vector<PlotSourceDevice>* devices = nullptr);
+
+/* Block until every queued save has been written */
+void config_save_wait();
+
+/* A save is queued or being written */
+bool config_save_busy();
+
+struct ConfigAutosave
+{
+    bool enabled;
+    bool pending;               // changed since the last save
+    bool rebase;                // take the next session seen as the saved one (autosave_reset)
+    bool force;                 // count the next session seen as a change (autosave_mark_changed)
+    uint64_t fingerprint;       // of the session as last seen
+    uint64_t changed_ms;
+
+    ConfigAutosave() : enabled(true), pending(false), rebase(false), force(false), fingerprint(0), changed_ms(0) {}
+};
+
+/* The config was just loaded from its file: the session as it stands is what is on disk */
+void autosave_reset(ConfigAutosave& autosave);
+
+/* The session differs from the file though no setting was touched (a hot reload carried it over) */
+void autosave_mark_changed(ConfigAutosave& autosave);
+
+/*
+ * Call once per frame. Returns true when the session has changed and then stayed
+ * unchanged for CONFIG_AUTOSAVE_DELAY_MS.
+ */
+bool autosave_update(ConfigAutosave& autosave, const DarttConfig& config, const Plotter& plot,
+                     const DarttSerialSettings& serial, uint64_t now_ms);
+
+#endif /* DARTT_CONFIG_SAVE_H */
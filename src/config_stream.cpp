@@ -0,0 +1,1421 @@
+/*
+ * config_stream.cpp - single-pass streaming parser for DARTT config JSON
+ *
+ * The SAX handler keeps a stack of frames, one per open JSON object or array it
+ * cares about. Each frame accumulates what its keys say and, when it closes, hands
+ * the finished piece (a field, a type, a symbol) to the frame below it. Members are
+ * not assumed to come in any order: the generator writes keys sorted, so a type's
+ * "element_type" and "fields" arrive before its "type". Anything not recognised is
+ * skipped without being stored.
+ *
+ * The writer walks a loaded tree back into the same schema. Arrays are written
+ * from their shape (dims, strides, element template), never from elements that
+ * happen to have been built, so a saved file does not grow as the user expands.
+ * Saving over a file that already holds the layout splices the session sections
+ * into it instead (splice_dartt_config_json).
+ */
+
+#include "config_stream.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+using json = nlohmann::json;
+
+/* ============================================================================
+ * Frames
+ * ============================================================================ */
+
+enum FrameKind {
+    FRAME_DOC,          // the document, or one element of "symbols"
+    FRAME_SYMBOLS,      // "symbols": [ doc, ... ]
+    FRAME_TYPE,         // a type_info object
+    FRAME_FIELDS,       // "fields": [ field, ... ]
+    FRAME_FIELD,        // one struct/union member
+    FRAME_DIMS,         // "dimensions": [ n, ... ]
+    FRAME_ENUMS,        // "enumerators": [ { name, value }, ... ]
+    FRAME_ENUMERATOR,
+    FRAME_UI_MAP,       // "ui_map": { "offset:name": entry, ... }
+    FRAME_UI_ENTRY,
+    FRAME_CAPTURE,      // a section kept as JSON (see StreamedConfig::extras)
+    FRAME_SKIP          // anything else, with its nesting depth
+};
+
+/* What one type_info says, before it is turned into DarttField settings */
+struct TypeData {
+    DarttField field;           // children (struct/union members) collect here
+    std::string type_str;
+    std::string type_def;
+    bool has_typedef;
+    uint32_t size;
+    uint32_t total_elements;
+    std::vector<uint32_t> dims;
+    std::vector<std::pair<int64_t, std::string>> enumerators;
+    bool has_enumerators;
+    std::unique_ptr<TypeData> element;      // "element_type" of an array
+
+    TypeData() : has_typedef(false), size(0), total_elements(0), has_enumerators(false) {}
+};
+
+struct Frame {
+    FrameKind kind;
+    std::string key;            // member being read (object frames)
+
+    TypeData type;              // TYPE: itself; FIELD/DOC: the finished type_info; FIELDS/DIMS/ENUMS: the list
+    std::string name;           // FIELD
+    uint32_t byte_offset;       // FIELD
+    uint32_t dartt_offset;      // FIELD
+    uint32_t bit_size;          // FIELD
+    uint32_t bit_offset;        // FIELD
+    DarttSymbol sym;            // DOC
+    bool has_type;              // DOC
+    bool is_top;                // DOC: the document itself
+    std::pair<int64_t, std::string> enumerator;     // ENUMERATOR
+    UiMapEntry ui;              // UI_ENTRY
+    json capture;               // CAPTURE: the section so far
+    std::vector<json*> capture_path;    // CAPTURE: open containers, innermost last
+    std::string capture_name;   // CAPTURE: which section
+    uint32_t depth;             // SKIP: containers opened inside the skipped value
+
+    explicit Frame(FrameKind k)
+        : kind(k), byte_offset(0), dartt_offset(0), bit_size(0), bit_offset(0)
+        , has_type(false), is_top(false), depth(0) {}
+};
+
+/* A scalar event's value, read as whichever type the key wants */
+struct Scalar {
+    bool is_float;
+    bool is_negative;
+    int64_t i;
+    uint64_t u;
+    double d;
+
+    uint32_t as_u32() const { return is_float ? (uint32_t)d : is_negative ? 0 : (uint32_t)u; }
+    int64_t as_i64() const { return is_float ? (int64_t)d : is_negative ? i : (int64_t)u; }
+    float as_float() const { return is_float ? (float)d : is_negative ? (float)i : (float)u; }
+};
+
+/* ============================================================================
+ * Turning parsed pieces into fields
+ * ============================================================================ */
+
+typedef std::unordered_map<std::string, DarttEnumRef> EnumCache;
+
+/*
+Shared enumerator table for an enum type. The JSON repeats an enum's enumerators at
+every use, so tables are deduplicated on name and contents and built once per type.
+*/
+static DarttEnumRef enum_table(const std::string& type_name,
+                               std::vector<std::pair<int64_t, std::string>>& entries, EnumCache& enums)
+{
+    std::string key = type_name;
+    for (size_t i = 0; i < entries.size(); i++)
+	{
+        key += '|';
+        key += std::to_string(entries[i].first);
+        key += '=';
+        key += entries[i].second;
+    }
+    EnumCache::iterator it = enums.find(key);
+    if (it != enums.end())
+	{
+        return it->second;
+    }
+    DarttEnumRef table = make_enum_table(type_name, std::move(entries));
+    enums[key] = table;
+    return table;
+}
+
+// Apply a finished type_info to its field: type, size, type name, enum table and array shape
+static void finish_type(TypeData& t, EnumCache& enums)
+{
+    DarttField& field = t.field;
+    const std::string type_str = t.type_str.empty() ? std::string("unknown") : t.type_str;
+
+    field.type = parse_field_type(type_str);
+    field.nbytes = t.size;
+    field.type_name = t.has_typedef ? t.type_def : type_str;
+    if (type_str == "enum" && t.has_enumerators)
+	{
+        field.enum_info = enum_table(field.type_name, t.enumerators, enums);
+    }
+
+    if (type_str == "array")
+	{
+        field.array_size = t.total_elements;
+        field.dims = std::move(t.dims);
+        if (t.element)
+		{
+            TypeData& elem = *t.element;
+            field.element_nbytes = elem.size;
+            if (elem.type_str == "struct" || elem.type_str == "union")
+			{
+                // Array of structs: the element becomes the single child init_lazy_arrays expects
+                field.children.clear();
+                field.children.push_back(std::move(elem.field));
+            }
+			else
+			{
+                // Primitive array, typed from its element like the ELF loader does, so a
+                // typedef'd element ("q_t") still knows it is an int32_t
+                field.children.clear();
+                FieldType elem_type = parse_field_type(elem.type_str);
+                if (is_primitive_type(elem_type))
+				{
+                    field.type = elem_type;
+                }
+                field.type_name = elem.has_typedef ? elem.type_def : (elem.type_str.empty() ? std::string("unknown") : elem.type_str);
+                if (elem.type_str == "enum" && elem.has_enumerators)
+				{
+                    field.enum_info = enum_table(field.type_name, elem.enumerators, enums);
+                }
+            }
+        }
+    }
+	else if (type_str != "struct" && type_str != "union")
+	{
+        field.children.clear();
+    }
+}
+
+/* ============================================================================
+ * SAX handler
+ * ============================================================================ */
+
+class ConfigSax {
+public:
+    explicit ConfigSax(StreamedConfig& out) : out(out), saw_symbols(false) {}
+
+    bool null() { return scalar_json(json()); }
+    bool boolean(bool v) {
+        if (capturing_or_skipping()) return scalar_json(json(v));
+        Frame& f = stack.back();
+        if (f.kind == FRAME_UI_ENTRY) {
+            if (f.key == "subscribed") f.ui.subscribed = v;
+            else if (f.key == "use_display_scale") f.ui.use_display_scale = v;
+        }
+        return true;
+    }
+    bool number_integer(int64_t v) {
+        if (capturing_or_skipping()) return scalar_json(json(v));
+        Scalar s = { false, v < 0, v, (uint64_t)v, (double)v };
+        return number(s);
+    }
+    bool number_unsigned(uint64_t v) {
+        if (capturing_or_skipping()) return scalar_json(json(v));
+        Scalar s = { false, false, (int64_t)v, v, (double)v };
+        return number(s);
+    }
+    bool number_float(double v) {
+        if (capturing_or_skipping()) return scalar_json(json(v));
+        Scalar s = { true, v < 0, (int64_t)v, 0, v };
+        return number(s);
+    }
+    bool string(std::string& v) {
+        if (capturing_or_skipping()) return scalar_json(json(std::move(v)));
+        Frame& f = stack.back();
+        switch (f.kind) {
+            case FRAME_DOC:
+                if (f.key == "symbol") f.sym.name = std::move(v);
+                else if (f.key == "address") f.sym.address_str = std::move(v);
+                break;
+            case FRAME_TYPE:
+                if (f.key == "type") f.type.type_str = std::move(v);
+                else if (f.key == "typedef") { f.type.type_def = std::move(v); f.type.has_typedef = true; }
+                break;
+            case FRAME_FIELD:
+                if (f.key == "name") f.name = std::move(v);
+                break;
+            case FRAME_ENUMERATOR:
+                if (f.key == "name") f.enumerator.second = std::move(v);
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+    bool key(std::string& k) {
+        Frame& f = stack.back();
+        if (f.kind == FRAME_SKIP) return true;
+        f.key = std::move(k);
+        return true;
+    }
+
+    bool start_object() {
+        if (stack.empty()) {
+            stack.emplace_back(FRAME_DOC);
+            stack.back().is_top = true;
+            return true;
+        }
+        if (capturing_or_skipping()) return open_nested(json::object());
+
+        Frame& f = stack.back();
+        switch (f.kind) {
+            case FRAME_DOC:
+                if (f.key == "type") return push(FRAME_TYPE);
+                if (f.is_top && f.key == "ui_map") return push(FRAME_UI_MAP);
+                if (f.is_top && (f.key == "serial_settings" || f.key == "plotting")) {
+                    std::string name = f.key;
+                    push(FRAME_CAPTURE);
+                    stack.back().capture_name = std::move(name);
+                    stack.back().capture = json::object();
+                    stack.back().capture_path.push_back(&stack.back().capture);
+                    return true;
+                }
+                break;
+            case FRAME_SYMBOLS:
+                return push(FRAME_DOC);
+            case FRAME_TYPE:
+                if (f.key == "element_type") return push(FRAME_TYPE);
+                break;
+            case FRAME_FIELDS:
+                return push(FRAME_FIELD);
+            case FRAME_FIELD:
+                if (f.key == "type_info") return push(FRAME_TYPE);
+                break;
+            case FRAME_ENUMS:
+                return push(FRAME_ENUMERATOR);
+            case FRAME_UI_MAP: {
+                // Key is "<byte_offset>:<name>"
+                size_t colon = f.key.find(':');
+                if (colon == std::string::npos) break;
+                push(FRAME_UI_ENTRY);
+                Frame& e = stack.back();
+                Frame& map = stack[stack.size() - 2];
+                e.ui.byte_offset = (uint32_t)strtoul(map.key.c_str(), nullptr, 10);
+                e.ui.name.assign(map.key, colon + 1, std::string::npos);
+                return true;
+            }
+            default:
+                break;
+        }
+        return push(FRAME_SKIP);
+    }
+
+    bool start_array() {
+        if (stack.empty()) return push(FRAME_SKIP);
+        if (capturing_or_skipping()) return open_nested(json::array());
+
+        Frame& f = stack.back();
+        if (f.kind == FRAME_DOC && f.is_top && f.key == "symbols") {
+            saw_symbols = true;
+            return push(FRAME_SYMBOLS);
+        }
+        if (f.kind == FRAME_TYPE) {
+            if (f.key == "fields") return push(FRAME_FIELDS);
+            if (f.key == "dimensions") return push(FRAME_DIMS);
+            if (f.key == "enumerators") return push(FRAME_ENUMS);
+        }
+        return push(FRAME_SKIP);
+    }
+
+    bool end_object() { return close(); }
+    bool end_array() { return close(); }
+
+private:
+    StreamedConfig& out;
+    std::vector<Frame> stack;
+    EnumCache enums;
+    bool saw_symbols;
+
+    bool push(FrameKind kind) {
+        stack.emplace_back(kind);
+        return true;
+    }
+
+    bool capturing_or_skipping() const {
+        return !stack.empty() && (stack.back().kind == FRAME_SKIP || stack.back().kind == FRAME_CAPTURE);
+    }
+
+    // A container opened inside a skipped or captured value
+    bool open_nested(json container) {
+        Frame& f = stack.back();
+        if (f.kind == FRAME_SKIP) {
+            f.depth++;
+            return true;
+        }
+        json* parent = f.capture_path.back();
+        json* child;
+        if (parent->is_array()) {
+            parent->push_back(std::move(container));
+            child = &parent->back();
+        } else {
+            child = &(*parent)[f.key];
+            *child = std::move(container);
+        }
+        f.capture_path.push_back(child);
+        return true;
+    }
+
+    // A scalar inside a skipped or captured value
+    bool scalar_json(json v) {
+        if (stack.empty()) return true;
+        Frame& f = stack.back();
+        if (f.kind != FRAME_CAPTURE) return true;
+        json* parent = f.capture_path.back();
+        if (parent->is_array()) {
+            parent->push_back(std::move(v));
+        } else {
+            (*parent)[f.key] = std::move(v);
+        }
+        return true;
+    }
+
+    bool number(const Scalar& s) {
+        Frame& f = stack.back();
+        switch (f.kind) {
+            case FRAME_DOC:
+                if (f.key == "address_int") f.sym.address = s.as_u32();
+                else if (f.key == "nbytes") f.sym.nbytes = s.as_u32();
+                else if (f.key == "base_offset") f.sym.base_offset = s.as_u32();
+                break;
+            case FRAME_TYPE:
+                if (f.key == "size") f.type.size = s.as_u32();
+                else if (f.key == "total_elements") f.type.total_elements = s.as_u32();
+                break;
+            case FRAME_FIELD:
+                if (f.key == "byte_offset") f.byte_offset = s.as_u32();
+                else if (f.key == "dartt_offset") f.dartt_offset = s.as_u32();
+                else if (f.key == "bit_size") f.bit_size = s.as_u32();
+                else if (f.key == "bit_offset") f.bit_offset = s.as_u32();
+                break;
+            case FRAME_DIMS:
+                f.type.dims.push_back(s.as_u32());
+                break;
+            case FRAME_ENUMERATOR:
+                if (f.key == "value") f.enumerator.first = s.as_i64();
+                break;
+            case FRAME_UI_ENTRY:
+                if (f.key == "display_scale") f.ui.display_scale = s.as_float();
+                else if (f.key == "poll_rate_hz") f.ui.poll_rate_hz = s.as_float();
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    // Close the innermost container and hand its result to the frame below
+    bool close() {
+        Frame& f = stack.back();
+        if (f.kind == FRAME_SKIP && f.depth > 0) {
+            f.depth--;
+            return true;
+        }
+        if (f.kind == FRAME_CAPTURE && f.capture_path.size() > 1) {
+            f.capture_path.pop_back();
+            return true;
+        }
+
+        // Nothing is pushed while closing, so both references stay valid until the pop
+        Frame& done = stack.back();
+        Frame* parent = (stack.size() > 1) ? &stack[stack.size() - 2] : nullptr;
+
+        switch (done.kind) {
+            case FRAME_DOC:
+                finish_doc(done);
+                break;
+            case FRAME_TYPE:
+                finish_type(done.type, enums);
+                if (!parent) break;
+                if (parent->kind == FRAME_TYPE) {
+                    parent->type.element.reset(new TypeData(std::move(done.type)));
+                } else {
+                    parent->type = std::move(done.type);   // FIELD's type_info or DOC's type
+                    parent->has_type = true;
+                }
+                break;
+            case FRAME_FIELD: {
+                DarttField field = std::move(done.type.field);
+                field.name = std::move(done.name);
+                field.byte_offset = done.byte_offset;
+                field.dartt_offset = done.dartt_offset;
+                if (done.bit_size > 0) {
+                    // Written normalised: bit_offset counts from the LSB of the byte at byte_offset
+                    uint32_t abs_bit = field.byte_offset * 8 + done.bit_offset;
+                    if (!set_bitfield_layout(field, abs_bit, done.bit_size)) {
+                        fprintf(stderr, "Warning: bitfield %s spans more than 8 bytes, shown as whole bytes\n", field.name.c_str());
+                    }
+                }
+                parent->type.field.children.push_back(std::move(field));
+                break;
+            }
+            case FRAME_FIELDS:
+                parent->type.field.children = std::move(done.type.field.children);
+                break;
+            case FRAME_DIMS:
+                parent->type.dims = std::move(done.type.dims);
+                break;
+            case FRAME_ENUMERATOR:
+                parent->type.enumerators.push_back(std::move(done.enumerator));
+                break;
+            case FRAME_ENUMS:
+                parent->type.enumerators = std::move(done.type.enumerators);
+                parent->type.has_enumerators = true;
+                break;
+            case FRAME_UI_ENTRY:
+                out.ui_map.push_back(std::move(done.ui));
+                break;
+            case FRAME_CAPTURE:
+                out.extras[done.capture_name] = std::move(done.capture);
+                break;
+            default:
+                break;
+        }
+        stack.pop_back();
+        return true;
+    }
+
+    void finish_doc(Frame& doc) {
+        if (!doc.is_top) {
+            out.symbols.push_back(doc.sym);
+            out.roots.push_back(doc.has_type ? std::move(doc.type.field) : DarttField());
+            return;
+        }
+        // Without a "symbols" list the document itself describes the one symbol
+        if (!saw_symbols) {
+            out.symbols.push_back(doc.sym);
+            out.roots.push_back(doc.has_type ? std::move(doc.type.field) : DarttField());
+        }
+        if (out.symbols.size() == 1 && out.symbols[0].base_offset == DARTT_SYMBOL_PACKED) {
+            out.symbols[0].base_offset = 0;
+        }
+    }
+};
+
+/* ============================================================================
+ * Scanner
+ *
+ * A minimal RFC 8259 tokenizer feeding ConfigSax. Configs are mostly keys and small
+ * integers, which it handles without allocating beyond the reused string buffer;
+ * only values with a fraction or exponent go through from_chars.
+ * ============================================================================ */
+
+static inline bool is_json_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static void append_utf8(std::string& s, uint32_t cp) {
+    if (cp < 0x80) {
+        s.push_back((char)cp);
+    } else if (cp < 0x800) {
+        s.push_back((char)(0xC0 | (cp >> 6)));
+        s.push_back((char)(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        s.push_back((char)(0xE0 | (cp >> 12)));
+        s.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        s.push_back((char)(0x80 | (cp & 0x3F)));
+    } else {
+        s.push_back((char)(0xF0 | (cp >> 18)));
+        s.push_back((char)(0x80 | ((cp >> 12) & 0x3F)));
+        s.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+        s.push_back((char)(0x80 | (cp & 0x3F)));
+    }
+}
+
+static bool read_hex4(const char*& p, const char* end, uint32_t& v) {
+    if (end - p < 4) return false;
+    v = 0;
+    for (int i = 0; i < 4; i++, p++) {
+        char c = *p;
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+        else if (c >= 'a' && c <= 'f') v |= (uint32_t)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') v |= (uint32_t)(c - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+/* p is just past the opening quote; on success it is just past the closing one */
+static bool scan_string(const char*& p, const char* end, std::string& s) {
+    s.clear();
+    while (p < end) {
+        const char* run = p;
+        while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+            p++;
+        }
+        s.append(run, p - run);
+        if (p >= end || (unsigned char)*p < 0x20) {
+            return false;
+        }
+        if (*p == '"') {
+            p++;
+            return true;
+        }
+        if (++p >= end) return false;      /* backslash */
+        char e = *p++;
+        switch (e) {
+            case '"': s.push_back('"'); break;
+            case '\\': s.push_back('\\'); break;
+            case '/': s.push_back('/'); break;
+            case 'b': s.push_back('\b'); break;
+            case 'f': s.push_back('\f'); break;
+            case 'n': s.push_back('\n'); break;
+            case 'r': s.push_back('\r'); break;
+            case 't': s.push_back('\t'); break;
+            case 'u': {
+                uint32_t cp;
+                if (!read_hex4(p, end, cp)) return false;
+                if (cp >= 0xDC00 && cp <= 0xDFFF) return false;    /* low surrogate with no high one */
+                if (cp >= 0xD800 && cp <= 0xDBFF) {
+                    uint32_t lo;
+                    if (end - p < 2 || p[0] != '\\' || p[1] != 'u') return false;
+                    p += 2;
+                    if (!read_hex4(p, end, lo) || lo < 0xDC00 || lo > 0xDFFF) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                append_utf8(s, cp);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+static bool scan_number(const char*& p, const char* end, ConfigSax& h, bool& handler_ok) {
+    const char* start = p;
+    bool negative = false;
+    if (*p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p >= end || *p < '0' || *p > '9') return false;
+    uint64_t v = 0;
+    bool overflow = false;
+    if (*p == '0') {
+        p++;
+    } else {
+        while (p < end && *p >= '0' && *p <= '9') {
+            uint64_t d = (uint64_t)(*p - '0');
+            if (v > (UINT64_MAX - d) / 10) overflow = true;
+            v = v * 10 + d;
+            p++;
+        }
+    }
+    bool is_float = overflow;
+    if (p < end && *p == '.') {
+        is_float = true;
+        p++;
+        if (p >= end || *p < '0' || *p > '9') return false;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        is_float = true;
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p >= end || *p < '0' || *p > '9') return false;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+
+    if (!is_float && negative && v > (uint64_t)INT64_MAX + 1) {
+        is_float = true;
+    }
+    if (is_float) {
+        double d = 0.0;
+        std::from_chars_result r = std::from_chars(start, p, d);
+        if (r.ec == std::errc::result_out_of_range) {
+            d = strtod(std::string(start, p).c_str(), nullptr);    /* from_chars leaves d alone; this gives +-inf or 0 */
+        } else if (r.ec != std::errc()) {
+            return false;
+        }
+        handler_ok = h.number_float(d);
+    } else if (negative) {
+        handler_ok = h.number_integer((int64_t)(0 - v));
+    } else {
+        handler_ok = h.number_unsigned(v);
+    }
+    return true;
+}
+
+static bool scan_literal(const char*& p, const char* end, const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end - p) < n || memcmp(p, word, n) != 0) return false;
+    p += n;
+    return true;
+}
+
+/* Scan one JSON document, calling h for every event. Returns false with *error set on bad input. */
+static bool scan_json(const char* text, size_t len, ConfigSax& h, std::string* error) {
+    enum State { VALUE, VALUE_OR_END, KEY, KEY_OR_END, COMMA_OR_END, DONE };
+    const char* p = text;
+    const char* end = text + len;
+    std::vector<char> open;     /* '{' or '[' for each open container */
+    std::string buf;
+    State state = VALUE;
+    const char* what = "unexpected end of input";
+
+    while (true) {
+        while (p < end && is_json_space(*p)) p++;
+        if (state == DONE) {
+            if (p == end) return true;
+            what = "trailing characters after the document";
+            break;
+        }
+        if (p >= end) {
+            what = "unexpected end of input";
+            break;
+        }
+
+        char c = *p;
+        bool ok = true;
+        if (state == KEY || state == KEY_OR_END) {
+            if (state == KEY_OR_END && c == '}') {
+                p++;
+                open.pop_back();
+                ok = h.end_object();
+            } else {
+                if (c != '"') { what = "expected a member name"; break; }
+                p++;
+                if (!scan_string(p, end, buf)) { what = "bad string"; break; }
+                while (p < end && is_json_space(*p)) p++;
+                if (p >= end || *p != ':') { what = "expected ':'"; break; }
+                p++;
+                if (!h.key(buf)) { what = "rejected by handler"; break; }
+                state = VALUE;
+                continue;
+            }
+        } else if (state == COMMA_OR_END) {
+            char close = (open.back() == '{') ? '}' : ']';
+            if (c == ',') {
+                p++;
+                state = (open.back() == '{') ? KEY : VALUE;
+                continue;
+            }
+            if (c != close) { what = "expected ',' or the end of the container"; break; }
+            p++;
+            open.pop_back();
+            ok = (close == '}') ? h.end_object() : h.end_array();
+        } else if (state == VALUE_OR_END && c == ']') {
+            p++;
+            open.pop_back();
+            ok = h.end_array();
+        } else {
+            switch (c) {
+                case '{':
+                    p++;
+                    open.push_back('{');
+                    if (!h.start_object()) { what = "rejected by handler"; goto fail; }
+                    state = KEY_OR_END;
+                    continue;
+                case '[':
+                    p++;
+                    open.push_back('[');
+                    if (!h.start_array()) { what = "rejected by handler"; goto fail; }
+                    state = VALUE_OR_END;
+                    continue;
+                case '"':
+                    p++;
+                    if (!scan_string(p, end, buf)) { what = "bad string"; goto fail; }
+                    ok = h.string(buf);
+                    break;
+                case 't':
+                    if (!scan_literal(p, end, "true")) { what = "bad literal"; goto fail; }
+                    ok = h.boolean(true);
+                    break;
+                case 'f':
+                    if (!scan_literal(p, end, "false")) { what = "bad literal"; goto fail; }
+                    ok = h.boolean(false);
+                    break;
+                case 'n':
+                    if (!scan_literal(p, end, "null")) { what = "bad literal"; goto fail; }
+                    ok = h.null();
+                    break;
+                default:
+                    if (!scan_number(p, end, h, ok)) { what = "bad value"; goto fail; }
+                    break;
+            }
+        }
+        if (!ok) {
+            what = "rejected by handler";
+            break;
+        }
+        state = open.empty() ? DONE : COMMA_OR_END;
+    }
+
+fail:
+    if (error) {
+        char msg[96];
+        snprintf(msg, sizeof(msg), "%s at byte %zu", what, (size_t)(p - text));
+        *error = msg;
+    }
+    return false;
+}
+
+bool stream_dartt_config(const char* text, size_t len, StreamedConfig& out, std::string* error)
+{
+    ConfigSax handler(out);
+    return scan_json(text, len, handler, error);
+}
+
+/* ============================================================================
+ * Writer
+ * ============================================================================ */
+
+/* Text in the layout of nlohmann's dump(indent): one member per line, 2-space indent by default */
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out, size_t indent = 2) : out(out), indent(indent), after_key(false) {}
+
+    void begin_object() { open('{'); }
+    void end_object() { close('}'); }
+    void begin_array() { open('['); }
+    void end_array() { close(']'); }
+
+    void key(const char* k) {
+        item();
+        put_string(k, strlen(k));
+        out += ": ";
+        after_key = true;
+    }
+    void value(const std::string& v) { item(); put_string(v.data(), v.size()); }
+    void value(const char* v) { item(); put_string(v, strlen(v)); }
+    void value(bool v) { item(); out += v ? "true" : "false"; }
+    void value(uint64_t v) { item(); put_chars(v); }
+    void value(uint32_t v) { value((uint64_t)v); }
+    void value(int64_t v) { item(); put_chars(v); }
+    void value(int32_t v) { value((int64_t)v); }
+    void value(float v) {
+        item();
+        if (!std::isfinite(v)) {
+            out += "null";      /* as nlohmann writes them; the loader falls back to the default */
+            return;
+        }
+        char buf[32];
+        std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);     /* shortest form that reads back as v */
+        size_t n = (size_t)(r.ptr - buf);
+        out.append(buf, n);
+        if (!memchr(buf, '.', n) && !memchr(buf, 'e', n)) {
+            out += ".0";
+        }
+    }
+
+private:
+    std::string& out;
+    size_t indent;                  // spaces per level
+    std::vector<bool> has_items;    // per open container
+    bool after_key;                 // the next value goes on the key's line
+
+    void item() {
+        if (after_key) {
+            after_key = false;
+            return;
+        }
+        if (has_items.empty()) {
+            return;
+        }
+        if (has_items.back()) {
+            out += ',';
+        }
+        has_items.back() = true;
+        out += '\n';
+        out.append(has_items.size() * indent, ' ');
+    }
+    void open(char c) {
+        item();
+        out += c;
+        has_items.push_back(false);
+    }
+    void close(char c) {
+        bool any = has_items.back();
+        has_items.pop_back();
+        if (any) {
+            out += '\n';
+            out.append(has_items.size() * indent, ' ');
+        }
+        out += c;
+    }
+    template <typename T> void put_chars(T v) {
+        char buf[24];
+        std::to_chars_result r = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, (size_t)(r.ptr - buf));
+    }
+    void put_string(const char* s, size_t n) {
+        out += '"';
+        for (size_t i = 0; i < n; i++) {
+            char c = s[i];
+            switch (c) {
+                case '"':  out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\b': out += "\\b"; break;
+                case '\f': out += "\\f"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+                default:
+                    if ((unsigned char)c < 0x20) {
+                        char esc[8];
+                        snprintf(esc, sizeof(esc), "\\u%04x", (unsigned)c);
+                        out += esc;
+                    } else {
+                        out += c;
+                    }
+                    break;
+            }
+        }
+        out += '"';
+    }
+};
+
+/* The "type" string parse_field_type maps back to t */
+static const char* field_type_json_name(FieldType t) {
+    switch (t) {
+        case FieldType::STRUCT:  return "struct";
+        case FieldType::UNION:   return "union";
+        case FieldType::ARRAY:   return "array";
+        case FieldType::FLOAT:   return "float";
+        case FieldType::DOUBLE:  return "double";
+        case FieldType::INT8:    return "int8_t";
+        case FieldType::UINT8:   return "uint8_t";
+        case FieldType::INT16:   return "int16_t";
+        case FieldType::UINT16:  return "uint16_t";
+        case FieldType::INT32:   return "int32_t";
+        case FieldType::UINT32:  return "uint32_t";
+        case FieldType::INT64:   return "int64_t";
+        case FieldType::UINT64:  return "uint64_t";
+        case FieldType::POINTER: return "pointer";
+        case FieldType::ENUM:    return "enum";
+        default:                 return "unknown";
+    }
+}
+
+static bool is_array_node(const DarttField& f) {
+    return !f.dims.empty() || f.array_size > 0 || f.type == FieldType::ARRAY;
+}
+
+static const DarttField* array_element_template(const DarttField& f) {
+    if (f.element_template) {
+        return f.element_template.get();
+    }
+    if (!is_shaped_array(f) && f.children.size() == 1 &&
+        (f.children[0].type == FieldType::STRUCT || f.children[0].type == FieldType::UNION)) {
+        return &f.children[0];
+    }
+    return nullptr;
+}
+
+static void write_enumerators(JsonWriter& w, const DarttEnum& e) {
+    w.key("enumerators");
+    w.begin_array();
+    for (size_t i = 0; i < e.values.size(); i++) {
+        w.begin_object();
+        w.key("name");
+        w.value(e.names[i]);
+        w.key("value");
+        w.value(e.values[i]);
+        w.end_object();
+    }
+    w.end_array();
+}
+
+/* Scalar element of a primitive array, typed as materialize_children would type it */
+static void write_scalar_element(JsonWriter& w, const DarttField& f, uint32_t elem_size) {
+    FieldType elem_type = parse_field_type(f.type_name);
+    if (elem_type == FieldType::UNKNOWN && f.enum_info) {
+        elem_type = FieldType::ENUM;
+    } else if (elem_type == FieldType::UNKNOWN && is_primitive_type(f.type)) {
+        elem_type = f.type;
+    }
+    const char* type = field_type_json_name(elem_type);
+    w.key("element_type");
+    w.begin_object();
+    if (f.enum_info && elem_type == FieldType::ENUM) {
+        write_enumerators(w, *f.enum_info);
+    }
+    if (elem_size > 0) {
+        w.key("size");
+        w.value(elem_size);
+    }
+    w.key("type");
+    w.value(type);
+    if (f.type_name != type) {
+        w.key("typedef");
+        w.value(f.type_name);
+    }
+    w.end_object();
+}
+
+enum WriteStep {
+    WRITE_TYPE,         // a type_info object
+    WRITE_TYPE_TAIL,    // its keys after the nested ones, and the closing brace
+    WRITE_FIELD,        // one member of "fields"
+    WRITE_END_OBJECT,
+    WRITE_END_ARRAY
+};
+
+struct WriteWork {
+    WriteStep step;
+    const DarttField* field;
+};
+
+/*
+ * Write field as a type_info. shift is subtracted from every offset: a symbol's tree
+ * is written relative to its own base, as combine_symbol_roots expects to find it.
+ * Keys go out sorted, so nested members are written between the scalar ones.
+ */
+static void write_type_info(JsonWriter& w, const DarttField& root, uint32_t shift) {
+    std::vector<WriteWork> stack;
+    stack.push_back({WRITE_TYPE, &root});
+    while (!stack.empty()) {
+        WriteWork work = stack.back();
+        stack.pop_back();
+        const DarttField& f = *work.field;
+
+        switch (work.step) {
+            case WRITE_TYPE: {
+                w.begin_object();
+                stack.push_back({WRITE_TYPE_TAIL, &f});
+                if (is_array_node(f)) {
+                    uint32_t inner = 1;
+                    w.key("dimensions");
+                    w.begin_array();
+                    for (size_t i = 0; i < f.dims.size(); i++) {
+                        w.value(f.dims[i]);
+                        if (i > 0) {
+                            inner *= f.dims[i];
+                        }
+                    }
+                    w.end_array();
+                    const DarttField* tmpl = array_element_template(f);
+                    if (tmpl) {
+                        w.key("element_type");
+                        stack.push_back({WRITE_TYPE, tmpl});
+                    } else {
+                        write_scalar_element(w, f, is_shaped_array(f) ? f.element_nbytes / inner : f.element_nbytes);
+                    }
+                    break;
+                }
+                if (f.enum_info && f.type == FieldType::ENUM) {
+                    write_enumerators(w, *f.enum_info);
+                }
+                if (f.type == FieldType::STRUCT || f.type == FieldType::UNION) {
+                    w.key("fields");
+                    w.begin_array();
+                    stack.push_back({WRITE_END_ARRAY, nullptr});
+                    for (size_t i = f.children.size(); i > 0; i--) {
+                        stack.push_back({WRITE_FIELD, &f.children[i - 1]});
+                    }
+                }
+                break;
+            }
+            case WRITE_TYPE_TAIL: {
+                bool array = is_array_node(f);
+                if (f.nbytes > 0) {
+                    w.key("size");
+                    w.value(f.nbytes);
+                }
+                if (array) {
+                    uint32_t total = f.array_size;
+                    if (is_shaped_array(f)) {
+                        total = 1;
+                        for (uint32_t d : f.dims) {
+                            total *= d;
+                        }
+                    }
+                    w.key("total_elements");
+                    w.value(total);
+                }
+                const char* type = array ? "array" : field_type_json_name(f.type);
+                w.key("type");
+                w.value(type);
+                /* A scalar array takes its type name from the element, written there */
+                if (f.type_name != type && (!array || array_element_template(f))) {
+                    w.key("typedef");
+                    w.value(f.type_name);
+                }
+                w.end_object();
+                break;
+            }
+            case WRITE_FIELD: {
+                uint32_t byte_offset = f.byte_offset - shift;
+                w.begin_object();
+                if (f.bit_size > 0) {
+                    w.key("bit_offset");
+                    w.value((uint32_t)f.bit_shift);
+                    w.key("bit_size");
+                    w.value((uint32_t)f.bit_size);
+                }
+                w.key("byte_offset");
+                w.value(byte_offset);
+                w.key("dartt_offset");
+                w.value(byte_offset / 4);
+                w.key("name");
+                w.value(f.name);
+                w.key("type_info");
+                stack.push_back({WRITE_END_OBJECT, nullptr});
+                stack.push_back({WRITE_TYPE, &f});
+                break;
+            }
+            case WRITE_END_OBJECT:
+                w.end_object();
+                break;
+            case WRITE_END_ARRAY:
+                w.end_array();
+                break;
+        }
+    }
+}
+
+static void write_plot_source(JsonWriter& w, const char* key, const PlotSourceRef& ref) {
+    w.key(key);
+    w.begin_object();
+    w.key("byte_offset");
+    w.value(ref.byte_offset);
+    if (ref.device != PLOT_SOURCE_THIS_DEVICE) {
+        w.key("device");
+        w.value(ref.device);
+    }
+    w.key("name");
+    w.value(ref.name);
+    w.end_object();
+}
+
+static void write_plotting(JsonWriter& w, const std::vector<SavedPlotLine>& lines) {
+    w.key("plotting");
+    w.begin_object();
+    w.key("lines");
+    w.begin_array();
+    for (size_t i = 0; i < lines.size(); i++) {
+        const SavedPlotLine& line = lines[i];
+        w.begin_object();
+        w.key("color");
+        w.begin_array();
+        w.value((uint32_t)line.color.r);
+        w.value((uint32_t)line.color.g);
+        w.value((uint32_t)line.color.b);
+        w.value((uint32_t)line.color.a);
+        w.end_array();
+        w.key("enqueue_cap");
+        w.value(line.enqueue_cap);
+        w.key("mode");
+        w.value((int32_t)line.mode);
+        w.key("xoffset");
+        w.value(line.xoffset);
+        w.key("xscale");
+        w.value(line.xscale);
+        write_plot_source(w, "xsource_data", line.xsource);
+        w.key("yoffset");
+        w.value(line.yoffset);
+        w.key("yscale");
+        w.value(line.yscale);
+        write_plot_source(w, "ysource_data", line.ysource);
+        w.end_object();
+    }
+    w.end_array();
+    w.end_object();
+}
+
+static void write_serial_settings(JsonWriter& w, const DarttSerialSettings& s) {
+    w.key("serial_settings");
+    w.begin_object();
+    w.key("baudrate");
+    w.value(s.baudrate);
+    w.key("comm_mode");
+    w.value(s.comm_mode);
+    w.key("dartt_blob_base_offset");
+    w.value(s.blob_base_offset);
+    w.key("dartt_serial_address");
+    w.value(s.dartt_serial_address);
+    w.key("tcp_ip");
+    w.value(s.tcp_ip);
+    w.key("tcp_port");
+    w.value((uint32_t)s.tcp_port);
+    w.key("udp_ip");
+    w.value(s.udp_ip);
+    w.key("udp_port");
+    w.value((uint32_t)s.udp_port);
+    w.end_object();
+}
+
+static void write_ui_map(JsonWriter& w, const std::vector<UiMapEntry>& ui_map) {
+    w.key("ui_map");
+    w.begin_object();
+    for (const UiMapEntry& e : ui_map) {
+        std::string key = std::to_string(e.byte_offset) + ":" + e.name;
+        w.key(key.c_str());
+        w.begin_object();
+        w.key("display_scale");
+        w.value(e.display_scale);
+        w.key("poll_rate_hz");
+        w.value(e.poll_rate_hz);
+        w.key("subscribed");
+        w.value(e.subscribed);
+        w.key("use_display_scale");
+        w.value(e.use_display_scale);
+        w.end_object();
+    }
+    w.end_object();
+}
+
+/* "address" through "nbytes"/"nwords" of one symbol document */
+static void write_symbol_header(JsonWriter& w, const DarttSymbol& sym, bool with_base) {
+    w.key("address");
+    w.value(sym.address_str);
+    w.key("address_int");
+    w.value(sym.address);
+    if (with_base) {
+        w.key("base_offset");
+        w.value(sym.base_offset);
+    }
+    w.key("nbytes");
+    w.value(sym.nbytes);
+    w.key("nwords");
+    w.value((sym.nbytes + 3) / 4);
+}
+
+void write_dartt_config_json(std::string& out, const DarttConfig& config, const ConfigSession& session)
+{
+    JsonWriter w(out);
+    w.begin_object();
+    if (config.symbols.size() <= 1) {
+        DarttSymbol sym;
+        if (!config.symbols.empty()) {
+            sym = config.symbols[0];
+        } else {
+            sym.name = config.symbol;
+            sym.address_str = config.address_str;
+            sym.address = config.address;
+        }
+        sym.nbytes = config.nbytes;
+        write_symbol_header(w, sym, false);
+        write_plotting(w, session.lines);
+        write_serial_settings(w, session.serial);
+        w.key("symbol");
+        w.value(config.symbol);
+        w.key("type");
+        write_type_info(w, config.root, 0);
+    } else {
+        w.key("nbytes");
+        w.value(config.nbytes);
+        w.key("nwords");
+        w.value(config.nwords);
+        write_plotting(w, session.lines);
+        write_serial_settings(w, session.serial);
+        w.key("symbol");
+        w.value(config.symbol);
+        w.key("symbols");
+        w.begin_array();
+        for (size_t i = 0; i < config.symbols.size() && i < config.root.children.size(); i++) {
+            const DarttSymbol& sym = config.symbols[i];
+            w.begin_object();
+            write_symbol_header(w, sym, true);
+            w.key("symbol");
+            w.value(sym.name);
+            w.key("type");
+            write_type_info(w, config.root.children[i], sym.base_offset);
+            w.end_object();
+        }
+        w.end_array();
+    }
+    write_ui_map(w, session.ui_map);
+    w.end_object();
+    out += '\n';
+}
+
+/* ============================================================================
+ * Splicing a save into an existing document
+ *
+ * A generated sidecar carries keys the loader skips ("encoding", "pointee", "const",
+ * ...). Rewriting it from the tree would drop them, so a save onto a file with the
+ * same layout replaces only the session sections and copies every other byte.
+ * ============================================================================ */
+
+/* Where one member of the top-level object sits: text[key, value_end) is "name": value */
+struct TopMember {
+    std::string name;
+    size_t key;
+    size_t value;
+    size_t value_end;
+};
+
+/* Skip the value at p. Only used on text stream_dartt_config has already accepted. */
+static void skip_json_value(const char*& p, const char* end, std::string& buf) {
+    int depth = 0;
+    do {
+        while (p < end && is_json_space(*p)) p++;
+        if (p >= end) return;
+        char c = *p;
+        if (c == '"') {
+            p++;
+            scan_string(p, end, buf);
+        } else if (c == '{' || c == '[') {
+            depth++;
+            p++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+            p++;
+        } else if (c == ',' || c == ':') {
+            p++;
+        } else {
+            while (p < end && !is_json_space(*p) && *p != ',' && *p != '}' && *p != ']') p++;
+        }
+    } while (depth > 0);
+}
+
+static bool find_top_members(const std::string& text, std::vector<TopMember>& out) {
+    const char* begin = text.data();
+    const char* p = begin;
+    const char* end = begin + text.size();
+    std::string buf;
+    while (p < end && is_json_space(*p)) p++;
+    if (p >= end || *p != '{') return false;
+    p++;
+    while (true) {
+        while (p < end && is_json_space(*p)) p++;
+        if (p < end && *p == ',') {
+            p++;
+            while (p < end && is_json_space(*p)) p++;
+        }
+        if (p >= end) return false;
+        if (*p == '}') return true;
+        TopMember m;
+        m.key = (size_t)(p - begin);
+        p++;
+        if (!scan_string(p, end, m.name)) return false;
+        while (p < end && is_json_space(*p)) p++;
+        if (p >= end || *p != ':') return false;
+        p++;
+        while (p < end && is_json_space(*p)) p++;
+        m.value = (size_t)(p - begin);
+        skip_json_value(p, end, buf);
+        m.value_end = (size_t)(p - begin);
+        out.push_back(m);
+    }
+}
+
+static bool same_enum(const DarttEnumRef& a, const DarttEnumRef& b) {
+    if (!a || !b) return !a && !b;
+    return a->name == b->name && a->values == b->values && a->names == b->names;
+}
+
+/*
+ * The layout part of two parsed fields matches, all the way down. An array's size is
+ * left to the layout pass when the generator omits it, and follows from its shape anyway.
+ */
+static bool same_field(const DarttField& a, const DarttField& b) {
+    if (a.name != b.name || a.type != b.type || a.type_name != b.type_name ||
+        a.byte_offset != b.byte_offset || (a.array_size == 0 && a.nbytes != b.nbytes) ||
+        a.array_size != b.array_size || a.element_nbytes != b.element_nbytes || a.dims != b.dims ||
+        a.bit_size != b.bit_size || a.bit_shift != b.bit_shift ||
+        !same_enum(a.enum_info, b.enum_info) || a.children.size() != b.children.size()) {
+        return false;
+    }
+    if (a.element_template || b.element_template) {
+        if (!a.element_template || !b.element_template || !same_field(*a.element_template, *b.element_template)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.children.size(); i++) {
+        if (!same_field(a.children[i], b.children[i])) return false;
+    }
+    return true;
+}
+
+static bool same_layout(const StreamedConfig& a, const StreamedConfig& b) {
+    if (a.symbols.size() != b.symbols.size() || a.roots.size() != b.roots.size()) return false;
+    for (size_t i = 0; i < a.symbols.size(); i++) {
+        const DarttSymbol& x = a.symbols[i];
+        const DarttSymbol& y = b.symbols[i];
+        if (x.name != y.name || x.address != y.address || x.base_offset != y.base_offset || x.nbytes != y.nbytes) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < a.roots.size(); i++) {
+        if (!same_field(a.roots[i], b.roots[i])) return false;
+    }
+    return true;
+}
+
+/* Top-level keys written from the session, sorted as the generator sorts them */
+static const char* const session_sections[] = { "plotting", "serial_settings", "ui_map" };
+
+/* The value text of one session section, indented as a member of the top-level object */
+static std::string session_section_value(size_t section, const ConfigSession& session, size_t indent) {
+    std::string text;
+    JsonWriter w(text, indent);
+    w.begin_object();
+    switch (section) {
+        case 0: write_plotting(w, session.lines); break;
+        case 1: write_serial_settings(w, session.serial); break;
+        default: write_ui_map(w, session.ui_map); break;
+    }
+    w.end_object();
+    size_t value = text.find("\": ") + 3;           /* after the section's own key */
+    return text.substr(value, text.size() - 2 - value);     /* less the closing "\n}" */
+}
+
+struct TextEdit {
+    size_t at;
+    size_t end;             /* == at for an insertion */
+    std::string text;
+};
+
+bool splice_dartt_config_json(const std::string& text, const DarttConfig& config, const ConfigSession& session,
+                              std::string& out)
+{
+    StreamedConfig file;
+    StreamedConfig saved;
+    std::string layout;
+    write_dartt_config_json(layout, config, ConfigSession());
+    if (!stream_dartt_config(text.data(), text.size(), file, nullptr) ||
+        !stream_dartt_config(layout.data(), layout.size(), saved, nullptr) || !same_layout(file, saved)) {
+        return false;
+    }
+    std::vector<TopMember> members;
+    if (!find_top_members(text, members) || members.empty()) {
+        return false;
+    }
+
+    /* New members take the indent of the first one */
+    size_t line = text.rfind('\n', members[0].key);
+    size_t indent = (line == std::string::npos) ? 2 : members[0].key - line - 1;
+    std::string pad = (line == std::string::npos) ? std::string(" ") : "\n" + std::string(indent, ' ');
+
+    std::vector<TextEdit> edits;
+    for (size_t s = 0; s < sizeof(session_sections) / sizeof(session_sections[0]); s++) {
+        const char* name = session_sections[s];
+        std::string value = session_section_value(s, session, indent);
+        bool found = false;
+        for (const TopMember& m : members) {
+            if (m.name == name) {
+                edits.push_back({ m.value, m.value_end, value });
+                found = true;
+            }
+        }
+        if (found) {
+            continue;
+        }
+        std::string member = "\"" + std::string(name) + "\": " + value;
+        const TopMember* next = nullptr;
+        for (const TopMember& m : members) {
+            if (m.name > name) {
+                next = &m;
+                break;
+            }
+        }
+        if (next) {
+            edits.push_back({ next->key, next->key, member + "," + pad });
+        } else {
+            edits.push_back({ members.back().value_end, members.back().value_end, "," + pad + member });
+        }
+    }
+    std::stable_sort(edits.begin(), edits.end(), [](const TextEdit& a, const TextEdit& b) { return a.at < b.at; });
+
+    out.clear();
+    size_t pos = 0;
+    for (const TextEdit& e : edits) {
+        out.append(text, pos, e.at - pos);
+        out += e.text;
+        pos = e.end;
+    }
+    out.append(text, pos, std::string::npos);
+    return true;
+}
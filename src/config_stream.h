@@ -0,0 +1,58 @@
+/*
+ * config_stream.h - single-pass streaming parser and writer for DARTT config JSON
+ *
+ * A small built-in RFC 8259 scanner feeds a SAX-style handler that builds the
+ * DarttField trees as it goes, so the layout part of a config (the "type" trees and
+ * the "ui_map") never exists as a JSON DOM.
+ * Only the small sections handled elsewhere ("serial_settings", "plotting") are
+ * kept as JSON, in extras. load_dartt_config lays the result out and applies it.
+ *
+ * The writer goes the other way, from a loaded DarttConfig straight to text, so
+ * saving needs neither the original file nor a DOM. When the original file is there
+ * and describes the same layout, a save splices the session into it instead, keeping
+ * the generator's keys the loader skips.
+ */
+
+#ifndef DARTT_CONFIG_STREAM_H
+#define DARTT_CONFIG_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "config.h"
+
+struct StreamedConfig
+{
+    std::vector<DarttSymbol> symbols;   // base_offset resolved as load_dartt_config expects
+    std::vector<DarttField> roots;      // roots[i] is the parsed "type" of symbols[i]
+    std::vector<UiMapEntry> ui_map;
+    nlohmann::json extras;              // "serial_settings" and "plotting", if present
+};
+
+/*
+ * Parse a whole config document held in memory. Returns false on malformed JSON,
+ * with the parser's message in *error.
+ */
+bool stream_dartt_config(const char* text, size_t len, StreamedConfig& out, std::string* error);
+
+/*
+ * Write config as a complete document (layout, "ui_map", "plotting", "serial_settings")
+ * that stream_dartt_config reads back to the same tree, 2-space indented with keys
+ * sorted like the generator's. Keys the loader does not use are not reproduced
+ * (see splice_dartt_config_json).
+ * Everything but the layout comes from session (capture_session).
+ */
+void write_dartt_config_json(std::string& out, const DarttConfig& config, const ConfigSession& session);
+
+/*
+ * Replace "ui_map", "plotting" and "serial_settings" in text, an existing config
+ * document, with session's, adding any that are missing, and copy every other byte
+ * as it is. Returns false if text is not a config or describes a different layout
+ * than config; the caller then writes the whole document with write_dartt_config_json.
+ */
+bool splice_dartt_config_json(const std::string& text, const DarttConfig& config, const ConfigSession& session,
+                              std::string& out);
+
+#endif /* DARTT_CONFIG_STREAM_H */
@@ -1,17 +1,32 @@
 #include "dartt_init.h"
 #include <cstdio>
+#include <cstring>
 
 Serial serial;
 CommMode comm_mode = COMM_SERIAL;
-UdpState udp_state = { TCS_SOCKET_INVALID, "192.168.1.100", 5000, false };
-TcpState tcp_state = { TCS_SOCKET_INVALID, "192.168.1.100", 5000, false };
+UdpState udp_state = { TCS_SOCKET_INVALID, "192.168.1.100", 5000, false, -1 };
+TcpState tcp_state = { TCS_SOCKET_INVALID, "192.168.1.100", 5000, false, -1 };
+Transport transport;
+int serial_link = -1;
 
  #define NUM_BYTES_COBS_OVERHEAD	2	//we have to tell dartt our serial buffers are smaller than they are, so the COBS layer has room to operate. This allows for functional multiple message handling with write_multi and read_multi for large configs
 
 unsigned char tx_mem[SERIAL_BUFFER_SIZE] = {};
 unsigned char rx_dartt_mem[SERIAL_BUFFER_SIZE] = {};
-unsigned char rx_cobs_mem[SERIAL_BUFFER_SIZE] = {};
 
+// Map the selected comm mode onto its transport link, -1 if that link is not up
+static int active_link()
+{
+	switch (comm_mode)
+	{
+		case COMM_TCP:
+			return tcp_state.connected ? tcp_state.link : -1;
+		case COMM_UDP:
+			return udp_state.connected ? udp_state.link : -1;
+		default:
+			return serial_link;
+	}
+}
 
 int tx_blocking(unsigned char addr, dartt_buffer_t * b, void * user_context, uint32_t timeout)
 {
@@ -26,32 +41,12 @@ int tx_blocking(unsigned char addr, dartt_buffer_t * b, void * user_context, uin
 	{
 		return rc;
 	}
-	switch (comm_mode)
+	int link = active_link();
+	if (link < 0)
 	{
-		case COMM_TCP:
-		{
-			if (!tcp_state.connected)
-				return -1;
-			size_t bytes_sent = 0;
-			TcsResult res = tcs_send(tcp_state.socket, cb.buf, cb.length, TCS_FLAG_NONE, &bytes_sent);
-			rc = (res == TCS_SUCCESS && bytes_sent == cb.length) ? (int)cb.length : -1;
-			break;
-		}
-		case COMM_UDP:
-		{
-			if (!udp_state.connected)
-				return -1;
-			size_t bytes_sent = 0;
-			TcsResult res = tcs_send(udp_state.socket, cb.buf, cb.length, TCS_FLAG_NONE, &bytes_sent);
-			rc = (res == TCS_SUCCESS && bytes_sent == cb.length) ? (int)cb.length : -1;
-			break;
-		}
-		default:
-		{
-			rc = serial.write(cb.buf, (int)cb.length);
-			break;
-		}
+		return -1;
 	}
+	rc = transport.send(link, cb.buf, cb.length);
 	if(rc == (int)cb.length)
 	{
 		return DARTT_PROTOCOL_SUCCESS;
@@ -62,77 +57,56 @@ int tx_blocking(unsigned char addr, dartt_buffer_t * b, void * user_context, uin
 	}
 }
 
-int rx_blocking(dartt_buffer_t * buf, void * user_context, uint32_t timeout)
+struct RxWait
 {
-	cobs_buf_t cb_enc =
-	{
-		.buf = rx_cobs_mem,
-		.size = sizeof(rx_cobs_mem),
-		.length = 0
-	};
-
+	bool done;
 	int rc;
-	switch (comm_mode)
+	dartt_buffer_t* out;
+};
+
+static void rx_complete(int rc, const uint8_t* frame, size_t len, void* user)
+{
+	RxWait* wait = (RxWait*)user;
+	wait->done = true;
+	wait->rc = rc;
+	if (rc == TRANSPORT_RX_OK)
 	{
-		case COMM_TCP:
-		{
-			if (!tcp_state.connected)
-				return -1;
-			size_t bytes_received = 0;
-			tcs_opt_receive_timeout_set(tcp_state.socket, timeout);
-			TcsResult res = tcs_receive_line(tcp_state.socket, cb_enc.buf, cb_enc.size, &bytes_received, 0x00);
-			rc = (res == TCS_SUCCESS) ? (int)bytes_received : -2;
-			break;
-		}
-		case COMM_UDP:
-		{
-			if (!udp_state.connected)
-				return -1;
-			struct TcsAddress src;
-			size_t bytes_received = 0;
-			tcs_opt_receive_timeout_set(udp_state.socket, timeout);
-			TcsResult res = tcs_receive_from(udp_state.socket, cb_enc.buf, cb_enc.size, TCS_FLAG_NONE, &src, &bytes_received);
-			rc = (res == TCS_SUCCESS) ? (int)bytes_received : -2;
-			break;
-		}
-		default:
+		if (len > wait->out->size)
 		{
-			rc = serial.read_until_delimiter(cb_enc.buf, cb_enc.size, 0, timeout);
-			break;
+			wait->rc = TRANSPORT_RX_LINK_ERROR;	//oversized frame, cannot be a reply to us
+			return;
 		}
+		//the scanner already decoded the frame in place, so it goes straight into the dartt buffer
+		memcpy(wait->out->buf, frame, len);
+		wait->out->len = len;
 	}
+}
 
-	if (rc >= 0)
-	{
-		cb_enc.length = rc;	//load encoded length (raw buffer)
-	}
-	else if (rc == -2)
-	{
-		return -7;
-	}
-	else
+int rx_blocking(dartt_buffer_t * buf, void * user_context, uint32_t timeout)
+{
+	int link = active_link();
+	if (link < 0)
 	{
 		return -1;
 	}
 
-	cobs_buf_t cb_dec =
+	//the deadline lives on the request, so sockets no longer need a receive timeout set per frame
+	RxWait wait = {false, TRANSPORT_RX_LINK_ERROR, buf};
+	transport.receive(link, timeout, &rx_complete, &wait);
+	while (!wait.done)
 	{
-		.buf = buf->buf,
-		.size = buf->size,
-		.length = 0
-	};
-	rc = cobs_decode_double_buffer(&cb_enc, &cb_dec);
-	buf->len = cb_dec.length;	//critical - we are aliasing this read buffer in sync, but must update the length to the cobs decoded value
+		transport.poll((int)timeout);
+	}
 
-	if (rc != COBS_SUCCESS)
+	if (wait.rc == TRANSPORT_RX_TIMEOUT)
 	{
-		return rc;
+		return -7;
 	}
-	else
+	else if (wait.rc != TRANSPORT_RX_OK)
 	{
-		return DARTT_PROTOCOL_SUCCESS;
+		return -1;
 	}
-    
+	return DARTT_PROTOCOL_SUCCESS;
 }
 
 void init_ds(dartt_sync_t * ds)
@@ -151,6 +125,11 @@ void init_ds(dartt_sync_t * ds)
 	ds->blocking_tx_callback = &tx_blocking;
 	ds->blocking_rx_callback = &rx_blocking;
 	ds->timeout_ms = 10;
+
+	if (serial_link < 0)
+	{
+		serial_link = transport.add_serial(&serial);
+	}
 }
 
 bool udp_connect(UdpState* state)
@@ -186,6 +165,13 @@ bool udp_connect(UdpState* state)
 		return false;
 	}
 
+	state->link = transport.add_socket(state->socket, LINK_DATAGRAM);
+	if (state->link < 0)
+	{
+		tcs_close(&state->socket);
+		return false;
+	}
+
 	state->connected = true;
 	printf("UDP: connected to %s:%u\n", state->ip, state->port);
 	return true;
@@ -193,6 +179,11 @@ bool udp_connect(UdpState* state)
 
 void udp_disconnect(UdpState* state)
 {
+	if (state->link >= 0)
+	{
+		transport.remove(state->link);
+		state->link = -1;
+	}
 	if (state->socket != TCS_SOCKET_INVALID)
 	{
 		tcs_close(&state->socket);
@@ -233,6 +224,13 @@ bool tcp_connect(TcpState* state)
 		return false;
 	}
 
+	state->link = transport.add_socket(state->socket, LINK_STREAM);
+	if (state->link < 0)
+	{
+		tcs_close(&state->socket);
+		return false;
+	}
+
 	state->connected = true;
 	printf("TCP: connected to %s:%u\n", state->ip, state->port);
 	return true;
@@ -240,6 +238,11 @@ bool tcp_connect(TcpState* state)
 
 void tcp_disconnect(TcpState* state)
 {
+	if (state->link >= 0)
+	{
+		transport.remove(state->link);
+		state->link = -1;
+	}
 	if (state->socket != TCS_SOCKET_INVALID)
 	{
 		tcs_close(&state->socket);
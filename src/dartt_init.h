@@ -6,6 +6,7 @@
 #include "dartt.h"
 #include "dartt_sync.h"
 #include "tinycsocket.h"
+#include "transport.h"
 
 #define SERIAL_BUFFER_SIZE 32
 
@@ -14,6 +15,7 @@ struct UdpState {
 	char ip[64];
 	uint16_t port;
 	bool connected;
+	int link;	//transport link id, -1 when disconnected
 };
 
 struct TcpState {
@@ -21,6 +23,7 @@ struct TcpState {
 	char ip[64];
 	uint16_t port;
 	bool connected;
+	int link;	//transport link id, -1 when disconnected
 };
 
 enum CommMode {
@@ -33,9 +36,10 @@ extern Serial serial;
 extern CommMode comm_mode;
 extern UdpState udp_state;
 extern TcpState tcp_state;
+extern Transport transport;
+extern int serial_link;
 extern unsigned char tx_mem[SERIAL_BUFFER_SIZE];
 extern unsigned char rx_dartt_mem[SERIAL_BUFFER_SIZE];
-extern unsigned char rx_cobs_mem[SERIAL_BUFFER_SIZE];
 
 void init_ds(dartt_sync_t * ds);
 bool udp_connect(UdpState* state);
@@ -0,0 +1,269 @@
+/*
+ * elf_image.cpp - read-only memory-mapped ELF file
+ */
+
+#include "elf_image.h"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+elf_image::elf_image()
+    : data(nullptr)
+    , size(0)
+    , is_64(false)
+    , big_endian(false)
+#ifdef _WIN32
+    , file_handle(nullptr)
+    , mapping_handle(nullptr)
+#else
+    , fd(-1)
+#endif
+{
+}
+
+uint16_t elf_image_u16(const elf_image* img, const uint8_t* p) {
+    return img->big_endian ? (uint16_t)((p[0] << 8) | p[1])
+                           : (uint16_t)((p[1] << 8) | p[0]);
+}
+
+uint32_t elf_image_u32(const elf_image* img, const uint8_t* p) {
+    if (img->big_endian) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+uint64_t elf_image_u64(const elf_image* img, const uint8_t* p) {
+    uint64_t lo = elf_image_u32(img, img->big_endian ? p + 4 : p);
+    uint64_t hi = elf_image_u32(img, img->big_endian ? p : p + 4);
+    return (hi << 32) | lo;
+}
+
+/* Map the whole file read-only */
+static bool map_file(elf_image* img, const char* path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    img->file_handle = file;
+    img->mapping_handle = mapping;
+    img->data = (const uint8_t*)view;
+    img->size = (size_t)file_size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    img->fd = fd;
+    img->data = (const uint8_t*)view;
+    img->size = (size_t)st.st_size;
+#endif
+    return true;
+}
+
+/* Decode one section header from the table */
+static void read_section_header(const elf_image* img, const uint8_t* p, elf_section* out, uint32_t* name_off) {
+    *name_off = elf_image_u32(img, p);
+    out->type = elf_image_u32(img, p + 4);
+    if (img->is_64) {
+        out->flags = elf_image_u64(img, p + 8);
+        out->addr = elf_image_u64(img, p + 16);
+        out->offset = elf_image_u64(img, p + 24);
+        out->size = elf_image_u64(img, p + 32);
+        out->link = elf_image_u32(img, p + 40);
+        out->info = elf_image_u32(img, p + 44);
+        out->addralign = elf_image_u64(img, p + 48);
+        out->entsize = elf_image_u64(img, p + 56);
+    } else {
+        out->flags = elf_image_u32(img, p + 8);
+        out->addr = elf_image_u32(img, p + 12);
+        out->offset = elf_image_u32(img, p + 16);
+        out->size = elf_image_u32(img, p + 20);
+        out->link = elf_image_u32(img, p + 24);
+        out->info = elf_image_u32(img, p + 28);
+        out->addralign = elf_image_u32(img, p + 32);
+        out->entsize = elf_image_u32(img, p + 36);
+    }
+    out->name = "";
+}
+
+bool elf_image_open(elf_image* img, const char* path) {
+    if (!img || !path) return false;
+    elf_image_close(img);
+
+    if (!map_file(img, path)) {
+        return false;
+    }
+
+    const uint8_t* d = img->data;
+    if (img->size < 52 || d[0] != 0x7F || d[1] != 'E' || d[2] != 'L' || d[3] != 'F' ||
+        (d[4] != 1 && d[4] != 2) || (d[5] != 1 && d[5] != 2)) {
+        elf_image_close(img);
+        return false;
+    }
+    img->is_64 = (d[4] == 2);
+    img->big_endian = (d[5] == 2);
+
+    uint64_t shoff;
+    uint16_t shentsize, shnum, shstrndx;
+    if (img->is_64) {
+        if (img->size < 64) {
+            elf_image_close(img);
+            return false;
+        }
+        shoff = elf_image_u64(img, d + 0x28);
+        shentsize = elf_image_u16(img, d + 0x3A);
+        shnum = elf_image_u16(img, d + 0x3C);
+        shstrndx = elf_image_u16(img, d + 0x3E);
+    } else {
+        shoff = elf_image_u32(img, d + 0x20);
+        shentsize = elf_image_u16(img, d + 0x2E);
+        shnum = elf_image_u16(img, d + 0x30);
+        shstrndx = elf_image_u16(img, d + 0x32);
+    }
+
+    size_t min_entsize = img->is_64 ? 64 : 40;
+    if (shoff == 0 || shentsize < min_entsize || shoff + shentsize > img->size) {
+        elf_image_close(img);
+        return false;
+    }
+
+    /* Extended numbering: the real counts live in section 0 */
+    elf_section first;
+    uint32_t first_name = 0;
+    read_section_header(img, d + shoff, &first, &first_name);
+    uint64_t count = (shnum == 0) ? first.size : shnum;
+    uint32_t strndx = (shstrndx == 0xFFFF) ? first.link : shstrndx;
+    if (count == 0 || shoff + count * shentsize > img->size) {
+        elf_image_close(img);
+        return false;
+    }
+
+    std::vector<uint32_t> name_offsets((size_t)count);
+    img->sections.resize((size_t)count);
+    for (uint64_t i = 0; i < count; i++) {
+        read_section_header(img, d + shoff + i * shentsize, &img->sections[i], &name_offsets[i]);
+    }
+
+    /* Section names point straight into the mapped string table */
+    if (strndx < count) {
+        const elf_section& strtab = img->sections[strndx];
+        const uint8_t* names = elf_image_section_data(img, &strtab);
+        if (names) {
+            for (size_t i = 0; i < img->sections.size(); i++) {
+                if (name_offsets[i] < strtab.size &&
+                    memchr(names + name_offsets[i], 0, strtab.size - name_offsets[i])) {
+                    img->sections[i].name = (const char*)names + name_offsets[i];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void elf_image_close(elf_image* img) {
+    if (!img) return;
+#ifdef _WIN32
+    if (img->data) UnmapViewOfFile(img->data);
+    if (img->mapping_handle) CloseHandle((HANDLE)img->mapping_handle);
+    if (img->file_handle) CloseHandle((HANDLE)img->file_handle);
+    img->file_handle = nullptr;
+    img->mapping_handle = nullptr;
+#else
+    if (img->data) munmap((void*)img->data, img->size);
+    if (img->fd >= 0) close(img->fd);
+    img->fd = -1;
+#endif
+    img->data = nullptr;
+    img->size = 0;
+    img->sections.clear();
+}
+
+const elf_section* elf_image_find_section(const elf_image* img, const char* name) {
+    if (!img || !name) return nullptr;
+    for (size_t i = 0; i < img->sections.size(); i++) {
+        if (strcmp(img->sections[i].name, name) == 0) {
+            return &img->sections[i];
+        }
+    }
+    return nullptr;
+}
+
+const uint8_t* elf_image_section_data(const elf_image* img, const elf_section* sec) {
+    if (!img || !sec || !img->data || sec->type == ELF_SHT_NOBITS) return nullptr;
+    if (sec->offset > img->size || sec->size > img->size - sec->offset) return nullptr;
+    return img->data + sec->offset;
+}
+
+bool elf_image_build_id(const elf_image* img, std::string& out_hex) {
+    static const char hex[] = "0123456789abcdef";
+    if (!img) return false;
+
+    for (size_t s = 0; s < img->sections.size(); s++) {
+        const elf_section& sec = img->sections[s];
+        if (sec.type != ELF_SHT_NOTE) continue;
+        const uint8_t* p = elf_image_section_data(img, &sec);
+        if (!p) continue;
+
+        /* Notes: namesz, descsz, type, then name and desc each padded to 4 bytes */
+        uint64_t pos = 0;
+        while (pos + 12 <= sec.size) {
+            uint32_t namesz = elf_image_u32(img, p + pos);
+            uint32_t descsz = elf_image_u32(img, p + pos + 4);
+            uint32_t type = elf_image_u32(img, p + pos + 8);
+            uint64_t name_pos = pos + 12;
+            uint64_t desc_pos = name_pos + (((uint64_t)namesz + 3) & ~3ull);
+            uint64_t next = desc_pos + (((uint64_t)descsz + 3) & ~3ull);
+            if (next > sec.size) break;
+
+            if (type == 3 && namesz == 4 && memcmp(p + name_pos, "GNU", 4) == 0 && descsz > 0) {
+                out_hex.clear();
+                for (uint32_t i = 0; i < descsz; i++) {
+                    out_hex += hex[p[desc_pos + i] >> 4];
+                    out_hex += hex[p[desc_pos + i] & 0xF];
+                }
+                return true;
+            }
+            pos = next;
+        }
+    }
+    return false;
+}
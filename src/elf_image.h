@@ -0,0 +1,84 @@
+/*
+ * elf_image.h - read-only memory-mapped ELF file
+ *
+ * The file is mapped once; section contents are pointers into the mapping, so
+ * nothing is copied to the heap no matter how large the debug sections are.
+ * Only the section header table is decoded up front.
+ *
+ * Usage:
+ *   elf_image img;
+ *   if (elf_image_open(&img, "firmware.elf")) {
+ *       const elf_section* sec = elf_image_find_section(&img, ".symtab");
+ *       const uint8_t* data = elf_image_section_data(&img, sec);
+ *       elf_image_close(&img);
+ *   }
+ */
+
+#ifndef DARTT_ELF_IMAGE_H
+#define DARTT_ELF_IMAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+/* Section types used by the parser */
+#define ELF_SHT_NOBITS          8
+#define ELF_SHT_SYMTAB          2
+#define ELF_SHT_DYNSYM          11
+#define ELF_SHT_NOTE            7
+
+/* Decoded section header (fields widened to 64 bits for both ELF classes) */
+struct elf_section {
+    const char* name;       /* points into the mapped section name table */
+    uint32_t type;
+    uint64_t flags;
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t link;
+    uint32_t info;
+    uint64_t addralign;
+    uint64_t entsize;
+};
+
+struct elf_image {
+    const uint8_t* data;    /* start of the read-only mapping */
+    size_t size;            /* file size in bytes */
+    bool is_64;             /* ELFCLASS64 */
+    bool big_endian;        /* ELFDATA2MSB */
+    std::vector<elf_section> sections;  /* index 0 is the null section */
+
+#ifdef _WIN32
+    void* file_handle;
+    void* mapping_handle;
+#else
+    int fd;
+#endif
+
+    elf_image();
+    elf_image(const elf_image&) = delete;
+    elf_image& operator=(const elf_image&) = delete;
+};
+
+/* Map path read-only and decode its section headers. Returns false if the file is missing or not ELF. */
+bool elf_image_open(elf_image* img, const char* path);
+
+/* Unmap the file. Safe to call on an image that was never opened. */
+void elf_image_close(elf_image* img);
+
+/* First section with the given name, or NULL */
+const elf_section* elf_image_find_section(const elf_image* img, const char* name);
+
+/* Section contents inside the mapping, or NULL for SHT_NOBITS and out-of-range sections */
+const uint8_t* elf_image_section_data(const elf_image* img, const elf_section* sec);
+
+/* GNU build-id (NT_GNU_BUILD_ID note) as lowercase hex. Returns false if the image has none. */
+bool elf_image_build_id(const elf_image* img, std::string& out_hex);
+
+/* Read an integer of the image's byte order */
+uint16_t elf_image_u16(const elf_image* img, const uint8_t* p);
+uint32_t elf_image_u32(const elf_image* img, const uint8_t* p);
+uint64_t elf_image_u64(const elf_image* img, const uint8_t* p);
+
+#endif /* DARTT_ELF_IMAGE_H */
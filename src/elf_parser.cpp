@@ -1,25 +1,31 @@
 /*
  * elf_parser.cpp - ELF/DWARF parser implementation
  *
- * Uses libdwarf for DWARF parsing and ELFIO for symbol table access.
+ * The ELF is memory-mapped once (elf_image); the symbol table is read straight
+ * from the mapping and libdwarf is fed the same mapping through its object
+ * access interface, so no section is copied or read twice.
  * Implements iterative (stack-based) traversal to avoid stack overflow
  * on deeply nested types.
  */
 
 #include "elf_parser.h"
 #include "config.h"
+#include "layout_cache.h"
 
-#include <elfio/elfio.hpp>
 #include <dwarf.h>
 #include <libdwarf.h>
 
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cctype>
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <fstream>
+#include <unordered_set>
+#include <deque>
+#include <algorithm>
+#include <thread>
 #include <memory>
 
 /* ============================================================================
@@ -29,17 +35,23 @@
 /* Forward declaration for recursive structure */
 struct TypeInfo;
 
+/*
+ * Resolved types are immutable once built and shared between every field that
+ * uses them, so a struct used by hundreds of members is walked through libdwarf once.
+ */
+typedef std::shared_ptr<const TypeInfo> TypeInfoRef;
+
 /* Field info for struct/union members */
 struct FieldInfo {
     std::string name;
     uint32_t byte_offset;           /* relative to parent struct */
-    std::unique_ptr<TypeInfo> type_info;
+    TypeInfoRef type_info;
     int bit_size;                   /* -1 if not a bitfield */
-    int bit_offset;
+    int bit_offset;                 /* raw DW_AT_data_bit_offset or DW_AT_bit_offset */
+    bool legacy_bit_offset;         /* bit_offset is DWARF 2/3 DW_AT_bit_offset */
+    uint32_t storage_bytes;         /* member DW_AT_byte_size (legacy storage unit), 0 if absent */
 
-    FieldInfo() : byte_offset(0), bit_size(-1), bit_offset(0) {}
-    FieldInfo(FieldInfo&&) = default;
-    FieldInfo& operator=(FieldInfo&&) = default;
+    FieldInfo() : byte_offset(0), bit_size(-1), bit_offset(0), legacy_bit_offset(false), storage_bytes(0) {}
 };
 
 /* Enum value */
@@ -67,21 +79,22 @@ struct TypeInfo {
     std::vector<EnumValue> enumerators;
 
     /* For pointers */
-    std::unique_ptr<TypeInfo> pointee;
+    TypeInfoRef pointee;
 
     /* Type qualifiers */
     bool is_const;
     bool is_volatile;
 
+    /* Name-only copy of a struct still being resolved, used to break pointer cycles */
+    bool cycle_stub;
+
     TypeInfo()
         : size(0)
         , total_elements(0)
         , is_const(false)
         , is_volatile(false)
+        , cycle_stub(false)
     {}
-
-    TypeInfo(TypeInfo&&) = default;
-    TypeInfo& operator=(TypeInfo&&) = default;
 };
 
 /* DWARF base type encoding names */
@@ -119,43 +132,137 @@ const char* elf_parse_error_str(elf_parse_error_t err) {
 }
 
 /* ============================================================================
- * Symbol Table Access (ELFIO)
+ * Symbol Table Access
  * ============================================================================ */
 
+/* One pass over the symbol tables; the first definition of a name wins, as the old linear scan did */
+static void build_symbol_index(elf_parser_ctx* parser) {
+    const elf_image* img = &parser->image;
+    size_t entsize = img->is_64 ? 24 : 16;
+
+    parser->symbols.clear();
+    for (size_t s = 0; s < img->sections.size(); s++) {
+        const elf_section& section = img->sections[s];
+        if (section.type != ELF_SHT_SYMTAB && section.type != ELF_SHT_DYNSYM) continue;
+        if (section.link >= img->sections.size()) continue;
+
+        const uint8_t* syms = elf_image_section_data(img, &section);
+        const elf_section& strtab = img->sections[section.link];
+        const char* names = (const char*)elf_image_section_data(img, &strtab);
+        if (!syms || !names) continue;
+
+        size_t count = (size_t)(section.size / entsize);
+        parser->symbols.reserve(parser->symbols.size() + count);
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t* sym = syms + i * entsize;
+            uint32_t name_off = elf_image_u32(img, sym);
+            if (name_off == 0 || name_off >= strtab.size) continue;
+
+            elf_symbol_entry entry;
+            if (img->is_64) {
+                entry.addr = (uint32_t)elf_image_u64(img, sym + 8);
+                entry.size = (uint32_t)elf_image_u64(img, sym + 16);
+            } else {
+                entry.addr = elf_image_u32(img, sym + 4);
+                entry.size = elf_image_u32(img, sym + 8);
+            }
+            size_t name_len = strnlen(names + name_off, (size_t)(strtab.size - name_off));
+            parser->symbols.emplace(std::string(names + name_off, name_len), entry);
+        }
+    }
+}
+
 bool elf_parser_find_symbol(elf_parser_ctx* parser, const char* name,
                             uint32_t* out_addr, uint32_t* out_size) {
     if (!parser || !name) return false;
 
-    for (ELFIO::Elf_Half i = 0; i < parser->elf.sections.size(); i++) {
-        ELFIO::section* section = parser->elf.sections[i];
-        if (section->get_type() == ELFIO::SHT_SYMTAB ||
-            section->get_type() == ELFIO::SHT_DYNSYM) {
-            ELFIO::const_symbol_section_accessor symbols(parser->elf, section);
-            for (ELFIO::Elf_Xword i = 0; i < symbols.get_symbols_num(); i++) {
-                std::string sym_name;
-                ELFIO::Elf64_Addr value;
-                ELFIO::Elf_Xword size;
-                unsigned char bind, type, other;
-                ELFIO::Elf_Half section_index;
-
-                if (symbols.get_symbol(i, sym_name, value, size, bind, type,
-                                       section_index, other)) {
-                    if (sym_name == name) {
-                        if (out_addr) *out_addr = (uint32_t)value;
-                        if (out_size) *out_size = (uint32_t)size;
-                        return true;
-                    }
-                }
-            }
-        }
-    }
-    return false;
+    std::unordered_map<std::string, elf_symbol_entry>::const_iterator it = parser->symbols.find(name);
+    if (it == parser->symbols.end()) return false;
+
+    if (out_addr) *out_addr = it->second.addr;
+    if (out_size) *out_size = it->second.size;
+    return true;
 }
 
 /* ============================================================================
  * Parser Lifecycle
  * ============================================================================ */
 
+static void build_variable_index(elf_parser_ctx* parser);
+
+/* libdwarf object access callbacks; the object is the elf_image */
+static int image_get_section_info(void* obj, Dwarf_Unsigned index,
+                                  Dwarf_Obj_Access_Section_a* out, int* error) {
+    const elf_image* img = (const elf_image*)obj;
+    if (index >= img->sections.size()) {
+        *error = 0;
+        return DW_DLV_NO_ENTRY;
+    }
+    const elf_section& sec = img->sections[index];
+    out->as_name = sec.name;
+    out->as_type = sec.type;
+    out->as_flags = sec.flags;
+    out->as_addr = sec.addr;
+    out->as_offset = sec.offset;
+    out->as_size = sec.size;
+    out->as_link = sec.link;
+    out->as_info = sec.info;
+    out->as_addralign = sec.addralign;
+    out->as_entrysize = sec.entsize;
+    return DW_DLV_OK;
+}
+
+static Dwarf_Small image_get_byte_order(void* obj) {
+    return ((const elf_image*)obj)->big_endian ? DW_END_big : DW_END_little;
+}
+
+static Dwarf_Small image_get_offset_size(void* obj) {
+    return ((const elf_image*)obj)->is_64 ? 8 : 4;
+}
+
+static Dwarf_Unsigned image_get_filesize(void* obj) {
+    return ((const elf_image*)obj)->size;
+}
+
+static Dwarf_Unsigned image_get_section_count(void* obj) {
+    return ((const elf_image*)obj)->sections.size();
+}
+
+/* Zero-copy: libdwarf gets a pointer into the mapping. It only writes to section data when relocating, which is not offered. */
+static int image_load_section(void* obj, Dwarf_Unsigned index, Dwarf_Small** data, int* error) {
+    const elf_image* img = (const elf_image*)obj;
+    if (index == 0 || index >= img->sections.size()) {
+        *error = 0;
+        return DW_DLV_NO_ENTRY;
+    }
+    const uint8_t* p = elf_image_section_data(img, &img->sections[index]);
+    if (!p) {
+        *error = 0;
+        return DW_DLV_NO_ENTRY;
+    }
+    *data = (Dwarf_Small*)p;
+    return DW_DLV_OK;
+}
+
+static const Dwarf_Obj_Access_Methods_a image_access_methods = {
+    image_get_section_info,
+    image_get_byte_order,
+    image_get_offset_size,      /* length size */
+    image_get_offset_size,      /* pointer size */
+    image_get_filesize,
+    image_get_section_count,
+    image_load_section,
+    nullptr,                    /* no relocation: firmware images are fully linked */
+};
+
+/* Open a libdwarf handle on an already mapped image. access must outlive the handle. */
+static int open_dwarf_on_image(const elf_image* img, Dwarf_Obj_Access_Interface_a* access,
+                               Dwarf_Debug* out, Dwarf_Error* err) {
+    access->ai_object = (void*)img;
+    access->ai_methods = &image_access_methods;
+    return dwarf_object_init_b(access, nullptr, nullptr, DW_GROUPNUMBER_ANY, out, err);
+}
+
 elf_parse_error_t elf_parser_init(elf_parser_ctx* parser, const char* path)
 {
     if (!parser || !path) return ELF_PARSE_ERROR;
@@ -164,25 +271,30 @@ elf_parse_error_t elf_parser_init(elf_parser_ctx* parser, const char* path)
     parser->dbg = nullptr;
     parser->dwarf_initialized = false;
 
-    /* Load ELF with ELFIO */
-    if (!parser->elf.load(path)) {
+    /* Map the ELF once; everything below reads from the mapping */
+    if (!elf_image_open(&parser->image, path)) {
         return ELF_PARSE_NOT_ELF;
     }
 
     /* Initialize libdwarf */
     Dwarf_Error err = nullptr;
-    int res = dwarf_init_path(path, nullptr, 0, DW_GROUPNUMBER_ANY,
-                              nullptr, nullptr, &parser->dbg, &err);
+    int res = open_dwarf_on_image(&parser->image, &parser->dwarf_access, &parser->dbg, &err);
     if (res == DW_DLV_NO_ENTRY) {
         /* No DWARF info, but ELF is valid */
         parser->dwarf_initialized = false;
     } else if (res == DW_DLV_ERROR) {
         if (err) dwarf_dealloc_error(parser->dbg, err);
+        elf_image_close(&parser->image);
         return ELF_PARSE_NO_DWARF;
     } else {
         parser->dwarf_initialized = true;
     }
 
+    build_symbol_index(parser);
+    if (parser->dwarf_initialized) {
+        build_variable_index(parser);
+    }
+
     return ELF_PARSE_SUCCESS;
 }
 
@@ -190,10 +302,14 @@ void elf_parser_cleanup(elf_parser_ctx* parser) {
     if (!parser) return;
 
     if (parser->dwarf_initialized && parser->dbg) {
-        dwarf_finish(parser->dbg);
+        dwarf_object_finish(parser->dbg);
         parser->dbg = nullptr;
         parser->dwarf_initialized = false;
     }
+    elf_image_close(&parser->image);
+    parser->symbols.clear();
+    parser->variables.clear();
+    parser->variable_names.clear();
 }
 
 /* ============================================================================
@@ -257,12 +373,12 @@ static bool get_die_signed(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half attr,
     return true;
 }
 
-/* Get the offset of the type DIE referenced by DW_AT_type */
-static bool get_type_ref_offset(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Off* out) {
+/* Get the offset of the DIE referenced by a reference attribute */
+static bool get_ref_offset(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Half attr, Dwarf_Off* out) {
     Dwarf_Attribute at = nullptr;
     Dwarf_Error err = nullptr;
 
-    int res = dwarf_attr(die, DW_AT_type, &at, &err);
+    int res = dwarf_attr(die, attr, &at, &err);
     if (res != DW_DLV_OK) {
         if (err) dwarf_dealloc_error(dbg, err);
         return false;
@@ -282,6 +398,11 @@ static bool get_type_ref_offset(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Off* out)
     return true;
 }
 
+/* Get the offset of the type DIE referenced by DW_AT_type */
+static bool get_type_ref_offset(Dwarf_Debug dbg, Dwarf_Die die, Dwarf_Off* out) {
+    return get_ref_offset(dbg, die, DW_AT_type, out);
+}
+
 /* Get the data member location (byte offset) for a struct member */
 static bool get_member_location(Dwarf_Debug dbg, Dwarf_Die die, uint32_t* out) {
     Dwarf_Attribute at = nullptr;
@@ -341,16 +462,21 @@ static bool get_member_location(Dwarf_Debug dbg, Dwarf_Die die, uint32_t* out) {
  * DWARF Type Resolution (Iterative)
  * ============================================================================ */
 
-/* Type cache to avoid re-parsing the same type */
+/*
+ * Resolved types keyed by DIE offset. Structs and unions are entered as soon as their
+ * header is read and stay in_progress until all members resolve; a lookup that lands
+ * on one of those came through a pointer back into the same struct.
+ */
 struct TypeCache {
-    std::unordered_map<Dwarf_Off, std::unique_ptr<TypeInfo>> cache;
+    std::unordered_map<Dwarf_Off, std::shared_ptr<TypeInfo>> cache;
+    std::unordered_set<Dwarf_Off> in_progress;
 
-    TypeInfo* get(Dwarf_Off offset) {
-        std::unordered_map<Dwarf_Off, std::unique_ptr<TypeInfo>>::iterator it = cache.find(offset);
-        return (it != cache.end()) ? it->second.get() : nullptr;
+    std::shared_ptr<TypeInfo> get(Dwarf_Off offset) {
+        std::unordered_map<Dwarf_Off, std::shared_ptr<TypeInfo>>::iterator it = cache.find(offset);
+        return (it != cache.end()) ? it->second : nullptr;
     }
 
-    void put(Dwarf_Off offset, std::unique_ptr<TypeInfo> ti) {
+    void put(Dwarf_Off offset, std::shared_ptr<TypeInfo> ti) {
         cache[offset] = std::move(ti);
     }
 };
@@ -359,22 +485,29 @@ struct TypeCache {
 enum WorkType {
     WORK_RESOLVE_TYPE,      /* Resolve a type DIE */
     WORK_PARSE_MEMBER,      /* Parse a struct/union member */
+    WORK_FINISH_STRUCT,     /* All members of a struct/union resolved */
+    WORK_FINISH_ALIAS,      /* Underlying type of a typedef/const/volatile resolved */
 };
 
 struct DwarfWork {
     WorkType type;
     Dwarf_Off die_offset;
-    TypeInfo* result;       /* Where to store result (raw ptr, owned elsewhere) */
-    uint32_t base_offset;   /* For members: cumulative byte offset */
-    int index;              /* For storing into parent's fields array */
-
-    DwarfWork(WorkType t, Dwarf_Off off, TypeInfo* r, uint32_t base, int idx)
-        : type(t), die_offset(off), result(r), base_offset(base), index(idx) {}
+    TypeInfoRef* slot;      /* RESOLVE/FINISH_ALIAS: where the result goes (owned elsewhere) */
+    TypeInfo* parent;       /* PARSE_MEMBER: struct being filled */
+    int index;              /* PARSE_MEMBER: index into parent's fields; FINISH_ALIAS: scratch index */
+    Dwarf_Half tag;         /* FINISH_ALIAS: DW_TAG_typedef, DW_TAG_const_type or DW_TAG_volatile_type */
+    std::string name;       /* FINISH_ALIAS: typedef name */
+
+    DwarfWork(WorkType t, Dwarf_Off off, TypeInfoRef* s, TypeInfo* p, int idx)
+        : type(t), die_offset(off), slot(s), parent(p), index(idx), tag(0) {}
 };
 
-/* Find a variable DIE by name */
-static bool find_variable_die(Dwarf_Debug dbg, const char* name,
-                              Dwarf_Die* out_die, Dwarf_Off* out_type_offset) {
+/* CUs per worker below which another thread costs more than it saves */
+#define ELF_INDEX_MIN_CUS_PER_WORKER 16
+#define ELF_INDEX_MAX_WORKERS 16
+
+/* Offsets of every CU's root DIE, in section order. Only reads CU headers. */
+static void collect_cu_die_offsets(Dwarf_Debug dbg, std::vector<Dwarf_Off>& out) {
     Dwarf_Error err = nullptr;
     Dwarf_Bool is_info = true;
     Dwarf_Unsigned cu_header_length, abbrev_offset, next_cu_header;
@@ -383,7 +516,6 @@ static bool find_variable_die(Dwarf_Debug dbg, const char* name,
     Dwarf_Unsigned typeoffset;
     Dwarf_Half header_cu_type;
 
-    /* Iterate through all CUs */
     while (true) {
         int res = dwarf_next_cu_header_d(dbg, is_info,
             &cu_header_length, &version_stamp, &abbrev_offset,
@@ -393,88 +525,320 @@ static bool find_variable_die(Dwarf_Debug dbg, const char* name,
         if (res == DW_DLV_NO_ENTRY) break;
         if (res == DW_DLV_ERROR) {
             if (err) dwarf_dealloc_error(dbg, err);
-            return false;
+            return;
         }
 
-        /* Get the CU DIE */
         Dwarf_Die cu_die = nullptr;
         res = dwarf_siblingof_b(dbg, nullptr, is_info, &cu_die, &err);
         if (res != DW_DLV_OK) {
             if (err) dwarf_dealloc_error(dbg, err);
+            err = nullptr;
             continue;
         }
+        Dwarf_Off cu_off = 0;
+        if (dwarf_dieoffset(cu_die, &cu_off, &err) == DW_DLV_OK) {
+            out.push_back(cu_off);
+        }
+        if (err) {
+            dwarf_dealloc_error(dbg, err);
+            err = nullptr;
+        }
+        dwarf_dealloc_die(cu_die);
+    }
+}
 
-        /* Search for variables in this CU using a stack */
-        std::vector<Dwarf_Die> die_stack;
-        die_stack.push_back(cu_die);
+/* Walk every DIE under one CU, recording named variables that carry a type */
+static void scan_cu_variables(Dwarf_Debug dbg, Dwarf_Off cu_off,
+                              std::unordered_map<std::string, Dwarf_Off>& out) {
+    Dwarf_Error err = nullptr;
+    Dwarf_Bool is_info = true;
 
-        while (!die_stack.empty()) {
-            Dwarf_Die die = die_stack.back();
-            die_stack.pop_back();
+    Dwarf_Die cu_die = nullptr;
+    int res = dwarf_offdie_b(dbg, cu_off, is_info, &cu_die, &err);
+    if (res != DW_DLV_OK) {
+        if (err) dwarf_dealloc_error(dbg, err);
+        return;
+    }
 
-            Dwarf_Half tag;
-            res = dwarf_tag(die, &tag, &err);
-            if (res != DW_DLV_OK) {
+    /* Visit the CU's DIEs using a stack */
+    std::vector<Dwarf_Die> die_stack;
+    die_stack.push_back(cu_die);
+
+    while (!die_stack.empty()) {
+        Dwarf_Die die = die_stack.back();
+        die_stack.pop_back();
+
+        Dwarf_Half tag;
+        res = dwarf_tag(die, &tag, &err);
+        if (res != DW_DLV_OK) {
+            if (err) dwarf_dealloc_error(dbg, err);
+            err = nullptr;
+            dwarf_dealloc_die(die);
+            continue;
+        }
+
+        if (tag == DW_TAG_variable) {
+            std::string var_name;
+            Dwarf_Off type_off;
+            Dwarf_Off die_off;
+            if (get_die_name(dbg, die, var_name) &&
+                get_type_ref_offset(dbg, die, &type_off) &&
+                dwarf_dieoffset(die, &die_off, &err) == DW_DLV_OK) {
+                out.emplace(std::move(var_name), die_off);
+            }
+            if (err) {
+                dwarf_dealloc_error(dbg, err);
+                err = nullptr;
+            }
+        }
+
+        /* Add children to stack */
+        Dwarf_Die child = nullptr;
+        res = dwarf_child(die, &child, &err);
+        if (res == DW_DLV_OK) {
+            die_stack.push_back(child);
+            /* Add siblings */
+            while (true) {
+                Dwarf_Die sibling = nullptr;
+                res = dwarf_siblingof_b(dbg, child, is_info, &sibling, &err);
+                if (res != DW_DLV_OK) break;
+                die_stack.push_back(sibling);
+                child = sibling;
+            }
+        }
+        if (err) {
+            dwarf_dealloc_error(dbg, err);
+            err = nullptr;
+        }
+
+        dwarf_dealloc_die(die);
+    }
+}
+
+/* One contiguous range of CUs, indexed on its own thread with a private libdwarf handle */
+struct CuScanWorker {
+    size_t first;
+    size_t last;
+    bool ok;
+    std::unordered_map<std::string, Dwarf_Off> variables;
+};
+
+/*
+ * Walk every DIE of every CU once, recording named variables that carry a type.
+ * libdwarf handles are not thread safe, so each worker opens its own Dwarf_Debug
+ * over the shared mapping and indexes a contiguous CU range; results merge in CU order so the
+ * first definition of a name still wins, as with a sequential scan.
+ */
+static void scan_variable_dies(elf_parser_ctx* parser) {
+    std::vector<Dwarf_Off> cu_offsets;
+    collect_cu_die_offsets(parser->dbg, cu_offsets);
+
+    size_t n_workers = std::thread::hardware_concurrency();
+    n_workers = std::min(n_workers, (size_t)ELF_INDEX_MAX_WORKERS);
+    n_workers = std::min(n_workers, cu_offsets.size() / ELF_INDEX_MIN_CUS_PER_WORKER);
+    if (n_workers <= 1) {
+        for (size_t i = 0; i < cu_offsets.size(); i++) {
+            scan_cu_variables(parser->dbg, cu_offsets[i], parser->variables);
+        }
+        return;
+    }
+
+    std::vector<CuScanWorker> workers(n_workers);
+    std::vector<std::thread> threads;
+    size_t per_worker = (cu_offsets.size() + n_workers - 1) / n_workers;
+    for (size_t w = 0; w < n_workers; w++) {
+        workers[w].first = std::min(w * per_worker, cu_offsets.size());
+        workers[w].last = std::min(workers[w].first + per_worker, cu_offsets.size());
+        workers[w].ok = false;
+        threads.emplace_back([&parser, &cu_offsets, &worker = workers[w]]() {
+            /* Private handle over the shared read-only mapping */
+            Dwarf_Obj_Access_Interface_a access;
+            Dwarf_Debug dbg = nullptr;
+            Dwarf_Error err = nullptr;
+            if (open_dwarf_on_image(&parser->image, &access, &dbg, &err) != DW_DLV_OK) {
                 if (err) dwarf_dealloc_error(dbg, err);
-                if (die != cu_die) dwarf_dealloc_die(die);
-                continue;
+                return;
             }
+            for (size_t i = worker.first; i < worker.last; i++) {
+                scan_cu_variables(dbg, cu_offsets[i], worker.variables);
+            }
+            dwarf_object_finish(dbg);
+            worker.ok = true;
+        });
+    }
+    for (size_t w = 0; w < threads.size(); w++) {
+        threads[w].join();
+    }
 
-            if (tag == DW_TAG_variable) 
-			{
-                std::string var_name;
-                if (get_die_name(dbg, die, var_name) && var_name == name) 
-				{
-					printf("Found correct name %s\n", var_name.c_str());
-                    /* Found it! Get the type reference */
-                    Dwarf_Off type_off;
-                    if (get_type_ref_offset(dbg, die, &type_off)) 
-					{
-                        *out_die = die;
-                        *out_type_offset = type_off;
-                        /* Clean up remaining stack */
-                        for (size_t j = 0; j < die_stack.size(); j++) {
-                            if (die_stack[j] != cu_die) dwarf_dealloc_die(die_stack[j]);
-                        }
-                        return true;
-                    }
-                }
-				else
-				{
-					// printf("Looked at %s, not correct\n", var_name.c_str());
-				}
+    for (size_t w = 0; w < n_workers; w++) {
+        if (!workers[w].ok) {
+            /* Could not open a second handle: do this range on the parser's own */
+            workers[w].variables.clear();
+            for (size_t i = workers[w].first; i < workers[w].last; i++) {
+                scan_cu_variables(parser->dbg, cu_offsets[i], workers[w].variables);
             }
+        }
+        parser->variables.reserve(parser->variables.size() + workers[w].variables.size());
+        for (std::unordered_map<std::string, Dwarf_Off>::iterator it = workers[w].variables.begin();
+             it != workers[w].variables.end(); ++it) {
+            parser->variables.emplace(it->first, it->second);
+        }
+    }
+}
 
-            /* Add children to stack */
-            Dwarf_Die child = nullptr;
-            res = dwarf_child(die, &child, &err);
-            if (res == DW_DLV_OK) {
-                die_stack.push_back(child);
-                /* Add siblings */
-                while (true) {
-                    Dwarf_Die sibling = nullptr;
-                    res = dwarf_siblingof_b(dbg, child, is_info, &sibling, &err);
-                    if (res != DW_DLV_OK) break;
-                    die_stack.push_back(sibling);
-                    child = sibling;
-                }
+/*
+ * Build the variable name index. The accelerated tables (.debug_names, or
+ * .debug_pubnames for older toolchains) list external names without touching
+ * .debug_info; file-static variables are not in them, so lookups that miss
+ * fall back to the full scan (see find_variable_die).
+ */
+static void build_variable_index(elf_parser_ctx* parser) {
+    Dwarf_Debug dbg = parser->dbg;
+    Dwarf_Error err = nullptr;
+    Dwarf_Global* globals = nullptr;
+    Dwarf_Signed count = 0;
+
+    parser->variables.clear();
+    int res = dwarf_get_globals(dbg, &globals, &count, &err);
+    if (res == DW_DLV_OK) {
+        parser->variables.reserve((size_t)count);
+        for (Dwarf_Signed i = 0; i < count; i++) {
+            /* .debug_names carries the tag; pubnames entries report 0 and are checked at lookup */
+            Dwarf_Half tag = 0;
+            if (dwarf_global_tag_number(globals[i], &tag, &err) != DW_DLV_OK) {
+                tag = 0;
+            }
+            if (err) {
+                dwarf_dealloc_error(dbg, err);
+                err = nullptr;
+            }
+            if (tag != 0 && tag != DW_TAG_variable) {
+                continue;
             }
-            if (err) dwarf_dealloc_error(dbg, err);
 
-            if (die != cu_die) dwarf_dealloc_die(die);
+            char* name = nullptr;
+            Dwarf_Off die_off = 0;
+            Dwarf_Off cu_off = 0;
+            if (dwarf_global_name_offsets(globals[i], &name, &die_off, &cu_off, &err) == DW_DLV_OK && name) {
+                parser->variables.emplace(name, die_off);
+            }
+            if (err) {
+                dwarf_dealloc_error(dbg, err);
+                err = nullptr;
+            }
         }
+        dwarf_globals_dealloc(dbg, globals, count);
+        parser->variables_complete = false;
+    } else {
+        if (err) dwarf_dealloc_error(dbg, err);
+        scan_variable_dies(parser);
+        parser->variables_complete = true;
     }
 
-    return false;
+    parser->variable_names.clear();
+    parser->variable_names.reserve(parser->variables.size());
+    for (std::unordered_map<std::string, Dwarf_Off>::const_iterator it = parser->variables.begin();
+         it != parser->variables.end(); ++it) {
+        parser->variable_names.push_back(it->first);
+    }
+    std::sort(parser->variable_names.begin(), parser->variable_names.end());
+}
+
+/*
+ * Type of the variable DIE at die_off. A definition that completes an earlier
+ * declaration (DW_AT_specification) carries its type on the declaration.
+ */
+static bool get_variable_type_offset(Dwarf_Debug dbg, Dwarf_Off die_off, Dwarf_Off* out_type_offset) {
+    Dwarf_Error err = nullptr;
+    Dwarf_Die die = nullptr;
+    if (dwarf_offdie_b(dbg, die_off, true, &die, &err) != DW_DLV_OK) {
+        if (err) dwarf_dealloc_error(dbg, err);
+        return false;
+    }
+
+    bool found = false;
+    Dwarf_Half tag = 0;
+    if (dwarf_tag(die, &tag, &err) == DW_DLV_OK && tag == DW_TAG_variable) {
+        Dwarf_Off decl_off;
+        if (get_type_ref_offset(dbg, die, out_type_offset)) {
+            found = true;
+        } else if (get_ref_offset(dbg, die, DW_AT_specification, &decl_off)) {
+            Dwarf_Die decl = nullptr;
+            if (dwarf_offdie_b(dbg, decl_off, true, &decl, &err) == DW_DLV_OK) {
+                found = get_type_ref_offset(dbg, decl, out_type_offset);
+                dwarf_dealloc_die(decl);
+            }
+        }
+    }
+    if (err) dwarf_dealloc_error(dbg, err);
+    dwarf_dealloc_die(die);
+    return found;
+}
+
+/* Find a variable by name through the index and return its type DIE offset */
+static bool find_variable_die(elf_parser_ctx* parser, const char* name, Dwarf_Off* out_type_offset) {
+    std::unordered_map<std::string, Dwarf_Off>::const_iterator it = parser->variables.find(name);
+    if (it != parser->variables.end() &&
+        get_variable_type_offset(parser->dbg, it->second, out_type_offset)) {
+        return true;
+    }
+    if (parser->variables_complete) {
+        return false;
+    }
+
+    /* Not an external name (e.g. a file-static): index every DIE once and retry */
+    printf("%s not in the accelerated name table, scanning all DIEs\n", name);
+    scan_variable_dies(parser);
+    parser->variables_complete = true;
+    parser->variable_names.clear();
+    for (it = parser->variables.begin(); it != parser->variables.end(); ++it) {
+        parser->variable_names.push_back(it->first);
+    }
+    std::sort(parser->variable_names.begin(), parser->variable_names.end());
+
+    it = parser->variables.find(name);
+    return it != parser->variables.end() &&
+           get_variable_type_offset(parser->dbg, it->second, out_type_offset);
+}
+
+size_t elf_parser_complete(const elf_parser_ctx* parser, const char* prefix,
+                           std::vector<std::string>& out, size_t max_results) {
+    out.clear();
+    if (!parser || !prefix) return 0;
+
+    size_t prefix_len = strlen(prefix);
+    std::vector<std::string>::const_iterator it = std::lower_bound(
+        parser->variable_names.begin(), parser->variable_names.end(), prefix,
+        [](const std::string& a, const char* b) { return a.compare(b) < 0; });
+    for (; it != parser->variable_names.end() && out.size() < max_results; ++it) {
+        if (it->compare(0, prefix_len, prefix) != 0) break;
+        out.push_back(*it);
+    }
+    return out.size();
+}
+
+/* Copy of a type without its members, for references back into a struct under construction */
+static std::shared_ptr<TypeInfo> make_cycle_stub(const TypeInfo& ti)
+{
+    std::shared_ptr<TypeInfo> stub = std::make_shared<TypeInfo>();
+    stub->type = ti.type;
+    stub->name = ti.name;
+    stub->typedef_name = ti.typedef_name;
+    stub->size = ti.size;
+    stub->is_const = ti.is_const;
+    stub->is_volatile = ti.is_volatile;
+    stub->cycle_stub = true;
+    return stub;
 }
 
 /* Resolve a type given its DIE offset - iterative implementation */
-static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_Off start_offset, TypeCache& cache) 
+static TypeInfoRef resolve_type_iterative(Dwarf_Debug dbg, Dwarf_Off start_offset, TypeCache& cache) 
 {
     std::vector<DwarfWork> stack;
-    std::unique_ptr<TypeInfo> root_result = std::make_unique<TypeInfo>();
+    std::deque<TypeInfoRef> scratch;    /* underlying types of pending aliases; deque keeps slots stable */
+    TypeInfoRef root_result;
 
-    stack.emplace_back(WORK_RESOLVE_TYPE, start_offset, root_result.get(), 0, 0);
+    stack.emplace_back(WORK_RESOLVE_TYPE, start_offset, &root_result, nullptr, 0);
 
     while (!stack.empty()) 
 	{
@@ -486,31 +850,30 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
 
         if (work.type == WORK_RESOLVE_TYPE) 
 		{
-            /* Check cache first */
-            TypeInfo* cached = cache.get(work.die_offset);
+            /* Check cache first - a hit shares the already resolved subtree */
+            std::shared_ptr<TypeInfo> cached = cache.get(work.die_offset);
             if (cached) 
 			{
-                /* Copy cached type info */
-                work.result->type = cached->type;
-                work.result->name = cached->name;
-                work.result->typedef_name = cached->typedef_name;
-                work.result->size = cached->size;
-                work.result->encoding = cached->encoding;
-                work.result->dimensions = cached->dimensions;
-                work.result->total_elements = cached->total_elements;
-                work.result->is_const = cached->is_const;
-                work.result->is_volatile = cached->is_volatile;
-                work.result->enumerators = cached->enumerators;
-                /* Note: fields and pointee need deep copy - skip for simplicity */
+                if (cache.in_progress.count(work.die_offset))
+                {
+                    *work.slot = make_cycle_stub(*cached);
+                }
+                else
+                {
+                    *work.slot = cached;
+                }
                 continue;
             }
 
+            std::shared_ptr<TypeInfo> result = std::make_shared<TypeInfo>();
+            *work.slot = result;
+
             /* Get DIE at offset */
             int res = dwarf_offdie_b(dbg, work.die_offset, true, &die, &err);
             if (res != DW_DLV_OK) 
 			{
                 if (err) dwarf_dealloc_error(dbg, err);
-                work.result->type = "unknown";
+                result->type = "unknown";
                 continue;
             }
 
@@ -519,7 +882,7 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
             if (res != DW_DLV_OK) {
                 if (err) dwarf_dealloc_error(dbg, err);
                 dwarf_dealloc_die(die);
-                work.result->type = "unknown";
+                result->type = "unknown";
                 continue;
             }
 
@@ -527,60 +890,60 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                 case DW_TAG_base_type: {
                     std::string name;
                     get_die_name(dbg, die, name);
-                    work.result->type = name.empty() ? "unknown" : name;
-                    work.result->name = name;
+                    result->type = name.empty() ? "unknown" : name;
+                    result->name = name;
 
                     Dwarf_Unsigned size = 0;
                     if (get_die_unsigned(dbg, die, DW_AT_byte_size, &size)) {
-                        work.result->size = (uint32_t)size;
+                        result->size = (uint32_t)size;
                     }
 
                     Dwarf_Unsigned encoding = 0;
                     if (get_die_unsigned(dbg, die, DW_AT_encoding, &encoding)) {
-                        work.result->encoding = get_encoding_name((int)encoding);
+                        result->encoding = get_encoding_name((int)encoding);
                     }
+                    cache.put(work.die_offset, result);
                     break;
                 }
 
-                case DW_TAG_typedef: {
-                    std::string typedef_name;
-                    get_die_name(dbg, die, typedef_name);
+                case DW_TAG_typedef:
+                case DW_TAG_const_type:
+                case DW_TAG_volatile_type: {
+                    /* Qualifiers and typedefs decorate a copy of the underlying type once it resolves */
+                    DwarfWork finish(WORK_FINISH_ALIAS, work.die_offset, work.slot, nullptr, (int)scratch.size());
+                    finish.tag = tag;
+                    if (tag == DW_TAG_typedef) {
+                        get_die_name(dbg, die, finish.name);
+                    }
+                    scratch.emplace_back();
 
                     Dwarf_Off underlying_offset;
-                    if (get_type_ref_offset(dbg, die, &underlying_offset)) {
-                        /* Push work to resolve underlying type into same result */
+                    bool has_underlying = get_type_ref_offset(dbg, die, &underlying_offset);
+                    stack.push_back(std::move(finish));
+                    if (has_underlying) {
                         stack.emplace_back(WORK_RESOLVE_TYPE, underlying_offset,
-                                          work.result, 0, 0);
-                        /* Preserve outermost typedef name through chains */
-                        if (work.result->typedef_name.empty())
-						{
-                            work.result->typedef_name = typedef_name;
-						}
-                    } 
-					else 
-					{
-                        work.result->type = typedef_name;
+                                          &scratch.back(), nullptr, 0);
                     }
                     break;
                 }
 
                 case DW_TAG_pointer_type: {
-                    work.result->type = "pointer";
+                    result->type = "pointer";
                     Dwarf_Unsigned size = 4;  /* Default 32-bit */
                     get_die_unsigned(dbg, die, DW_AT_byte_size, &size);
-                    work.result->size = (uint32_t)size;
+                    result->size = (uint32_t)size;
 
                     Dwarf_Off pointee_offset;
                     if (get_type_ref_offset(dbg, die, &pointee_offset)) {
-                        work.result->pointee = std::make_unique<TypeInfo>();
                         stack.emplace_back(WORK_RESOLVE_TYPE, pointee_offset,
-                                          work.result->pointee.get(), 0, 0);
+                                          &result->pointee, nullptr, 0);
                     }
+                    cache.put(work.die_offset, result);
                     break;
                 }
 
                 case DW_TAG_array_type: {
-                    work.result->type = "array";
+                    result->type = "array";
 
                     /* Get element type */
                     Dwarf_Off elem_offset;
@@ -595,11 +958,11 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                                 Dwarf_Unsigned upper = 0;
                                 Dwarf_Unsigned count = 0;
                                 if (get_die_unsigned(dbg, child, DW_AT_count, &count)) {
-                                    work.result->dimensions.push_back((uint32_t)count);
+                                    result->dimensions.push_back((uint32_t)count);
                                 } else if (get_die_unsigned(dbg, child, DW_AT_upper_bound, &upper)) {
-                                    work.result->dimensions.push_back((uint32_t)(upper + 1));
+                                    result->dimensions.push_back((uint32_t)(upper + 1));
                                 } else {
-                                    work.result->dimensions.push_back(0);  /* Flexible array */
+                                    result->dimensions.push_back(0);  /* Flexible array */
                                 }
                             }
                             if (err) dwarf_dealloc_error(dbg, err);
@@ -612,32 +975,32 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                         if (err) dwarf_dealloc_error(dbg, err);
 
                         /* Calculate total elements */
-                        work.result->total_elements = 1;
-                        for (uint32_t d : work.result->dimensions) {
-                            work.result->total_elements *= d;
+                        result->total_elements = 1;
+                        for (uint32_t d : result->dimensions) {
+                            result->total_elements *= d;
                         }
 
                         /* Create a single "element_type" field to hold element info */
-                        work.result->fields.resize(1);
-                        work.result->fields[0].name = "__element_type__";
-                        work.result->fields[0].byte_offset = 0;
-                        work.result->fields[0].type_info = std::make_unique<TypeInfo>();
+                        result->fields.resize(1);
+                        result->fields[0].name = "__element_type__";
+                        result->fields[0].byte_offset = 0;
                         stack.emplace_back(WORK_RESOLVE_TYPE, elem_offset,
-                                          work.result->fields[0].type_info.get(), 0, 0);
+                                          &result->fields[0].type_info, nullptr, 0);
                     }
+                    cache.put(work.die_offset, result);
                     break;
                 }
 
                 case DW_TAG_structure_type:
                 case DW_TAG_union_type: {
-                    work.result->type = (tag == DW_TAG_structure_type) ? "struct" : "union";
+                    result->type = (tag == DW_TAG_structure_type) ? "struct" : "union";
                     std::string name;
                     get_die_name(dbg, die, name);
-                    work.result->name = name;
+                    result->name = name;
 
                     Dwarf_Unsigned size = 0;
                     get_die_unsigned(dbg, die, DW_AT_byte_size, &size);
-                    work.result->size = (uint32_t)size;
+                    result->size = (uint32_t)size;
 
                     /* Count members first */
                     std::vector<Dwarf_Off> member_offsets;
@@ -661,29 +1024,30 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                     }
                     if (err) dwarf_dealloc_error(dbg, err);
 
-                    /* Pre-allocate fields */
-                    work.result->fields.resize(member_offsets.size());
-                    for (size_t i = 0; i < member_offsets.size(); i++) {
-                        work.result->fields[i].type_info = std::make_unique<TypeInfo>();
-                    }
+                    /* Pre-allocate fields; the vector is never resized again, so member slots stay valid */
+                    result->fields.resize(member_offsets.size());
+
+                    cache.put(work.die_offset, result);
+                    cache.in_progress.insert(work.die_offset);
+                    stack.emplace_back(WORK_FINISH_STRUCT, work.die_offset, nullptr, nullptr, 0);
 
                     /* Push work items for each member (in reverse order) */
                     for (size_t i = member_offsets.size(); i > 0; i--) {
                         stack.emplace_back(WORK_PARSE_MEMBER, member_offsets[i-1],
-                                          work.result, 0, (int)(i-1));
+                                          nullptr, result.get(), (int)(i-1));
                     }
                     break;
                 }
 
                 case DW_TAG_enumeration_type: {
-                    work.result->type = "enum";
+                    result->type = "enum";
                     std::string name;
                     get_die_name(dbg, die, name);
-                    work.result->name = name;
+                    result->name = name;
 
                     Dwarf_Unsigned size = 4;
                     get_die_unsigned(dbg, die, DW_AT_byte_size, &size);
-                    work.result->size = (uint32_t)size;
+                    result->size = (uint32_t)size;
 
                     /* Parse enumerators */
                     Dwarf_Die child = nullptr;
@@ -698,7 +1062,7 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                             if (get_die_signed(dbg, child, DW_AT_const_value, &val)) {
                                 ev.value = val;
                             }
-                            work.result->enumerators.push_back(ev);
+                            result->enumerators.push_back(ev);
                         }
                         if (err) dwarf_dealloc_error(dbg, err);
 
@@ -708,41 +1072,18 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                         child = sibling;
                     }
                     if (err) dwarf_dealloc_error(dbg, err);
+                    cache.put(work.die_offset, result);
                     break;
                 }
 
-                case DW_TAG_const_type: {
-                    Dwarf_Off underlying_offset;
-                    if (get_type_ref_offset(dbg, die, &underlying_offset)) {
-                        work.result->is_const = true;
-                        stack.emplace_back(WORK_RESOLVE_TYPE, underlying_offset,
-                                          work.result, 0, 0);
-                    } else {
-                        work.result->type = "void";
-                        work.result->is_const = true;
-                    }
-                    break;
-                }
-
-                case DW_TAG_volatile_type: {
-                    Dwarf_Off underlying_offset;
-                    if (get_type_ref_offset(dbg, die, &underlying_offset)) {
-                        work.result->is_volatile = true;
-                        stack.emplace_back(WORK_RESOLVE_TYPE, underlying_offset,
-                                          work.result, 0, 0);
-                    } else {
-                        work.result->type = "void";
-                        work.result->is_volatile = true;
-                    }
-                    break;
-                }
-
-                default:
-                    work.result->type = "unknown";
+                default: {
+                    result->type = "unknown";
                     Dwarf_Unsigned size = 0;
                     get_die_unsigned(dbg, die, DW_AT_byte_size, &size);
-                    work.result->size = (uint32_t)size;
+                    result->size = (uint32_t)size;
+                    cache.put(work.die_offset, result);
                     break;
+                }
             }
 
             dwarf_dealloc_die(die);
@@ -755,8 +1096,7 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                 continue;
             }
 
-            TypeInfo* parent = work.result;
-            FieldInfo& field = parent->fields[work.index];
+            FieldInfo& field = work.parent->fields[work.index];
 
             get_die_name(dbg, die, field.name);
             get_member_location(dbg, die, &field.byte_offset);
@@ -774,8 +1114,14 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
                 } 
 				else if (get_die_unsigned(dbg, die, DW_AT_bit_offset, &bit_offset)) 
 				{
-                    /* Convert from big-endian bit numbering */
-                    field.bit_offset = (int)bit_offset;  /* Simplified */
+                    /* Counted from the MSB of the storage unit; see member_bit_position */
+                    field.bit_offset = (int)bit_offset;
+                    field.legacy_bit_offset = true;
+                    Dwarf_Unsigned storage = 0;
+                    if (get_die_unsigned(dbg, die, DW_AT_byte_size, &storage)) 
+					{
+                        field.storage_bytes = (uint32_t)storage;
+                    }
                 }
             } 
 			else 
@@ -788,11 +1134,39 @@ static std::unique_ptr<TypeInfo> resolve_type_iterative(Dwarf_Debug dbg, Dwarf_O
             Dwarf_Off type_offset;
             if (get_type_ref_offset(dbg, die, &type_offset)) 
 			{
-                stack.emplace_back(WORK_RESOLVE_TYPE, type_offset, field.type_info.get(), 0, 0);
+                stack.emplace_back(WORK_RESOLVE_TYPE, type_offset, &field.type_info, nullptr, 0);
             }
 
             dwarf_dealloc_die(die);
         }
+        else if (work.type == WORK_FINISH_STRUCT) {
+            cache.in_progress.erase(work.die_offset);
+        }
+        else if (work.type == WORK_FINISH_ALIAS) {
+            const TypeInfoRef& underlying = scratch[work.index];
+            std::shared_ptr<TypeInfo> result;
+            if (underlying) {
+                /* Shallow copy: member and pointee subtrees stay shared */
+                result = std::make_shared<TypeInfo>(*underlying);
+            } else {
+                result = std::make_shared<TypeInfo>();
+                result->type = (work.tag == DW_TAG_typedef) ? work.name : "void";
+            }
+
+            if (work.tag == DW_TAG_typedef) {
+                result->typedef_name = work.name;   /* outermost typedef of a chain resolves last and wins */
+            } else if (work.tag == DW_TAG_const_type) {
+                result->is_const = true;
+            } else {
+                result->is_volatile = true;
+            }
+
+            /* An alias of a cycle stub is only valid inside the pointer that needed it */
+            if (!result->cycle_stub) {
+                cache.put(work.die_offset, result);
+            }
+            *work.slot = result;
+        }
     }
 
     return root_result;
@@ -852,6 +1226,27 @@ static std::string get_simple_type_name(const TypeInfo& ti)
     return ti.type;
 }
 
+/*
+ * Bit position of a bitfield member from the start of its parent, counted from the
+ * LSB of byte 0 (little-endian target). DW_AT_data_bit_offset already counts that way;
+ * DWARF 2/3 DW_AT_bit_offset counts from the MSB of the storage unit found at
+ * DW_AT_data_member_location, whose size is the member's DW_AT_byte_size or its type's.
+ */
+static uint32_t member_bit_position(const FieldInfo& f)
+{
+    if (!f.legacy_bit_offset) 
+	{
+        return f.byte_offset * 8 + (uint32_t)f.bit_offset;
+    }
+    uint32_t storage = f.storage_bytes;
+    if (storage == 0 && f.type_info) 
+	{
+        storage = f.type_info->size;
+    }
+    int64_t pos = (int64_t)(f.byte_offset + storage) * 8 - f.bit_offset - f.bit_size;
+    return (pos > 0) ? (uint32_t)pos : 0;
+}
+
 /* Compute absolute dartt_offsets and convert TypeInfo tree to DarttField tree */
 struct ConvertWork {
     const TypeInfo* type_info;
@@ -863,7 +1258,29 @@ struct ConvertWork {
         : type_info(ti), field_info(fi), out_field(out), base_byte_offset(base) {}
 };
 
-static void type_info_to_dartt_field(const TypeInfo& root_ti, DarttField& root_field, uint32_t base_offset = 0) 
+/* Enumerator tables by resolved enum type; typedefs of an enum are types of their own */
+typedef std::unordered_map<const TypeInfo*, DarttEnumRef> EnumTableMap;
+
+static DarttEnumRef enum_table_for(const TypeInfo& ti, EnumTableMap& enums)
+{
+    EnumTableMap::iterator it = enums.find(&ti);
+    if (it != enums.end()) 
+	{
+        return it->second;
+    }
+    std::vector<std::pair<int64_t, std::string>> entries;
+    entries.reserve(ti.enumerators.size());
+    for (size_t i = 0; i < ti.enumerators.size(); i++) 
+	{
+        entries.emplace_back(ti.enumerators[i].value, ti.enumerators[i].name);
+    }
+    DarttEnumRef table = make_enum_table(get_simple_type_name(ti), std::move(entries));
+    enums[&ti] = table;
+    return table;
+}
+
+static void type_info_to_dartt_field(const TypeInfo& root_ti, DarttField& root_field, EnumTableMap& enums,
+                                     uint32_t base_offset = 0) 
 {
     std::vector<ConvertWork> stack;
     stack.emplace_back(&root_ti, nullptr, &root_field, base_offset);
@@ -888,6 +1305,19 @@ static void type_info_to_dartt_field(const TypeInfo& root_ti, DarttField& root_f
         field.nbytes = ti.size;
         field.type_name = get_simple_type_name(ti);
         field.type = parse_field_type(ti.type);
+        if (ti.type == "enum") 
+		{
+            field.enum_info = enum_table_for(ti, enums);
+        }
+
+        if (work.field_info && work.field_info->bit_size > 0) 
+		{
+            uint32_t abs_bit = work.base_byte_offset * 8 + member_bit_position(*work.field_info);
+            if (!set_bitfield_layout(field, abs_bit, (uint32_t)work.field_info->bit_size)) 
+			{
+                fprintf(stderr, "Warning: bitfield %s spans more than 8 bytes, shown as whole bytes\n", field.name.c_str());
+            }
+        }
 
         if (ti.type == "struct" || ti.type == "union") 
 		{
@@ -905,6 +1335,7 @@ static void type_info_to_dartt_field(const TypeInfo& root_ti, DarttField& root_f
         else if (ti.type == "array") 
 		{
             field.array_size = ti.total_elements;
+            field.dims = ti.dimensions;
             if (!ti.fields.empty() && ti.fields[0].type_info) 
 			{
                 field.element_nbytes = ti.fields[0].type_info->size;
@@ -920,6 +1351,10 @@ static void type_info_to_dartt_field(const TypeInfo& root_ti, DarttField& root_f
                     /* Primitive array - set type from element */
                     field.type = parse_field_type(ti.fields[0].type_info->type);
                     field.type_name = get_simple_type_name(*ti.fields[0].type_info);
+                    if (ti.fields[0].type_info->type == "enum") 
+					{
+                        field.enum_info = enum_table_for(*ti.fields[0].type_info, enums);
+                    }
                 }
             }
         }
@@ -944,66 +1379,162 @@ elf_parse_error_t elf_parser_load_config(const char* elf_path, const char* symbo
 		 return err;
 	}
 
-    /* Get symbol address and size */
-    uint32_t sym_addr = 0, sym_size = 0;
-    if (!elf_parser_find_symbol(&parser, symbol_name, &sym_addr, &sym_size)) 
+    err = elf_parser_load_config_ctx(&parser, symbol_name, config);
+    elf_parser_cleanup(&parser);
+    return err;
+}
+
+/* One symbol of a (possibly multi-symbol) DARTT map, resolved to its type */
+struct ResolvedSymbol {
+    std::string name;
+    uint32_t addr;
+    uint32_t size;
+    TypeInfoRef type_info;
+
+    ResolvedSymbol() : addr(0), size(0) {}
+};
+
+/* Split "gl_ctrl, gl_diag gl_calib" into names; commas and whitespace both separate */
+static void split_symbol_list(const char* list, std::vector<std::string>& out)
+{
+    out.clear();
+    std::string cur;
+    for (const char* c = list; ; c++) 
 	{
-        elf_parser_cleanup(&parser);
-        return ELF_PARSE_SYMBOL_NOT_FOUND;
+        if (*c == '\0' || *c == ',' || isspace((unsigned char)*c)) 
+		{
+            if (!cur.empty()) 
+			{
+                out.push_back(cur);
+                cur.clear();
+            }
+            if (*c == '\0') break;
+        } 
+		else 
+		{
+            cur += *c;
+        }
     }
+}
 
-    config->symbol = symbol_name;
-    config->address = sym_addr;
-    char addr_buf[32];
-    snprintf(addr_buf, sizeof(addr_buf), "0x%08X", sym_addr);
-    config->address_str = addr_buf;
+const char* elf_symbol_list_last(const char* list)
+{
+    const char* last = list;
+    for (const char* c = list; *c; c++) 
+	{
+        if (*c == ',' || isspace((unsigned char)*c)) 
+		{
+            last = c + 1;
+        }
+    }
+    return last;
+}
 
-    /* Check for DWARF info */
-    if (!parser.dwarf_initialized) 
+/*
+ * Symbol lookup and type resolution shared by the DarttConfig and JSON outputs. Every
+ * symbol in the list is resolved against one TypeCache, so types they share (a common
+ * header struct, say) are walked once.
+ */
+static elf_parse_error_t resolve_symbol_list(elf_parser_ctx* parser, const char* symbol_list,
+                                             std::vector<ResolvedSymbol>& out)
+{
+    std::vector<std::string> names;
+    split_symbol_list(symbol_list, names);
+    if (names.empty()) 
 	{
-        elf_parser_cleanup(&parser);
-        return ELF_PARSE_NO_DWARF;
+        return ELF_PARSE_SYMBOL_NOT_FOUND;
     }
 
-    /* Find the variable in DWARF */
-    Dwarf_Die var_die = nullptr;
-    Dwarf_Off type_offset = 0;
-    if (!find_variable_die(parser.dbg, symbol_name, &var_die, &type_offset)) 
+    /* Check for DWARF info */
+    if (!parser->dwarf_initialized) 
 	{
-        elf_parser_cleanup(&parser);
-        return ELF_PARSE_NO_DEBUG_INFO;
+        return ELF_PARSE_NO_DWARF;
     }
 
-    /* Resolve the type */
     TypeCache cache;
-    std::unique_ptr<TypeInfo> type_info = resolve_type_iterative(parser.dbg, type_offset, cache);
-    if (!type_info) 
+    out.assign(names.size(), ResolvedSymbol());
+    for (size_t i = 0; i < names.size(); i++) 
 	{
-        if (var_die) dwarf_dealloc_die(var_die);
-        elf_parser_cleanup(&parser);
-        return ELF_PARSE_TYPE_ERROR;
-    }
+        ResolvedSymbol& rs = out[i];
+        rs.name = names[i];
 
-    /* Set size */
-    config->nbytes = (sym_size > 0) ? sym_size : type_info->size;
-    config->nwords = (config->nbytes + 3) / 4;
+        /* Get symbol address and size */
+        if (!elf_parser_find_symbol(parser, rs.name.c_str(), &rs.addr, &rs.size)) 
+		{
+            fprintf(stderr, "Symbol not found: %s\n", rs.name.c_str());
+            return ELF_PARSE_SYMBOL_NOT_FOUND;
+        }
 
-    /* Convert to DarttField tree */
-    config->root.name = symbol_name;
-    type_info_to_dartt_field(*type_info, config->root, 0);
+        /* Find the variable in DWARF */
+        Dwarf_Off type_offset = 0;
+        if (!find_variable_die(parser, rs.name.c_str(), &type_offset)) 
+		{
+            fprintf(stderr, "No debug info for: %s\n", rs.name.c_str());
+            return ELF_PARSE_NO_DEBUG_INFO;
+        }
 
-    /* Expand primitive arrays into element children, then collect leaves */
-    expand_array_elements(config->root);
-    collect_leaves(config->root, config->leaf_list);
+        /* Resolve the type */
+        rs.type_info = resolve_type_iterative(parser->dbg, type_offset, cache);
+        if (!rs.type_info) 
+		{
+            return ELF_PARSE_TYPE_ERROR;
+        }
+    }
+    return ELF_PARSE_SUCCESS;
+}
+
+/* Populate config from resolved symbol types, packed into one DARTT map in list order */
+static elf_parse_error_t type_info_to_config(const std::vector<ResolvedSymbol>& resolved, DarttConfig* config)
+{
+    std::vector<DarttField> roots(resolved.size());
+    EnumTableMap enums;
+    for (size_t i = 0; i < resolved.size(); i++) 
+	{
+        const ResolvedSymbol& rs = resolved[i];
+        DarttSymbol sym;
+        sym.name = rs.name;
+        sym.address = rs.addr;
+        char addr_buf[32];
+        snprintf(addr_buf, sizeof(addr_buf), "0x%08X", rs.addr);
+        sym.address_str = addr_buf;
+        sym.nbytes = (rs.size > 0) ? rs.size : rs.type_info->size;
+        config->symbols.push_back(sym);
+
+        /* Convert to DarttField tree */
+        type_info_to_dartt_field(*rs.type_info, roots[i], enums, 0);
+    }
+    if (!combine_symbol_roots(*config, roots)) 
+	{
+        return ELF_PARSE_ERROR;
+    }
+
+    /* Arrays build their elements on demand; collect the leaves outside them */
+    init_lazy_arrays(config->root);
+    refresh_leaf_list(*config);
+    build_field_search_index(config->root, config->search_index);
 
     printf("Loaded config from ELF: symbol=%s, address=0x%08X, nbytes=%u, nwords=%u\n",
            config->symbol.c_str(), config->address, config->nbytes, config->nwords);
-
-    if (var_die) dwarf_dealloc_die(var_die);
-    elf_parser_cleanup(&parser);
     return ELF_PARSE_SUCCESS;
 }
 
+elf_parse_error_t elf_parser_load_config_ctx(elf_parser_ctx* parser, const char* symbol_name, DarttConfig* config) 
+{
+    if (!parser || !symbol_name || !config)
+	{
+		 return ELF_PARSE_ERROR;
+	}
+
+    std::vector<ResolvedSymbol> resolved;
+    elf_parse_error_t err = resolve_symbol_list(parser, symbol_name, resolved);
+    if (err != ELF_PARSE_SUCCESS)
+	{
+        return err;
+    }
+
+    return type_info_to_config(resolved, config);
+}
+
 /* ============================================================================
  * JSON Generation (matches dartt-describe.py output format)
  * ============================================================================ */
@@ -1049,8 +1580,11 @@ static json type_info_to_json(const TypeInfo& ti)
             }
             if (f.bit_size >= 0) 
 			{
+                /* Normalised: byte holding the lowest bit, and the bit within that byte */
+                uint32_t pos = member_bit_position(f);
+                fj["byte_offset"] = pos / 8;
                 fj["bit_size"] = f.bit_size;
-                fj["bit_offset"] = f.bit_offset;
+                fj["bit_offset"] = pos % 8;
             }
             fields.push_back(fj);
         }
@@ -1134,69 +1668,154 @@ static void compute_json_dartt_offsets(json& type_json, uint32_t base_offset)
     }
 }
 
-elf_parse_error_t elf_parser_generate_json(elf_parser_ctx* parser,
-                                           const char* symbol_name,
-                                           const char* output_path) {
-    if (!parser || !symbol_name) return ELF_PARSE_ERROR;
-
-    /* Get symbol address and size */
-    uint32_t sym_addr = 0, sym_size = 0;
-    if (!elf_parser_find_symbol(parser, symbol_name, &sym_addr, &sym_size)) {
-        return ELF_PARSE_SYMBOL_NOT_FOUND;
-    }
-
-    /* Check for DWARF info */
-    if (!parser->dwarf_initialized) {
-        return ELF_PARSE_NO_DWARF;
-    }
-
-    /* Find the variable in DWARF */
-    Dwarf_Die var_die = nullptr;
-    Dwarf_Off type_offset = 0;
-    if (!find_variable_die(parser->dbg, symbol_name, &var_die, &type_offset)) {
-        return ELF_PARSE_NO_DEBUG_INFO;
-    }
-
-    /* Resolve the type */
-    TypeCache cache;
-    std::unique_ptr<TypeInfo> type_info = resolve_type_iterative(parser->dbg, type_offset, cache);
-    if (!type_info) {
-        if (var_die) dwarf_dealloc_die(var_die);
-        return ELF_PARSE_TYPE_ERROR;
-    }
-
-    /* Build output JSON */
-    uint32_t total_nbytes = (sym_size > 0) ? sym_size : type_info->size;
+/* JSON document for one resolved symbol */
+static json symbol_to_json(const ResolvedSymbol& rs)
+{
+    uint32_t total_nbytes = (rs.size > 0) ? rs.size : rs.type_info->size;
     json output;
-    output["symbol"] = symbol_name;
+    output["symbol"] = rs.name;
 
     char addr_buf[32];
-    snprintf(addr_buf, sizeof(addr_buf), "0x%08X", sym_addr);
+    snprintf(addr_buf, sizeof(addr_buf), "0x%08X", rs.addr);
     output["address"] = addr_buf;
-    output["address_int"] = sym_addr;
+    output["address_int"] = rs.addr;
     output["nbytes"] = total_nbytes;
     output["nwords"] = (total_nbytes + 3) / 4;
 
-    json type_json = type_info_to_json(*type_info);
+    json type_json = type_info_to_json(*rs.type_info);
     compute_json_dartt_offsets(type_json, 0);
     output["type"] = type_json;
+    return output;
+}
 
-    /* Write output */
-    std::string json_str = output.dump(2);
+/*
+ * Top-level JSON document. A single symbol keeps the original flat format; several are
+ * listed under "symbols", each with its base_offset in the DARTT map (packed in list order,
+ * as combine_symbol_roots does) and offsets relative to its own base.
+ */
+static json symbols_to_json(const std::vector<ResolvedSymbol>& resolved)
+{
+    if (resolved.size() == 1) 
+	{
+        return symbol_to_json(resolved[0]);
+    }
+
+    json output;
+    json list = json::array();
+    std::string names;
+    uint32_t next = 0;
+    uint32_t end = 0;
+    for (size_t i = 0; i < resolved.size(); i++) 
+	{
+        json sj = symbol_to_json(resolved[i]);
+        uint32_t nbytes = sj["nbytes"].get<uint32_t>();
+        sj["base_offset"] = next;
+        end = next + nbytes;
+        next = (end + 3u) & ~3u;
+        names += (i > 0 ? "," : "") + resolved[i].name;
+        list.push_back(sj);
+    }
+    output["symbol"] = names;
+    output["nbytes"] = end;
+    output["nwords"] = (end + 3) / 4;
+    output["symbols"] = list;
+    return output;
+}
 
+static bool write_json_text(const std::string& json_str, const char* output_path)
+{
     if (output_path) {
-        std::ofstream f(output_path);
-        if (!f.is_open()) {
-            if (var_die) dwarf_dealloc_die(var_die);
-            return ELF_PARSE_ERROR;
+        /* Atomic, since a reader (or the next load) may open the sidecar while this thread writes it */
+        std::string text = json_str + "\n";
+        if (!write_file_atomic(output_path, text.data(), text.size())) {
+            return false;
         }
-        f << json_str << "\n";
-        f.close();
         fprintf(stderr, "Wrote %s\n", output_path);
     } else {
         printf("%s\n", json_str.c_str());
     }
+    return true;
+}
+
+static bool write_json_file(const json& output, const char* output_path)
+{
+    return write_json_text(output.dump(2), output_path);
+}
+
+elf_parse_error_t elf_parser_generate_json(elf_parser_ctx* parser,
+                                           const char* symbol_name,
+                                           const char* output_path) {
+    if (!parser || !symbol_name) return ELF_PARSE_ERROR;
+
+    std::vector<ResolvedSymbol> resolved;
+    elf_parse_error_t err = resolve_symbol_list(parser, symbol_name, resolved);
+    if (err != ELF_PARSE_SUCCESS) {
+        return err;
+    }
+
+    json output = symbols_to_json(resolved);
+    if (!write_json_file(output, output_path)) {
+        return ELF_PARSE_ERROR;
+    }
+    return ELF_PARSE_SUCCESS;
+}
+
+/* At most one sidecar write in flight; later loads and saves wait on it */
+static std::thread json_writer;
+
+void elf_parser_wait_json(void)
+{
+    if (json_writer.joinable()) {
+        json_writer.join();
+    }
+}
+
+elf_parse_error_t elf_parser_load_config_and_json(elf_parser_ctx* parser,
+                                                  const char* symbol_name,
+                                                  DarttConfig* config,
+                                                  const char* json_path) {
+    if (!parser || !symbol_name || !config) return ELF_PARSE_ERROR;
+
+    /* Same image and symbol as an earlier load: skip DWARF entirely */
+    std::string cache_key = layout_cache_key(&parser->image);
+    std::string cached_json;
+    if (layout_cache_load(cache_key, symbol_name, config, &cached_json)) {
+        printf("Loaded config from layout cache: symbol=%s, address=0x%08X, nbytes=%u, nwords=%u\n",
+               config->symbol.c_str(), config->address, config->nbytes, config->nwords);
+        if (json_path) {
+            elf_parser_wait_json();
+            json_writer = std::thread([text = std::move(cached_json), path = std::string(json_path)]() {
+                if (!write_json_text(text, path.c_str())) {
+                    fprintf(stderr, "Error: could not write %s\n", path.c_str());
+                }
+            });
+        }
+        return ELF_PARSE_SUCCESS;
+    }
+
+    std::vector<ResolvedSymbol> resolved;
+    elf_parse_error_t err = resolve_symbol_list(parser, symbol_name, resolved);
+    if (err != ELF_PARSE_SUCCESS) {
+        return err;
+    }
 
-    if (var_die) dwarf_dealloc_die(var_die);
+    err = type_info_to_config(resolved, config);
+    if (err != ELF_PARSE_SUCCESS) {
+        return err;
+    }
+    std::vector<uint8_t> layout_blob;
+    layout_cache_encode(cache_key, symbol_name, *config, layout_blob);
+
+    /* The JSON tree is built here while type_info is alive; serializing and writing it is the slow part */
+    json output = symbols_to_json(resolved);
+    elf_parser_wait_json();
+    json_writer = std::thread([output = std::move(output), path = std::string(json_path ? json_path : ""),
+                               blob = std::move(layout_blob), key = cache_key, symbol = std::string(symbol_name)]() {
+        std::string text = output.dump(2);
+        if (!path.empty() && !write_json_text(text, path.c_str())) {
+            fprintf(stderr, "Error: could not write %s\n", path.c_str());
+        }
+        layout_cache_store(key, symbol.c_str(), blob, text);
+    });
     return ELF_PARSE_SUCCESS;
 }
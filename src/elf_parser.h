@@ -21,8 +21,10 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string>
-#include <elfio/elfio.hpp>
+#include <vector>
+#include <unordered_map>
 #include <libdwarf.h>
+#include "elf_image.h"
 
 /* Error codes returned by elf_parser functions */
 typedef enum {
@@ -40,18 +42,35 @@ typedef enum {
 /* Returns a human-readable string for an error code */
 const char* elf_parse_error_str(elf_parse_error_t err);
 
-/* Parser context - holds ELFIO and libdwarf state */
+/* Symbol table entry kept in the name index */
+struct elf_symbol_entry {
+    uint32_t addr;
+    uint32_t size;
+};
+
+/* Parser context - holds the mapped ELF and libdwarf state */
 struct elf_parser_ctx {
-    ELFIO::elfio elf;       /* ELFIO reader for symbol table access */
+    elf_image image;        /* read-only mapping of the ELF file */
+    Dwarf_Obj_Access_Interface_a dwarf_access;  /* feeds dbg from image; must outlive dbg */
     Dwarf_Debug dbg;        /* libdwarf debug handle */
     std::string path;       /* path to the ELF file */
     bool dwarf_initialized; /* true if libdwarf was successfully initialized */
 
-    elf_parser_ctx() : dbg(nullptr), dwarf_initialized(false) {}
+    /* Name index, built once by elf_parser_init */
+    std::unordered_map<std::string, elf_symbol_entry> symbols;  /* symtab name -> addr/size */
+    std::unordered_map<std::string, Dwarf_Off> variables;       /* global variable name -> DIE offset */
+    std::vector<std::string> variable_names;                    /* sorted keys of variables, for completion */
+    bool variables_complete;    /* false while variables only holds accelerated-table names */
+
+    elf_parser_ctx() : dwarf_access(), dbg(nullptr), dwarf_initialized(false), variables_complete(false) {}
+    elf_parser_ctx(const elf_parser_ctx&) = delete;
+    elf_parser_ctx& operator=(const elf_parser_ctx&) = delete;
 };
 
 /*
- * Initialize parser and load an ELF file.
+ * Initialize parser and load an ELF file. Also builds the symbol and variable
+ * name index (from .debug_names/.debug_pubnames when present, otherwise one
+ * pass over every CU), so later lookups are hash lookups.
  *
  * @param parser Pointer to parser struct (caller-allocated, e.g. on stack)
  * @param path   Path to the ELF file
@@ -60,7 +79,7 @@ struct elf_parser_ctx {
 elf_parse_error_t elf_parser_init(elf_parser_ctx* parser, const char* path);
 
 /*
- * Clean up parser internal resources (libdwarf handle, etc).
+ * Clean up parser internal resources (libdwarf handle, file mapping, indexes).
  * Does not free the parser struct itself.
  *
  * @param parser Pointer to parser struct
@@ -79,11 +98,26 @@ void elf_parser_cleanup(elf_parser_ctx* parser);
 bool elf_parser_find_symbol(elf_parser_ctx* parser, const char* name,
                             uint32_t* out_addr, uint32_t* out_size);
 
+/*
+ * List indexed variable names starting with prefix, in sorted order.
+ *
+ * @param parser      Parser pointer
+ * @param prefix      Name prefix (empty matches everything)
+ * @param out         Receives up to max_results names (cleared first)
+ * @param max_results Maximum names to return
+ * @return            Number of names written to out
+ */
+size_t elf_parser_complete(const elf_parser_ctx* parser, const char* prefix,
+                           std::vector<std::string>& out, size_t max_results);
+
+/* The name being typed at the end of a comma/space separated symbol list (points into list) */
+const char* elf_symbol_list_last(const char* list);
+
 /*
  * Generate JSON output matching dartt-describe.py format.
  *
  * @param parser      Parser pointer
- * @param symbol_name Name of the global variable to describe
+ * @param symbol_name Name of the global variable(s) to describe, as for elf_parser_load_config
  * @param output_path Path to write JSON file, or NULL for stdout
  * @return            ELF_PARSE_SUCCESS or error code
  */
@@ -106,7 +140,8 @@ struct DarttConfig;
  *   [ELF] -> [C++: elf_parser_load_config]
  *
  * @param elf_path    Path to the ELF file with DWARF debug info
- * @param symbol_name Name of the global variable to parse
+ * @param symbol_name Name of the global variable to parse, or several separated by
+ *                    commas ("gl_ctrl,gl_diag,gl_calib"), packed into one DARTT map in order
  * @param config      DarttConfig to populate
  * @return            ELF_PARSE_SUCCESS or error code
  */
@@ -116,4 +151,36 @@ elf_parse_error_t elf_parser_load_config(
     DarttConfig* config
 );
 
+/*
+ * Same as elf_parser_load_config, using an already initialized parser.
+ */
+elf_parse_error_t elf_parser_load_config_ctx(
+    elf_parser_ctx* parser,
+    const char* symbol_name,
+    DarttConfig* config
+);
+
+/*
+ * Load a DarttConfig and write its JSON sidecar from a single symbol lookup and
+ * type resolution. The file is written on a background thread; call
+ * elf_parser_wait_json() before reading it back. Layouts are kept in the on-disk
+ * layout cache (layout_cache.h), so dropping the same image again skips DWARF.
+ *
+ * @param parser      Initialized parser
+ * @param symbol_name Name of the global variable(s) to parse, as for elf_parser_load_config
+ * @param config      DarttConfig to populate
+ * @param json_path   Path of the JSON file to write, or NULL for none (a reload whose
+ *                    session file must not be replaced by a bare layout)
+ * @return            ELF_PARSE_SUCCESS or error code (the write itself is reported on stderr)
+ */
+elf_parse_error_t elf_parser_load_config_and_json(
+    elf_parser_ctx* parser,
+    const char* symbol_name,
+    DarttConfig* config,
+    const char* json_path
+);
+
+/* Block until any pending background JSON write has finished */
+void elf_parser_wait_json(void);
+
 #endif /* DARTT_ELF_PARSER_H */
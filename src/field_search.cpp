@@ -0,0 +1,614 @@
+/*
+ * field_search.cpp - fuzzy search over the full dotted paths of a field tree
+ *
+ * Paths are stored back to back in one string (plus a lower-cased copy) so a scan
+ * touches memory in order. Each entry has a 64-bit mask of the characters in its
+ * path, kept in an array of their own; a path whose mask lacks any of the query's
+ * characters is rejected without touching the text, which removes most of the index
+ * for any query of two or more characters.
+ *
+ * A pattern's elements differ only in their index digits. A query with no digits
+ * therefore matches all of them or none, at the same score bar the path length, and
+ * is decided once per pattern. A query with digits scans the elements of the patterns
+ * whose names it matches, sharing the scan of the path up to the index that changed.
+ */
+
+#include "field_search.h"
+#include "config.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+/* ============================================================================
+ * Building
+ * ============================================================================ */
+
+static inline char fold_char(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+/* Bit for a folded character: letters, digits and the path punctuation get their own */
+static inline uint64_t char_bit(char c) {
+    if (c >= 'a' && c <= 'z') return 1ull << (c - 'a');
+    if (c >= '0' && c <= '9') return 1ull << (26 + c - '0');
+    switch (c) {
+        case '_': return 1ull << 36;
+        case '.': return 1ull << 37;
+        case '[': return 1ull << 38;
+        case ']': return 1ull << 39;
+        default:  return 1ull << (40 + (uint8_t)c % 24);
+    }
+}
+
+#define DIGIT_BITS (0x3ffull << 26)
+
+static void add_entry(FieldSearchIndex& index, const std::string& path, size_t name_pos, uint32_t byte_offset,
+                      const std::vector<FieldSearchDim>& dims) {
+    uint64_t count = 1;
+    for (const FieldSearchDim& d : dims) {
+        count *= d.count;
+    }
+    if (count == 0) {
+        return;
+    }
+    if (count > UINT32_MAX) {
+        fprintf(stderr, "Warning: %s has too many elements to search, left out\n", path.c_str());
+        return;
+    }
+    FieldSearchEntry e;
+    e.path_start = (uint32_t)index.text.size();
+    e.path_len = (uint32_t)path.size();
+    e.name_pos = (uint32_t)name_pos;
+    e.byte_offset = byte_offset;
+    e.dim_start = (uint32_t)index.dims.size();
+    e.ndims = (uint32_t)dims.size();
+    e.count = (uint32_t)count;
+    uint64_t mask = 0;
+    for (char c : path) {
+        char f = fold_char(c);
+        index.folded.push_back(f);
+        if (f != '*') {
+            mask |= char_bit(f);
+        }
+    }
+    index.text += path;
+    index.dims.insert(index.dims.end(), dims.begin(), dims.end());
+    index.entries.push_back(e);
+    index.char_masks.push_back(mask);
+}
+
+/*
+ * Work item for the index walk. Lazy arrays are walked without building them: each
+ * becomes a "[*]" per dimension, then either the scalar elements (one entry) or the
+ * element template, which is laid out at the array's first element and reached
+ * through shift.
+ */
+struct IndexWork {
+    const DarttField* field;
+    uint32_t shift;                     // added to the offsets of field and everything below it
+    std::vector<FieldSearchDim> dims;   // the path's "[*]"s so far
+    std::string path;
+};
+
+void build_field_search_index(const DarttField& root, FieldSearchIndex& index) {
+    static uint32_t generation = 0;
+
+    index.entries.clear();
+    index.dims.clear();
+    index.char_masks.clear();
+    index.text.clear();
+    index.folded.clear();
+    index.by_shape.clear();
+    index.generation = ++generation;
+
+    std::vector<IndexWork> stack;
+    if (is_leaf_field(root)) {
+        add_entry(index, root.name, 0, root.byte_offset, {});
+        return;
+    }
+    if (root.lazy) {
+        stack.push_back({&root, 0, {}, std::string()});
+    } else {
+        for (size_t i = root.children.size(); i > 0; i--) {
+            stack.push_back({&root.children[i - 1], 0, {}, root.children[i - 1].name});
+        }
+    }
+
+    while (!stack.empty()) {
+        IndexWork work = std::move(stack.back());
+        stack.pop_back();
+        const DarttField* f = work.field;
+
+        if (is_leaf_field(*f)) {
+            /* A leaf template (an empty struct element) is named "[i]" once built, like its path ends */
+            size_t name_pos = work.path.size() - f->name.size();
+            if (work.path.size() < f->name.size() || work.path.compare(name_pos, std::string::npos, f->name) != 0) {
+                name_pos = work.path.rfind('[');
+            }
+            add_entry(index, work.path, name_pos, f->byte_offset + work.shift, work.dims);
+            continue;
+        }
+        if (!f->lazy) {
+            for (size_t i = f->children.size(); i > 0; i--) {
+                const DarttField& child = f->children[i - 1];
+                stack.push_back({&child, work.shift, work.dims, field_child_path(work.path, child.name)});
+            }
+            continue;
+        }
+
+        /* A lazy array: one "[*]" per dimension, each stride the size of the level below */
+        if (f->dims.empty()) {
+            continue;
+        }
+        uint32_t base = f->byte_offset + work.shift;
+        uint32_t stride = f->element_nbytes;
+        size_t last_bracket = 0;
+        for (size_t d = 0; d < f->dims.size(); d++) {
+            if (d > 0) {
+                stride = f->dims[d] ? stride / f->dims[d] : 0;
+            }
+            work.dims.push_back({f->dims[d], stride});
+            last_bracket = work.path.size();
+            work.path += "[*]";
+        }
+        if (!f->element_template) {
+            add_entry(index, work.path, last_bracket, base, work.dims);
+            continue;
+        }
+        const DarttField* t = f->element_template.get();
+        stack.push_back({t, base - t->byte_offset, std::move(work.dims), std::move(work.path)});
+    }
+}
+
+/* ============================================================================
+ * Elements
+ * ============================================================================ */
+
+/* Indices of element, one per "[*]" */
+static void element_indices(const FieldSearchIndex& index, const FieldSearchEntry& e, uint32_t element,
+                            std::vector<uint32_t>& out) {
+    out.resize(e.ndims);
+    for (uint32_t d = e.ndims; d > 0; d--) {
+        uint32_t count = index.dims[e.dim_start + d - 1].count;
+        out[d - 1] = element % count;
+        element /= count;
+    }
+}
+
+/* The path of the element with these indices, into text, and where its leaf name starts */
+static void write_element_path(const FieldSearchIndex& index, const FieldSearchEntry& e, const uint32_t* indices,
+                               std::string& text, uint32_t* name_pos) {
+    const char* p = index.text.data() + e.path_start;
+    text.clear();
+    uint32_t d = 0;
+    for (uint32_t i = 0; i < e.path_len; i++) {
+        if (i == e.name_pos && name_pos) {
+            *name_pos = (uint32_t)text.size();
+        }
+        if (p[i] == '*') {
+            char digits[12];
+            char* end = std::to_chars(digits, digits + sizeof(digits), indices[d++]).ptr;
+            text.append(digits, end);
+            continue;
+        }
+        text.push_back(p[i]);
+    }
+}
+
+static inline uint32_t decimal_len(uint32_t v) {
+    uint32_t n = 1;
+    while (v >= 10) {
+        v /= 10;
+        n++;
+    }
+    return n;
+}
+
+/* Step indices to the next element, last index fastest. Returns the first index that changed. */
+static inline uint32_t next_element(const FieldSearchIndex& index, const FieldSearchEntry& e, std::vector<uint32_t>& indices) {
+    for (uint32_t d = e.ndims; d > 0; d--) {
+        if (++indices[d - 1] < index.dims[e.dim_start + d - 1].count) {
+            return d - 1;
+        }
+        indices[d - 1] = 0;
+    }
+    return 0;
+}
+
+std::string field_search_path(const FieldSearchIndex& index, FieldSearchHit hit) {
+    const FieldSearchEntry& e = index.entries[hit.entry];
+    std::vector<uint32_t> indices;
+    element_indices(index, e, hit.element, indices);
+    std::string path;
+    write_element_path(index, e, indices.data(), path, nullptr);
+    return path;
+}
+
+std::string field_search_leaf_name(const FieldSearchIndex& index, FieldSearchHit hit) {
+    const FieldSearchEntry& e = index.entries[hit.entry];
+    std::vector<uint32_t> indices;
+    element_indices(index, e, hit.element, indices);
+    std::string path;
+    uint32_t name_pos = 0;
+    write_element_path(index, e, indices.data(), path, &name_pos);
+    return path.substr(name_pos);
+}
+
+uint32_t field_search_offset(const FieldSearchIndex& index, FieldSearchHit hit) {
+    const FieldSearchEntry& e = index.entries[hit.entry];
+    std::vector<uint32_t> indices;
+    element_indices(index, e, hit.element, indices);
+    uint32_t offset = e.byte_offset;
+    for (uint32_t d = 0; d < e.ndims; d++) {
+        offset += indices[d] * index.dims[e.dim_start + d].stride;
+    }
+    return offset;
+}
+
+/* ============================================================================
+ * Matching
+ * ============================================================================ */
+
+static inline bool segment_start(char prev, char cur) {
+    return prev == '.' || prev == '[' || prev == '_' ||
+           (prev >= 'a' && prev <= 'z' && cur >= 'A' && cur <= 'Z');
+}
+
+static inline bool is_segment_start(const char* text, uint32_t i) {
+    return i == 0 || segment_start(text[i - 1], text[i]);
+}
+
+/*
+ * Match and rank in one pass: the query characters must appear in order, each taken
+ * at its first occurrence. Each matched character scores, with bonuses for running on
+ * from the previous match and for starting a segment; matching inside the leaf's own
+ * name is preferred. Returns NO_MATCH if the path does not match. The final score
+ * (final_score) also prefers short paths.
+ */
+#define NO_MATCH INT32_MIN
+
+static int fuzzy_points(const char* text, const char* folded, uint32_t len, uint32_t name_pos, const char* q, size_t qn) {
+    int score = 0;
+    uint32_t pos = 0;
+    uint32_t prev = UINT32_MAX;
+    for (size_t i = 0; i < qn; i++) {
+        while (pos < len && folded[pos] != q[i]) {
+            pos++;      /* paths are short; a plain scan beats a memchr call */
+        }
+        if (pos == len) {
+            return NO_MATCH;
+        }
+        score += 1;
+        if (prev != UINT32_MAX && pos == prev + 1) score += 4;
+        if (is_segment_start(text, pos)) score += 3;
+        if (pos >= name_pos) score += 2;
+        prev = pos;
+        pos++;
+    }
+    return score;
+}
+
+static inline int final_score(int points, uint32_t path_len) {
+    return points * 16 - (int)path_len;
+}
+
+/* fuzzy_points part way along a path, so a pattern's elements can share the scan of their common start */
+struct ScanState {
+    uint32_t qi;            // query characters matched
+    int points;
+    uint32_t len;           // path characters seen
+    char last;
+    bool last_matched;
+};
+
+static inline void scan_char(ScanState& s, char c, char f, bool in_name, const char* q, size_t qn) {
+    bool matched = s.qi < qn && f == q[s.qi];
+    if (matched) {
+        s.points += 1;
+        if (s.last_matched) s.points += 4;
+        if (s.len == 0 || segment_start(s.last, c)) s.points += 3;
+        if (in_name) s.points += 2;
+        s.qi++;
+    }
+    s.last_matched = matched;
+    s.last = c;
+    s.len++;
+}
+
+/* Scan pattern characters from..to-1, none of them a "*" */
+static inline void scan_pattern(ScanState& s, const FieldSearchIndex& index, const FieldSearchEntry& e,
+                                uint32_t from, uint32_t to, const char* q, size_t qn) {
+    for (uint32_t i = from; i < to; i++) {
+        scan_char(s, index.text[e.path_start + i], index.folded[e.path_start + i], i >= e.name_pos, q, qn);
+    }
+}
+
+/* Whether q with its digits left out appears in order in the pattern: every element match needs it */
+static bool pattern_may_match(const char* folded, uint32_t len, const char* q, size_t qn) {
+    uint32_t pos = 0;
+    for (size_t i = 0; i < qn; i++) {
+        if (q[i] >= '0' && q[i] <= '9') {
+            continue;
+        }
+        while (pos < len && folded[pos] != q[i]) {
+            pos++;
+        }
+        if (pos == len) {
+            return false;
+        }
+        pos++;
+    }
+    return true;
+}
+
+/* Scores are negated so ascending order is best first, ties in tree order */
+struct Scored {
+    int neg_score;
+    FieldSearchHit hit;
+    bool operator<(const Scored& o) const {
+        if (neg_score != o.neg_score) return neg_score < o.neg_score;
+        if (hit.entry != o.hit.entry) return hit.entry < o.hit.entry;
+        return hit.element < o.hit.element;
+    }
+};
+
+/* The best FIELD_SEARCH_MAX_RANKED so far, as a heap with the worst on top */
+struct Ranking {
+    std::vector<Scored> heap;
+
+    bool wants(int neg_score) const {
+        return heap.size() < FIELD_SEARCH_MAX_RANKED || neg_score <= heap.front().neg_score;
+    }
+    void add(int neg_score, uint32_t entry, uint32_t element) {
+        Scored s = {neg_score, {entry, element}};
+        if (heap.size() < FIELD_SEARCH_MAX_RANKED) {
+            heap.push_back(s);
+            std::push_heap(heap.begin(), heap.end());
+        } else if (s < heap.front()) {
+            std::pop_heap(heap.begin(), heap.end());
+            heap.back() = s;
+            std::push_heap(heap.begin(), heap.end());
+        }
+    }
+};
+
+static void add_match(FieldSearch& search, uint32_t entry, uint32_t element) {
+    if (!search.matches.empty()) {
+        FieldSearchRun& last = search.matches.back();
+        if (last.entry == entry && last.first + last.count == element) {
+            last.count++;
+            search.match_count++;
+            return;
+        }
+    }
+    search.matches.push_back({entry, element, 1});
+    search.match_count++;
+}
+
+/*
+ * Add the matching elements of entry i among first..first + count - 1. Without digits
+ * in the query (plain) the pattern's own text decides for all of them.
+ */
+static void match_entry(const FieldSearchIndex& index, uint32_t i, uint32_t first, uint32_t count,
+                        const std::string& q, uint64_t mask, bool plain,
+                        FieldSearch& search, Ranking& ranking, std::vector<uint32_t>& indices) {
+    const FieldSearchEntry& e = index.entries[i];
+    uint64_t have = index.char_masks[i];
+    const char* pattern_text = index.text.data() + e.path_start;
+    const char* pattern_folded = index.folded.data() + e.path_start;
+
+    if (e.ndims == 0) {
+        if ((mask & ~have) != 0) {
+            return;
+        }
+        int points = fuzzy_points(pattern_text, pattern_folded, e.path_len, e.name_pos, q.data(), q.size());
+        if (points != NO_MATCH) {
+            add_match(search, i, 0);
+            ranking.add(-final_score(points, e.path_len), i, 0);
+        }
+        return;
+    }
+
+    if ((mask & ~(have | DIGIT_BITS)) != 0 || !pattern_may_match(pattern_folded, e.path_len, q.data(), q.size())) {
+        return;
+    }
+    element_indices(index, e, first, indices);
+    uint32_t end = first + count;
+    if (plain) {
+        int points = fuzzy_points(pattern_text, pattern_folded, e.path_len, e.name_pos, q.data(), q.size());
+        if (points == NO_MATCH) {
+            return;
+        }
+        search.matches.push_back({i, first, count});
+        search.match_count += count;
+        /* Elements differ only in length; the shortest could still rank */
+        uint32_t base_len = e.path_len - e.ndims;
+        if (!ranking.wants(-final_score(points, base_len + e.ndims))) {
+            return;
+        }
+        for (uint32_t element = first; element < end; element++) {
+            uint32_t len = base_len;
+            for (uint32_t d = 0; d < e.ndims; d++) {
+                len += decimal_len(indices[d]);
+            }
+            int neg = -final_score(points, len);
+            if (ranking.wants(neg)) {
+                ranking.add(neg, i, element);
+            } else if (e.ndims == 1) {
+                break;      /* one index: the paths only get longer */
+            }
+            next_element(index, e, indices);
+        }
+        return;
+    }
+
+    /*
+     * The query may reach into the indices. The scan state where each "[*]" starts is
+     * kept, so the next element rescans only from the first index that changed.
+     */
+    const char* qd = q.data();
+    size_t qn = q.size();
+    std::vector<uint32_t> stars;
+    for (uint32_t p = 0; p < e.path_len; p++) {
+        if (pattern_text[p] == '*') {
+            stars.push_back(p);
+        }
+    }
+    stars.push_back(e.path_len);
+    std::vector<ScanState> states(e.ndims + 1);
+    states[0] = ScanState{0, 0, 0, 0, false};
+    scan_pattern(states[0], index, e, 0, stars[0], qd, qn);
+    uint32_t changed = 0;
+    for (uint32_t element = first; element < end; element++) {
+        for (uint32_t d = changed; d < e.ndims; d++) {
+            ScanState st = states[d];
+            char digits[12];
+            char* digits_end = std::to_chars(digits, digits + sizeof(digits), indices[d]).ptr;
+            for (char* c = digits; c < digits_end; c++) {
+                scan_char(st, *c, *c, stars[d] >= e.name_pos, qd, qn);
+            }
+            scan_pattern(st, index, e, stars[d] + 1, stars[d + 1], qd, qn);
+            states[d + 1] = st;
+        }
+        const ScanState& done = states[e.ndims];
+        if (done.qi == qn) {
+            add_match(search, i, element);
+            ranking.add(-final_score(done.points, done.len), i, element);
+        }
+        changed = next_element(index, e, indices);
+    }
+}
+
+bool field_search_update(const FieldSearchIndex& index, const char* query, FieldSearch& search) {
+    std::string q;
+    for (const char* c = query; *c; c++) {
+        if (*c != ' ' && *c != '\t') {
+            q.push_back(fold_char(*c));
+        }
+    }
+    bool same_index = search.generation == index.generation;
+    if (same_index && q == search.query) {
+        return false;
+    }
+
+    /* Typing more can only narrow the previous results */
+    bool narrowing = same_index && !search.query.empty() &&
+                     q.size() > search.query.size() && q.compare(0, search.query.size(), search.query) == 0;
+    search.generation = index.generation;
+    search.query = q;
+    search.ranked.clear();
+    std::vector<FieldSearchRun> previous;
+    previous.swap(search.matches);
+    search.match_count = 0;
+    if (q.empty()) {
+        return true;
+    }
+
+    uint64_t mask = 0;
+    bool plain = true;
+    for (char c : q) {
+        mask |= char_bit(c);
+        if ((c >= '0' && c <= '9') || c == '*') {
+            plain = false;
+        }
+    }
+    Ranking ranking;
+    std::vector<uint32_t> indices;
+    if (narrowing) {
+        for (const FieldSearchRun& run : previous) {
+            match_entry(index, run.entry, run.first, run.count, q, mask, plain, search, ranking, indices);
+        }
+    } else {
+        uint32_t n = (uint32_t)index.entries.size();
+        for (uint32_t i = 0; i < n; i++) {
+            match_entry(index, i, 0, index.entries[i].count, q, mask, plain, search, ranking, indices);
+        }
+    }
+
+    /* Only the shown results need sorting */
+    std::sort(ranking.heap.begin(), ranking.heap.end());
+    search.ranked.reserve(ranking.heap.size());
+    for (const Scored& s : ranking.heap) {
+        search.ranked.push_back(s.hit);
+    }
+    return true;
+}
+
+/* ============================================================================
+ * Exact lookup
+ * ============================================================================ */
+
+/* FNV-1a over the path with every bracketed index (or "*") read as "*" */
+static uint64_t shape_hash(const char* s, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ (uint8_t)s[i]) * 0x100000001b3ull;
+        if (s[i] == '[') {
+            h = (h ^ (uint8_t)'*') * 0x100000001b3ull;
+            while (i + 1 < n && s[i + 1] != ']') {
+                i++;
+            }
+        }
+    }
+    return h;
+}
+
+/* Whether path is one of e's leaves; which one into *element */
+static bool match_pattern(const FieldSearchIndex& index, const FieldSearchEntry& e, const std::string& path,
+                          uint32_t* element) {
+    const char* p = index.text.data() + e.path_start;
+    size_t j = 0;
+    uint32_t d = 0;
+    uint64_t el = 0;
+    for (uint32_t i = 0; i < e.path_len; i++) {
+        if (p[i] != '*') {
+            if (j >= path.size() || path[j] != p[i]) {
+                return false;
+            }
+            j++;
+            continue;
+        }
+        uint32_t count = index.dims[e.dim_start + d++].count;
+        size_t start = j;
+        uint64_t v = 0;
+        while (j < path.size() && path[j] >= '0' && path[j] <= '9') {
+            v = v * 10 + (uint64_t)(path[j] - '0');
+            if (v >= count) {
+                return false;
+            }
+            j++;
+        }
+        if (j == start || (j - start > 1 && path[start] == '0')) {
+            return false;
+        }
+        el = el * count + v;
+    }
+    if (j != path.size()) {
+        return false;
+    }
+    *element = (uint32_t)el;
+    return true;
+}
+
+bool field_search_find_path(FieldSearchIndex& index, const std::string& path, FieldSearchHit* hit) {
+    if (index.by_shape.empty() && !index.entries.empty()) {
+        index.by_shape.reserve(index.entries.size());
+        for (uint32_t i = 0; i < (uint32_t)index.entries.size(); i++) {
+            const FieldSearchEntry& e = index.entries[i];
+            index.by_shape.emplace(shape_hash(index.text.data() + e.path_start, e.path_len), i);
+        }
+    }
+    auto range = index.by_shape.equal_range(shape_hash(path.data(), path.size()));
+    for (auto it = range.first; it != range.second; ++it) {
+        uint32_t element;
+        if (match_pattern(index, index.entries[it->second], path, &element)) {
+            hit->entry = it->second;
+            hit->element = element;
+            return true;
+        }
+    }
+    return false;
+}
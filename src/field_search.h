@@ -0,0 +1,114 @@
+/*
+ * field_search.h - fuzzy search over the full dotted paths of a field tree
+ *
+ * The index lists every leaf by its path from the root ("thing_array[2].v[1]"),
+ * including the elements of arrays that have not been built yet, so a search can
+ * find them without expanding anything. An unbuilt array is indexed once, as a
+ * pattern with "[*]" for its indices ("thing_array[*].v[*]"), so the index is the
+ * size of the layout however long its arrays are; a query expands only the
+ * patterns whose names it matches. It is built once per loaded layout.
+ * A query matches a path when its characters appear in order (case-insensitive);
+ * matches are ranked by how many characters run together or start a path segment.
+ *
+ * Usage:
+ *   build_field_search_index(config.root, config.search_index);
+ *   if (field_search_update(config.search_index, query, search)) {
+ *       ... search.matches / search.ranked changed ...
+ *   }
+ *   FieldSearchHit hit = search.ranked[i];
+ *   DarttField* leaf = find_leaf(config.root, field_search_offset(index, hit),
+ *                                field_search_leaf_name(index, hit), true);
+ */
+
+#ifndef DARTT_FIELD_SEARCH_H
+#define DARTT_FIELD_SEARCH_H
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct DarttField;
+
+/* Most results kept in ranked order; the rest are still in matches (e.g. for bulk subscribe) */
+#define FIELD_SEARCH_MAX_RANKED 512
+
+/* One "[*]" of a pattern: it stands for 0..count-1, each index stride bytes on from the last */
+struct FieldSearchDim
+{
+    uint32_t count;
+    uint32_t stride;
+};
+
+struct FieldSearchEntry
+{
+    uint32_t path_start;        // into FieldSearchIndex::text / folded
+    uint32_t path_len;
+    uint32_t name_pos;          // the leaf's own name is path[name_pos..]
+    uint32_t byte_offset;       // the leaf's absolute offset (all indices 0), for find_leaf
+    uint32_t dim_start;         // the path's "[*]"s, in order, are dims[dim_start..dim_start + ndims)
+    uint32_t ndims;
+    uint32_t count;             // leaves the entry stands for: the product of its dims' counts
+};
+
+/* One leaf: an entry, and for a pattern its element (row-major over the "[*]"s, last fastest) */
+struct FieldSearchHit
+{
+    uint32_t entry;
+    uint32_t element;
+};
+
+/* Consecutive matching elements of one entry */
+struct FieldSearchRun
+{
+    uint32_t entry;
+    uint32_t first;
+    uint32_t count;
+};
+
+struct FieldSearchIndex
+{
+    std::vector<FieldSearchEntry> entries;  // leaves and patterns in tree order
+    std::vector<FieldSearchDim> dims;
+    std::vector<uint64_t> char_masks;       // per entry: which folded characters occur (see field_search.cpp)
+    std::string text;                       // all paths back to back
+    std::string folded;                     // the same, lower-cased
+    uint32_t generation;                    // changes on every build
+    std::unordered_multimap<uint64_t, uint32_t> by_shape;  // path hash, indices as "[*]" -> entry; built on first lookup
+
+    FieldSearchIndex() : generation(0) {}
+};
+
+/* Results of the last query; pass the same object back in as the query is typed */
+struct FieldSearch
+{
+    std::string query;                  // query the results are for
+    uint32_t generation;                // index the results are for
+    std::vector<FieldSearchRun> matches;    // every matching leaf, by entry then element
+    size_t match_count;                 // leaves in matches
+    std::vector<FieldSearchHit> ranked; // best matches first, at most FIELD_SEARCH_MAX_RANKED
+
+    FieldSearch() : generation(0), match_count(0) {}
+};
+
+/* Index every leaf path below root (root's own name is left out unless it is a leaf itself) */
+void build_field_search_index(const DarttField& root, FieldSearchIndex& index);
+
+/*
+ * Bring search up to date with query. A query that extends the previous one only
+ * rescans the previous matches. Returns true if the results changed.
+ */
+bool field_search_update(const FieldSearchIndex& index, const char* query, FieldSearch& search);
+
+/*
+ * Leaf whose path is exactly path, into *hit; false if there is none. The first
+ * lookup after a build hashes every entry, later ones are a hash lookup.
+ */
+bool field_search_find_path(FieldSearchIndex& index, const std::string& path, FieldSearchHit* hit);
+
+/* Full path, leaf name and absolute offset of a leaf */
+std::string field_search_path(const FieldSearchIndex& index, FieldSearchHit hit);
+std::string field_search_leaf_name(const FieldSearchIndex& index, FieldSearchHit hit);
+uint32_t field_search_offset(const FieldSearchIndex& index, FieldSearchHit hit);
+
+#endif /* DARTT_FIELD_SEARCH_H */
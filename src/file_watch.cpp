@@ -0,0 +1,135 @@
+/*
+ * file_watch.cpp - notice when a file on disk has been rewritten
+ */
+
+#include "file_watch.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <system_error>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+/* Size and modification time, or false if the file cannot be read right now */
+static bool stat_file(const std::string& path, uint64_t* size, int64_t* mtime) {
+    std::error_code ec;
+    uintmax_t n = fs::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    fs::file_time_type t = fs::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    *size = (uint64_t)n;
+    *mtime = (int64_t)t.time_since_epoch().count();
+    return true;
+}
+
+FileWatch::~FileWatch() {
+    file_watch_stop(*this);
+}
+
+bool file_watch_start(FileWatch& w, const std::string& path) {
+    file_watch_stop(w);
+    fs::path p(path);
+    w.path = path;
+    w.name = p.filename().string();
+    w.dir = p.has_parent_path() ? p.parent_path().string() : std::string(".");
+    w.pending = false;
+    w.checked_ms = 0;
+    if (!stat_file(path, &w.size, &w.mtime)) {
+        fprintf(stderr, "Error: cannot watch %s: file not found\n", path.c_str());
+        return false;
+    }
+
+#ifdef __linux__
+    /* The directory, not the file: a rename over the file would end a watch on its inode */
+    w.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w.fd >= 0) {
+        w.wd = inotify_add_watch(w.fd, w.dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY);
+        if (w.wd < 0) {
+            close(w.fd);
+            w.fd = -1;
+        }
+    }
+    if (w.fd < 0) {
+        fprintf(stderr, "Warning: inotify unavailable for %s, polling instead\n", w.dir.c_str());
+    }
+#endif
+    w.active = true;
+    return true;
+}
+
+void file_watch_stop(FileWatch& w) {
+#ifdef __linux__
+    if (w.fd >= 0) {
+        close(w.fd);    /* also drops the watch */
+    }
+#endif
+    w.fd = -1;
+    w.wd = -1;
+    w.active = false;
+    w.pending = false;
+}
+
+#ifdef __linux__
+/* Drain queued events; true if any of them was about the watched file */
+static bool read_inotify(FileWatch& w) {
+    alignas(struct inotify_event) char buf[4096];
+    bool hit = false;
+    for (;;) {
+        ssize_t n = read(w.fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;      /* EAGAIN: nothing more queued */
+        }
+        for (char* p = buf; p < buf + n; ) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            if (ev->len > 0 && w.name == ev->name) {
+                hit = true;
+            }
+            p += sizeof(struct inotify_event) + ev->len;
+        }
+    }
+    return hit;
+}
+#endif
+
+bool file_watch_poll(FileWatch& w, uint64_t now_ms) {
+    if (!w.active) {
+        return false;
+    }
+
+    bool changed = false;
+#ifdef __linux__
+    if (w.fd >= 0) {
+        changed = read_inotify(w);
+    } else
+#endif
+    if (now_ms - w.checked_ms >= FILE_WATCH_POLL_MS) {
+        w.checked_ms = now_ms;
+        uint64_t size;
+        int64_t mtime;
+        if (stat_file(w.path, &size, &mtime) && (size != w.size || mtime != w.mtime)) {
+            w.size = size;
+            w.mtime = mtime;
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        w.pending = true;
+        w.changed_ms = now_ms;
+        return false;
+    }
+    if (w.pending && now_ms - w.changed_ms >= FILE_WATCH_SETTLE_MS) {
+        w.pending = false;
+        return true;
+    }
+    return false;
+}
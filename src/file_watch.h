@@ -0,0 +1,59 @@
+/*
+ * file_watch.h - notice when a file on disk has been rewritten
+ *
+ * On Linux the file's directory is watched with inotify, so replacing the file
+ * (write in place, or write elsewhere and rename over it, as linkers and objcopy do)
+ * is seen without touching the disk each frame. Elsewhere the file's size and
+ * modification time are polled a few times a second.
+ *
+ * A build usually touches its output more than once, so a change is reported only
+ * once the file has been quiet for FILE_WATCH_SETTLE_MS.
+ *
+ * Usage:
+ *   FileWatch w;
+ *   file_watch_start(w, "build/motor.elf");
+ *   ...every frame...
+ *   if (file_watch_poll(w, now_ms)) { ... reload ... }
+ *   file_watch_stop(w);
+ */
+
+#ifndef DARTT_FILE_WATCH_H
+#define DARTT_FILE_WATCH_H
+
+#include <stdint.h>
+#include <string>
+
+/* How long a changed file must stay untouched before it is reported */
+#define FILE_WATCH_SETTLE_MS 150
+
+/* Stat interval where there is no inotify */
+#define FILE_WATCH_POLL_MS 250
+
+struct FileWatch
+{
+    std::string path;
+    std::string dir;            // directory watched (inotify)
+    std::string name;           // file name within dir
+    int fd;                     // inotify descriptor, -1 when not used
+    int wd;                     // inotify watch on dir
+    bool active;
+    bool pending;               // changed, waiting to settle
+    uint64_t changed_ms;        // time of the last change seen
+    uint64_t checked_ms;        // last stat (polling)
+    uint64_t size;              // last seen size and mtime (polling)
+    int64_t mtime;
+
+    FileWatch() : fd(-1), wd(-1), active(false), pending(false), changed_ms(0), checked_ms(0), size(0), mtime(0) {}
+    ~FileWatch();
+    FileWatch(const FileWatch&) = delete;
+    FileWatch& operator=(const FileWatch&) = delete;
+};
+
+/* Start watching path (stops any previous watch). Returns false if it cannot be watched. */
+bool file_watch_start(FileWatch& w, const std::string& path);
+void file_watch_stop(FileWatch& w);
+
+/* True once per change, after the file has settled. now_ms is any monotonic clock. */
+bool file_watch_poll(FileWatch& w, uint64_t now_ms);
+
+#endif /* DARTT_FILE_WATCH_H */
@@ -0,0 +1,107 @@
+/*
+ * hot_reload.cpp - carry a live session over to a reloaded layout
+ */
+
+#include "hot_reload.h"
+
+#include <string>
+#include <unordered_map>
+
+/* State worth keeping: anything a user set on the leaf */
+static bool has_session_state(const DarttField& f) {
+    return f.subscribed || f.display_scale != 1.0f || f.use_display_scale || f.poll_rate_hz != 0.0f;
+}
+
+/* Remember source's field if it belongs to config */
+static void mark_source(const plot_source_t& source, const DarttConfig& config, std::vector<uint8_t>& wanted) {
+    if (source.kind == SOURCE_FIELD && source.config == config.instance && source.field < wanted.size()) {
+        wanted[source.field] = 1;
+    }
+}
+
+static bool remap_source(plot_source_t& source, uint32_t old_instance, uint32_t new_instance,
+                         const std::unordered_map<DarttFieldId, DarttFieldId>& remap) {
+    if (source.kind != SOURCE_FIELD || source.config != old_instance) {
+        return false;
+    }
+    auto it = remap.find(source.field);
+    if (it == remap.end()) {
+        return false;   /* gone: left stale, resolves to nothing */
+    }
+    source = plot_source_t::of_field(new_instance, it->second);
+    return true;
+}
+
+HotReloadStats carry_over_session(DarttConfig& old_config, DarttConfig& fresh, std::vector<Line>& lines) {
+    HotReloadStats stats = {0, 0, 0, 0};
+
+    std::vector<uint8_t> wanted(old_config.fields.size(), 0);
+    for (const DarttField* leaf : old_config.leaf_list) {
+        if (leaf->id < wanted.size() && has_session_state(*leaf)) {
+            wanted[leaf->id] = 1;
+        }
+    }
+    for (const Line& line : lines) {
+        mark_source(line.xsource, old_config, wanted);
+        mark_source(line.ysource, old_config, wanted);
+    }
+
+    /* Paths of the wanted leaves, from one walk over the built part of the old tree */
+    struct Item {
+        const DarttField* field;
+        std::string path;
+    };
+    std::vector<Item> found;
+    std::vector<Item> stack;
+    if (is_leaf_field(old_config.root)) {
+        stack.push_back({&old_config.root, old_config.root.name});
+    } else {
+        for (size_t i = old_config.root.children.size(); i > 0; i--) {
+            const DarttField& child = old_config.root.children[i - 1];
+            stack.push_back({&child, child.name});
+        }
+    }
+    while (!stack.empty()) {
+        Item item = std::move(stack.back());
+        stack.pop_back();
+        const DarttField* f = item.field;
+        if (is_leaf_field(*f)) {
+            if (f->id < wanted.size() && wanted[f->id]) {
+                found.push_back(std::move(item));
+            }
+            continue;
+        }
+        for (size_t i = f->children.size(); i > 0; i--) {
+            const DarttField& child = f->children[i - 1];
+            stack.push_back({&child, field_child_path(item.path, child.name)});
+        }
+    }
+
+    std::unordered_map<DarttFieldId, DarttFieldId> remap;
+    for (const Item& item : found) {
+        DarttFieldId id = field_id_by_path(fresh, item.path, true);
+        DarttField* leaf = config_field(fresh, id);
+        if (!leaf) {
+            stats.dropped++;
+            continue;
+        }
+        const DarttField& old_leaf = *item.field;
+        leaf->subscribed = old_leaf.subscribed;
+        leaf->display_scale = old_leaf.display_scale;
+        leaf->use_display_scale = old_leaf.use_display_scale;
+        leaf->poll_rate_hz = old_leaf.poll_rate_hz;
+        remap[old_leaf.id] = id;
+        if (leaf->byte_offset == old_leaf.byte_offset) {
+            stats.kept++;
+        } else {
+            stats.moved++;
+        }
+    }
+
+    for (Line& line : lines) {
+        stats.lines += remap_source(line.xsource, old_config.instance, fresh.instance, remap) ? 1 : 0;
+        stats.lines += remap_source(line.ysource, old_config.instance, fresh.instance, remap) ? 1 : 0;
+    }
+    fresh.view_rows_valid = false;
+    return stats;
+}
@@ -0,0 +1,42 @@
+/*
+ * hot_reload.h - carry a live session over to a reloaded layout
+ *
+ * When a device's config is loaded again (a rebuilt ELF, or a JSON dropped on a device
+ * that already has one), the old and new layouts are matched by full field path
+ * ("motor.pid[2].kp"), so a field keeps its session state even if the rebuild moved it:
+ * subscription, display scale and poll rate carry over, and plot lines reading it are
+ * pointed at the new field with their history intact. Fields that no longer exist drop
+ * out; lines on them fall back as after a device removal.
+ *
+ * Usage:
+ *   DarttConfig fresh;
+ *   if (load_dartt_config(path, fresh, scratch_plot, serial, ds)) {
+ *       dev.replace_config(fresh, plot.lines);     // calls carry_over_session
+ *   }
+ */
+
+#ifndef DARTT_HOT_RELOAD_H
+#define DARTT_HOT_RELOAD_H
+
+#include <stdint.h>
+#include <vector>
+#include "config.h"
+#include "plotting.h"
+
+struct HotReloadStats
+{
+    uint32_t kept;          // leaves with session state found at the same offset
+    uint32_t moved;         // found at a different offset
+    uint32_t dropped;       // no longer in the layout
+    uint32_t lines;         // plot sources pointed at the new layout
+};
+
+/*
+ * Copy the session state of old_config's leaves onto the same paths in fresh (loaded,
+ * not yet in use) and repoint lines from old_config's fields to fresh's. Leaves in
+ * fresh arrays are built as needed. Only leaves with state are looked up, so the cost
+ * follows the session, not the layout.
+ */
+HotReloadStats carry_over_session(DarttConfig& old_config, DarttConfig& fresh, std::vector<Line>& lines);
+
+#endif /* DARTT_HOT_RELOAD_H */
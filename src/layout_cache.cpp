@@ -0,0 +1,400 @@
+/*
+ * layout_cache.cpp - on-disk cache of DarttConfig layouts resolved from ELF files
+ *
+ * Entry layout (native byte order, the cache never leaves the machine):
+ *   "DLC\0" u32 version, str key, str symbol, str address_str, u32 address,
+ *   u32 nbytes, u32 nwords, u32 symbol_count, symbols, u32 enum_count, enums,
+ *   u32 node_count, nodes in pre-order, str json_text
+ * where each symbol is str name, str address_str, u32 address, u32 base_offset, u32 nbytes,
+ * each enum is str name, u32 count, then count times u64 value and str name,
+ * str is a u32 length followed by the bytes, and each node is
+ *   str name, u32 byte_offset, u32 dartt_offset, u32 nbytes, u8 type, str type_name,
+ *   u32 array_size, u32 element_nbytes, u8 lazy, u32 dim_count, dims, u8 has_template,
+ *   u8 bit_size, u8 bit_shift, u32 enum index + 1 (0 = none), u32 child_count
+ * and an array's element template, when present, comes right before its children
+ */
+
+#include "layout_cache.h"
+#include "config.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+static const char LAYOUT_CACHE_MAGIC[4] = { 'D', 'L', 'C', '\0' };
+
+/* ============================================================================
+ * Cache location and keys
+ * ============================================================================ */
+
+static fs::path layout_cache_dir() {
+    fs::path base;
+#ifdef _WIN32
+    const char* local = getenv("LOCALAPPDATA");
+    base = local ? fs::path(local) : fs::temp_directory_path();
+    return base / "dartt-dashboard" / "layout-cache";
+#else
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (xdg && xdg[0]) {
+        base = xdg;
+    } else if (home && home[0]) {
+        base = fs::path(home) / ".cache";
+    } else {
+        base = fs::temp_directory_path();
+    }
+    return base / "dartt-dashboard" / "layouts";
+#endif
+}
+
+static fs::path layout_cache_path(const std::string& key, const char* symbol_name) {
+    std::string file = key + "-";
+    for (const char* c = symbol_name; *c; c++) {
+        bool safe = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                    (*c >= '0' && *c <= '9') || *c == '_';
+        file += safe ? *c : '_';
+    }
+    file += ".dlc";
+    return layout_cache_dir() / file;
+}
+
+std::string layout_cache_key(const elf_image* img) {
+    std::string build_id;
+    if (elf_image_build_id(img, build_id)) {
+        return "gnu-" + build_id;
+    }
+
+    /* No build-id: FNV-1a over the mapped file, a word at a time */
+    uint64_t h = 0xcbf29ce484222325ull;
+    const uint64_t prime = 0x100000001b3ull;
+    size_t i = 0;
+    for (; i + 8 <= img->size; i += 8) {
+        uint64_t word;
+        memcpy(&word, img->data + i, 8);
+        h = (h ^ word) * prime;
+    }
+    for (; i < img->size; i++) {
+        h = (h ^ img->data[i]) * prime;
+    }
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "fnv-%016llx-%llx", (unsigned long long)h, (unsigned long long)img->size);
+    return buf;
+}
+
+/* ============================================================================
+ * Encoding
+ * ============================================================================ */
+
+static void put_u32(std::vector<uint8_t>& out, uint32_t v) {
+    const uint8_t* p = (const uint8_t*)&v;
+    out.insert(out.end(), p, p + 4);
+}
+
+static void put_u64(std::vector<uint8_t>& out, uint64_t v) {
+    const uint8_t* p = (const uint8_t*)&v;
+    out.insert(out.end(), p, p + 8);
+}
+
+static void put_str(std::vector<uint8_t>& out, const std::string& s) {
+    put_u32(out, (uint32_t)s.size());
+    out.insert(out.end(), s.begin(), s.end());
+}
+
+/* Bounds-checked reader; any overrun marks the entry corrupt */
+struct CacheReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    CacheReader(const uint8_t* data, size_t len) : p(data), end(data + len), ok(true) {}
+
+    uint32_t u32() {
+        uint32_t v = 0;
+        if (end - p < 4) { ok = false; return 0; }
+        memcpy(&v, p, 4);
+        p += 4;
+        return v;
+    }
+
+    uint64_t u64() {
+        uint64_t v = 0;
+        if (end - p < 8) { ok = false; return 0; }
+        memcpy(&v, p, 8);
+        p += 8;
+        return v;
+    }
+
+    uint8_t u8() {
+        if (end - p < 1) { ok = false; return 0; }
+        return *p++;
+    }
+
+    std::string str() {
+        uint32_t len = u32();
+        if (!ok || (size_t)(end - p) < len) { ok = false; return std::string(); }
+        std::string s((const char*)p, len);
+        p += len;
+        return s;
+    }
+};
+
+void layout_cache_encode(const std::string& key, const char* symbol_name,
+                         const DarttConfig& config, std::vector<uint8_t>& blob) {
+    blob.clear();
+    blob.insert(blob.end(), LAYOUT_CACHE_MAGIC, LAYOUT_CACHE_MAGIC + 4);
+    put_u32(blob, LAYOUT_CACHE_VERSION);
+    put_str(blob, key);
+    put_str(blob, symbol_name);
+    put_str(blob, config.address_str);
+    put_u32(blob, config.address);
+    put_u32(blob, config.nbytes);
+    put_u32(blob, config.nwords);
+    put_u32(blob, (uint32_t)config.symbols.size());
+    for (const DarttSymbol& sym : config.symbols) {
+        put_str(blob, sym.name);
+        put_str(blob, sym.address_str);
+        put_u32(blob, sym.address);
+        put_u32(blob, sym.base_offset);
+        put_u32(blob, sym.nbytes);
+    }
+
+    /* Enum tables once each; nodes refer to them by index */
+    std::unordered_map<const DarttEnum*, uint32_t> enum_index;
+    std::vector<const DarttEnum*> enums;
+    std::vector<const DarttField*> stack;
+    stack.push_back(&config.root);
+    while (!stack.empty()) {
+        const DarttField* f = stack.back();
+        stack.pop_back();
+        if (f->enum_info && enum_index.find(f->enum_info.get()) == enum_index.end()) {
+            enum_index[f->enum_info.get()] = (uint32_t)enums.size();
+            enums.push_back(f->enum_info.get());
+        }
+        for (size_t i = 0; i < f->children.size(); i++) {
+            stack.push_back(&f->children[i]);
+        }
+        if (f->element_template) {
+            stack.push_back(f->element_template.get());
+        }
+    }
+    put_u32(blob, (uint32_t)enums.size());
+    for (const DarttEnum* e : enums) {
+        put_str(blob, e->name);
+        put_u32(blob, (uint32_t)e->values.size());
+        for (size_t i = 0; i < e->values.size(); i++) {
+            put_u64(blob, (uint64_t)e->values[i]);
+            put_str(blob, e->names[i]);
+        }
+    }
+
+    size_t count_pos = blob.size();
+    put_u32(blob, 0);
+
+    /* Pre-order, children in declaration order */
+    uint32_t node_count = 0;
+    stack.push_back(&config.root);
+    while (!stack.empty()) {
+        const DarttField* f = stack.back();
+        stack.pop_back();
+        node_count++;
+
+        put_str(blob, f->name);
+        put_u32(blob, f->byte_offset);
+        put_u32(blob, f->dartt_offset);
+        put_u32(blob, f->nbytes);
+        blob.push_back((uint8_t)f->type);
+        put_str(blob, f->type_name);
+        put_u32(blob, f->array_size);
+        put_u32(blob, f->element_nbytes);
+        blob.push_back(f->lazy ? 1 : 0);
+        put_u32(blob, (uint32_t)f->dims.size());
+        for (uint32_t d : f->dims) {
+            put_u32(blob, d);
+        }
+        blob.push_back(f->element_template ? 1 : 0);
+        blob.push_back(f->bit_size);
+        blob.push_back(f->bit_shift);
+        put_u32(blob, f->enum_info ? enum_index[f->enum_info.get()] + 1 : 0);
+        put_u32(blob, (uint32_t)f->children.size());
+
+        for (size_t i = f->children.size(); i > 0; i--) {
+            stack.push_back(&f->children[i - 1]);
+        }
+        if (f->element_template) {
+            stack.push_back(f->element_template.get());
+        }
+    }
+    memcpy(blob.data() + count_pos, &node_count, 4);
+}
+
+/* ============================================================================
+ * Load / store
+ * ============================================================================ */
+
+bool layout_cache_load(const std::string& key, const char* symbol_name,
+                       DarttConfig* config, std::string* json_text) {
+    fs::path path = layout_cache_path(key, symbol_name);
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+    f.close();
+
+    CacheReader r(data.data(), data.size());
+    if (data.size() < 4 || memcmp(data.data(), LAYOUT_CACHE_MAGIC, 4) != 0) {
+        return false;
+    }
+    r.p += 4;
+    if (r.u32() != LAYOUT_CACHE_VERSION || r.str() != key || r.str() != symbol_name || !r.ok) {
+        return false;   /* written by another version, or a hash collision on the file name */
+    }
+
+    DarttConfig loaded;
+    loaded.address_str = r.str();
+    loaded.address = r.u32();
+    loaded.nbytes = r.u32();
+    loaded.nwords = r.u32();
+    uint32_t symbol_count = r.u32();
+    for (uint32_t i = 0; i < symbol_count && r.ok; i++) {
+        DarttSymbol sym;
+        sym.name = r.str();
+        sym.address_str = r.str();
+        sym.address = r.u32();
+        sym.base_offset = r.u32();
+        sym.nbytes = r.u32();
+        loaded.symbols.push_back(sym);
+        loaded.symbol += (i > 0 ? "," : "") + sym.name;
+    }
+    uint32_t enum_count = r.u32();
+    std::vector<DarttEnumRef> enums;
+    for (uint32_t i = 0; i < enum_count && r.ok; i++) {
+        std::string name = r.str();
+        uint32_t count = r.u32();
+        std::vector<std::pair<int64_t, std::string>> entries;
+        for (uint32_t k = 0; k < count && r.ok; k++) {
+            int64_t value = (int64_t)r.u64();
+            entries.emplace_back(value, r.str());
+        }
+        enums.push_back(make_enum_table(name, std::move(entries)));
+    }
+    uint32_t node_count = r.u32();
+
+    /* Rebuild the tree in the same pre-order it was written */
+    uint32_t nodes_read = 0;
+    std::vector<DarttField*> stack;
+    stack.push_back(&loaded.root);
+    while (!stack.empty() && r.ok) {
+        DarttField* field = stack.back();
+        stack.pop_back();
+        nodes_read++;
+
+        field->name = r.str();
+        field->byte_offset = r.u32();
+        field->dartt_offset = r.u32();
+        field->nbytes = r.u32();
+        uint8_t type = r.u8();
+        field->type = (type <= (uint8_t)FieldType::UNKNOWN) ? (FieldType)type : FieldType::UNKNOWN;
+        field->type_name = r.str();
+        field->array_size = r.u32();
+        field->element_nbytes = r.u32();
+        field->lazy = (r.u8() != 0);
+        uint32_t dim_count = r.u32();
+        if (!r.ok || dim_count > (uint32_t)(r.end - r.p) / 4) {
+            return false;
+        }
+        field->dims.resize(dim_count);
+        for (uint32_t i = 0; i < dim_count; i++) {
+            field->dims[i] = r.u32();
+        }
+        bool has_template = (r.u8() != 0);
+        uint8_t bit_size = r.u8();
+        uint8_t bit_shift = r.u8();
+        if (bit_size > 0 && !set_bitfield_layout(*field, field->byte_offset * 8 + bit_shift, bit_size)) {
+            return false;
+        }
+        uint32_t enum_ref = r.u32();
+        if (enum_ref > enums.size()) {
+            return false;
+        }
+        if (enum_ref > 0) {
+            field->enum_info = enums[enum_ref - 1];
+        }
+        uint32_t child_count = r.u32();
+        if (!r.ok || nodes_read > node_count || child_count + (has_template ? 1u : 0u) > node_count - nodes_read) {
+            return false;
+        }
+
+        field->children.resize(child_count);
+        for (size_t i = child_count; i > 0; i--) {
+            stack.push_back(&field->children[i - 1]);
+        }
+        if (has_template) {
+            std::shared_ptr<DarttField> tmpl = std::make_shared<DarttField>();
+            field->element_template = tmpl;
+            stack.push_back(tmpl.get());    /* filled in place; shared as const from here on */
+        }
+    }
+    std::string json = r.str();
+    if (!r.ok || nodes_read != node_count) {
+        return false;
+    }
+
+    /* Only move into the caller's config once the entry proved intact */
+    config->symbol = loaded.symbol;
+    config->address_str = loaded.address_str;
+    config->address = loaded.address;
+    config->nbytes = loaded.nbytes;
+    config->nwords = loaded.nwords;
+    config->symbols = std::move(loaded.symbols);
+    config->root = std::move(loaded.root);
+    refresh_leaf_list(*config);
+    build_field_search_index(config->root, config->search_index);
+    if (json_text) {
+        *json_text = std::move(json);
+    }
+    return true;
+}
+
+bool layout_cache_store(const std::string& key, const char* symbol_name,
+                        const std::vector<uint8_t>& blob, const std::string& json_text) {
+    std::error_code ec;
+    fs::path path = layout_cache_path(key, symbol_name);
+    fs::create_directories(path.parent_path(), ec);
+    if (ec) {
+        fprintf(stderr, "layout cache: cannot create %s: %s\n", path.parent_path().string().c_str(), ec.message().c_str());
+        return false;
+    }
+
+    /* Write beside the entry and rename over it, so a reader never sees half a file */
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+        if (!f.is_open()) {
+            return false;
+        }
+        uint32_t json_len = (uint32_t)json_text.size();
+        f.write((const char*)blob.data(), (std::streamsize)blob.size());
+        f.write((const char*)&json_len, 4);
+        f.write(json_text.data(), (std::streamsize)json_text.size());
+        if (!f.good()) {
+            f.close();
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
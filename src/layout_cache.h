@@ -0,0 +1,52 @@
+/*
+ * layout_cache.h - on-disk cache of DarttConfig layouts resolved from ELF files
+ *
+ * Entries live in the per-user cache directory, one file per (ELF, symbol). The ELF
+ * is identified by its GNU build-id, or by a hash of its contents when it has none,
+ * so a rebuilt image never matches an old entry. Each entry holds the field tree in
+ * a compact binary form plus the JSON sidecar text produced with it.
+ *
+ * Usage:
+ *   std::string key = layout_cache_key(&parser.image);
+ *   std::string json_text;
+ *   if (!layout_cache_load(key, "gl_dp", &config, &json_text)) {
+ *       ... parse DWARF ...
+ *       std::vector<uint8_t> blob;
+ *       layout_cache_encode(key, "gl_dp", config, blob);
+ *       layout_cache_store(key, "gl_dp", blob, json_text);
+ *   }
+ */
+
+#ifndef DARTT_LAYOUT_CACHE_H
+#define DARTT_LAYOUT_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "elf_image.h"
+
+/* Bump when the DarttField tree produced from DWARF changes, so older entries are ignored */
+#define LAYOUT_CACHE_VERSION 5
+
+struct DarttConfig;
+
+/* Identity of a mapped ELF: "gnu-<build-id>" or "fnv-<content hash>-<size>" */
+std::string layout_cache_key(const elf_image* img);
+
+/*
+ * Load a cached layout. On success config holds the symbol, address, sizes and the
+ * full field tree with leaf_list collected, and json_text the sidecar JSON.
+ * Missing, corrupt or mismatched entries return false.
+ */
+bool layout_cache_load(const std::string& key, const char* symbol_name,
+                       DarttConfig* config, std::string* json_text);
+
+/* Serialize config's layout (everything but values and UI state) for layout_cache_store */
+void layout_cache_encode(const std::string& key, const char* symbol_name,
+                         const DarttConfig& config, std::vector<uint8_t>& blob);
+
+/* Write an entry (blob from layout_cache_encode plus the JSON text). Replaces any existing entry atomically. */
+bool layout_cache_store(const std::string& key, const char* symbol_name,
+                        const std::vector<uint8_t>& blob, const std::string& json_text);
+
+#endif /* DARTT_LAYOUT_CACHE_H */
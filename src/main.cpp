@@ -42,6 +42,9 @@
 #include "buffer_sync.h"
 #include "plotting.h"
 #include "elf_parser.h"
+#include "bus_manager.h"
+#include "hot_reload.h"
+#include "config_save.h"
 
 #include <algorithm>
 #include <string>
@@ -59,6 +62,52 @@ static bool ends_with_ci(const std::string& str, const std::string& suffix)
 }
 
 
+/*
+Value a plot line source reads this frame, looked up by ID. A field that is gone (its config
+was reloaded or its device removed) turns the source into fallback, as a new line starts.
+*/
+static const float* plot_source_value(plot_source_t& source, const plot_source_t& fallback, Plotter& plot, BusManager& bus)
+{
+	if (source.kind == SOURCE_FIELD)
+	{
+		DarttField* field = bus.find_field(source);
+		if (field)
+		{
+			return &field->display_value;
+		}
+		source = fallback;
+	}
+	return (source.kind == SOURCE_SYS_SEC) ? &plot.sys_sec : nullptr;
+}
+
+static void print_reload_stats(const char* path, const HotReloadStats& stats, uint64_t start_ms)
+{
+	printf("Reloaded %s in %llu ms: %u fields kept, %u moved, %u gone, %u plot sources remapped\n", path,
+	       (unsigned long long)(SDL_GetTicks64() - start_ms), stats.kept, stats.moved, stats.dropped, stats.lines);
+}
+
+// The device's ELF was rebuilt: load it again with the same symbols and swap the layout in place.
+// No sidecar is written; config_json_path holds the session, which autosave rewrites for the new layout.
+static void reload_device_elf(BusDevice& dev, std::vector<Line>& lines)
+{
+	uint64_t start_ms = SDL_GetTicks64();
+	elf_parser_ctx parser;
+	DarttConfig fresh;
+	elf_parse_error_t err = elf_parser_init(&parser, dev.elf_path.c_str());
+	if (err == ELF_PARSE_SUCCESS)
+	{
+		err = elf_parser_load_config_and_json(&parser, dev.elf_symbols.c_str(), &fresh, nullptr);
+	}
+	elf_parser_cleanup(&parser);
+	if (err != ELF_PARSE_SUCCESS)
+	{
+		printf("Reload of %s failed: %s\n", dev.elf_path.c_str(), elf_parse_error_str(err));
+		return;
+	}
+	HotReloadStats stats = dev.replace_config(fresh, lines);
+	print_reload_stats(dev.elf_path.c_str(), stats, start_ms);
+}
+
 int main(int argc, char* argv[])
 {
 	(void)argc;
@@ -69,8 +118,10 @@ int main(int argc, char* argv[])
 	bool show_elf_popup = false;
 	char var_name_buf[128] = "";
 	std::string elf_load_error;
+	elf_parser_ctx drop_parser;		//dropped ELF, kept open for name completion and the load itself
+	std::vector<std::string> elf_completions;
+	std::string elf_completion_prefix;
 	bool pending_json_load = false;
-	std::string config_json_path = "";
 
 	// Initialize SDL
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) 
@@ -143,28 +194,9 @@ int main(int argc, char* argv[])
 
 
 
-	// Load config (including plotting config)
-	DarttConfig config;
-
-	// Allocate DARTT buffers
-	if (config.nbytes > 0) 
-	{
-		config.allocate_buffers();
-	}
-
-	// Setup dartt_sync
-	dartt_sync_t ds;
-	init_ds(&ds);
-	ds.address = 0x0; // TODO: make configurable
-
-	if (config.ctl_buf.buf && config.periph_buf.buf) 
-	{
-		//shallow copy the buffers
-		ds.ctl_base.buf = config.ctl_buf.buf;
-		ds.ctl_base.size = config.ctl_buf.size;
-		ds.periph_base.buf = config.periph_buf.buf;
-		ds.periph_base.size = config.periph_buf.size;
-	}
+	// One device per DARTT peripheral on the link; drops load into the active one
+	BusManager bus;
+	bus.add_device();
 
 	// Main loop
 	bool running = true;
@@ -195,9 +227,17 @@ int main(int argc, char* argv[])
 				{
 					var_name_buf[0] = '\0';
 					elf_load_error.clear();
+					elf_parser_cleanup(&drop_parser);
+					elf_parse_error_t err = elf_parser_init(&drop_parser, dropped_file_path.c_str());
+					if (err != ELF_PARSE_SUCCESS)
+					{
+						elf_load_error = elf_parse_error_str(err);
+					}
+					elf_parser_complete(&drop_parser, "", elf_completions, 64);
+					elf_completion_prefix.clear();
 					show_elf_popup = true;
 				}
-				else if (ends_with_ci(dropped_file_path, ".json"))
+				else if (ends_with_ci(dropped_file_path, ".json") || ends_with_ci(dropped_file_path, ".dcfg"))
 				{
 					pending_json_load = true;
 				}
@@ -209,31 +249,33 @@ int main(int argc, char* argv[])
 		ImGui_ImplSDL2_NewFrame();
 		ImGui::NewFrame();
 
+		BusDevice& dev = bus.active_device();
+		DarttConfig& config = dev.config;
+		dartt_sync_t& ds = dev.ds;
+		std::string& config_json_path = dev.config_json_path;
+
 		// --- Drag-and-drop: JSON load ---
 		if (pending_json_load)
 		{
 			pending_json_load = false;
-			// Detach external references before replacing config
-			for (size_t i = 0; i < plot.lines.size(); i++)
+			// A device that already has a layout keeps its session and plot lines (hot reload);
+			// an empty one takes the file's plot lines as well
+			uint64_t start_ms = SDL_GetTicks64();
+			bool reload = config.nbytes > 0;
+			Plotter file_plot;
+			DarttConfig fresh;
+
+			std::vector<PlotSourceDevice> others = bus.other_devices(dev);
+			if (load_dartt_config(dropped_file_path.c_str(), fresh, reload ? file_plot : plot, serial, ds, &others))
 			{
-				plot.lines[i].xsource = &plot.sys_sec;
-				plot.lines[i].ysource = nullptr;
-			}
-			ds.ctl_base.buf = nullptr;
-			ds.periph_base.buf = nullptr;
-			config = DarttConfig();
-
-			if (load_dartt_config(dropped_file_path.c_str(), config, plot, serial, ds))
-			{
-				if (config.nbytes > 0)
+				HotReloadStats stats = dev.replace_config(fresh, plot.lines);
+				config_json_path = dropped_file_path;
+				dev.elf_path.clear();
+				file_watch_stop(dev.elf_watch);
+				if (reload)
 				{
-					config.allocate_buffers();
-					ds.ctl_base.buf = config.ctl_buf.buf;
-					ds.ctl_base.size = config.ctl_buf.size;
-					ds.periph_base.buf = config.periph_buf.buf;
-					ds.periph_base.size = config.periph_buf.size;
+					print_reload_stats(dropped_file_path.c_str(), stats, start_ms);
 				}
-				config_json_path = dropped_file_path;
 				printf("Loaded config from JSON: %s\n", dropped_file_path.c_str());
 			}
 			else
@@ -243,37 +285,36 @@ int main(int argc, char* argv[])
 		}
 
 		// --- Drag-and-drop: ELF popup + load ---
-		if (render_elf_load_popup(&show_elf_popup, dropped_file_path, var_name_buf, sizeof(var_name_buf), elf_load_error))
+		if (elf_completion_prefix != elf_symbol_list_last(var_name_buf))
 		{
-			// User clicked Load - detach external references
-			for (size_t i = 0; i < plot.lines.size(); i++)
-			{
-				plot.lines[i].xsource = &plot.sys_sec;
-				plot.lines[i].ysource = nullptr;
-			}
-			ds.ctl_base.buf = nullptr;
-			ds.periph_base.buf = nullptr;
-			config = DarttConfig();
+			elf_completion_prefix = elf_symbol_list_last(var_name_buf);
+			elf_parser_complete(&drop_parser, elf_completion_prefix.c_str(), elf_completions, 64);
+		}
+		if (render_elf_load_popup(&show_elf_popup, dropped_file_path, var_name_buf, sizeof(var_name_buf), elf_completions, elf_load_error))
+		{
+			// User clicked Load. The new layout replaces the old one in place, keeping the session.
+			uint64_t start_ms = SDL_GetTicks64();
+			bool reload = config.nbytes > 0;
+			DarttConfig fresh;
 
-			elf_parse_error_t err = elf_parser_load_config(dropped_file_path.c_str(), var_name_buf, &config);
+			// On a reload the sidecar is written with the carried-over session, not as a bare layout
+			std::string json_path = dropped_file_path.substr(0, dropped_file_path.size() - 4) + ".json";
+			elf_parse_error_t err = elf_parser_load_config_and_json(&drop_parser, var_name_buf, &fresh, reload ? nullptr : json_path.c_str());
 
 			if (err == ELF_PARSE_SUCCESS)
 			{
-				if (config.nbytes > 0)
+				HotReloadStats stats = dev.replace_config(fresh, plot.lines);
+				if (reload)
 				{
-					config.allocate_buffers();
-					ds.ctl_base.buf = config.ctl_buf.buf;
-					ds.ctl_base.size = config.ctl_buf.size;
-					ds.periph_base.buf = config.periph_buf.buf;
-					ds.periph_base.size = config.periph_buf.size;
-				}
-				config_json_path = dropped_file_path.substr(0, dropped_file_path.size() - 4) + ".json";
-				elf_parser_ctx tmp_parser;
-				if (elf_parser_init(&tmp_parser, dropped_file_path.c_str()) == ELF_PARSE_SUCCESS)
-				{
-					elf_parser_generate_json(&tmp_parser, var_name_buf, config_json_path.c_str());
-					elf_parser_cleanup(&tmp_parser);
+					print_reload_stats(dropped_file_path.c_str(), stats, start_ms);
+					std::vector<PlotSourceDevice> others = bus.other_devices(dev);
+					config_save_async(json_path.c_str(), config, plot, get_serial_settings(serial, ds), &others);
+					autosave_reset(dev.autosave);
 				}
+				config_json_path = json_path;
+				dev.elf_path = dropped_file_path;
+				dev.elf_symbols = var_name_buf;
+				file_watch_start(dev.elf_watch, dev.elf_path);	//rebuilds reload automatically
 				elf_load_error.clear();
 				ImGui::CloseCurrentPopup();
 				printf("Loaded config from ELF: %s (symbol: %s)\n",
@@ -285,70 +326,62 @@ int main(int argc, char* argv[])
 			}
 		}
 
-		// Rebuild subscribed and dirty lists before read/write operations
-		collect_subscribed_fields(config.leaf_list, config.subscribed_list);
-		collect_dirty_fields(config.leaf_list, config.dirty_list);
-
-		// WRITE: Send dirty fields to device
-		if (config.ctl_buf.buf && config.periph_buf.buf) 
+		// --- Rebuilt ELFs: reload in place, keeping subscriptions and plots ---
+		for (size_t i = 0; i < bus.devices.size(); i++)
 		{
-			std::vector<MemoryRegion> write_queue = build_write_queue(config);
-			for (MemoryRegion& region : write_queue) {
-				sync_fields_to_ctl_buf(config, region);
-
-				dartt_mem_t slice = {
-					.buf = config.ctl_buf.buf + region.start_offset,
-					.size = region.length
-				};
-
-				int rc = dartt_write_multi(&slice, &ds);
-				if (rc == DARTT_PROTOCOL_SUCCESS) {
-					clear_dirty_flags(region);
-					printf("write ok: offset=%u len=%u\n", region.start_offset, region.length);
-				} else {
-					printf("write error %d\n", rc);
-				}
+			if (file_watch_poll(bus.devices[i]->elf_watch, SDL_GetTicks64()))
+			{
+				reload_device_elf(*bus.devices[i], plot.lines);
 			}
 		}
 
-		// READ: Poll subscribed fields from device
-		if (config.ctl_buf.buf && config.periph_buf.buf)
+		// Write dirty fields and poll subscriptions for every device on the bus
+		bus.poll();
+		uint64_t frame_ms = SDL_GetTicks64();
+		for (size_t i = 0; i < bus.devices.size(); i++)
 		{
-			std::vector<MemoryRegion> read_queue = build_read_queue(config);
-			for (MemoryRegion& region : read_queue) 
-			{
-				dartt_mem_t slice = 
-				{
-					.buf = config.ctl_buf.buf + region.start_offset,
-					.size = region.length,
-				};
-
-
-				int rc = dartt_read_multi(&slice, &ds);
-				if (rc == DARTT_PROTOCOL_SUCCESS) 
-				{
-					sync_periph_buf_to_fields(config, region);
-				} 
-				else 
-				{
-					printf("read error %d\n", rc);
-				}
-			}
+			diff_periph_buf(bus.devices[i]->config, frame_ms);
+			calculate_display_values(bus.devices[i]->config.leaf_list);
 		}
 		
-		calculate_display_values(config.leaf_list);		
 
 		// Render UI
-		bool value_edited = render_live_expressions(config, plot, config_json_path, serial, ds);
+		std::vector<PlotSourceDevice> other_devices = bus.other_devices(dev);
+		bool value_edited = render_live_expressions(config, plot, config_json_path, dev.autosave, serial, ds, other_devices);
 
 		SDL_GetWindowSize(window, &plot.window_width, &plot.window_height);	//map out
-		render_plotting_menu(plot, config.root, config.subscribed_list);
+		render_plotting_menu(plot, bus, config);
+		int device_to_remove = render_bus_menu(bus);
+		render_watch_panel(bus);
+		render_snapshot_panel(bus);
+		if (device_to_remove >= 0)
+		{
+			// config/ds are not used past this point
+			bus.remove_device(device_to_remove);
+		}
+
+		// --- Autosave: a device's config goes out once its settings have been quiet for a moment ---
+		for (size_t i = 0; i < bus.devices.size(); i++)
+		{
+			BusDevice& d = *bus.devices[i];
+			DarttSerialSettings settings = get_serial_settings(serial, d.ds);
+			if (autosave_update(d.autosave, d.config, plot, settings, SDL_GetTicks64()) && !d.config_json_path.empty())
+			{
+				elf_parser_wait_json();		//the sidecar from an ELF load may still be being written
+				std::vector<PlotSourceDevice> others = bus.other_devices(d);
+				config_save_async(d.config_json_path.c_str(), d.config, plot, settings, &others);
+			}
+		}
+
 		plot.sys_sec = (float)(((double)SDL_GetTicks64())/1000.);	//outside of class, load the time in sec as timebase for signals that use it as default
 
 		//add new frame of data to each line, as determined by UI
 		for(int i = 0; i < plot.lines.size(); i++)
 		{
-			plot.lines[i].enqueue_data(plot.window_width);
+			Line& line = plot.lines[i];
+			const float* x = plot_source_value(line.xsource, plot_source_t::sys_sec(), plot, bus);
+			const float* y = plot_source_value(line.ysource, plot_source_t(), plot, bus);
+			line.enqueue_data(plot.window_width, x, y);
 		}
 		
 
@@ -365,10 +398,21 @@ int main(int argc, char* argv[])
 		SDL_GL_SwapWindow(window);
 	}
 
-	// Save UI settings back to config
-	// save_dartt_config("config.json", config);
+	// Save UI settings back to config: autosaves still waiting out their delay go now
+	elf_parser_wait_json();
+	for (size_t i = 0; i < bus.devices.size(); i++)
+	{
+		BusDevice& d = *bus.devices[i];
+		if (d.autosave.enabled && d.autosave.pending && !d.config_json_path.empty())
+		{
+			std::vector<PlotSourceDevice> others = bus.other_devices(d);
+			config_save_async(d.config_json_path.c_str(), d.config, plot, get_serial_settings(serial, d.ds), &others);
+		}
+	}
+	config_save_wait();
 
 	// Cleanup
+	elf_parser_cleanup(&drop_parser);
 	shutdown_imgui();
 	SDL_GL_DeleteContext(gl_context);
 	SDL_DestroyWindow(window);
@@ -21,12 +21,46 @@ fpoint_t::fpoint_t(float x_val, float y_val)
 }
 
 
+// plot_source_t definition
+plot_source_t::plot_source_t()
+	: kind(SOURCE_NONE)
+	, config(0)
+	, field(0)
+{
+}
+
+plot_source_t plot_source_t::sys_sec()
+{
+	plot_source_t s;
+	s.kind = SOURCE_SYS_SEC;
+	return s;
+}
+
+plot_source_t plot_source_t::of_field(uint32_t config_instance, uint32_t field_id)
+{
+	plot_source_t s;
+	s.kind = SOURCE_FIELD;
+	s.config = config_instance;
+	s.field = field_id;
+	return s;
+}
+
+bool plot_source_t::operator==(const plot_source_t& other) const
+{
+	if(kind != other.kind)
+	{
+		return false;
+	}
+	return kind != SOURCE_FIELD || (config == other.config && field == other.field);
+}
+
+
 // Line class implementation
 Line::Line()
 	: points()
 	, color()
-	, xsource(NULL)
-	, ysource(NULL)
+	, xsource()
+	, ysource()
 	, mode(TIME_MODE)
 	, xscale(1.f)
 	, xoffset(0.f)
@@ -43,8 +77,8 @@ Line::Line()
 Line::Line(int capacity)
 	: points(capacity)
 	, color()
-	, xsource(NULL)
-	, ysource(NULL)
+	, xsource()
+	, ysource()
 	, mode(TIME_MODE)
 	, xscale(1.f)
 	, xoffset(0.f)
@@ -83,7 +117,7 @@ bool Plotter::init(int width, int height)
 	lines.resize(1);
 	lines[0].points.resize(line_capacity);
 	lines[0].points.clear();
-	lines[0].xsource = &sys_sec;
+	lines[0].xsource = plot_source_t::sys_sec();
 	int color_idx = (lines.size() % NUM_COLORS);
 	lines[0].color = template_colors[color_idx];
 	return true;
@@ -157,16 +191,16 @@ void Plotter::render()
 
 
 
-bool Line::enqueue_data(int screen_width)
+bool Line::enqueue_data(int screen_width, const float * x, const float * y)
 {
-	if(xsource == NULL || ysource == NULL)
+	if(x == NULL || y == NULL)
 	{
-		return false;	//fail due to bad pointer reference
+		return false;	//fail due to a missing source
 	}
 	//enqueue data
 	if(points.size() < enqueue_cap)	//cap on buffer width - may want to expand
 	{
-		points.push_back(fpoint_t(*xsource, *ysource));
+		points.push_back(fpoint_t(*x, *y));
 	}	
 	else if(points.size() > enqueue_cap)
 	{
@@ -175,7 +209,7 @@ bool Line::enqueue_data(int screen_width)
 	if(points.size() == enqueue_cap)
 	{
 		std::rotate(points.begin(), points.begin() + 1, points.end());
-		points.back() = fpoint_t(*xsource, *ysource);
+		points.back() = fpoint_t(*x, *y);
 	}
 
 	if(mode == TIME_MODE)
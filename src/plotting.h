@@ -17,6 +17,25 @@ struct fpoint_t
 
 typedef enum {TIME_MODE, XY_MODE}timemode_t;
 
+typedef enum {SOURCE_NONE, SOURCE_SYS_SEC, SOURCE_FIELD}sourcekind_t;
+
+/*
+	What a line plots on one axis. Fields are named by their config's instance and their
+	field ID (see DarttConfig), never by pointer, so a line whose config was reloaded or
+	removed finds nothing instead of reading freed memory.
+*/
+struct plot_source_t
+{
+	sourcekind_t kind;
+	uint32_t config;	//DarttConfig::instance, for SOURCE_FIELD
+	uint32_t field;		//DarttFieldId within that config
+
+	plot_source_t();
+	static plot_source_t sys_sec();
+	static plot_source_t of_field(uint32_t config_instance, uint32_t field_id);
+	bool operator==(const plot_source_t& other) const;
+};
+
 class Line
 {
 public:
@@ -25,8 +44,8 @@ public:
 
 
 
-	float * xsource;	//pointer to the x variable which we source for our data stream
-	float * ysource;	//pointer to the y variable which we source for our data stream
+	plot_source_t xsource;	//the x variable which we source for our data stream
+	plot_source_t ysource;	//the y variable which we source for our data stream
 
 	/*
 		Data is formatted and 
@@ -49,7 +68,8 @@ public:
 	Line();
 	Line(int capacity);
 
-	bool enqueue_data(int screen_width);
+	//x and y are the sources' values this frame, resolved by the caller; false if either is missing
+	bool enqueue_data(int screen_width, const float * x, const float * y);
 	
 };
 
@@ -0,0 +1,147 @@
+/*
+ * snapshot.cpp - named copies of a device's whole DARTT blob, their diffs, and restore
+ */
+
+#include "snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+void snapshot_capture(const DarttConfig& config, const char* name, DarttSnapshot& out) {
+    out.name = name;
+    out.symbol = config.symbol;
+    out.taken = std::time(nullptr);
+    out.bytes.assign(config.periph_buf.buf, config.periph_buf.buf + config.periph_buf.size);
+}
+
+bool snapshot_matches(const DarttSnapshot& snap, const DarttConfig& config) {
+    return config.periph_buf.buf && snap.symbol == config.symbol && snap.bytes.size() == config.periph_buf.size;
+}
+
+/* A leaf's value in blob. Floats get every significant digit, so two that differ never read the same. */
+static std::string decode_leaf(const DarttField& leaf, const uint8_t* blob) {
+    DarttField copy = leaf;
+    decode_field_value(copy, blob);
+    char buf[32];
+    if (copy.type == FieldType::FLOAT) {
+        snprintf(buf, sizeof(buf), "%.9g", copy.value.f32);
+        return buf;
+    }
+    if (copy.type == FieldType::DOUBLE) {
+        snprintf(buf, sizeof(buf), "%.17g", copy.value.f64);
+        return buf;
+    }
+    return format_field_value(copy);
+}
+
+/*
+ * One walk from the root that skips every subtree whose bytes are all equal, so the cost
+ * follows the differences rather than the layout. Unbuilt arrays on the way are built a
+ * level at a time, only where they hold a difference.
+ */
+void diff_blobs(DarttConfig& config, const uint8_t* a, const uint8_t* b, std::vector<SnapshotChange>& out) {
+    out.clear();
+    size_t size = config.periph_buf.size;
+    std::vector<uint64_t> changed;
+    if (!diff_chunks(a, b, size, changed)) {
+        return;
+    }
+
+    struct Item {
+        DarttField* field;
+        std::string path;
+    };
+    std::vector<Item> stack;
+    std::vector<Item> found;
+    if (is_leaf_field(config.root)) {
+        stack.push_back({&config.root, config.root.name});
+    } else {
+        for (size_t i = config.root.children.size(); i > 0; i--) {
+            stack.push_back({&config.root.children[i - 1], config.root.children[i - 1].name});
+        }
+    }
+    bool built = false;
+    while (!stack.empty()) {
+        Item item = std::move(stack.back());
+        stack.pop_back();
+        DarttField* f = item.field;
+        if (f->byte_offset + f->nbytes > size || !chunks_changed(changed, f->byte_offset, f->nbytes)) {
+            continue;
+        }
+        if (f->lazy) {
+            built |= materialize_children(*f);
+        }
+        if (is_leaf_field(*f)) {
+            if (leaf_bytes_differ(*f, a, b)) {
+                found.push_back(std::move(item));
+            }
+            continue;
+        }
+        for (size_t i = f->children.size(); i > 0; i--) {
+            stack.push_back({&f->children[i - 1], field_child_path(item.path, f->children[i - 1].name)});
+        }
+    }
+    if (built) {
+        refresh_leaf_list(config);      /* the new leaves get their IDs */
+        config.view_rows_valid = false;
+    }
+
+    out.reserve(found.size());
+    for (Item& item : found) {
+        SnapshotChange c;
+        c.id = item.field->id;
+        c.path = std::move(item.path);
+        c.before = decode_leaf(*item.field, a);
+        c.after = decode_leaf(*item.field, b);
+        c.selected = true;
+        out.push_back(std::move(c));
+    }
+}
+
+std::vector<MemoryRegion> build_restore_regions(const DarttConfig& config, const DarttSnapshot& snap,
+                                                const std::vector<SnapshotChange>& changes,
+                                                const uint8_t* live, std::vector<uint8_t>& image) {
+    std::vector<MemoryRegion> regions;
+    size_t size = snap.bytes.size();
+    image.assign(live, live + size);
+    for (const SnapshotChange& c : changes) {
+        const DarttField* leaf = c.selected ? config_field(config, c.id) : nullptr;
+        if (leaf && leaf->byte_offset + leaf->nbytes <= size) {
+            copy_leaf_bytes(*leaf, snap.bytes.data(), image.data());
+        }
+    }
+
+    /* Differing 32-bit words, run together when the gap between them is short */
+    uint32_t nwords = (uint32_t)((size + 3) / 4);
+    MemoryRegion current;
+    uint32_t current_end = 0;       /* in words */
+    bool open = false;
+    for (uint32_t w = 0; w < nwords; w++) {
+        size_t n = std::min<size_t>(4, size - (size_t)w * 4);
+        if (std::memcmp(image.data() + w * 4, live + w * 4, n) == 0) {
+            continue;
+        }
+        if (open && w - current_end <= SNAPSHOT_GAP_WORDS) {
+            current_end = w + 1;
+            continue;
+        }
+        if (open) {
+            current.length = current_end * 4 - current.start_offset;
+            regions.push_back(current);
+        }
+        current = MemoryRegion();
+        current.start_offset = w * 4;
+        current_end = w + 1;
+        open = true;
+    }
+    if (open) {
+        current.length = current_end * 4 - current.start_offset;
+        regions.push_back(current);
+    }
+    if (!regions.empty()) {
+        MemoryRegion& last = regions.back();
+        last.length = std::min<uint32_t>(last.length, (uint32_t)size - last.start_offset);  /* a blob ending mid-word */
+    }
+    return regions;
+}
@@ -0,0 +1,86 @@
+/*
+ * snapshot.h - named copies of a device's whole DARTT blob, their diffs, and restore
+ *
+ * A snapshot is periph_buf right after a full read, with a name and the time it was
+ * taken. Two snapshots, or a snapshot and the live device, are compared a word at a time
+ * and the differences listed per leaf with both values decoded through the config; only
+ * the array levels that contain a difference are built. Restoring writes the chosen
+ * leaves back as the fewest coalesced regions covering the words that actually differ
+ * from the device, so a calibration set goes back in a handful of transactions.
+ *
+ * Snapshots hold only bytes, so they stay valid across a hot reload as long as the
+ * layout keeps its symbol and size (snapshot_matches).
+ *
+ * Usage:
+ *   DarttSnapshot snap;
+ *   if (bus.take_snapshot(dev, "before tuning", snap)) dev.snapshots.push_back(snap);
+ *   ...
+ *   std::vector<SnapshotChange> changes;
+ *   bus.read_all(dev);
+ *   diff_blobs(dev.config, snap.bytes.data(), dev.config.periph_buf.buf, changes);
+ *   bus.restore_snapshot(dev, snap, changes, &stats);   // the selected changes
+ */
+
+#ifndef DARTT_SNAPSHOT_H
+#define DARTT_SNAPSHOT_H
+
+#include <stdint.h>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "buffer_sync.h"
+
+/* Unchanged words a restore region may span to avoid starting another transaction */
+#define SNAPSHOT_GAP_WORDS 2
+
+struct DarttSnapshot
+{
+    std::string name;
+    std::string symbol;             // DarttConfig::symbol of the layout it was taken with
+    time_t taken;                   // wall clock
+    std::vector<uint8_t> bytes;     // periph_buf
+
+    DarttSnapshot() : taken(0) {}
+};
+
+/* One leaf that differs between two blobs */
+struct SnapshotChange
+{
+    DarttFieldId id;
+    std::string path;
+    std::string before;             // decoded from the first blob
+    std::string after;              // decoded from the second
+    bool selected;                  // included in a restore
+};
+
+struct SnapshotRestoreStats
+{
+    uint32_t fields;                // selected leaves that differed from the device
+    uint32_t regions;               // write transactions
+    uint32_t bytes;                 // bytes written
+};
+
+/* Copy config's periph_buf into out (read it in full first, see BusManager::read_all) */
+void snapshot_capture(const DarttConfig& config, const char* name, DarttSnapshot& out);
+
+/* Whether snap's bytes line up with config's layout */
+bool snapshot_matches(const DarttSnapshot& snap, const DarttConfig& config);
+
+/*
+ * List the leaves whose bytes differ between blobs a and b (each periph_buf.size bytes),
+ * in tree order, all selected. Arrays are built where they hold a difference, so
+ * config's leaf list may grow.
+ */
+void diff_blobs(DarttConfig& config, const uint8_t* a, const uint8_t* b, std::vector<SnapshotChange>& out);
+
+/*
+ * The blob a restore should leave on the device: live with the selected changes' leaves
+ * taken from snap, into image. Returns the regions where image differs from live, word
+ * aligned and merged across gaps of up to SNAPSHOT_GAP_WORDS.
+ */
+std::vector<MemoryRegion> build_restore_regions(const DarttConfig& config, const DarttSnapshot& snap,
+                                                const std::vector<SnapshotChange>& changes,
+                                                const uint8_t* live, std::vector<uint8_t>& image);
+
+#endif /* DARTT_SNAPSHOT_H */
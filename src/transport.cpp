@@ -0,0 +1,377 @@
+#include "transport.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#define TRANSPORT_RECV_FLAGS MSG_DONTWAIT	//readiness comes from epoll; never let a spurious wakeup block the caller
+#else
+#define TRANSPORT_RECV_FLAGS 0
+#endif
+
+uint64_t transport_now_us()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Transport::Transport()
+{
+	for (int i = 0; i < TRANSPORT_MAX_LINKS; i++)
+	{
+		links[i].in_use = false;
+		links[i].type = LINK_SERIAL;
+		links[i].serial = nullptr;
+		links[i].socket = TCS_SOCKET_INVALID;
+		links[i].dropped_frames = 0;
+	}
+#ifdef __linux__
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd < 0)
+	{
+		perror("transport: epoll_create1");
+	}
+#else
+	pool = nullptr;
+	if (tcs_pool_create(&pool) != TCS_SUCCESS)
+	{
+		printf("transport: failed to create socket pool\n");
+		pool = nullptr;
+	}
+#endif
+}
+
+Transport::~Transport()
+{
+	for (int i = 0; i < TRANSPORT_MAX_LINKS; i++)
+	{
+		if (links[i].in_use)
+		{
+			remove(i);
+		}
+	}
+#ifdef __linux__
+	if (epoll_fd >= 0)
+	{
+		close(epoll_fd);
+	}
+#else
+	if (pool)
+	{
+		tcs_pool_destroy(&pool);
+	}
+#endif
+}
+
+int Transport::alloc_link()
+{
+	for (int i = 0; i < TRANSPORT_MAX_LINKS; i++)
+	{
+		if (!links[i].in_use)
+		{
+			TransportLink& l = links[i];
+			l.in_use = true;
+			l.serial = nullptr;
+			l.socket = TCS_SOCKET_INVALID;
+			l.rx.init(TRANSPORT_RX_BUFFER_SIZE);
+			l.pending.clear();
+			l.dropped_frames = 0;
+			return i;
+		}
+	}
+	printf("transport: link table full\n");
+	return -1;
+}
+
+int Transport::add_serial(Serial* ser)
+{
+	int id = alloc_link();
+	if (id < 0)
+	{
+		return -1;
+	}
+	links[id].type = LINK_SERIAL;
+	links[id].serial = ser;
+	return id;
+}
+
+int Transport::add_socket(TcsSocket socket, TransportLinkType type)
+{
+	int id = alloc_link();
+	if (id < 0)
+	{
+		return -1;
+	}
+	links[id].type = type;
+	links[id].socket = socket;
+
+#ifdef __linux__
+	struct epoll_event ev = {};
+	ev.events = EPOLLIN;
+	ev.data.u32 = (uint32_t)id;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &ev) != 0)
+	{
+		perror("transport: epoll_ctl add");
+		links[id].in_use = false;
+		return -1;
+	}
+#else
+	if (!pool || tcs_pool_add(pool, socket, (void*)(intptr_t)id, true, false, true) != TCS_SUCCESS)
+	{
+		printf("transport: failed to add socket to pool\n");
+		links[id].in_use = false;
+		return -1;
+	}
+#endif
+	return id;
+}
+
+void Transport::remove(int link)
+{
+	if (link < 0 || link >= TRANSPORT_MAX_LINKS || !links[link].in_use)
+	{
+		return;
+	}
+	TransportLink& l = links[link];
+	if (l.type != LINK_SERIAL && l.socket != TCS_SOCKET_INVALID)
+	{
+#ifdef __linux__
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, l.socket, nullptr);
+#else
+		if (pool)
+		{
+			tcs_pool_remove(pool, l.socket);
+		}
+#endif
+	}
+	fail_all(link, TRANSPORT_RX_LINK_ERROR);
+	l.in_use = false;
+	l.serial = nullptr;
+	l.socket = TCS_SOCKET_INVALID;
+	l.rx.init(0);
+}
+
+const TransportLink* Transport::get_link(int link) const
+{
+	if (link < 0 || link >= TRANSPORT_MAX_LINKS || !links[link].in_use)
+	{
+		return nullptr;
+	}
+	return &links[link];
+}
+
+int Transport::send(int link, const uint8_t* data, size_t len)
+{
+	if (link < 0 || link >= TRANSPORT_MAX_LINKS || !links[link].in_use)
+	{
+		return -1;
+	}
+	TransportLink& l = links[link];
+	if (l.type == LINK_SERIAL)
+	{
+		return l.serial->write((unsigned char*)data, (int)len);
+	}
+
+	size_t bytes_sent = 0;
+	TcsResult res = tcs_send(l.socket, data, len, TCS_FLAG_NONE, &bytes_sent);
+	return (res == TCS_SUCCESS) ? (int)bytes_sent : -1;
+}
+
+void Transport::receive(int link, uint32_t timeout_ms, transport_rx_cb_t callback, void* user)
+{
+	if (link < 0 || link >= TRANSPORT_MAX_LINKS || !links[link].in_use)
+	{
+		callback(TRANSPORT_RX_LINK_ERROR, nullptr, 0, user);
+		return;
+	}
+	TransportRequest req;
+	req.deadline_us = transport_now_us() + (uint64_t)timeout_ms * 1000u;
+	req.callback = callback;
+	req.user = user;
+	links[link].pending.push_back(req);
+}
+
+/*
+Hand every complete frame in the link's scanner to the oldest pending request. Frames
+nobody is waiting for (late replies after a timeout) are dropped.
+*/
+int Transport::dispatch(int link)
+{
+	TransportLink& l = links[link];
+	int completed = 0;
+	uint8_t* frame = nullptr;
+	size_t len = 0;
+	while (l.rx.next_frame(&frame, &len))
+	{
+		if (!l.pending.empty())
+		{
+			TransportRequest req = l.pending.front();
+			l.pending.pop_front();
+			req.callback(TRANSPORT_RX_OK, frame, len, req.user);
+			completed++;
+		}
+		else
+		{
+			l.dropped_frames++;
+		}
+	}
+	return completed;
+}
+
+// Pull whatever is currently available on the link in as few reads as possible, without blocking
+int Transport::drain(int link)
+{
+	TransportLink& l = links[link];
+	int completed = 0;
+
+	if (l.type == LINK_SERIAL)
+	{
+		while (true)
+		{
+			size_t space = 0;
+			uint8_t* dst = l.rx.write_ptr(&space);
+			int n = l.serial->read(dst, (int)space);
+			if (n <= 0)
+			{
+				break;
+			}
+			l.rx.commit((size_t)n);
+			completed += dispatch(link);
+			if ((size_t)n < space)
+			{
+				break;	//short read: the driver buffer is empty
+			}
+		}
+		return completed;
+	}
+
+	size_t space = 0;
+	uint8_t* dst = l.rx.write_ptr(&space);
+	size_t bytes_received = 0;
+	TcsResult res = tcs_receive(l.socket, dst, space, TRANSPORT_RECV_FLAGS, &bytes_received);
+	if (res == TCS_SUCCESS)
+	{
+		l.rx.commit(bytes_received);
+		if (l.type == LINK_DATAGRAM)
+		{
+			l.rx.end_of_packet();	//a datagram is a whole frame even if the peer omits the delimiter
+		}
+		completed += dispatch(link);
+	}
+	else if (res == TCS_SHUTDOWN || (res != TCS_ERROR_WOULD_BLOCK && res != TCS_ERROR_TIMED_OUT))
+	{
+		completed += fail_all(link, TRANSPORT_RX_LINK_ERROR);
+	}
+	return completed;
+}
+
+int Transport::expire(int link, uint64_t now_us)
+{
+	TransportLink& l = links[link];
+	int completed = 0;
+	//requests are queued in order with monotonic deadlines, so only the front can be overdue first
+	while (!l.pending.empty() && l.pending.front().deadline_us <= now_us)
+	{
+		TransportRequest req = l.pending.front();
+		l.pending.pop_front();
+		req.callback(TRANSPORT_RX_TIMEOUT, nullptr, 0, req.user);
+		completed++;
+	}
+	if (completed > 0)
+	{
+		l.rx.reset();	//a partial frame belonging to a timed out reply must not prefix the next one
+	}
+	return completed;
+}
+
+int Transport::fail_all(int link, int rc)
+{
+	TransportLink& l = links[link];
+	int completed = 0;
+	while (!l.pending.empty())
+	{
+		TransportRequest req = l.pending.front();
+		l.pending.pop_front();
+		req.callback(rc, nullptr, 0, req.user);
+		completed++;
+	}
+	return completed;
+}
+
+int Transport::poll(int timeout_ms)
+{
+	uint64_t now = transport_now_us();
+	int wait_ms = timeout_ms;
+	bool serial_pending = false;
+	for (int i = 0; i < TRANSPORT_MAX_LINKS; i++)
+	{
+		if (!links[i].in_use || links[i].pending.empty())
+		{
+			continue;
+		}
+		uint64_t deadline = links[i].pending.front().deadline_us;
+		int remaining_ms = (deadline > now) ? (int)((deadline - now + 999) / 1000) : 0;
+		wait_ms = std::min(wait_ms, remaining_ms);
+		if (links[i].type == LINK_SERIAL)
+		{
+			serial_pending = true;
+		}
+	}
+	if (serial_pending)
+	{
+		wait_ms = std::min(wait_ms, TRANSPORT_SERIAL_TICK_MS);
+	}
+	wait_ms = std::max(wait_ms, 0);
+
+	int completed = 0;
+#ifdef __linux__
+	struct epoll_event events[TRANSPORT_MAX_LINKS];
+	int n = epoll_wait(epoll_fd, events, TRANSPORT_MAX_LINKS, wait_ms);
+	for (int i = 0; i < n; i++)
+	{
+		int link = (int)events[i].data.u32;
+		if (link < TRANSPORT_MAX_LINKS && links[link].in_use)
+		{
+			completed += drain(link);
+		}
+	}
+#else
+	struct TcsPollEvent events[TRANSPORT_MAX_LINKS];
+	size_t n = 0;
+	if (pool && tcs_pool_poll(pool, events, TRANSPORT_MAX_LINKS, &n, wait_ms) == TCS_SUCCESS)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			int link = (int)(intptr_t)events[i].user_data;
+			if (link < TRANSPORT_MAX_LINKS && links[link].in_use && (events[i].can_read || events[i].error != TCS_SUCCESS))
+			{
+				completed += drain(link);
+			}
+		}
+	}
+	else if (wait_ms > 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));	//empty pool: keep the serial tick
+	}
+#endif
+
+	now = transport_now_us();
+	for (int i = 0; i < TRANSPORT_MAX_LINKS; i++)
+	{
+		if (!links[i].in_use)
+		{
+			continue;
+		}
+		if (links[i].type == LINK_SERIAL && !links[i].pending.empty())
+		{
+			completed += drain(i);
+		}
+		completed += expire(i, now);
+	}
+	return completed;
+}
@@ -0,0 +1,95 @@
+#ifndef DARTT_TRANSPORT_H
+#define DARTT_TRANSPORT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include "serial.h"
+#include "tinycsocket.h"
+#include "cobs_scanner.h"
+
+#define TRANSPORT_MAX_LINKS		8
+#define TRANSPORT_RX_BUFFER_SIZE	16384	//per-link receive buffer; one read syscall drains up to this much
+#define TRANSPORT_SERIAL_TICK_MS	1	//Serial exposes no descriptor to wait on, so pending serial reads are drained on this tick
+
+// Completion codes handed to transport_rx_cb_t. Values match what rx_blocking already reports upward.
+#define TRANSPORT_RX_OK			0
+#define TRANSPORT_RX_LINK_ERROR	-1
+#define TRANSPORT_RX_TIMEOUT	-7
+
+enum TransportLinkType {
+	LINK_SERIAL = 0,
+	LINK_STREAM = 1,	//TCP: frames may be split across or packed into reads
+	LINK_DATAGRAM = 2	//UDP: one read per datagram
+};
+
+// Called from Transport::poll when a frame arrives or the request deadline passes.
+// frame is the COBS-decoded payload, valid only for the duration of the call.
+typedef void (*transport_rx_cb_t)(int rc, const uint8_t* frame, size_t len, void* user);
+
+struct TransportRequest {
+	uint64_t deadline_us;
+	transport_rx_cb_t callback;
+	void* user;
+};
+
+struct TransportLink {
+	bool in_use;
+	TransportLinkType type;
+	Serial* serial;
+	TcsSocket socket;
+	CobsScanner rx;							//bulk receive buffer and streaming frame decoder
+	std::deque<TransportRequest> pending;	//receive requests, completed in arrival order
+	uint32_t dropped_frames;				//frames that arrived with no request waiting on them
+};
+
+/*
+Event-driven transport for DARTT links. Sockets are multiplexed with epoll on Linux
+(TcsPool elsewhere) and read without blocking, so per-frame receive timeouts are
+replaced by per-request deadlines enforced in poll(). Several links can be driven
+from one thread by calling poll() in a loop. Not thread safe - poll(), send() and
+receive() must be called from the same thread, and callbacks must not remove links.
+*/
+class Transport
+{
+public:
+	Transport();
+	~Transport();
+
+	// Register a link. Returns the link id, or -1 if the table is full.
+	int add_serial(Serial* ser);
+	int add_socket(TcsSocket socket, TransportLinkType type);
+	// Fails any pending requests with TRANSPORT_RX_LINK_ERROR and frees the slot
+	void remove(int link);
+
+	// Write an encoded frame. Returns the number of bytes sent, or -1 on error.
+	int send(int link, const uint8_t* data, size_t len);
+
+	// Queue a receive request; callback fires from poll() with the next frame or on timeout.
+	void receive(int link, uint32_t timeout_ms, transport_rx_cb_t callback, void* user);
+
+	// Wait up to timeout_ms (clamped to the nearest pending deadline) for descriptors to become
+	// readable, dispatch complete frames and expire overdue requests. Returns the number of completions.
+	int poll(int timeout_ms);
+
+	const TransportLink* get_link(int link) const;
+
+private:
+	TransportLink links[TRANSPORT_MAX_LINKS];
+#ifdef __linux__
+	int epoll_fd;
+#else
+	struct TcsPool* pool;
+#endif
+
+	int alloc_link();
+	int drain(int link);
+	int dispatch(int link);
+	int expire(int link, uint64_t now_us);
+	int fail_all(int link, int rc);
+};
+
+uint64_t transport_now_us();
+
+#endif // DARTT_TRANSPORT_H
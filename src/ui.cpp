@@ -3,11 +3,21 @@
 #include "imgui_impl_sdl2.h"
 #include "imgui_impl_opengl3.h"
 #include <SDL.h>
+#include <algorithm>
+#include <cmath>
+#include <climits>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include "colors.h"
 #include "dartt_init.h"
+#include "elf_parser.h"
+#include "config_binary.h"
+#include "config_save.h"
 
 
 bool init_imgui(SDL_Window* window, SDL_GLContext gl_context) 
@@ -41,8 +51,9 @@ void shutdown_imgui()
     ImGui::DestroyContext();
 }
 
-void set_subscribed_all(DarttField* root, bool subscribed) 
+bool set_subscribed_all(DarttField* root, bool subscribed) 
 {
+    bool built = false;
     std::vector<DarttField*> stack;
     stack.push_back(root);
 
@@ -52,54 +63,74 @@ void set_subscribed_all(DarttField* root, bool subscribed)
         stack.pop_back();
 
         field->subscribed = subscribed;
+        if (subscribed && field->lazy)
+		{
+            built |= materialize_children(*field);	//subscribing needs the elements themselves
+        }
 
         for (size_t i = 0; i < field->children.size(); i++) 
 		{
             stack.push_back(&field->children[i]);
         }
     }
+    return built;
 }
 
-bool any_child_subscribed(const DarttField* root) 
+void set_poll_rate_all(DarttField* root, float rate_hz)
 {
-    std::vector<const DarttField*> stack;
+    std::vector<DarttField*> stack;
     stack.push_back(root);
 
-    while (!stack.empty()) {
-        const DarttField* field = stack.back();
+    while (!stack.empty())
+	{
+        DarttField* field = stack.back();
         stack.pop_back();
 
-        if (field->subscribed) {
-            return true;
-        }
+        field->poll_rate_hz = rate_hz;
 
-        for (size_t i = 0; i < field->children.size(); i++) {
+        for (size_t i = 0; i < field->children.size(); i++)
+		{
             stack.push_back(&field->children[i]);
         }
     }
-    return false;
 }
 
-bool all_children_subscribed(const DarttField* root) {
-    std::vector<const DarttField*> stack;
-    stack.push_back(root);
+void count_subscribed_leaves(DarttField* root)
+{
+    // Post-order: a node is summed on its second visit, after all of its children
+    std::vector<std::pair<DarttField*, bool>> stack;
+    stack.push_back({root, false});
 
-    while (!stack.empty()) {
-        const DarttField* field = stack.back();
+    while (!stack.empty())
+	{
+        DarttField* field = stack.back().first;
+        bool children_done = stack.back().second;
         stack.pop_back();
 
-        // Only check leaves
-        if (field->children.empty()) {
-            if (!field->subscribed) {
-                return false;
-            }
-        } else {
-            for (size_t i = 0; i < field->children.size(); i++) {
-                stack.push_back(&field->children[i]);
+        if (field->children.empty())
+		{
+            field->leaf_count = 1;
+            field->subscribed_count = field->subscribed ? 1 : 0;
+            continue;
+        }
+        if (!children_done)
+		{
+            stack.push_back({field, true});
+            for (size_t i = 0; i < field->children.size(); i++)
+			{
+                stack.push_back({&field->children[i], false});
             }
+            continue;
+        }
+
+        field->leaf_count = 0;
+        field->subscribed_count = 0;
+        for (size_t i = 0; i < field->children.size(); i++)
+		{
+            field->leaf_count += field->children[i].leaf_count;
+            field->subscribed_count += field->children[i].subscribed_count;
         }
     }
-    return true;
 }
 
 // Work item for iterative field rendering
@@ -109,6 +140,10 @@ struct RenderWork
     bool is_tree_pop;  // true = just call TreePop(), no rendering
 };
 
+// Set when the plot source selector opens or closes a node, which shares field->expanded
+// with the Live Expressions table, so the table rebuilds its rows
+static bool selector_expand_changed = false;
+
 void calculate_display_values(const std::vector<DarttField*> &leaf_list)
 {
 	for(int i = 0; i < leaf_list.size(); i++)
@@ -116,63 +151,230 @@ void calculate_display_values(const std::vector<DarttField*> &leaf_list)
 		DarttField * leaf = leaf_list[i];
 		if(leaf->subscribed)
 		{
-			switch (leaf->type) 
-			{
-				case FieldType::FLOAT:
-				{
-					leaf->display_value = leaf->value.f32 * leaf->display_scale;
-					break;
-				}
-				case FieldType::INT32:
-				{
-					leaf->display_value = ((float)leaf->value.i32)*leaf->display_scale;
-					break;
-				}
-				case FieldType::UINT32:
-				{
-					leaf->display_value = ((float)leaf->value.u32)*leaf->display_scale;
-					break;
-				}
-				case FieldType::INT16:
-				{
-					leaf->display_value = ((float)leaf->value.i16) * leaf->display_scale;
-					break;
-				}
-				case FieldType::UINT16:
-				{
-					leaf->display_value = ((float)leaf->value.u16) * leaf->display_scale;
-					break;
-				}
-				case FieldType::INT8:
-				{
-					leaf->display_value = ((float)leaf->value.i8) * leaf->display_scale;
-					break;
-				}
-				case FieldType::UINT8:
-				{
-					leaf->display_value = ((float)leaf->value.u8) * leaf->display_scale;
-					break;
-				}
-				case FieldType::DOUBLE:
-				{
-					leaf->display_value = (float)leaf->value.f64 * leaf->display_scale;
-					break;
-				}
-				case FieldType::INT64:
-				{
-					leaf->display_value = ((float)leaf->value.i64) * leaf->display_scale;
-					break;
-				}
-				case FieldType::UINT64:
-				{
-					leaf->display_value = ((float)leaf->value.u64) * leaf->display_scale;
-					break;
-				}
-				default:
-					break;
-			}	
+			//same conversion as the Watch statistics, so they agree with the plots (enums plot the numeric value)
+			leaf->display_value = (float)field_numeric_value(*leaf) * leaf->display_scale;
+		}
+	}
+}
+
+// "850 ms", "12.3 s", "4m 05s"
+static void format_age(char* buf, size_t size, uint64_t us)
+{
+	if (us < 1000000ull)
+	{
+		snprintf(buf, size, "%u ms", (unsigned)(us / 1000ull));
+	}
+	else if (us < 60000000ull)
+	{
+		snprintf(buf, size, "%.1f s", (double)us * 1e-6);
+	}
+	else
+	{
+		uint64_t sec = us / 1000000ull;
+		snprintf(buf, size, "%um %02us", (unsigned)(sec / 60), (unsigned)(sec % 60));
+	}
+}
+
+// A leaf's window statistics in the units its value is shown in
+static bool scaled_stats(const DarttField& field, uint64_t now_us, FieldStatsSummary& out)
+{
+	if (!field_stats_summary(field, now_us, out))
+	{
+		return false;
+	}
+	if (field.use_display_scale)
+	{
+		float s = field.display_scale;
+		out.min *= s;
+		out.max *= s;
+		if (s < 0.f)
+		{
+			std::swap(out.min, out.max);
 		}
+		out.mean *= s;
+		out.stddev *= std::fabs(s);
 	}
+	return true;
+}
+
+// Hover text for a subscribed leaf's Sub checkbox: the Watch panel's numbers for one field
+static void render_stats_tooltip(const DarttField& field)
+{
+	uint64_t now_us = transport_now_us();
+	FieldStatsSummary st;
+	if (!scaled_stats(field, now_us, st))
+	{
+		ImGui::SetTooltip("No reads in the last %u s", (unsigned)(FIELD_STATS_WINDOW_US / 1000000ull));
+		return;
+	}
+	char age[32];
+	format_age(age, sizeof(age), now_us - field.stats.last_change_us);
+	ImGui::SetTooltip("min %g  max %g\nmean %g  std %g\n%.1f Hz, unchanged for %s",
+	                  st.min, st.max, st.mean, st.stddev, field.achieved_hz, age);
+}
+
+/*
+Value boxes keep their text between frames and format it again only when the value's bits
+(or its type or format) change, so a big table of values that are not moving does no number
+formatting. The box is an InputText on that text, and an edit is parsed back the way
+InputScalar would. Entries are keyed by the value's address; the text depends only on the
+bits, type and format, so an entry left by a field that has since been freed is harmless.
+*/
+#define VALUE_TEXT_CACHE_MAX 8192
+#define VALUE_TEXT_ENUM -1          // type of an enum preview entry
+
+struct ValueText
+{
+	int type;                       // what text was formatted from
+	const char* format;
+	uint64_t bits;
+	bool valid;                     // false after an edit, so the parsed value is shown
+	bool editing;                   // the box was active when last drawn
+	int drawn_frame;                // frame the box was last drawn
+	char text[64];
+};
+static std::unordered_map<const void*, ValueText> value_texts;
+
+static size_t data_type_size(ImGuiDataType type)
+{
+	switch (type)
+	{
+		case ImGuiDataType_S8:
+		case ImGuiDataType_U8:     return 1;
+		case ImGuiDataType_S16:
+		case ImGuiDataType_U16:    return 2;
+		case ImGuiDataType_S32:
+		case ImGuiDataType_U32:
+		case ImGuiDataType_Float:  return 4;
+		default:                   return 8;
+	}
+}
+
+// The cache entry for data. Returns true if its text must be formatted again: the value
+// changed and the user is not typing in the box.
+static bool value_text_entry(const void* data, int type, const char* format, uint64_t bits, ValueText*& out)
+{
+	auto it = value_texts.find(data);
+	if (it == value_texts.end())
+	{
+		if (value_texts.size() >= VALUE_TEXT_CACHE_MAX)
+		{
+			value_texts.clear();    //rows scrolled past long ago; the visible ones come straight back
+		}
+		it = value_texts.emplace(data, ValueText{}).first;
+	}
+	ValueText& vt = it->second;
+	out = &vt;
+	bool active = vt.editing && vt.drawn_frame == ImGui::GetFrameCount() - 1;
+	if (active || (vt.valid && vt.type == type && vt.format == format && vt.bits == bits))
+	{
+		return false;
+	}
+	vt.type = type;
+	vt.format = format;
+	vt.bits = bits;
+	vt.valid = true;
+	return true;
+}
+
+static void format_data(char* buf, size_t size, ImGuiDataType type, const void* data, const char* format)
+{
+	switch (type)
+	{
+		case ImGuiDataType_S8:     snprintf(buf, size, format ? format : "%d", *(const int8_t*)data); break;
+		case ImGuiDataType_U8:     snprintf(buf, size, format ? format : "%u", *(const uint8_t*)data); break;
+		case ImGuiDataType_S16:    snprintf(buf, size, format ? format : "%d", *(const int16_t*)data); break;
+		case ImGuiDataType_U16:    snprintf(buf, size, format ? format : "%u", *(const uint16_t*)data); break;
+		case ImGuiDataType_S32:    snprintf(buf, size, format ? format : "%d", *(const int32_t*)data); break;
+		case ImGuiDataType_U32:    snprintf(buf, size, format ? format : "%u", *(const uint32_t*)data); break;
+		case ImGuiDataType_S64:    snprintf(buf, size, format ? format : "%lld", (long long)*(const int64_t*)data); break;
+		case ImGuiDataType_U64:    snprintf(buf, size, format ? format : "%llu", (unsigned long long)*(const uint64_t*)data); break;
+		case ImGuiDataType_Float:  snprintf(buf, size, format ? format : "%.3f", *(const float*)data); break;
+		case ImGuiDataType_Double: snprintf(buf, size, format ? format : "%f", *(const double*)data); break;
+		default:                   buf[0] = '\0'; break;
+	}
+}
+
+// Parse an edited box into data, clamping integers to their type. Text that is not a number leaves data alone.
+static void parse_data(const char* text, ImGuiDataType type, void* data)
+{
+	char* end = nullptr;
+	if (type == ImGuiDataType_Float || type == ImGuiDataType_Double)
+	{
+		double v = strtod(text, &end);
+		if (end == text)
+		{
+			return;
+		}
+		if (type == ImGuiDataType_Float)
+		{
+			*(float*)data = (float)v;
+		}
+		else
+		{
+			*(double*)data = v;
+		}
+		return;
+	}
+	if (type == ImGuiDataType_U64)
+	{
+		unsigned long long v = strtoull(text, &end, 10);
+		if (end != text)
+		{
+			*(uint64_t*)data = (uint64_t)v;
+		}
+		return;
+	}
+	long long v = strtoll(text, &end, 10);
+	if (end == text)
+	{
+		return;
+	}
+	switch (type)
+	{
+		case ImGuiDataType_S8:  *(int8_t*)data = (int8_t)std::clamp<long long>(v, INT8_MIN, INT8_MAX); break;
+		case ImGuiDataType_U8:  *(uint8_t*)data = (uint8_t)std::clamp<long long>(v, 0, UINT8_MAX); break;
+		case ImGuiDataType_S16: *(int16_t*)data = (int16_t)std::clamp<long long>(v, INT16_MIN, INT16_MAX); break;
+		case ImGuiDataType_U16: *(uint16_t*)data = (uint16_t)std::clamp<long long>(v, 0, UINT16_MAX); break;
+		case ImGuiDataType_S32: *(int32_t*)data = (int32_t)std::clamp<long long>(v, INT32_MIN, INT32_MAX); break;
+		case ImGuiDataType_U32: *(uint32_t*)data = (uint32_t)std::clamp<long long>(v, 0, UINT32_MAX); break;
+		case ImGuiDataType_S64: *(int64_t*)data = (int64_t)v; break;
+		default: break;
+	}
+}
+
+// Drop-in for ImGui::InputScalar in the field handlers: check IsItemDeactivatedAfterEdit() after it as before
+static void input_value(const char* label, ImGuiDataType type, void* data, const char* format = nullptr)
+{
+	uint64_t bits = 0;
+	std::memcpy(&bits, data, data_type_size(type));
+	ValueText* vt = nullptr;
+	if (value_text_entry(data, type, format, bits, vt))
+	{
+		format_data(vt->text, sizeof(vt->text), type, data, format);
+	}
+	bool is_float = (type == ImGuiDataType_Float || type == ImGuiDataType_Double);
+	ImGuiInputTextFlags flags = ImGuiInputTextFlags_AutoSelectAll |
+		(is_float ? ImGuiInputTextFlags_CharsScientific : ImGuiInputTextFlags_CharsDecimal);
+	ImGui::InputText(label, vt->text, sizeof(vt->text), flags);
+	vt->editing = ImGui::IsItemActive();
+	vt->drawn_frame = ImGui::GetFrameCount();
+	if (ImGui::IsItemDeactivatedAfterEdit())
+	{
+		parse_data(vt->text, type, data);
+		vt->valid = false;      //show the value as parsed, like InputScalar
+	}
+}
+
+// An enum's combo preview, named again only when the value changes
+static const char* enum_preview(const DarttField& field)
+{
+	ValueText* vt = nullptr;
+	if (value_text_entry(&field.value, VALUE_TEXT_ENUM, nullptr, field.value.u64, vt))
+	{
+		snprintf(vt->text, sizeof(vt->text), "%s", format_field_value(field).c_str());
+	}
+	return vt->text;
 }
 
 void float_field_handler(DarttField* field)
@@ -183,12 +385,12 @@ void float_field_handler(DarttField* field)
 	}
 	if (field->use_display_scale == false)
 	{
-		ImGui::InputFloat("##val", &field->value.f32, 0, 0, "%f");
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_Float, &field->value.f32, "%f");
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();	//stays set until the bus manager sends it
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -206,12 +408,12 @@ void int32_field_handler(DarttField * field)
 
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_S32, &field->value.i32, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit(); 
+		input_value("##val", ImGuiDataType_S32, &field->value.i32);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit()) 
 		{ 
 			field->dirty = true; 
@@ -224,12 +426,12 @@ void uint32_field_handler(DarttField * field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_U32, &field->value.u32, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit(); 
+		input_value("##val", ImGuiDataType_U32, &field->value.u32);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit()) 
 		{ 
 			field->dirty = true; 
@@ -243,12 +445,12 @@ void int16_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_S16, &field->value.i16, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_S16, &field->value.i16);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -261,12 +463,12 @@ void uint16_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_U16, &field->value.u16, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_U16, &field->value.u16);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -279,12 +481,12 @@ void int8_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_S8, &field->value.i8, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_S8, &field->value.i8);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -297,12 +499,12 @@ void uint8_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_U8, &field->value.u8, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_U8, &field->value.u8);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -315,12 +517,12 @@ void double_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputDouble("##val", &field->value.f64, 0, 0, "%f");
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_Double, &field->value.f64, "%f");
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -333,12 +535,12 @@ void int64_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_S64, &field->value.i64, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_S64, &field->value.i64);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -351,12 +553,12 @@ void uint64_field_handler(DarttField* field)
 {
 	if(field->use_display_scale == false)
 	{
-		ImGui::InputScalar("##val", ImGuiDataType_U64, &field->value.u64, 0, 0);
-		field->dirty = ImGui::IsItemDeactivatedAfterEdit();
+		input_value("##val", ImGuiDataType_U64, &field->value.u64);
+		field->dirty |= ImGui::IsItemDeactivatedAfterEdit();
 	}
 	else
 	{
-		ImGui::InputScalar("###val", ImGuiDataType_Float, &field->display_value, 0, 0, "%f");
+		input_value("###val", ImGuiDataType_Float, &field->display_value, "%f");
 		if (ImGui::IsItemDeactivatedAfterEdit())
 		{
 			field->dirty = true;
@@ -365,109 +567,215 @@ void uint64_field_handler(DarttField* field)
 	}
 }
 
-// Render a single field's row (called from iterative loop)
-static bool render_single_field(DarttField* field, bool show_display_props) 
+/*
+Enums with known enumerators edit through a combo of their names; the shared table is
+sorted by value, so the list reads in declaration order for the usual 0..N enums.
+Without a table they fall back to plain integer entry.
+*/
+void enum_field_handler(DarttField* field)
 {
-    bool is_leaf = field->children.empty();
+	if(field->enum_info == nullptr)
+	{
+		int32_field_handler(field);
+		return;
+	}
+
+	const DarttEnum& e = *field->enum_info;
+	int64_t current = get_enum_value(*field);
+	if (ImGui::BeginCombo("##val", enum_preview(*field)))
+	{
+		for (size_t i = 0; i < e.values.size(); i++)
+		{
+			char label[160];
+			snprintf(label, sizeof(label), "%s (%lld)", e.names[i].c_str(), (long long)e.values[i]);
+			bool selected = (e.values[i] == current);
+			if (ImGui::Selectable(label, selected))
+			{
+				set_enum_value(*field, e.values[i]);
+				field->dirty = true;
+			}
+			if (selected)
+			{
+				ImGui::SetItemDefaultFocus();
+			}
+		}
+		ImGui::EndCombo();
+	}
+}
+
+// Editable value box for a leaf, by field type
+static void render_value_editor(DarttField* field)
+{
+    // Different input types based on field type
+    switch (field->type) 
+	{
+        case FieldType::FLOAT:
+		{
+			float_field_handler(field);
+			break;
+		}
+        case FieldType::INT32:
+		{
+			int32_field_handler(field);
+            break;
+		}
+        case FieldType::UINT32:
+		{
+			uint32_field_handler(field);
+            break;
+		}
+        case FieldType::INT16:
+		{
+			int16_field_handler(field);
+			break;
+		}
+        case FieldType::UINT16:
+		{
+			uint16_field_handler(field);
+			break;
+		}
+        case FieldType::INT8:
+		{
+			int8_field_handler(field);
+			break;
+		}
+        case FieldType::UINT8:
+		{
+			uint8_field_handler(field);
+			break;
+		}
+        case FieldType::DOUBLE:
+		{
+			double_field_handler(field);
+			break;
+		}
+        case FieldType::INT64:
+		{
+			int64_field_handler(field);
+			break;
+		}
+        case FieldType::UINT64:
+		{
+			uint64_field_handler(field);
+			break;
+		}
+		case FieldType::ENUM:
+		{
+			enum_field_handler(field);
+			break;
+		}
+        default:
+            ImGui::TextDisabled("???");
+            break;
+    }
+}
+
+// How long a value that changed on the device stays highlighted
+#define VALUE_CHANGE_FADE_MS 750
+
+// Tint the current table cell if field's value changed recently (diff_periph_buf), fading out
+static void highlight_changed_cell(const DarttField& field, uint64_t now_ms)
+{
+	if (field.changed_ms == 0 || now_ms - field.changed_ms >= VALUE_CHANGE_FADE_MS)
+	{
+		return;
+	}
+	float fade = 1.0f - (float)(now_ms - field.changed_ms) / (float)VALUE_CHANGE_FADE_MS;
+	ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, ImGui::GetColorU32(ImVec4(0.9f, 0.7f, 0.1f, 0.45f * fade)));
+}
+
+// Add delta to the subscribed_count of a view row and all of its ancestors
+static void add_subscribed_count(DarttConfig& config, int32_t row, int32_t delta)
+{
+    while (row >= 0)
+	{
+        config.view_rows[row].field->subscribed_count += delta;
+        row = config.view_rows[row].parent;
+    }
+}
+
+// Render one row of the Live Expressions table (called from the clipped row loops).
+// row is the field's view row, or -1 for a search result, which is labelled with its path.
+static bool render_single_field(DarttConfig& config, DarttField* field, int32_t row, const char* label,
+                                bool show_display_props, bool show_poll_rates, bool& tree_changed)
+{
+    bool is_leaf = is_leaf_field(*field);
 
     ImGui::TableNextRow();
 
-    // Column 0: Name (with tree indentation)
+    // Column 0: Name (with tree indentation). Rows are flat, so no node pushes a tree level.
     ImGui::TableNextColumn();
+    float indent = (row >= 0) ? config.view_rows[row].depth * ImGui::GetStyle().IndentSpacing : 0.0f;
+    if (indent > 0.0f)
+	{
+        ImGui::Indent(indent);
+    }
 
-    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth;
+    ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_NoTreePushOnOpen;
     if (is_leaf) {
-        flags |= ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen;
-    }
-    if (field->expanded) {
-        flags |= ImGuiTreeNodeFlags_DefaultOpen;
+        flags |= ImGuiTreeNodeFlags_Leaf;
     }
 
     // Use a unique ID based on pointer
     ImGui::PushID(field);
 
-    bool node_open = false;
     if (is_leaf) 
 	{
         // Leaf: just show name, no tree node behavior
-        ImGui::TreeNodeEx(field->name.c_str(), flags);
-        node_open = false;
+        ImGui::TreeNodeEx(label, flags);
+        if (field->bit_size > 0 && ImGui::IsItemHovered())
+		{
+            ImGui::SetTooltip("Bitfield: %u bit%s at byte %u, bit %u", field->bit_size,
+                              field->bit_size == 1 ? "" : "s", field->byte_offset, field->bit_shift);
+        }
     } 
 	else 
 	{
-        // Parent: expandable tree node
-        node_open = ImGui::TreeNodeEx(field->name.c_str(), flags);
-        field->expanded = node_open;
+        // Parent: expandable tree node. Opening or closing it changes the row list,
+        // which is rebuilt next frame rather than under the clipper.
+        ImGui::SetNextItemOpen(field->expanded, ImGuiCond_Always);
+        bool node_open = ImGui::TreeNodeEx(label, flags);
+        if (node_open != field->expanded)
+		{
+            field->expanded = node_open;
+            config.view_rows_valid = false;
+
+            // Arrays get their elements the first time they are opened
+            if (node_open && field->lazy)
+			{
+                tree_changed |= materialize_children(*field);
+            }
+        }
+    }
+    if (indent > 0.0f)
+	{
+        ImGui::Unindent(indent);
     }
 
     // Column 1: Value
     ImGui::TableNextColumn();
     if (is_leaf) 
 	{
+        highlight_changed_cell(*field, SDL_GetTicks64());
+        if (field->write_failed || field->write_failures > 0)
+		{
+            // Retrying a failed write, or gave up on it and shows the device's value again
+            ImGui::TableSetBgColor(ImGuiTableBgTarget_CellBg, ImGui::GetColorU32(ImVec4(0.8f, 0.2f, 0.15f, 0.45f)));
+        }
+
         // Editable value box
         ImGui::SetNextItemWidth(-FLT_MIN); // Fill column width
-
-        // Different input types based on field type
-        switch (field->type) 
+        render_value_editor(field);
+        if ((field->write_failed || field->write_failures > 0) && ImGui::IsItemHovered())
 		{
-            case FieldType::FLOAT:
-			{
-				float_field_handler(field);
-				break;
-			}
-            case FieldType::INT32:
-			{
-				int32_field_handler(field);
-                break;
-			}
-            case FieldType::UINT32:
-			{
-				uint32_field_handler(field);
-                break;
-			}
-            case FieldType::INT16:
-			{
-				int16_field_handler(field);
-				break;
-			}
-            case FieldType::UINT16:
-			{
-				uint16_field_handler(field);
-				break;
-			}
-            case FieldType::INT8:
-			{
-				int8_field_handler(field);
-				break;
-			}
-            case FieldType::UINT8:
+            if (field->write_failed)
 			{
-				uint8_field_handler(field);
-				break;
-			}
-            case FieldType::DOUBLE:
-			{
-				double_field_handler(field);
-				break;
-			}
-            case FieldType::INT64:
-			{
-				int64_field_handler(field);
-				break;
-			}
-            case FieldType::UINT64:
-			{
-				uint64_field_handler(field);
-				break;
-			}
-			case FieldType::ENUM:
+                ImGui::SetTooltip("Write failed %d times; the edit was dropped", WRITE_RETRY_LIMIT);
+            }
+            else
 			{
-				int32_field_handler(field);
-				break;
-			}
-            default:
-                ImGui::TextDisabled("???");
-                break;
+                ImGui::SetTooltip("Write failed, retrying (%u of %d)", (unsigned)field->write_failures, WRITE_RETRY_LIMIT);
+            }
         }
     } 
 	else 
@@ -481,8 +789,8 @@ static bool render_single_field(DarttField* field, bool show_display_props)
 
     // For parent nodes, show mixed state if some but not all children subscribed
     if (!is_leaf) {
-        bool all_sub = all_children_subscribed(field);
-        bool any_sub = any_child_subscribed(field);
+        bool all_sub = field->subscribed_count == field->leaf_count;
+        bool any_sub = field->subscribed_count > 0;
 
         // Mixed state: use a different visual
         if (any_sub && !all_sub) {
@@ -492,7 +800,17 @@ static bool render_single_field(DarttField* field, bool show_display_props)
         bool sub_state = all_sub;
         if (ImGui::Checkbox("##sub", &sub_state)) {
             // Toggle: if was mixed or off, turn all on; if all on, turn all off
-            set_subscribed_all(field, !all_sub);
+            config.settings_version++;
+            uint32_t before = field->subscribed_count;
+            if (set_subscribed_all(field, !all_sub))
+			{
+                tree_changed = true;    // new elements: counts are redone with the rows
+            }
+            else
+			{
+                count_subscribed_leaves(field);
+                add_subscribed_count(config, config.view_rows[row].parent, (int32_t)(field->subscribed_count - before));
+            }
         }
 
         if (any_sub && !all_sub) {
@@ -504,6 +822,19 @@ static bool render_single_field(DarttField* field, bool show_display_props)
         if (ImGui::Checkbox("##sub", &field->subscribed)) 
 		{
             // Individual leaf subscription changed
+            config.settings_version++;
+            if (row >= 0)
+			{
+                add_subscribed_count(config, row, field->subscribed ? 1 : -1);
+            }
+            else
+			{
+                config.view_rows_valid = false;     // recounted when the tree is shown again
+            }
+        }
+        if (field->subscribed && ImGui::IsItemHovered())
+		{
+            render_stats_tooltip(*field);
         }
     }
 
@@ -511,9 +842,60 @@ static bool render_single_field(DarttField* field, bool show_display_props)
 	if (show_display_props)
 	{
 		ImGui::TableNextColumn();
-		ImGui::Checkbox("##native_type", &field->use_display_scale);
+		bool changed = ImGui::Checkbox("##native_type", &field->use_display_scale);
 		ImGui::SameLine();
-		ImGui::InputFloat("##displayscale", &field->display_scale, 0, 0, "%g");
+		changed |= ImGui::InputFloat("##displayscale", &field->display_scale, 0, 0, "%g");
+		if (changed)
+		{
+			config.settings_version++;
+		}
+	}
+
+	/*Poll rate target and measured rate. Negative targets are read on demand only*/
+	if (show_poll_rates)
+	{
+		ImGui::TableNextColumn();
+		ImGui::SetNextItemWidth(60);
+		if (is_leaf)
+		{
+			if (ImGui::InputFloat("##pollrate", &field->poll_rate_hz, 0, 0, "%g"))
+			{
+				config.settings_version++;
+			}
+			ImGui::SameLine();
+			if (field->poll_rate_hz < 0.f)
+			{
+				// Requests go through the read scheduler, which only reads subscribed fields
+				if (field->subscribed && ImGui::SmallButton("Read"))
+				{
+					field->read_requested = true;
+				}
+			}
+			else if (field->subscribed)
+			{
+				// The bus is polled once per frame, so no rate above the frame rate can be met
+				float frame_hz = ImGui::GetIO().Framerate;
+				bool frame_capped = field->poll_rate_hz > frame_hz;
+				bool behind = field->poll_rate_hz > 0.f && field->achieved_hz < 0.9f * field->poll_rate_hz;
+				ImVec4 col = frame_capped ? ImVec4(1.0f, 0.7f, 0.2f, 1.0f)
+				           : behind ? ImVec4(1.0f, 0.4f, 0.3f, 1.0f) : ImVec4(0.6f, 0.6f, 0.6f, 1.0f);
+				ImGui::TextColored(col, frame_capped ? "%.1f Hz (max)" : "%.1f Hz", field->achieved_hz);
+				if (frame_capped && ImGui::IsItemHovered())
+				{
+					ImGui::SetTooltip("Fields are read at most once per frame: %.0f Hz at the current frame rate", frame_hz);
+				}
+			}
+		}
+		else
+		{
+			float rate = field->poll_rate_hz;
+			ImGui::InputFloat("##pollrate", &rate, 0, 0, "%g");
+			if (ImGui::IsItemDeactivatedAfterEdit())
+			{
+				set_poll_rate_all(field, rate);
+				config.settings_version++;
+			}
+		}
 	}
 
     ImGui::PopID();
@@ -521,47 +903,157 @@ static bool render_single_field(DarttField* field, bool show_display_props)
     return field->dirty;
 }
 
-// Render field tree iteratively, returns true if any value was edited
-static bool render_field_tree(DarttField* root, bool show_display_props)
+// Flatten the tree into config.view_rows: every node whose ancestors are all expanded, in
+// display order, and recount subscriptions. Runs only when the rows were invalidated.
+// Returns true if it built lazy arrays that were open, so the leaf list needs refreshing.
+static bool refresh_view_rows(DarttConfig& config)
 {
-    bool any_edited = false;
-    std::vector<RenderWork> stack;
-
-    stack.push_back({root, false});
+    bool built = false;
+    std::vector<DarttViewRow> stack;
+    stack.push_back({&config.root, 0, -1});
+    config.view_rows.clear();
 
     while (!stack.empty())
 	{
-        RenderWork work = stack.back();
+        DarttViewRow work = stack.back();
         stack.pop_back();
 
-        // TreePop marker - just pop and continue
-        if (work.is_tree_pop)
+        int32_t index = (int32_t)config.view_rows.size();
+        config.view_rows.push_back(work);
+
+        DarttField* field = work.field;
+        if (field->expanded && field->lazy)
 		{
-            ImGui::TreePop();
-            continue;
+            built |= materialize_children(*field);
+        }
+        if (field->expanded && !is_leaf_field(*field))
+		{
+            // Push children in reverse order so first child comes first
+            for (size_t i = field->children.size(); i > 0; i--)
+			{
+                stack.push_back({&field->children[i - 1], work.depth + 1, index});
+            }
         }
+    }
 
-        bool is_leaf = work.field->children.empty();
+    count_subscribed_leaves(&config.root);
+    config.view_rows_valid = true;
+    return built;
+}
 
-        // Render this field's row
-        if (render_single_field(work.field, show_display_props))
+// Render the visible rows of the field tree, returns true if any value was edited.
+// Only rows inside the table's scroll region are drawn, so the cost per frame does not
+// grow with the size of the tree. tree_changed is set when lazy arrays were built, so the
+// caller can refresh its leaf list.
+static bool render_field_tree(DarttConfig& config, bool show_display_props, bool show_poll_rates, bool& tree_changed)
+{
+    bool any_edited = false;
+
+    if (!config.view_rows_valid || selector_expand_changed ||
+        config.view_rows.empty() || config.view_rows[0].field != &config.root)
+	{
+        tree_changed |= refresh_view_rows(config);
+        selector_expand_changed = false;
+    }
+
+    ImGuiListClipper clipper;
+    clipper.Begin((int)config.view_rows.size());
+    while (clipper.Step())
+	{
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 		{
-            any_edited = true;
+            DarttField* field = config.view_rows[i].field;
+            if (render_single_field(config, field, i, field->name.c_str(), show_display_props, show_poll_rates, tree_changed))
+			{
+                any_edited = true;
+            }
+        }
+    }
+    clipper.End();
+
+    return any_edited;
+}
+
+// Subscribe or unsubscribe every search match (not just the ranked ones shown).
+// Subscribing builds the arrays the matches sit in.
+static void set_search_matches_subscribed(DarttConfig& config, bool subscribed)
+{
+    const FieldSearchIndex& index = config.search_index;
+    for (size_t i = 0; i < config.search.matches.size(); i++)
+	{
+        const FieldSearchRun& run = config.search.matches[i];
+        for (uint32_t element = run.first; element < run.first + run.count; element++)
+		{
+            FieldSearchHit hit = {run.entry, element};
+            DarttField* leaf = find_leaf(config.root, field_search_offset(index, hit),
+                                         field_search_leaf_name(index, hit), subscribed);
+            if (leaf)
+			{
+                leaf->subscribed = subscribed;
+            }
         }
+    }
+    config.settings_version++;
+}
 
-        // If node is open and has children, queue them
-        if (work.field->expanded && !is_leaf)
+// Render the ranked search results as table rows, labelled with their full paths.
+// Matches inside arrays that have not been built yet get a placeholder row until subscribed.
+static bool render_search_results(DarttConfig& config, bool show_display_props, bool show_poll_rates, bool& tree_changed)
+{
+    bool any_edited = false;
+    const FieldSearchIndex& index = config.search_index;
+
+    ImGuiListClipper clipper;
+    clipper.Begin((int)config.search.ranked.size());
+    while (clipper.Step())
+	{
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
 		{
-            // Push TreePop marker first (will be processed after children)
-            stack.push_back({NULL, true});
+            FieldSearchHit hit = config.search.ranked[i];
+            std::string path = field_search_path(index, hit);
+            std::string name = field_search_leaf_name(index, hit);
+            uint32_t offset = field_search_offset(index, hit);
+            DarttField* leaf = find_leaf(config.root, offset, name, false);
+            if (leaf)
+			{
+                if (render_single_field(config, leaf, -1, path.c_str(), show_display_props, show_poll_rates, tree_changed))
+				{
+                    any_edited = true;
+                }
+                continue;
+            }
 
-            // Push children in reverse order so first child renders first
-            for (size_t i = work.field->children.size(); i > 0; i--)
+            // Not built yet: nothing to show until it is subscribed
+            ImGui::TableNextRow();
+            ImGui::PushID(path.c_str());
+            ImGui::TableNextColumn();
+            ImGui::TreeNodeEx(path.c_str(), ImGuiTreeNodeFlags_SpanFullWidth | ImGuiTreeNodeFlags_Leaf | ImGuiTreeNodeFlags_NoTreePushOnOpen);
+            ImGui::TableNextColumn();
+            ImGui::TextDisabled("-");
+            ImGui::TableNextColumn();
+            bool sub = false;
+            if (ImGui::Checkbox("##sub", &sub))
+			{
+                leaf = find_leaf(config.root, offset, name, true);
+                if (leaf)
+				{
+                    leaf->subscribed = true;
+                    tree_changed = true;
+                    config.settings_version++;
+                }
+            }
+            if (show_display_props)
 			{
-                stack.push_back({&work.field->children[i - 1], false});
+                ImGui::TableNextColumn();
             }
+            if (show_poll_rates)
+			{
+                ImGui::TableNextColumn();
+            }
+            ImGui::PopID();
         }
     }
+    clipper.End();
 
     return any_edited;
 }
@@ -615,7 +1107,11 @@ static DarttField* render_field_selector_tree(DarttField* root)
 			}
 
 			bool node_open = ImGui::TreeNodeEx(field->name.c_str(), flags);
-			field->expanded = node_open;
+			if (node_open != field->expanded)
+			{
+				field->expanded = node_open;
+				selector_expand_changed = true;
+			}
 
 			if (node_open)
 			{
@@ -629,14 +1125,76 @@ static DarttField* render_field_selector_tree(DarttField* root)
 				}
 			}
 		}
-
-		ImGui::PopID();
+
+		ImGui::PopID();
+	}
+
+	return selected;
+}
+
+// Plot source picker: a search box over the field paths, with the tree below it while
+// the box is empty. Only subscribed leaves can be picked. One search is shared by every
+// source combo, since only one is open at a time.
+static DarttField* render_source_selector(DarttConfig& config)
+{
+	const FieldSearchIndex& search_index = config.search_index;
+	static char query[128] = "";
+	static FieldSearch results;
+
+	if (ImGui::IsWindowAppearing())
+	{
+		ImGui::SetKeyboardFocusHere();
+	}
+	ImGui::SetNextItemWidth(-FLT_MIN);
+	ImGui::InputTextWithHint("##source_search", "Search", query, sizeof(query));
+	field_search_update(search_index, query, results);
+	if (results.query.empty())
+	{
+		return render_field_selector_tree(&config.root);
+	}
+
+	DarttField* selected = nullptr;
+	ImGuiListClipper clipper;
+	clipper.Begin((int)results.ranked.size());
+	while (clipper.Step())
+	{
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+		{
+			FieldSearchHit hit = results.ranked[i];
+			std::string path = field_search_path(search_index, hit);
+			DarttField* leaf = config_field(config, field_id_by_key(config, field_search_offset(search_index, hit),
+			                                                        field_search_leaf_name(search_index, hit), false));
+			ImGui::PushID(path.c_str());
+			if (leaf && leaf->subscribed)
+			{
+				if (ImGui::Selectable(path.c_str(), false))
+				{
+					selected = leaf;
+				}
+			}
+			else
+			{
+				ImGui::TextDisabled("%s", path.c_str());
+			}
+			ImGui::PopID();
+		}
 	}
-
+	clipper.End();
 	return selected;
 }
 
-bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<DarttField*> &subscribed_list)
+// Combo preview for a line source
+static const char* plot_source_label(const plot_source_t& source, BusManager& bus)
+{
+	if (source.kind == SOURCE_SYS_SEC)
+	{
+		return "sys_sec";
+	}
+	DarttField* field = bus.find_field(source);
+	return field ? field->name.c_str() : "None";
+}
+
+bool render_plotting_menu(Plotter &plot, BusManager& bus, DarttConfig& config)
 {
 	ImGui::Begin("Plot Settings");
 
@@ -644,7 +1202,7 @@ bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<Dar
 	if (ImGui::SmallButton("+"))
 	{
 		plot.lines.push_back(Line());
-		plot.lines.back().xsource = &plot.sys_sec;
+		plot.lines.back().xsource = plot_source_t::sys_sec();
 		int color_index = (plot.lines.size() % NUM_COLORS);
 		plot.lines.back().color = template_colors[color_index];
 		//consider automatic "Clear" here - will look more professional (and it's really easy to implement), but does wipe data
@@ -693,9 +1251,9 @@ bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<Dar
 		{
 			line.mode = TIME_MODE;
 			// Default to sys_sec if no X source assigned
-			if (line.xsource == nullptr)
+			if (line.xsource.kind == SOURCE_NONE)
 			{
-				line.xsource = &plot.sys_sec;
+				line.xsource = plot_source_t::sys_sec();
 			}
 		}
 		ImGui::SameLine();
@@ -707,35 +1265,19 @@ bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<Dar
 		// X source combo with tree selector
 		ImGui::Text("X Source:");
 		ImGui::SameLine();
-		const char* x_preview = "None";
-		if (line.xsource == &plot.sys_sec)
-		{
-			x_preview = "sys_sec";
-		}
-		else if (line.xsource != nullptr)
-		{
-			// Find field name by pointer
-			for (size_t i = 0; i < subscribed_list.size(); i++)
-			{
-				if (&subscribed_list[i]->display_value == line.xsource)
-				{
-					x_preview = subscribed_list[i]->name.c_str();
-					break;
-				}
-			}
-		}
+		const char* x_preview = plot_source_label(line.xsource, bus);
 		ImGui::SetNextItemWidth(150.0f);
 		if (ImGui::BeginCombo("##xsrc", x_preview))
 		{
-			if (ImGui::Selectable("sys_sec", line.xsource == &plot.sys_sec))
+			if (ImGui::Selectable("sys_sec", line.xsource.kind == SOURCE_SYS_SEC))
 			{
-				line.xsource = &plot.sys_sec;
+				line.xsource = plot_source_t::sys_sec();
 			}
 			ImGui::Separator();
-			DarttField* selected = render_field_selector_tree(&root);
+			DarttField* selected = render_source_selector(config);
 			if (selected)
 			{
-				line.xsource = &selected->display_value;
+				line.xsource = plot_source_t::of_field(config.instance, register_field(config, selected));
 			}
 			ImGui::EndCombo();
 		}
@@ -757,25 +1299,14 @@ bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<Dar
 		// Y source combo with tree selector
 		ImGui::Text("Y Source:");
 		ImGui::SameLine();
-		const char* y_preview = "None";
-		if (line.ysource != nullptr)
-		{
-			for (size_t i = 0; i < subscribed_list.size(); i++)
-			{
-				if (&subscribed_list[i]->display_value == line.ysource)
-				{
-					y_preview = subscribed_list[i]->name.c_str();
-					break;
-				}
-			}
-		}
+		const char* y_preview = plot_source_label(line.ysource, bus);
 		ImGui::SetNextItemWidth(150.0f);
 		if (ImGui::BeginCombo("##ysrc", y_preview))
 		{
-			DarttField* selected = render_field_selector_tree(&root);
+			DarttField* selected = render_source_selector(config);
 			if (selected)
 			{
-				line.ysource = &selected->display_value;
+				line.ysource = plot_source_t::of_field(config.instance, register_field(config, selected));
 			}
 			ImGui::EndCombo();
 		}
@@ -820,7 +1351,8 @@ bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<Dar
 	return true;
 }
 
-bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::string& config_json_path, Serial & ser, dartt_sync_t & ds)
+bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::string& config_json_path, ConfigAutosave& autosave, Serial & ser, dartt_sync_t & ds,
+                             const std::vector<PlotSourceDevice>& other_devices)
 {
     bool any_edited = false;
 
@@ -930,27 +1462,97 @@ bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::stri
 	ImGui::InputScalar("##dartt_base_offset", ImGuiDataType_U8, &ds.base_offset);
 
     // Show config info
-    ImGui::Text("Symbol: %s", config.symbol.c_str());
-    ImGui::Text("Address: %s (%u bytes)", config.address_str.c_str(), config.nbytes);
+    if (config.symbols.size() > 1)
+	{
+        for (const DarttSymbol& sym : config.symbols)
+		{
+            ImGui::Text("Symbol: %s at %s (%u bytes, DARTT offset %u)", sym.name.c_str(),
+                        sym.address_str.c_str(), sym.nbytes, sym.base_offset);
+        }
+    }
+	else
+	{
+        ImGui::Text("Symbol: %s", config.symbol.c_str());
+        ImGui::Text("Address: %s (%u bytes)", config.address_str.c_str(), config.nbytes);
+    }
     bool save_clicked = ImGui::Button("Save");
 	if(save_clicked)
 	{
-		save_dartt_config(config_json_path.c_str(), config, plot, ser, ds);
+		elf_parser_wait_json();	//the sidecar from an ELF drop may still be being written
+		config_save_async(config_json_path.c_str(), config, plot, get_serial_settings(ser, ds), &other_devices);
+	}
+	// The same settings in the other format, next to the current file (motor.json <-> motor.dcfg)
+	ImGui::SameLine();
+	bool binary_config = is_binary_config_path(config_json_path.c_str());
+	if (ImGui::Button(binary_config ? "Export .json" : "Export .dcfg") && !config_json_path.empty())
+	{
+		std::string export_path = config_json_path;
+		size_t dot = export_path.find_last_of('.');
+		size_t slash = export_path.find_last_of("/\\");
+		if (dot != std::string::npos && (slash == std::string::npos || dot > slash))
+		{
+			export_path.erase(dot);
+		}
+		export_path += binary_config ? ".json" : DARTT_CONFIG_BINARY_EXT;
+		elf_parser_wait_json();
+		config_save_async(export_path.c_str(), config, plot, get_serial_settings(ser, ds), &other_devices);
+	}
+	// Saves again a moment after the UI settings or plot lines stop changing
+	ImGui::SameLine();
+	ImGui::Checkbox("Autosave", &autosave.enabled);
+	if (config_save_busy())
+	{
+		ImGui::SameLine();
+		ImGui::TextDisabled("Saving...");
 	}
 
 	ImGui::SameLine();
 	static bool show_display_props = false;
 	ImGui::Checkbox("Display Properties", &show_display_props);
+	ImGui::SameLine();
+	static bool show_poll_rates = false;
+	ImGui::Checkbox("Poll Rates", &show_poll_rates);
 
 	ImGui::Separator();
 
+	// Search box: while it holds a query the table lists the best matching paths instead of the tree
+	static char search_buf[128] = "";
+	ImGui::SetNextItemWidth(-FLT_MIN);
+	ImGui::InputTextWithHint("##field_search", "Search fields (e.g. thing2v1 for thing_array[2].v[1])", search_buf, sizeof(search_buf));
+	field_search_update(config.search_index, search_buf, config.search);
+	bool searching = !config.search.query.empty();
+	bool bulk_changed = false;
+	if (searching)
+	{
+		if (config.search.ranked.size() < config.search.match_count)
+		{
+			ImGui::Text("%zu matches (best %zu shown)", config.search.match_count, config.search.ranked.size());
+		}
+		else
+		{
+			ImGui::Text("%zu matches", config.search.match_count);
+		}
+		ImGui::SameLine();
+		if (ImGui::SmallButton("Subscribe all"))
+		{
+			set_search_matches_subscribed(config, true);
+			bulk_changed = true;
+		}
+		ImGui::SameLine();
+		if (ImGui::SmallButton("Unsubscribe all"))
+		{
+			set_search_matches_subscribed(config, false);
+			bulk_changed = true;
+		}
+	}
+
     // Create table with 4 or 5 columns (Plot column always present)
     ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV
                                 | ImGuiTableFlags_BordersOuterH
                                 | ImGuiTableFlags_Resizable
                                 | ImGuiTableFlags_RowBg
                                 | ImGuiTableFlags_NoBordersInBody;
-	int num_columns = show_display_props ? 4 : 3;
+	int num_columns = 3 + (show_display_props ? 1 : 0) + (show_poll_rates ? 1 : 0);
     if (ImGui::BeginTable("fields_table", num_columns, table_flags))
 	{
         // Setup columns
@@ -961,12 +1563,26 @@ bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::stri
 		{
 			ImGui::TableSetupColumn("Scale", ImGuiTableColumnFlags_WidthFixed, 100.0f);
 		}
+		if (show_poll_rates)
+		{
+			ImGui::TableSetupColumn("Rate (Hz)", ImGuiTableColumnFlags_WidthFixed, 130.0f);
+		}
         ImGui::TableHeadersRow();
 
-        // Render the field tree iteratively
-        if (render_field_tree(&config.root, show_display_props)) {
+        // Render the field tree (or the search results) through a clipper
+        bool tree_changed = bulk_changed;
+        if (searching)
+		{
+            any_edited = render_search_results(config, show_display_props, show_poll_rates, tree_changed);
+        }
+        else if (render_field_tree(config, show_display_props, show_poll_rates, tree_changed)) {
             any_edited = true;
         }
+        if (tree_changed)
+		{
+            refresh_leaf_list(config);
+            config.view_rows_valid = false;
+        }
 
         ImGui::EndTable();
     }
@@ -976,8 +1592,486 @@ bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::stri
     return any_edited;
 }
 
+int render_bus_menu(BusManager& bus)
+{
+	int device_to_remove = -1;
+
+	ImGui::Begin("Bus");
+
+	if (ImGui::SmallButton("+"))
+	{
+		bus.add_device();
+		bus.active = (int)bus.devices.size() - 1;
+	}
+	ImGui::SameLine();
+	ImGui::Text("Add Device");
+	ImGui::SameLine();
+	ImGui::Text("  Read budget (bytes/cycle, 0 = all):");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(60);
+	ImGui::InputScalar("##read_budget", ImGuiDataType_U32, &bus.read_budget_bytes);
+	ImGui::Text("Write budget (bytes/s, 0 = no cap):");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(60);
+	ImGui::InputScalar("##write_budget", ImGuiDataType_U32, &bus.write_budget_bytes_per_s);
+	ImGui::SameLine();
+	ImGui::Checkbox("Verify writes", &bus.verify_writes);
+	ImGui::Separator();
+
+	for (size_t i = 0; i < bus.devices.size(); i++)
+	{
+		BusDevice& dev = *bus.devices[i];
+		ImGui::PushID((int)i);
+
+		char label[32];
+		snprintf(label, sizeof(label), "Addr %u", dev.ds.address);
+		ImGui::RadioButton(label, &bus.active, (int)i);
+		ImGui::SameLine();
+		if (dev.config.symbol.empty())
+		{
+			ImGui::TextDisabled("(no config)");
+		}
+		else
+		{
+			ImGui::Text("%s  %zu sub  %u rd err  %u wr err", dev.config.symbol.c_str(),
+				dev.config.subscribed_list.size(), dev.read_errors, dev.write_errors);
+			ImGui::SameLine();
+			ImGui::TextDisabled("%u wr (%u B)  %u deferred", dev.writes_ok, dev.write_bytes, dev.writes_deferred);
+			if (dev.verify_errors > 0)
+			{
+				ImGui::SameLine();
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "%u verify mismatch", dev.verify_errors);
+			}
+			if (dev.write_failing)
+			{
+				ImGui::SameLine();
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "writes failing (error %d)", dev.last_write_rc);
+			}
+			if (dev.writes_dropped > 0)
+			{
+				ImGui::SameLine();
+				ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "%u edit(s) dropped", dev.writes_dropped);
+			}
+		}
+
+		if (bus.devices.size() > 1)
+		{
+			float minus_width = ImGui::CalcTextSize("-").x + ImGui::GetStyle().FramePadding.x * 2;
+			ImGui::SameLine(ImGui::GetWindowWidth() - minus_width - ImGui::GetStyle().WindowPadding.x);
+			if (ImGui::SmallButton("-"))
+			{
+				device_to_remove = (int)i;
+			}
+		}
+		ImGui::PopID();
+	}
+
+	ImGui::End();
+	return device_to_remove;
+}
+
+/* ===== Watch panel ===== */
+
+// Paths of the subscribed leaves, in tree order. Only the built part of the tree can hold
+// subscribed leaves, so the walk never builds array elements.
+static void refresh_watch_rows(DarttConfig& config)
+{
+	config.watch_rows.clear();
+	struct Item
+	{
+		DarttField* field;
+		std::string path;
+	};
+	std::vector<Item> stack;
+	if (is_leaf_field(config.root))
+	{
+		stack.push_back({&config.root, config.root.name});
+	}
+	else
+	{
+		for (size_t i = config.root.children.size(); i > 0; i--)
+		{
+			stack.push_back({&config.root.children[i - 1], config.root.children[i - 1].name});
+		}
+	}
+	while (!stack.empty())
+	{
+		Item item = std::move(stack.back());
+		stack.pop_back();
+		DarttField* f = item.field;
+		if (is_leaf_field(*f))
+		{
+			if (f->subscribed && f->id != DARTT_FIELD_NONE)
+			{
+				config.watch_rows.push_back({f->id, std::move(item.path)});
+			}
+			continue;
+		}
+		for (size_t i = f->children.size(); i > 0; i--)
+		{
+			stack.push_back({&f->children[i - 1], field_child_path(item.path, f->children[i - 1].name)});
+		}
+	}
+}
+
+struct WatchItem
+{
+	BusDevice* dev;
+	const DarttWatchRow* row;
+	DarttField* field;
+};
+
+void render_watch_panel(BusManager& bus)
+{
+	ImGui::Begin("Watch");
+
+	static bool stalest_first = false;
+	ImGui::Checkbox("Stalest first", &stalest_first);
+	ImGui::SameLine();
+	ImGui::TextDisabled("Statistics over the last %u s", (unsigned)(FIELD_STATS_WINDOW_US / 1000000ull));
+
+	std::vector<WatchItem> items;
+	for (size_t d = 0; d < bus.devices.size(); d++)
+	{
+		BusDevice& dev = *bus.devices[d];
+		DarttConfig& config = dev.config;
+		uint64_t key = ((uint64_t)config.settings_version << 32) ^
+		               ((uint64_t)config.subscribed_list.size() << 8) ^ (uint64_t)config.fields.size();
+		if (key != config.watch_rows_key)
+		{
+			refresh_watch_rows(config);
+			config.watch_rows_key = key;
+		}
+		for (const DarttWatchRow& row : config.watch_rows)
+		{
+			DarttField* field = config_field(config, row.id);
+			if (field && field->subscribed)
+			{
+				items.push_back({&dev, &row, field});
+			}
+		}
+	}
+	if (stalest_first)
+	{
+		//never-read leaves (last_change_us 0) come first, as the stalest of all
+		std::stable_sort(items.begin(), items.end(), [](const WatchItem& a, const WatchItem& b) {
+			return a.field->stats.last_change_us < b.field->stats.last_change_us;
+		});
+	}
+
+	ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV
+	                            | ImGuiTableFlags_BordersOuterH
+	                            | ImGuiTableFlags_Resizable
+	                            | ImGuiTableFlags_RowBg
+	                            | ImGuiTableFlags_ScrollY;
+	if (ImGui::BeginTable("watch_table", 8, table_flags))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn("Value", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableSetupColumn("Min", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableSetupColumn("Max", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableSetupColumn("Mean", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableSetupColumn("Std dev", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableSetupColumn("Rate", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+		ImGui::TableSetupColumn("Unchanged", ImGuiTableColumnFlags_WidthFixed, 80.0f);
+		ImGui::TableHeadersRow();
+
+		uint64_t now_us = transport_now_us();
+		uint64_t now_ms = SDL_GetTicks64();
+		bool several = bus.devices.size() > 1;
+		ImGuiListClipper clipper;
+		clipper.Begin((int)items.size());
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const WatchItem& item = items[i];
+				const DarttField& field = *item.field;
+				ImGui::TableNextRow();
+
+				ImGui::TableNextColumn();
+				if (several)
+				{
+					ImGui::TextDisabled("%u", item.dev->ds.address);
+					ImGui::SameLine();
+				}
+				ImGui::TextUnformatted(item.row->path.c_str());
+
+				ImGui::TableNextColumn();
+				highlight_changed_cell(field, now_ms);
+				double value = field_numeric_value(field) * (field.use_display_scale ? field.display_scale : 1.0f);
+				ImGui::Text("%g", value);
+
+				FieldStatsSummary st = {};
+				bool have = scaled_stats(field, now_us, st);
+				double cells[4] = { st.min, st.max, st.mean, st.stddev };
+				for (int c = 0; c < 4; c++)
+				{
+					ImGui::TableNextColumn();
+					if (have)
+					{
+						ImGui::Text("%g", cells[c]);
+					}
+					else
+					{
+						ImGui::TextDisabled("-");
+					}
+				}
+
+				ImGui::TableNextColumn();
+				ImGui::Text("%.1f", have ? field.achieved_hz : 0.0f);
+
+				// A value that has not moved for a whole window while being read is likely stuck
+				ImGui::TableNextColumn();
+				if (field.stats.last_change_us == 0)
+				{
+					ImGui::TextDisabled("never read");
+				}
+				else
+				{
+					uint64_t unchanged_us = now_us - field.stats.last_change_us;
+					char age[32];
+					format_age(age, sizeof(age), unchanged_us);
+					if (have && unchanged_us >= FIELD_STATS_WINDOW_US)
+					{
+						ImGui::TextColored(ImVec4(1.0f, 0.4f, 0.3f, 1.0f), "%s", age);
+					}
+					else
+					{
+						ImGui::TextUnformatted(age);
+					}
+				}
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
+
+/* ===== Snapshots ===== */
+
+// The last diff shown, and what it was taken between
+struct SnapshotView
+{
+	const BusDevice* dev;
+	uint32_t instance;                  // config it was diffed with
+	int a;                              // snapshot index
+	int b;                              // snapshot index, or -1 for the live device
+	bool valid;
+	std::vector<SnapshotChange> changes;
+};
+
+static const char* snapshot_label(const BusDevice& dev, int i)
+{
+	return i < 0 ? "Live device" : dev.snapshots[i].name.c_str();
+}
+
+void render_snapshot_panel(BusManager& bus)
+{
+	ImGui::Begin("Snapshots");
+
+	BusDevice& dev = bus.active_device();
+	static SnapshotView view = { nullptr, 0, 0, -1, false, {} };
+	if (view.dev != &dev || view.instance != dev.config.instance)
+	{
+		view.dev = &dev;
+		view.instance = dev.config.instance;
+		view.a = 0;
+		view.b = -1;
+		view.valid = false;
+	}
+
+	static char name_buf[64] = "";
+	ImGui::SetNextItemWidth(200);
+	ImGui::InputTextWithHint("##snapshot_name", "Name", name_buf, sizeof(name_buf));
+	ImGui::SameLine();
+	ImGui::BeginDisabled(!dev.config.periph_buf.buf);
+	if (ImGui::Button("Take snapshot"))
+	{
+		DarttSnapshot snap;
+		char fallback[32];
+		snprintf(fallback, sizeof(fallback), "Snapshot %zu", dev.snapshots.size() + 1);
+		if (bus.take_snapshot(dev, name_buf[0] ? name_buf : fallback, snap))
+		{
+			dev.snapshots.push_back(std::move(snap));
+			name_buf[0] = '\0';
+		}
+	}
+	ImGui::EndDisabled();
+
+	// Taken snapshots; one from another layout can be kept but not compared or restored
+	int to_delete = -1;
+	for (size_t i = 0; i < dev.snapshots.size(); i++)
+	{
+		const DarttSnapshot& snap = dev.snapshots[i];
+		ImGui::PushID((int)i);
+		char when[32];
+		std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", std::localtime(&snap.taken));
+		if (snapshot_matches(snap, dev.config))
+		{
+			ImGui::Text("%s", snap.name.c_str());
+		}
+		else
+		{
+			ImGui::TextDisabled("%s (other layout)", snap.name.c_str());
+		}
+		ImGui::SameLine();
+		ImGui::TextDisabled("%s, %zu bytes", when, snap.bytes.size());
+		ImGui::SameLine();
+		if (ImGui::SmallButton("Delete"))
+		{
+			to_delete = (int)i;
+		}
+		ImGui::PopID();
+	}
+	if (to_delete >= 0)
+	{
+		dev.snapshots.erase(dev.snapshots.begin() + to_delete);
+		view.a = 0;
+		view.b = -1;
+		view.valid = false;
+	}
+	if (dev.snapshots.empty())
+	{
+		ImGui::TextDisabled("No snapshots of this device yet");
+		ImGui::End();
+		return;
+	}
+
+	ImGui::Separator();
+	int count = (int)dev.snapshots.size();
+	view.a = std::min(view.a, count - 1);
+	view.b = std::min(view.b, count - 1);
+	ImGui::SetNextItemWidth(160);
+	if (ImGui::BeginCombo("##diff_a", snapshot_label(dev, view.a)))
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (ImGui::Selectable(snapshot_label(dev, i), view.a == i))
+			{
+				view.a = i;
+				view.valid = false;
+			}
+		}
+		ImGui::EndCombo();
+	}
+	ImGui::SameLine();
+	ImGui::Text("vs");
+	ImGui::SameLine();
+	ImGui::SetNextItemWidth(160);
+	if (ImGui::BeginCombo("##diff_b", snapshot_label(dev, view.b)))
+	{
+		for (int i = -1; i < count; i++)
+		{
+			if (ImGui::Selectable(snapshot_label(dev, i), view.b == i))
+			{
+				view.b = i;
+				view.valid = false;
+			}
+		}
+		ImGui::EndCombo();
+	}
+	ImGui::SameLine();
+	const DarttSnapshot& snap_a = dev.snapshots[view.a];
+	bool comparable = snapshot_matches(snap_a, dev.config) &&
+		(view.b < 0 || snapshot_matches(dev.snapshots[view.b], dev.config));
+	ImGui::BeginDisabled(!comparable);
+	if (ImGui::Button("Compare"))
+	{
+		// Against the device: read it all now, the subscribed parts are not enough
+		bool have_b = view.b >= 0 || bus.read_all(dev);
+		if (have_b)
+		{
+			const uint8_t* b = view.b >= 0 ? dev.snapshots[view.b].bytes.data() : dev.config.periph_buf.buf;
+			diff_blobs(dev.config, snap_a.bytes.data(), b, view.changes);
+			view.valid = true;
+		}
+	}
+	ImGui::EndDisabled();
+	if (!view.valid)
+	{
+		ImGui::End();
+		return;
+	}
+
+	size_t selected = 0;
+	for (const SnapshotChange& c : view.changes)
+	{
+		selected += c.selected ? 1 : 0;
+	}
+	ImGui::Text("%zu field(s) differ", view.changes.size());
+	ImGui::SameLine();
+	if (ImGui::SmallButton("All"))
+	{
+		for (SnapshotChange& c : view.changes)
+		{
+			c.selected = true;
+		}
+	}
+	ImGui::SameLine();
+	if (ImGui::SmallButton("None"))
+	{
+		for (SnapshotChange& c : view.changes)
+		{
+			c.selected = false;
+		}
+	}
+	ImGui::SameLine();
+	char restore_label[96];
+	snprintf(restore_label, sizeof(restore_label), "Restore %zu from %s", selected, snap_a.name.c_str());
+	ImGui::BeginDisabled(selected == 0);
+	if (ImGui::Button(restore_label))
+	{
+		bus.restore_snapshot(dev, snap_a, view.changes, nullptr);     // reports to the terminal
+		view.valid = false;     // the device changed; compare again to see what is left
+	}
+	ImGui::EndDisabled();
+
+	ImGuiTableFlags table_flags = ImGuiTableFlags_BordersV
+	                            | ImGuiTableFlags_BordersOuterH
+	                            | ImGuiTableFlags_Resizable
+	                            | ImGuiTableFlags_RowBg
+	                            | ImGuiTableFlags_ScrollY;
+	if (view.valid && ImGui::BeginTable("snapshot_diff", 4, table_flags))
+	{
+		ImGui::TableSetupScrollFreeze(0, 1);
+		ImGui::TableSetupColumn("", ImGuiTableColumnFlags_WidthFixed, 24.0f);
+		ImGui::TableSetupColumn("Name", ImGuiTableColumnFlags_WidthStretch);
+		ImGui::TableSetupColumn(snapshot_label(dev, view.a), ImGuiTableColumnFlags_WidthFixed, 120.0f);
+		ImGui::TableSetupColumn(snapshot_label(dev, view.b), ImGuiTableColumnFlags_WidthFixed, 120.0f);
+		ImGui::TableHeadersRow();
+
+		ImGuiListClipper clipper;
+		clipper.Begin((int)view.changes.size());
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				SnapshotChange& c = view.changes[i];
+				ImGui::PushID(i);
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Checkbox("##restore", &c.selected);
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(c.path.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(c.before.c_str());
+				ImGui::TableNextColumn();
+				ImGui::TextUnformatted(c.after.c_str());
+				ImGui::PopID();
+			}
+		}
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
+
 bool render_elf_load_popup(bool* show, const std::string& elf_path,
                            char* var_name_buf, size_t buf_size,
+                           const std::vector<std::string>& completions,
                            std::string& error_msg)
 {
     bool load_requested = false;
@@ -1000,7 +2094,7 @@ bool render_elf_load_popup(bool* show, const std::string& elf_path,
 
         ImGui::Separator();
 
-        ImGui::Text("Variable name:");
+        ImGui::Text("Variable name (several separated by commas):");
         ImGui::SetNextItemWidth(-FLT_MIN);
         bool enter_pressed = ImGui::InputText("##varname", var_name_buf, buf_size,
                                                ImGuiInputTextFlags_EnterReturnsTrue);
@@ -1011,6 +2105,22 @@ bool render_elf_load_popup(bool* show, const std::string& elf_path,
             ImGui::SetKeyboardFocusHere(-1);
         }
 
+        // Matching variable names from the ELF's name index; click to fill in the name being typed
+        const char* last_name = elf_symbol_list_last(var_name_buf);
+        if (!completions.empty() && !(completions.size() == 1 && completions[0] == last_name))
+        {
+            ImGui::BeginChild("##completions", ImVec2(-FLT_MIN, ImGui::GetTextLineHeightWithSpacing() * 6), true);
+            for (size_t i = 0; i < completions.size(); i++)
+            {
+                if (ImGui::Selectable(completions[i].c_str()))
+                {
+                    size_t keep = (size_t)(last_name - var_name_buf);
+                    snprintf(var_name_buf + keep, buf_size - keep, "%s", completions[i].c_str());
+                }
+            }
+            ImGui::EndChild();
+        }
+
         // Error message
         if (!error_msg.empty())
         {
@@ -5,6 +5,8 @@
 #include "config.h"
 #include "plotting.h"
 #include "serial.h"
+#include "bus_manager.h"
+#include "config_save.h"
 
 // Initialize ImGui (call after SDL/OpenGL setup)
 bool init_imgui(SDL_Window* window, SDL_GLContext gl_context);
@@ -12,28 +14,48 @@ bool init_imgui(SDL_Window* window, SDL_GLContext gl_context);
 // Shutdown ImGui
 void shutdown_imgui();
 
-// Render the live expressions panel
+// Render the live expressions panel. Save and Export write in the background (config_save.h);
+// autosave is the device's autosave state, for its checkbox, and other_devices the rest of
+// the bus, so saved plot lines keep sources on other devices.
 // Returns true if any value was edited (triggers write)
-bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::string& config_json_path, Serial & ser, dartt_sync_t & ds);
+bool render_live_expressions(DarttConfig& config, Plotter& plot, const std::string& config_json_path, ConfigAutosave& autosave, Serial & ser, dartt_sync_t & ds,
+                             const std::vector<PlotSourceDevice>& other_devices);
 
-// Render the plot settings menu with tree selectors for X/Y sources
-bool render_plotting_menu(Plotter &plot, DarttField& root, const std::vector<DarttField*> &subscribed_list);
+// Render the bus device list. Selecting a device makes it the active one in Live Expressions.
+// Returns the index of a device the user asked to remove, or -1.
+int render_bus_menu(BusManager& bus);
 
-// Helper: set subscribed state on field and all children (iterative)
-void set_subscribed_all(DarttField* root, bool subscribed);
+// Render the Watch panel: every subscribed leaf on the bus with its value, min/max/mean/stddev
+// over the statistics window, read rate and how long the value has been unchanged.
+void render_watch_panel(BusManager& bus);
 
-// Helper: check if any child is subscribed (for mixed state display)
-bool any_child_subscribed(const DarttField* root);
+// Render the Snapshots window for the active device: take named snapshots of its whole blob,
+// compare two of them or one against the device, and restore the selected differences.
+void render_snapshot_panel(BusManager& bus);
 
-// Helper: check if all children are subscribed
-bool all_children_subscribed(const DarttField* root);
+// Render the plot settings menu with searchable tree selectors for X/Y sources. Sources are
+// picked from config (the active device); lines may show fields of any device on bus.
+bool render_plotting_menu(Plotter &plot, BusManager& bus, DarttConfig& config);
+
+// Helper: set subscribed state on field and all children (iterative). Subscribing builds
+// lazy arrays' elements; returns true if it did, so the leaf list needs refreshing.
+bool set_subscribed_all(DarttField* root, bool subscribed);
+
+// Helper: set the poll rate target on field and all children (iterative)
+void set_poll_rate_all(DarttField* root, float rate_hz);
+
+// Helper: recompute leaf_count and subscribed_count on field and every node below it (iterative).
+// Unbuilt arrays count as one leaf.
+void count_subscribed_leaves(DarttField* root);
 
 void calculate_display_values(const std::vector<DarttField*> &leaf_list);
 
 // Render the ELF file load popup (modal).
 // Call every frame when *show is true. Returns true when user clicks "Load".
+// completions: variable names matching the current input, listed under the text box.
 bool render_elf_load_popup(bool* show, const std::string& elf_path,
                            char* var_name_buf, size_t buf_size,
+                           const std::vector<std::string>& completions,
                            std::string& error_msg);
 
 #endif // DARTT_UI_H
@@ -0,0 +1,870 @@
+/*
+ * unit_tests.cpp - checks for the parts of the dashboard that need no device or window
+ *
+ * One function per area, each a list of CHECKs. A failed check prints its line; the exit
+ * status is the number of failures.
+ *
+ * Usage:
+ *   cmake --build . --target dartt_unit_tests && ctest    (from the build directory)
+ */
+
+/* config.cpp links the transport, whose socket layer is implemented in main.cpp for the app */
+#define TINYCSOCKET_IMPLEMENTATION
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <windows.h>
+#endif
+#include "tinycsocket.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "cobs_scanner.h"
+#include "buffer_sync.h"
+#include "config_binary.h"
+#include "config_stream.h"
+#include "dartt_init.h"
+#include "snapshot.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static int decode(std::vector<uint8_t> frame, std::vector<uint8_t>& out) {
+    int n = cobs_decode_in_place(frame.data(), frame.size());
+    out.assign(frame.begin(), frame.begin() + (n > 0 ? n : 0));
+    return n;
+}
+
+static void test_cobs_decode() {
+    std::vector<uint8_t> out;
+
+    /* a run of zeros is a run of 0x01 codes */
+    CHECK(decode({0x02, 0x11, 0x01, 0x02, 0x22}, out) == 4);
+    CHECK((out == std::vector<uint8_t>{0x11, 0x00, 0x00, 0x22}));
+    CHECK(decode({0x01, 0x01}, out) == 1);
+    CHECK((out == std::vector<uint8_t>{0x00}));
+    CHECK(decode({0x01, 0x01, 0x01}, out) == 2);
+    CHECK((out == std::vector<uint8_t>{0x00, 0x00}));
+
+    /* 0xFF carries 254 bytes and no implied zero */
+    std::vector<uint8_t> full(255, 0x5A);
+    full[0] = 0xFF;
+    CHECK(decode(full, out) == 254);
+    CHECK(out == std::vector<uint8_t>(254, 0x5A));
+
+    /* a group running past the end of the frame, or a zero inside it */
+    CHECK(decode({0x05, 0x11, 0x22}, out) == -1);
+    CHECK(decode({0x02, 0x11, 0x00, 0x22}, out) == -1);
+    CHECK(decode({0xFF, 0x11}, out) == -1);
+}
+
+static void test_cobs_scanner_overflow() {
+    CobsScanner s;
+    s.init(16);
+    size_t space = 0;
+    uint8_t* w = s.write_ptr(&space);
+    CHECK(space == 16);
+
+    /* "A" and "BC" complete, then a frame cut off by the end of the buffer */
+    const uint8_t packet[16] = {2, 'A', 0, 3, 'B', 'C', 0, 10, 1, 1, 1, 1, 1, 1, 1, 1};
+    std::memcpy(w, packet, sizeof(packet));
+    s.commit(sizeof(packet));
+    s.end_of_packet();
+    CHECK(s.overflows == 1);
+
+    uint8_t* frame = nullptr;
+    size_t len = 0;
+    CHECK(s.next_frame(&frame, &len) && len == 1 && frame[0] == 'A');
+    CHECK(s.next_frame(&frame, &len) && len == 2 && std::memcmp(frame, "BC", 2) == 0);
+    CHECK(!s.next_frame(&frame, &len));
+
+    /* the dropped tail does not run into the next packet */
+    w = s.write_ptr(&space);
+    const uint8_t next[3] = {2, 'Z', 0};
+    std::memcpy(w, next, sizeof(next));
+    s.commit(sizeof(next));
+    CHECK(s.next_frame(&frame, &len) && len == 1 && frame[0] == 'Z');
+    CHECK(s.bad_frames == 0);
+
+    /* a whole packet with no delimiter in it is dropped alone */
+    s.reset();
+    w = s.write_ptr(&space);
+    std::memset(w, 1, space);
+    s.commit(space);
+    s.end_of_packet();
+    CHECK(s.overflows == 2);
+    CHECK(!s.next_frame(&frame, &len));
+}
+
+static void test_diff_chunks_tail() {
+    /* 13 bytes: one whole chunk and a 5-byte tail; the byte past the end must not count */
+    uint8_t a[16] = {0};
+    uint8_t b[16] = {0};
+    std::vector<uint64_t> changed;
+    b[13] = 1;
+    CHECK(!diff_chunks(a, b, 13, changed));
+    CHECK(changed.size() == 1 && changed[0] == 0);
+
+    b[12] = 1;
+    CHECK(diff_chunks(a, b, 13, changed));
+    CHECK(changed[0] == 0x2);
+    CHECK(chunks_changed(changed, 12, 1));
+    CHECK(chunks_changed(changed, 4, 5));
+    CHECK(!chunks_changed(changed, 0, 8));
+    CHECK(!chunks_changed(changed, 12, 0));
+
+    /* 37 bytes: a block of four whole chunks, then a 5-byte tail chunk */
+    uint8_t c[40] = {0};
+    uint8_t d[40] = {0};
+    d[3] = 7;
+    d[36] = 7;
+    CHECK(diff_chunks(c, d, 37, changed));
+    CHECK(changed[0] == ((1ull << 0) | (1ull << 4)));
+    CHECK(!chunks_changed(changed, 8, 24));
+    CHECK(chunks_changed(changed, 32, 5));
+}
+
+static DarttField make_leaf(const char* name, uint32_t byte_offset, uint32_t nbytes, FieldType type) {
+    DarttField f;
+    f.name = name;
+    f.byte_offset = byte_offset;
+    f.dartt_offset = byte_offset / 4;
+    f.nbytes = nbytes;
+    f.type = type;
+    return f;
+}
+
+static void test_child_paths() {
+    CHECK(field_child_path("", "motor") == "motor");
+    CHECK(field_child_path("motor", "pid") == "motor.pid");
+    CHECK(field_child_path("motor.pid", "[2]") == "motor.pid[2]");
+    CHECK(field_child_path("", "[0]") == "[0]");
+}
+
+static void test_restore_regions() {
+    /* a 30-byte blob, so the last word is cut short */
+    DarttConfig config;
+    config.nbytes = 30;
+    config.root.name = "root";
+    config.root.nbytes = 30;
+    config.root.children.push_back(make_leaf("a", 0, 4, FieldType::UINT32));    /* word 0 */
+    config.root.children.push_back(make_leaf("b", 12, 4, FieldType::UINT32));   /* word 3, two words after a */
+    config.root.children.push_back(make_leaf("d", 24, 4, FieldType::UINT32));   /* word 6, not selected */
+    config.root.children.push_back(make_leaf("c", 28, 2, FieldType::UINT16));   /* word 7, the short one */
+    refresh_leaf_list(config);
+    CHECK(config.leaf_list.size() == 4);
+
+    std::vector<uint8_t> live(30, 0);
+    DarttSnapshot snap;
+    snap.bytes.assign(30, 0);
+    snap.bytes[1] = 0x11;
+    snap.bytes[14] = 0x22;
+    snap.bytes[25] = 0x33;
+    snap.bytes[29] = 0x44;
+
+    std::vector<SnapshotChange> changes;
+    for (DarttField* leaf : config.leaf_list) {
+        SnapshotChange c;
+        c.id = leaf->id;
+        c.path = leaf->name;
+        c.selected = leaf->name != "d";
+        changes.push_back(c);
+    }
+
+    std::vector<uint8_t> image;
+    std::vector<MemoryRegion> regions = build_restore_regions(config, snap, changes, live.data(), image);
+    CHECK(image.size() == 30);
+    CHECK(image[1] == 0x11 && image[14] == 0x22 && image[25] == 0 && image[29] == 0x44);
+    CHECK(regions.size() == 2);
+    if (regions.size() == 2) {
+        CHECK(regions[0].start_offset == 0 && regions[0].length == 16);     /* a and b across the gap */
+        CHECK(regions[1].start_offset == 28 && regions[1].length == 2);     /* clipped to the blob */
+    }
+
+    /* with d selected too, every gap is short enough to bridge */
+    changes[2].selected = true;
+    regions = build_restore_regions(config, snap, changes, live.data(), image);
+    CHECK(regions.size() == 1);
+    if (regions.size() == 1) {
+        CHECK(regions[0].start_offset == 0 && regions[0].length == 30);
+    }
+
+    /* nothing selected, nothing written */
+    for (SnapshotChange& c : changes) {
+        c.selected = false;
+    }
+    CHECK(build_restore_regions(config, snap, changes, live.data(), image).empty());
+}
+
+static void test_bitfields() {
+    DarttConfig config;
+    config.nbytes = 8;
+    CHECK(config.allocate_buffers());
+
+    /* 7 bits from bit 13 span bytes 1 and 2, shift 5 */
+    DarttField u;
+    u.name = "u";
+    u.type = FieldType::UINT8;
+    CHECK(set_bitfield_layout(u, 13, 7));
+    CHECK(u.byte_offset == 1 && u.nbytes == 2 && u.bit_shift == 5 && u.bit_mask == (0x7Full << 5));
+
+    /* 5 signed bits from bit 0 */
+    DarttField s;
+    s.name = "s";
+    s.type = FieldType::INT8;
+    CHECK(set_bitfield_layout(s, 0, 5));
+
+    /* 64 bits from bit 4 cannot fit in 8 bytes */
+    DarttField wide;
+    CHECK(!set_bitfield_layout(wide, 4, 64));
+    CHECK(wide.bit_size == 0);
+
+    /* writes keep the neighbouring bits */
+    std::memset(config.ctl_buf.buf, 0xFF, config.ctl_buf.size);
+    MemoryRegion region;
+    region.start_offset = 0;
+    region.length = 4;
+    region.fields = {&u, &s};
+    u.value.u64 = 0x55;
+    s.value.i64 = -6;
+    CHECK(sync_fields_to_ctl_buf(config, region));
+    CHECK(config.ctl_buf.buf[0] == 0xFA);       /* bits 0-4 = -6 & 0x1F, bits 5-7 untouched */
+    CHECK(config.ctl_buf.buf[1] == 0xBF);       /* bits 13-15 = 0b101 */
+    CHECK(config.ctl_buf.buf[2] == 0xFA);       /* bits 16-19 = 0b1010, bits 20-23 untouched */
+    CHECK(config.ctl_buf.buf[3] == 0xFF);
+
+    /* and read back as written, sign-extended */
+    DarttField ru = u;
+    DarttField rs = s;
+    ru.value.u64 = 0;
+    rs.value.u64 = 0;
+    decode_field_value(ru, config.ctl_buf.buf);
+    decode_field_value(rs, config.ctl_buf.buf);
+    CHECK(ru.value.u64 == 0x55);
+    CHECK(rs.value.i64 == -6 && rs.value.i8 == -6);
+
+    std::memcpy(config.periph_buf.buf, config.ctl_buf.buf, config.periph_buf.size);
+    ru.value.u64 = 0;
+    rs.value.u64 = 0;
+    MemoryRegion readback = region;
+    readback.fields = {&ru, &rs};
+    CHECK(sync_periph_buf_to_fields(config, readback));
+    CHECK(ru.value.u64 == 0x55);
+    CHECK(rs.value.i64 == -6);
+
+    /* copying one field between blobs leaves the other field's bits alone */
+    uint8_t dst[8] = {0};
+    copy_leaf_bytes(u, config.ctl_buf.buf, dst);
+    CHECK(dst[0] == 0 && dst[1] == 0xA0 && dst[2] == 0x0A);
+    CHECK(leaf_bytes_differ(s, config.ctl_buf.buf, dst));
+    CHECK(!leaf_bytes_differ(u, config.ctl_buf.buf, dst));
+}
+
+static void test_write_retry() {
+    DarttField f = make_leaf("f", 0, 4, FieldType::UINT32);
+    f.dirty = true;
+    MemoryRegion region = {0, 4, {&f}};
+    std::vector<DarttField*> leaves = {&f};
+    std::vector<DarttField*> dirty;
+
+    /* each failure doubles the wait before the field is collected again */
+    uint64_t now = 1000000;
+    CHECK(note_write_failure(region, now) == 0);
+    CHECK(f.dirty && f.write_failures == 1 && f.next_write_us == now + WRITE_RETRY_BACKOFF_US);
+    collect_dirty_fields(leaves, dirty, now + WRITE_RETRY_BACKOFF_US - 1);
+    CHECK(dirty.empty());
+    collect_dirty_fields(leaves, dirty, now + WRITE_RETRY_BACKOFF_US);
+    CHECK(dirty.size() == 1);
+    CHECK(note_write_failure(region, now) == 0);
+    CHECK(f.next_write_us == now + 2 * WRITE_RETRY_BACKOFF_US);
+
+    /* the last try drops the edit, and a later success clears the mark */
+    for (int i = 2; i < WRITE_RETRY_LIMIT - 1; i++) {
+        CHECK(note_write_failure(region, now) == 0);
+    }
+    CHECK(note_write_failure(region, now) == 1);
+    CHECK(!f.dirty && f.write_failed && f.write_failures == 0);
+    collect_dirty_fields(leaves, dirty, now);
+    CHECK(dirty.empty());
+
+    f.dirty = true;
+    clear_dirty_flags(region);
+    CHECK(!f.dirty && !f.write_failed && f.next_write_us == 0);
+}
+
+static bool parse(const std::string& text, StreamedConfig& out, std::string* error = nullptr) {
+    out = StreamedConfig();
+    return stream_dartt_config(text.data(), text.size(), out, error);
+}
+
+/* "serial_settings" comes back as JSON, so it shows exactly what the scanner read */
+static bool parse_value(const std::string& value, nlohmann::json& out) {
+    StreamedConfig cfg;
+    if (!parse("{\"serial_settings\": {\"v\": " + value + "}}", cfg)) {
+        return false;
+    }
+    out = cfg.extras["serial_settings"]["v"];
+    return true;
+}
+
+static void test_json_scanner() {
+    nlohmann::json v;
+
+    /* escapes, BMP code points and a surrogate pair */
+    CHECK(parse_value(R"("q\"b\\s\/\b\f\n\r\t|\u0041\u00e9\u20AC\ud83d\ude00")", v));
+    CHECK(v == "q\"b\\s/\b\f\n\r\t|A\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80");
+    CHECK(!parse_value(R"("\ud83d")", v));          /* lone high surrogate */
+    CHECK(!parse_value(R"("\ud83d\u0041")", v));    /* high surrogate without a low one */
+    CHECK(!parse_value(R"("\ude00")", v));          /* low surrogate on its own */
+    CHECK(!parse_value(R"("\u12G4")", v));
+    CHECK(!parse_value(R"("\x")", v));
+    CHECK(!parse_value("\"a\nb\"", v));             /* raw control character */
+    CHECK(!parse_value("\"open", v));
+
+    /* integers keep their signedness and full range; anything wider becomes a double */
+    CHECK(parse_value("-42", v) && v.is_number_integer() && v.get<int64_t>() == -42);
+    CHECK(parse_value("-9223372036854775808", v) && v.is_number_integer() && v.get<int64_t>() == INT64_MIN);
+    CHECK(parse_value("18446744073709551615", v) && v.is_number_unsigned() && v.get<uint64_t>() == UINT64_MAX);
+    CHECK(parse_value("18446744073709551616", v) && v.is_number_float() && v.get<double>() == 18446744073709551616.0);
+    CHECK(parse_value("-9223372036854775809", v) && v.is_number_float() && v.get<double>() < -9.2e18);
+    CHECK(parse_value("123456789012345678901234567890", v) && v.is_number_float() &&
+          std::fabs(v.get<double>() / 1.2345678901234568e29 - 1.0) < 1e-15);
+    CHECK(parse_value("-1.5e3", v) && v.get<double>() == -1500.0);
+    CHECK(parse_value("0.25", v) && v.get<double>() == 0.25);
+    CHECK(parse_value("1e400", v) && std::isinf(v.get<double>()) && v.get<double>() > 0);
+    CHECK(parse_value("-1e400", v) && std::isinf(v.get<double>()) && v.get<double>() < 0);
+    CHECK(parse_value("1e-400", v) && v.get<double>() == 0.0);
+    for (const char* bad : {"01", "-", "1.", "1e", "1e+", "+1", ".5", "--1", "0x10", "tru", "nul"}) {
+        CHECK(!parse_value(bad, v));
+    }
+
+    /* the document must be one value, closed, with nothing after it */
+    StreamedConfig cfg;
+    std::string error;
+    CHECK(parse("{}  \n", cfg));
+    CHECK(!parse("", cfg));
+    CHECK(!parse("{} x", cfg, &error));
+    CHECK(error.find("trailing") != std::string::npos);
+    CHECK(!parse("{}{}", cfg));
+    CHECK(!parse("{\"a\": [1, 2", cfg, &error));
+    CHECK(error.find("end of input") != std::string::npos);
+    for (const char* bad : {"{", "[", "{\"a\"", "{\"a\":", "{\"a\": {", "{\"a\":}", "[1,]", "{\"a\":1,}",
+                            "{\"a\": [1}", "[1 2]", "{a: 1}", "{\"a\" 1}"}) {
+        CHECK(!parse(bad, cfg));
+    }
+}
+
+static void test_json_config_tree() {
+    const char* text = R"({
+  "address": "0x20000000",
+  "address_int": 536870912,
+  "generator": {"name": "elf2json", "version": [1, 2]},
+  "nbytes": 20,
+  "symbol": "dev",
+  "type": {
+    "fields": [
+      {"byte_offset": 0, "dartt_offset": 0, "name": "gain",
+       "type_info": {"encoding": "float", "size": 4, "type": "float"}},
+      {"bit_offset": 2, "bit_size": 3, "byte_offset": 4, "dartt_offset": 1, "name": "mode",
+       "type_info": {"size": 1, "type": "uint8_t"}},
+      {"byte_offset": 8, "dartt_offset": 2, "name": "samples",
+       "type_info": {"dimensions": [2, 3], "element_type": {"size": 2, "type": "short int", "typedef": "int16_t"},
+                     "size": 12, "total_elements": 6, "type": "array"}}
+    ],
+    "size": 20,
+    "type": "struct"
+  },
+  "ui_map": {
+    "0:gain": {"display_scale": 2.5, "poll_rate_hz": -1, "subscribed": true, "use_display_scale": true}
+  },
+  "serial_settings": {"baudrate": 921600}
+})";
+    StreamedConfig cfg;
+    std::string error;
+    CHECK(parse(text, cfg, &error));
+    CHECK(cfg.symbols.size() == 1 && cfg.roots.size() == 1);
+    if (cfg.symbols.size() != 1 || cfg.roots.size() != 1) {
+        return;
+    }
+    CHECK(cfg.symbols[0].name == "dev");
+    CHECK(cfg.symbols[0].address == 0x20000000u && cfg.symbols[0].nbytes == 20);
+
+    const DarttField& root = cfg.roots[0];
+    CHECK(root.type == FieldType::STRUCT && root.nbytes == 20);
+    CHECK(root.children.size() == 3);
+    if (root.children.size() == 3) {
+        const DarttField& gain = root.children[0];
+        CHECK(gain.name == "gain" && gain.type == FieldType::FLOAT && gain.nbytes == 4 && gain.byte_offset == 0);
+
+        const DarttField& mode = root.children[1];
+        CHECK(mode.name == "mode" && mode.type == FieldType::UINT8);
+        CHECK(mode.bit_size == 3 && mode.bit_shift == 2 && mode.byte_offset == 4 && mode.nbytes == 1);
+
+        const DarttField& samples = root.children[2];
+        CHECK(samples.name == "samples" && samples.type == FieldType::INT16 && samples.type_name == "int16_t");
+        CHECK(samples.byte_offset == 8 && samples.nbytes == 12);
+        CHECK(samples.array_size == 6 && samples.element_nbytes == 2);
+        CHECK((samples.dims == std::vector<uint32_t>{2, 3}));
+    }
+
+    CHECK(cfg.ui_map.size() == 1);
+    if (cfg.ui_map.size() == 1) {
+        const UiMapEntry& e = cfg.ui_map[0];
+        CHECK(e.byte_offset == 0 && e.name == "gain");
+        CHECK(e.subscribed && e.use_display_scale && e.display_scale == 2.5f && e.poll_rate_hz == -1.0f);
+    }
+    CHECK(cfg.extras["serial_settings"]["baudrate"] == 921600);
+}
+
+/* A generated sidecar, with the keys the loader skips ("encoding", "struct_name", "pointee", ...) */
+static const char* sidecar_json = R"({
+  "address": "0x20000000",
+  "address_int": 536870912,
+  "nbytes": 40,
+  "nwords": 10,
+  "symbol": "dev",
+  "type": {
+    "fields": [
+      {"byte_offset": 0, "dartt_offset": 0, "name": "gain",
+       "type_info": {"encoding": "float", "size": 4, "type": "float"}},
+      {"byte_offset": 4, "dartt_offset": 1, "name": "count",
+       "type_info": {"encoding": "signed", "size": 4, "type": "long int", "typedef": "int32_t"}},
+      {"byte_offset": 8, "dartt_offset": 2, "name": "state",
+       "type_info": {"enum_name": "state_t", "enumerators": [{"name": "IDLE", "value": 0}, {"name": "RUN", "value": 1}],
+                     "size": 1, "type": "enum"}},
+      {"bit_offset": 1, "bit_size": 2, "byte_offset": 9, "dartt_offset": 2, "name": "mode",
+       "type_info": {"encoding": "unsigned", "size": 1, "type": "unsigned char", "typedef": "uint8_t"}},
+      {"byte_offset": 12, "dartt_offset": 3, "name": "name",
+       "type_info": {"pointee": {"const": true, "encoding": "signed_char", "size": 1, "type": "char"},
+                     "size": 4, "type": "pointer"}},
+      {"byte_offset": 16, "dartt_offset": 4, "name": "pid",
+       "type_info": {"dimensions": [2], "element_type": {"fields": [
+                       {"byte_offset": 0, "dartt_offset": 0, "name": "kp", "type_info": {"encoding": "float", "size": 4, "type": "float"}},
+                       {"byte_offset": 4, "dartt_offset": 1, "name": "ki", "type_info": {"encoding": "float", "size": 4, "type": "float"}}],
+                     "size": 8, "struct_name": "pid_t", "type": "struct"},
+                     "total_elements": 2, "type": "array"}},
+      {"byte_offset": 32, "dartt_offset": 8, "name": "samples",
+       "type_info": {"dimensions": [2, 2], "element_type": {"encoding": "signed", "size": 2, "type": "short int", "typedef": "int16_t"},
+                     "total_elements": 4, "type": "array"}}
+    ],
+    "size": 40,
+    "struct_name": "dev_t",
+    "type": "struct",
+    "unaligned": false,
+    "volatile": true
+  },
+  "ui_map": {
+    "0:gain": {"display_scale": 2.5, "poll_rate_hz": -1.0, "subscribed": true, "use_display_scale": true}
+  }
+}
+)";
+
+static std::string temp_path(const char* name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static std::string read_text(const std::string& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+}
+
+/* Load the sidecar from a file and capture its session at the serial port's own baud rate, so nothing reconnects */
+static bool load_sidecar(const std::string& path, DarttConfig& config, Serial& serial, dartt_sync_t& ds,
+                         ConfigSession& session) {
+    Plotter plot;
+    if (!write_file_atomic(path.c_str(), sidecar_json, strlen(sidecar_json)) ||
+        !load_dartt_config(path.c_str(), config, plot, serial, ds)) {
+        return false;
+    }
+    DarttSerialSettings settings;
+    settings.baudrate = serial.get_baud_rate();
+    capture_session(config, plot, settings, session);
+    return true;
+}
+
+static void test_config_round_trip() {
+    std::string json_path = temp_path("dartt_unit_tests.json");
+    std::string dcfg_path = temp_path("dartt_unit_tests.dcfg");
+    Serial serial;
+    dartt_sync_t ds;
+    init_ds(&ds);
+    Plotter plot;
+
+    /* JSON -> .dcfg -> JSON writes the same document */
+    DarttConfig a;
+    ConfigSession session;
+    CHECK(load_sidecar(json_path, a, serial, ds, session));
+    CHECK(a.nbytes == 40 && a.leaf_list.size() > 0);
+    DarttField* count = config_field(a, field_id_by_path(a, "count", true));
+    CHECK(count != nullptr);
+    if (count) {
+        count->subscribed = true;
+        count->poll_rate_hz = 5.0f;
+    }
+    capture_session(a, plot, session.serial, session);
+    CHECK(write_dartt_config_file(dcfg_path.c_str(), a, session));
+
+    DarttConfig b;
+    CHECK(load_dartt_config(dcfg_path.c_str(), b, plot, serial, ds));
+    ConfigSession session_b;
+    capture_session(b, plot, session.serial, session_b);
+    std::string text_a, text_b;
+    write_dartt_config_json(text_a, a, session);
+    write_dartt_config_json(text_b, b, session_b);
+    CHECK(text_a == text_b);
+    DarttField* count_b = config_field(b, field_id_by_path(b, "count", true));
+    CHECK(count_b && count_b->subscribed && count_b->poll_rate_hz == 5.0f);
+
+    /* saving over the sidecar keeps the generator's keys and every byte outside the session */
+    CHECK(write_dartt_config_file(json_path.c_str(), b, session_b));
+    std::string saved = read_text(json_path);
+    std::string original = sidecar_json;
+    for (const char* kept : {"\"encoding\": \"signed\"", "\"struct_name\": \"pid_t\"", "\"pointee\"", "\"const\": true",
+                             "\"unaligned\": false", "\"volatile\": true", "\"long int\"", "\"enum_name\": \"state_t\""}) {
+        CHECK(saved.find(kept) != std::string::npos);
+    }
+    size_t symbol = original.find("\"symbol\"");
+    size_t ui_map = original.find("\"ui_map\"");
+    CHECK(saved.compare(0, symbol, original, 0, symbol) == 0);
+    CHECK(saved.find(original.substr(symbol, ui_map - symbol)) != std::string::npos);
+    CHECK(saved.find("\"4:count\"") != std::string::npos && saved.find("\"serial_settings\"") < saved.find("\"symbol\""));
+
+    DarttConfig c;
+    CHECK(load_dartt_config(json_path.c_str(), c, plot, serial, ds));
+    ConfigSession session_c;
+    capture_session(c, plot, session.serial, session_c);
+    std::string text_c;
+    write_dartt_config_json(text_c, c, session_c);
+    CHECK(text_c == text_a);
+    CHECK(write_dartt_config_file(json_path.c_str(), c, session_c));
+    CHECK(read_text(json_path) == saved);      /* a second save changes nothing */
+
+    /* a file with another layout is not spliced into */
+    std::string other = original;
+    other.replace(other.find("\"kp\""), 4, "\"kd\"");
+    std::string out;
+    CHECK(!splice_dartt_config_json(other, a, session, out));
+    CHECK(!splice_dartt_config_json("{}", a, session, out));
+    CHECK(!splice_dartt_config_json("[1, 2]", a, session, out));
+
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(dcfg_path);
+}
+
+/* Write bytes to path and try to load them as a binary config */
+static bool dcfg_loads(const std::string& path, const std::vector<uint8_t>& bytes, Serial& serial, dartt_sync_t& ds) {
+    Plotter plot;
+    DarttConfig config;
+    return write_file_atomic(path.c_str(), (const char*)bytes.data(), bytes.size()) &&
+           load_dartt_config_binary(path.c_str(), config, plot, serial, ds);
+}
+
+static DcfgNode* dcfg_nodes(std::vector<uint8_t>& bytes) {
+    return (DcfgNode*)(bytes.data() + ((const DcfgHeader*)bytes.data())->sections[DCFG_NODES].offset);
+}
+
+static void test_dcfg_corrupt() {
+    std::string json_path = temp_path("dartt_unit_tests_corrupt.json");
+    std::string path = temp_path("dartt_unit_tests_corrupt.dcfg");
+    Serial serial;
+    dartt_sync_t ds;
+    init_ds(&ds);
+    DarttConfig config;
+    ConfigSession session;
+    CHECK(load_sidecar(json_path, config, serial, ds, session));
+    std::vector<uint8_t> good;
+    encode_dartt_config_binary(config, session, good);
+    CHECK(good.size() > sizeof(DcfgHeader));
+    CHECK(dcfg_loads(path, good, serial, ds));
+
+    const DcfgHeader& h = *(const DcfgHeader*)good.data();
+    uint32_t node_count = h.sections[DCFG_NODES].count;
+    CHECK(node_count > 2 && h.sections[DCFG_ENUMS].count == 1 && h.sections[DCFG_LEAVES].count > 0);
+
+    /* truncated, including with file_size patched to match */
+    for (size_t len : {(size_t)0, (size_t)3, sizeof(DcfgHeader) - 1, good.size() / 2, good.size() - 1}) {
+        std::vector<uint8_t> bad(good.begin(), good.begin() + len);
+        CHECK(!dcfg_loads(path, bad, serial, ds));
+    }
+    std::vector<uint8_t> bad(good.begin(), good.begin() + good.size() / 2);
+    ((DcfgHeader*)bad.data())->file_size = (uint32_t)bad.size();
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+
+    /* header and section table */
+    bad = good;
+    bad[0] = 'X';
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    ((DcfgHeader*)bad.data())->version++;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    ((DcfgHeader*)bad.data())->sections[DCFG_NODES].offset += 4;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    ((DcfgHeader*)bad.data())->sections[DCFG_NODES].count = 0xFFFFFFFFu;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    ((DcfgHeader*)bad.data())->sections[DCFG_STRINGS].offset = (uint32_t)bad.size() + 8;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+
+    /* records pointing outside their tables or the map */
+    bad = good;
+    dcfg_nodes(bad)[1].name.offset = h.sections[DCFG_STRINGS].count;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[1].name.len++;        /* no NUL where the string should end */
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[0].child_count = node_count;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[1].dims_first = h.sections[DCFG_DIMS].count + 1;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[1].type = 0xFF;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[1].enum_ref = 2;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[1].byte_offset = h.nbytes;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    dcfg_nodes(bad)[node_count - 1].nbytes = 0xFFFFFFF0u;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+
+    bad = good;
+    ((uint32_t*)(bad.data() + h.sections[DCFG_LEAVES].offset))[0] = node_count;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+    bad = good;
+    ((DcfgEnum*)(bad.data() + h.sections[DCFG_ENUMS].offset))[0].count = h.sections[DCFG_ENUMERATORS].count + 1;
+    CHECK(!dcfg_loads(path, bad, serial, ds));
+
+    std::filesystem::remove(json_path);
+    std::filesystem::remove(path);
+}
+
+/* Lazy arrays of two dimensions, one of structs holding another array, with two-digit indices */
+static const char* search_json = R"({
+  "address": "0x20000000",
+  "address_int": 536870912,
+  "nbytes": 1500,
+  "nwords": 375,
+  "symbol": "rig",
+  "type": {
+    "fields": [
+      {"byte_offset": 0, "dartt_offset": 0, "name": "gain", "type_info": {"size": 4, "type": "float"}},
+      {"byte_offset": 4, "dartt_offset": 1, "name": "motors",
+       "type_info": {"dimensions": [12, 3], "element_type": {"fields": [
+                       {"byte_offset": 4, "dartt_offset": 1, "name": "kp", "type_info": {"size": 4, "type": "float"}},
+                       {"byte_offset": 8, "dartt_offset": 2, "name": "pos",
+                        "type_info": {"dimensions": [15], "element_type": {"size": 2, "type": "short int", "typedef": "int16_t"},
+                                      "total_elements": 15, "type": "array"}}],
+                     "size": 36, "type": "struct"},
+                     "total_elements": 36, "type": "array"}},
+      {"byte_offset": 1300, "dartt_offset": 325, "name": "samples",
+       "type_info": {"dimensions": [4, 25], "element_type": {"size": 2, "type": "short int", "typedef": "int16_t"},
+                     "total_elements": 100, "type": "array"}}
+    ],
+    "size": 1500,
+    "type": "struct"
+  }
+}
+)";
+
+/* Every leaf the index stands for, with its path written out */
+struct ExpandedLeaf {
+    std::string path;
+    uint32_t name_pos;
+    FieldSearchHit hit;
+};
+
+static std::vector<ExpandedLeaf> expand_search_index(const FieldSearchIndex& index) {
+    std::vector<ExpandedLeaf> out;
+    for (uint32_t i = 0; i < (uint32_t)index.entries.size(); i++) {
+        for (uint32_t element = 0; element < index.entries[i].count; element++) {
+            FieldSearchHit hit = {i, element};
+            std::string path = field_search_path(index, hit);
+            uint32_t name_pos = (uint32_t)(path.size() - field_search_leaf_name(index, hit).size());
+            out.push_back({path, name_pos, hit});
+        }
+    }
+    return out;
+}
+
+#define REFERENCE_NO_MATCH INT32_MIN
+
+/* The scorer from before patterns, run on each written-out path */
+static int reference_score(const std::string& path, uint32_t name_pos, const std::string& q) {
+    int score = 0;
+    uint32_t pos = 0;
+    uint32_t prev = UINT32_MAX;
+    uint32_t len = (uint32_t)path.size();
+    for (size_t i = 0; i < q.size(); i++) {
+        while (pos < len && (char)tolower((unsigned char)path[pos]) != q[i]) {
+            pos++;
+        }
+        if (pos == len) {
+            return REFERENCE_NO_MATCH;
+        }
+        score += 1;
+        if (prev != UINT32_MAX && pos == prev + 1) score += 4;
+        char before = pos > 0 ? path[pos - 1] : '\0';
+        if (pos == 0 || before == '.' || before == '[' || before == '_' ||
+            (before >= 'a' && before <= 'z' && path[pos] >= 'A' && path[pos] <= 'Z')) {
+            score += 3;
+        }
+        if (pos >= name_pos) score += 2;
+        prev = pos;
+        pos++;
+    }
+    return score * 16 - (int)len;
+}
+
+/* search holds exactly the leaves the reference matches, and ranks them by the reference's scores */
+static void check_search(const std::vector<ExpandedLeaf>& leaves, const FieldSearch& search, const char* query) {
+    std::string q;
+    for (const char* c = query; *c; c++) {
+        if (*c != ' ') {
+            q.push_back((char)tolower((unsigned char)*c));
+        }
+    }
+    std::map<std::pair<uint32_t, uint32_t>, int> expected;
+    std::vector<int> scores;
+    for (const ExpandedLeaf& leaf : leaves) {
+        int score = reference_score(leaf.path, leaf.name_pos, q);
+        if (score != REFERENCE_NO_MATCH) {
+            expected[{leaf.hit.entry, leaf.hit.element}] = score;
+            scores.push_back(score);
+        }
+    }
+
+    bool in_order = true;
+    bool all_expected = true;
+    size_t listed = 0;
+    for (size_t r = 0; r < search.matches.size(); r++) {
+        const FieldSearchRun& run = search.matches[r];
+        if (r > 0) {
+            const FieldSearchRun& last = search.matches[r - 1];
+            in_order = in_order && (last.entry < run.entry || last.first + last.count <= run.first);
+        }
+        for (uint32_t k = 0; k < run.count; k++) {
+            all_expected = all_expected && expected.count({run.entry, run.first + k}) == 1;
+        }
+        listed += run.count;
+    }
+    CHECK(in_order && all_expected);
+    CHECK(listed == expected.size() && search.match_count == expected.size());
+
+    std::sort(scores.begin(), scores.end(), std::greater<int>());
+    size_t shown = std::min(scores.size(), (size_t)FIELD_SEARCH_MAX_RANKED);
+    CHECK(search.ranked.size() == shown);
+    bool ranked_ok = search.ranked.size() == shown;
+    for (size_t k = 0; ranked_ok && k < shown; k++) {
+        auto it = expected.find({search.ranked[k].entry, search.ranked[k].element});
+        ranked_ok = it != expected.end() && it->second == scores[k];
+    }
+    CHECK(ranked_ok);
+    if (!ranked_ok || listed != expected.size()) {
+        fprintf(stderr, "  query \"%s\"\n", query);
+    }
+}
+
+static void test_field_search() {
+    std::string path = temp_path("dartt_unit_tests_search.json");
+    Serial serial;
+    dartt_sync_t ds;
+    init_ds(&ds);
+    Plotter plot;
+    DarttConfig config;
+    CHECK(write_file_atomic(path.c_str(), search_json, strlen(search_json)));
+    CHECK(load_dartt_config(path.c_str(), config, plot, serial, ds));
+    std::filesystem::remove(path);
+    FieldSearchIndex& index = config.search_index;
+
+    /* the arrays stay patterns: gain, motors[*][*].kp, motors[*][*].pos[*], samples[*][*] */
+    CHECK(index.entries.size() == 4);
+    std::vector<ExpandedLeaf> leaves = expand_search_index(index);
+    CHECK(leaves.size() == 1 + 36 + 36 * 15 + 100);
+    CHECK(leaves.size() > FIELD_SEARCH_MAX_RANKED);
+
+    /* each query from scratch, plain and reaching into the indices */
+    for (const char* query : {"kp", "pos", "p", "s", "MoTo", "1", "10", "14", "0.", "1]", "[3]", "][2", "s12",
+                              "m11p", "motors[1", "motors[11][2].pos[14]", "samples3", "s2][24", "gain", "xyz", "9"}) {
+        FieldSearch search;
+        field_search_update(index, query, search);
+        check_search(leaves, search, query);
+    }
+
+    /* typed a character at a time, narrowing from a plain query to one with digits, then back out */
+    FieldSearch typed;
+    for (const char* query : {"m", "mo", "mot", "motp", "motpo", "motpos", "motpos1", "motpos13", "motpos1",
+                              "motpos", "p", "p1", "p1.", "p1.k", "s", "sa", "sa2", "sa24", "sa2", "sa"}) {
+        CHECK(field_search_update(index, query, typed));
+        check_search(leaves, typed, query);
+    }
+    CHECK(!field_search_update(index, "s a", typed));      /* the same query again */
+
+    /* exact lookup finds every leaf by its written-out path, and its offset agrees with the tree */
+    bool all_found = true;
+    for (const ExpandedLeaf& leaf : leaves) {
+        FieldSearchHit hit = {UINT32_MAX, UINT32_MAX};
+        all_found = all_found && field_search_find_path(index, leaf.path, &hit) &&
+                    hit.entry == leaf.hit.entry && hit.element == leaf.hit.element;
+    }
+    CHECK(all_found);
+    FieldSearchHit hit;
+    CHECK(field_search_find_path(index, "motors[11][2].pos[14]", &hit));
+    CHECK(field_search_offset(index, hit) == 4 + 35 * 36 + 4 + 14 * 2);
+    DarttField* leaf = config_field(config, field_id_by_path(config, "motors[11][2].pos[14]", true));
+    CHECK(leaf && leaf->byte_offset == field_search_offset(index, hit) && leaf->name == field_search_leaf_name(index, hit));
+    CHECK(field_search_find_path(index, "samples[0][0]", &hit) && field_search_offset(index, hit) == 1300);
+
+    /* out of range, leading zeros and malformed indices */
+    for (const char* bad : {"motors[12][0].kp", "motors[0][3].kp", "motors[0][0].pos[15]", "samples[4][0]",
+                            "samples[0][25]", "samples[4294967296][0]", "samples[99999999999999999999][0]",
+                            "motors[01][0].kp", "motors[0][00].kp", "motors[0][0].pos[007]", "samples[00][0]",
+                            "samples[][0]", "samples[-1][0]", "samples[*][0]", "samples[a][0]", "samples[ 1][0]",
+                            "samples[0]", "samples[0][0][0]", "samples", "motors[0][0]", "motors[0][0].kp.x",
+                            "gain[0]", "Gain", ""}) {
+        CHECK(!field_search_find_path(index, bad, &hit));
+    }
+}
+
+int main() {
+    test_json_scanner();
+    test_json_config_tree();
+    test_config_round_trip();
+    test_dcfg_corrupt();
+    test_field_search();
+    test_cobs_decode();
+    test_cobs_scanner_overflow();
+    test_diff_chunks_tail();
+    test_child_paths();
+    test_restore_regions();
+    test_bitfields();
+    test_write_retry();
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    } else {
+        printf("all checks passed\n");
+    }
+    return failures;
+}